@@ -0,0 +1,1079 @@
+/*
+Micro-benchmarks for the engine's hot paths. Runs without a window, rendering goes through the null OpenGL
+ implementation in nullGL.c and sound is mixed into a memory buffer using SDL's dummy audio driver.
+ Results are written out as JSON, to stdout unless a file is given with -o.
+
+ usage: xturosBenchmark [-o output.json] [-f font.ttf] [-t minSecondsPerBenchmark]
+*/
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../src/System/memory.h"
+#include "../src/System/platformLog.h"
+#include "../src/System/random.h"
+#include "../src/Utils/stretchyBuffer.h"
+#include "../src/collisionDetection.h"
+#include "../src/Graphics/camera.h"
+#include "../src/Graphics/images.h"
+#include "../src/Graphics/sprites.h"
+#include "../src/Graphics/tilemap.h"
+#include "../src/Graphics/layerCache.h"
+#include "../src/Graphics/glState.h"
+#include "../src/Graphics/scissor.h"
+#include "../src/Graphics/triRendering.h"
+#include "../src/Graphics/debugRendering.h"
+#include "../src/sound.h"
+#include "../src/UI/text.h"
+#include "../src/Game/levelData.h"
+
+// levelData.c pulls the floor images out of the game resources, nothing is drawn here so they can be anything
+int forestFloorImg = -1;
+int caveFloorImg = -1;
+
+// not exposed by sound.h, the benchmark drives the mixer directly instead of letting the audio thread do it
+void mixerCallback( void* userdata, Uint8* stream, int len );
+
+#define RENDER_WIDTH 800
+#define RENDER_HEIGHT 600
+
+#define BENCHMARK_SEED 0x5EED1234
+
+#define MIN_ITERATIONS 5
+#define DEFAULT_MIN_SECONDS 0.25
+
+#define MAX_RESULTS 64
+
+typedef void (*BenchmarkFunc)( int param );
+
+typedef struct {
+	const char* name;
+	int param;
+	int iterations;
+	double meanNS;
+	double minNS;
+	double maxNS;
+} BenchmarkResult;
+
+static BenchmarkResult results[MAX_RESULTS];
+static int lastResult = -1;
+
+static const char* skipped[MAX_RESULTS];
+static int lastSkipped = -1;
+
+static double minSeconds = DEFAULT_MIN_SECONDS;
+static double nsPerCount;
+
+static volatile uint32_t sink; // so the optimizer doesn't throw away work we're timing
+
+static void runBenchmark( const char* name, int param, BenchmarkFunc setup, BenchmarkFunc run, BenchmarkFunc cleanUp )
+{
+	if( lastResult >= ( MAX_RESULTS - 1 ) ) {
+		llog( LOG_ERROR, "Too many benchmark results, skipping %s.", name );
+		return;
+	}
+
+	rand_Seed( NULL, BENCHMARK_SEED );
+	if( setup != NULL ) setup( param );
+
+	// warm up
+	run( param );
+
+	Uint64 totalCount = 0;
+	Uint64 minCount = UINT64_MAX;
+	Uint64 maxCount = 0;
+	int iterations = 0;
+	Uint64 targetCount = (Uint64)( minSeconds * (double)SDL_GetPerformanceFrequency( ) );
+	while( ( iterations < MIN_ITERATIONS ) || ( totalCount < targetCount ) ) {
+		Uint64 start = SDL_GetPerformanceCounter( );
+		run( param );
+		Uint64 elapsed = SDL_GetPerformanceCounter( ) - start;
+
+		totalCount += elapsed;
+		if( elapsed < minCount ) minCount = elapsed;
+		if( elapsed > maxCount ) maxCount = elapsed;
+		++iterations;
+	}
+
+	if( cleanUp != NULL ) cleanUp( param );
+
+	BenchmarkResult* result = &( results[++lastResult] );
+	result->name = name;
+	result->param = param;
+	result->iterations = iterations;
+	result->meanNS = ( (double)totalCount / (double)iterations ) * nsPerCount;
+	result->minNS = (double)minCount * nsPerCount;
+	result->maxNS = (double)maxCount * nsPerCount;
+
+	llog( LOG_INFO, "%s(%i): %i iterations, mean %.0fns", name, param, iterations, result->meanNS );
+}
+
+static void skipBenchmark( const char* name, const char* reason )
+{
+	llog( LOG_WARN, "Skipping %s: %s", name, reason );
+	if( lastSkipped < ( MAX_RESULTS - 1 ) ) {
+		skipped[++lastSkipped] = name;
+	}
+}
+
+//***** Memory
+#define MAX_LIVE_ALLOCATIONS 4096
+static void* liveAllocations[MAX_LIVE_ALLOCATIONS];
+
+// allocate a bunch of differently sized blocks and release them in a shuffled order
+static void memAllocRelease_Run( int count )
+{
+	for( int i = 0; i < count; ++i ) {
+		liveAllocations[i] = mem_Allocate( (size_t)rand_GetRangeS32( NULL, 16, 1024 ) );
+	}
+
+	for( int i = count - 1; i > 0; --i ) {
+		int swapIdx = rand_GetRangeS32( NULL, 0, i );
+		void* temp = liveAllocations[i];
+		liveAllocations[i] = liveAllocations[swapIdx];
+		liveAllocations[swapIdx] = temp;
+	}
+
+	for( int i = 0; i < count; ++i ) {
+		mem_Release( liveAllocations[i] );
+	}
+}
+
+// the pattern the stretchy buffers use, grow by pushing and then release it all
+static void memStretchyBuffer_Run( int count )
+{
+	int* sbValues = NULL;
+	for( int i = 0; i < count; ++i ) {
+		sb_Push( sbValues, i );
+	}
+	sink += (uint32_t)sb_Count( sbValues );
+	sb_Release( sbValues );
+}
+
+//***** Collision
+#define COLLISION_WORLD_SIZE 2000.0f
+static Collider* sbColliders = NULL;
+static int collisionCount;
+
+static void collisionResponse( int firstColliderIdx, int secondColliderIdx, Vector2 separation )
+{
+	++collisionCount;
+}
+
+static void collision_Setup( int count )
+{
+	sb_Add( sbColliders, count );
+	for( int i = 0; i < count; ++i ) {
+		Vector2 center;
+		center.x = rand_GetRangeFloat( NULL, 0.0f, COLLISION_WORLD_SIZE );
+		center.y = rand_GetRangeFloat( NULL, 0.0f, COLLISION_WORLD_SIZE );
+		if( rand_Choice( NULL ) ) {
+			sbColliders[i].aabb.type = CT_AABB;
+			sbColliders[i].aabb.center = center;
+			sbColliders[i].aabb.halfDim.x = rand_GetRangeFloat( NULL, 2.0f, 16.0f );
+			sbColliders[i].aabb.halfDim.y = rand_GetRangeFloat( NULL, 2.0f, 16.0f );
+		} else {
+			sbColliders[i].circle.type = CT_CIRCLE;
+			sbColliders[i].circle.center = center;
+			sbColliders[i].circle.radius = rand_GetRangeFloat( NULL, 2.0f, 16.0f );
+		}
+	}
+}
+
+static void collision_Run( int count )
+{
+	ColliderCollection collection;
+	collection.firstCollider = sbColliders;
+	collection.stride = sizeof( sbColliders[0] );
+	collection.count = count;
+
+	collisionCount = 0;
+	collision_DetectAllInternal( collection, collisionResponse );
+	sink += (uint32_t)collisionCount;
+}
+
+static void collision_CleanUp( int count )
+{
+	sb_Release( sbColliders );
+}
+
+//***** Triangle rendering
+// every other triangle is transparent
+static void addTriangles( int count )
+{
+	triRenderer_Clear( );
+	for( int i = 0; i < count; ++i ) {
+		Vector2 pos0, pos1, pos2;
+		pos0.x = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_WIDTH );
+		pos0.y = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_HEIGHT );
+		pos1.x = pos0.x + 16.0f;
+		pos1.y = pos0.y;
+		pos2.x = pos0.x;
+		pos2.y = pos0.y + 16.0f;
+
+		triRenderer_Add( pos0, pos1, pos2, VEC2_ZERO, VEC2_ZERO, VEC2_ZERO,
+			(ShaderType)rand_GetRangeS32( NULL, 0, NUM_SHADERS - 1 ), (GLuint)rand_GetRangeS32( NULL, 1, 16 ), CLR_WHITE,
+			0, 1, (int8_t)rand_GetRangeS32( NULL, -16, 16 ), ( i % 2 ) );
+	}
+}
+
+static void triRenderer_Run( int count )
+{
+	addTriangles( count );
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+}
+
+// every other sprite is transparent
+static void triRenderer_SpritesRun( int count )
+{
+	triRenderer_Clear( );
+	for( int i = 0; i < count; ++i ) {
+		SpriteState start;
+		start.pos.x = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_WIDTH );
+		start.pos.y = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_HEIGHT );
+		start.scaleSize.x = 16.0f;
+		start.scaleSize.y = 16.0f;
+		start.color = CLR_WHITE;
+		start.rotation = rand_GetRangeFloat( NULL, 0.0f, 6.0f );
+
+		SpriteState end = start;
+		end.pos.x += 4.0f;
+
+		triRenderer_AddSprite( &start, &end, VEC2_ZERO, VEC2_ZERO, VEC2_ONE,
+			(ShaderType)rand_GetRangeS32( NULL, 0, NUM_SHADERS - 1 ), (GLuint)rand_GetRangeS32( NULL, 1, 16 ),
+			-1, 0, 1, (int8_t)rand_GetRangeS32( NULL, -16, 16 ), ( i % 2 ) );
+	}
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+}
+
+// just the cost of submitting, the same grid of quads is added either a triangle at a time or as meshes
+#define SUBMIT_MESH_QUADS 32
+
+static Vector2 submitPositions[SUBMIT_MESH_QUADS * 4];
+static Vector2 submitUVs[SUBMIT_MESH_QUADS * 4];
+static uint16_t submitIndices[SUBMIT_MESH_QUADS * 6];
+
+static void triRenderer_SubmitSetup( int count )
+{
+	for( int q = 0; q < SUBMIT_MESH_QUADS; ++q ) {
+		for( int v = 0; v < 4; ++v ) {
+			submitPositions[( q * 4 ) + v].x = ( 16.0f * (float)q ) + ( ( v & 1 ) ? 16.0f : 0.0f );
+			submitPositions[( q * 4 ) + v].y = ( v & 2 ) ? 16.0f : 0.0f;
+			submitUVs[( q * 4 ) + v].x = ( v & 1 ) ? 1.0f : 0.0f;
+			submitUVs[( q * 4 ) + v].y = ( v & 2 ) ? 1.0f : 0.0f;
+		}
+
+		uint16_t base = (uint16_t)( q * 4 );
+		uint16_t* indices = &( submitIndices[q * 6] );
+		indices[0] = base; indices[1] = base + 1; indices[2] = base + 2;
+		indices[3] = base + 1; indices[4] = base + 3; indices[5] = base + 2;
+	}
+}
+
+static void triRenderer_SubmitPerTriangle( int count )
+{
+	triRenderer_Clear( );
+	for( int i = 0; i < count; ++i ) {
+		int idx = i % ( SUBMIT_MESH_QUADS * 2 );
+		uint16_t* indices = &( submitIndices[idx * 3] );
+		triRenderer_Add( submitPositions[indices[0]], submitPositions[indices[1]], submitPositions[indices[2]],
+			submitUVs[indices[0]], submitUVs[indices[1]], submitUVs[indices[2]],
+			ST_DEFAULT, 1, CLR_WHITE, 0, 1, 0, 0 );
+	}
+}
+
+static void triRenderer_SubmitMesh( int count )
+{
+	TriMeshState state;
+	state.shader = ST_DEFAULT;
+	state.texture = 1;
+	state.textureLayer = -1;
+	state.color = CLR_WHITE;
+	state.clippingID = 0;
+	state.camFlags = 1;
+	state.depth = 0;
+	state.transparent = 0;
+
+	triRenderer_Clear( );
+	for( int i = 0; i < count; i += SUBMIT_MESH_QUADS * 2 ) {
+		triRenderer_AddMesh( submitPositions, NULL, submitUVs, NULL, SUBMIT_MESH_QUADS * 4,
+			submitIndices, SUBMIT_MESH_QUADS * 6, &state );
+	}
+}
+
+// just the cost of adding sprites, the same sprites are added one at a time or all at once from separate arrays
+static Vector2* submitStartPos = NULL;
+static Vector2* submitEndPos = NULL;
+static Vector2* submitScale = NULL;
+static Vector2* submitOffset = NULL;
+static float* submitStartRot = NULL;
+static float* submitEndRot = NULL;
+static Color* submitColor = NULL;
+static Vector2* submitUVMin = NULL;
+static Vector2* submitUVMax = NULL;
+static GLuint* submitTexture = NULL;
+static int* submitLayer = NULL;
+static int* submitClipping = NULL;
+static uint32_t* submitCamFlags = NULL;
+static int8_t* submitDepth = NULL;
+static uint8_t* submitTransparent = NULL;
+
+static void triRenderer_SpriteSubmitSetup( int count )
+{
+	submitStartPos = mem_Allocate( sizeof( Vector2 ) * count );
+	submitEndPos = mem_Allocate( sizeof( Vector2 ) * count );
+	submitScale = mem_Allocate( sizeof( Vector2 ) * count );
+	submitOffset = mem_Allocate( sizeof( Vector2 ) * count );
+	submitStartRot = mem_Allocate( sizeof( float ) * count );
+	submitEndRot = mem_Allocate( sizeof( float ) * count );
+	submitColor = mem_Allocate( sizeof( Color ) * count );
+	submitUVMin = mem_Allocate( sizeof( Vector2 ) * count );
+	submitUVMax = mem_Allocate( sizeof( Vector2 ) * count );
+	submitTexture = mem_Allocate( sizeof( GLuint ) * count );
+	submitLayer = mem_Allocate( sizeof( int ) * count );
+	submitClipping = mem_Allocate( sizeof( int ) * count );
+	submitCamFlags = mem_Allocate( sizeof( uint32_t ) * count );
+	submitDepth = mem_Allocate( sizeof( int8_t ) * count );
+	submitTransparent = mem_Allocate( sizeof( uint8_t ) * count );
+
+	for( int i = 0; i < count; ++i ) {
+		submitStartPos[i].x = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_WIDTH );
+		submitStartPos[i].y = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_HEIGHT );
+		submitEndPos[i].x = submitStartPos[i].x + 4.0f;
+		submitEndPos[i].y = submitStartPos[i].y;
+		submitScale[i].x = 16.0f;
+		submitScale[i].y = 16.0f;
+		submitOffset[i] = VEC2_ZERO;
+		submitStartRot[i] = rand_GetRangeFloat( NULL, 0.0f, 6.0f );
+		submitEndRot[i] = rand_GetRangeFloat( NULL, 0.0f, 6.0f );
+		submitColor[i] = CLR_WHITE;
+		submitUVMin[i] = VEC2_ZERO;
+		submitUVMax[i] = VEC2_ONE;
+		submitTexture[i] = (GLuint)rand_GetRangeS32( NULL, 1, 16 );
+		submitLayer[i] = -1;
+		submitClipping[i] = 0;
+		submitCamFlags[i] = 1;
+		submitDepth[i] = (int8_t)rand_GetRangeS32( NULL, -16, 16 );
+		submitTransparent[i] = (uint8_t)( i % 2 );
+	}
+}
+
+static void triRenderer_SpriteSubmitCleanUp( int count )
+{
+	mem_Release( submitStartPos );
+	mem_Release( submitEndPos );
+	mem_Release( submitScale );
+	mem_Release( submitOffset );
+	mem_Release( submitStartRot );
+	mem_Release( submitEndRot );
+	mem_Release( submitColor );
+	mem_Release( submitUVMin );
+	mem_Release( submitUVMax );
+	mem_Release( submitTexture );
+	mem_Release( submitLayer );
+	mem_Release( submitClipping );
+	mem_Release( submitCamFlags );
+	mem_Release( submitDepth );
+	mem_Release( submitTransparent );
+}
+
+static void triRenderer_SubmitSpriteEach( int count )
+{
+	triRenderer_Clear( );
+	for( int i = 0; i < count; ++i ) {
+		SpriteState start;
+		start.pos = submitStartPos[i];
+		start.scaleSize = submitScale[i];
+		start.color = submitColor[i];
+		start.rotation = submitStartRot[i];
+
+		SpriteState end;
+		end.pos = submitEndPos[i];
+		end.scaleSize = submitScale[i];
+		end.color = submitColor[i];
+		end.rotation = submitEndRot[i];
+
+		triRenderer_AddSprite( &start, &end, submitOffset[i], submitUVMin[i], submitUVMax[i], ST_DEFAULT,
+			submitTexture[i], submitLayer[i], submitClipping[i], submitCamFlags[i], submitDepth[i], submitTransparent[i] );
+	}
+}
+
+static void triRenderer_SubmitSprites( int count )
+{
+	SpriteArrays sprites;
+	sprites.startPos = submitStartPos;
+	sprites.endPos = submitEndPos;
+	sprites.startScale = submitScale;
+	sprites.endScale = submitScale;
+	sprites.offset = submitOffset;
+	sprites.startRot = submitStartRot;
+	sprites.endRot = submitEndRot;
+	sprites.startColor = submitColor;
+	sprites.endColor = submitColor;
+	sprites.uvMin = submitUVMin;
+	sprites.uvMax = submitUVMax;
+	sprites.texture = submitTexture;
+	sprites.textureLayer = submitLayer;
+	sprites.clippingID = submitClipping;
+	sprites.camFlags = submitCamFlags;
+	sprites.depth = submitDepth;
+	sprites.transparent = submitTransparent;
+
+	triRenderer_Clear( );
+	triRenderer_AddSprites( &sprites, count );
+}
+
+// the frames between ticks just redraw what was already uploaded
+static void triRenderer_RedrawSetup( int count )
+{
+	addTriangles( count );
+	triRenderer_Upload( );
+}
+
+static void triRenderer_Redraw( int count )
+{
+	triRenderer_Render( 0.5f );
+}
+
+//***** Triangle sorting
+// the qsort the renderer used to do is mirrored so it can be compared against the radix sort the renderer does now,
+//  which goes through the renderer itself, both sort the same mix of triangles as the triangle rendering benchmark
+typedef struct {
+	float zPos;
+	GLuint texture;
+	ShaderType shaderType;
+	int scissorID;
+} SortTriangle;
+
+static SortTriangle* sbSourceTris = NULL;
+static SortTriangle* sbSortTris = NULL;
+
+static int sortByRenderState( const void* p1, const void* p2 )
+{
+	SortTriangle* tri1 = (SortTriangle*)p1;
+	SortTriangle* tri2 = (SortTriangle*)p2;
+
+	int stDiff = ( (int)tri1->shaderType - (int)tri2->shaderType );
+	if( stDiff != 0 ) {
+		return stDiff;
+	}
+
+	if( tri1->texture < tri2->texture ) {
+		return -1;
+	} else if( tri1->texture > tri2->texture ) {
+		return 1;
+	}
+
+	return ( tri1->scissorID - tri2->scissorID );
+}
+
+static int sortByDepth( const void* p1, const void* p2 )
+{
+	SortTriangle* tri1 = (SortTriangle*)p1;
+	SortTriangle* tri2 = (SortTriangle*)p2;
+	return ( ( ( tri1->zPos ) - ( tri2->zPos ) ) > 0.0f ) ? 1 : -1;
+}
+
+// every other triangle is transparent
+static void triSortQSort_Setup( int count )
+{
+	sb_Add( sbSourceTris, count );
+	sb_Add( sbSortTris, count );
+
+	float zOffset = 1.0f / (float)( count + 1 );
+	for( int i = 0; i < count; ++i ) {
+		sbSourceTris[i].zPos = (float)rand_GetRangeS32( NULL, -16, 16 ) + ( zOffset * (float)i );
+		sbSourceTris[i].texture = (GLuint)rand_GetRangeS32( NULL, 1, 16 );
+		sbSourceTris[i].shaderType = (ShaderType)rand_GetRangeS32( NULL, 0, NUM_SHADERS - 1 );
+		sbSourceTris[i].scissorID = 0;
+	}
+}
+
+static void triSortQSort_Run( int count )
+{
+	int solidCount = ( count + 1 ) / 2;
+	memcpy( sbSortTris, sbSourceTris, sizeof( sbSortTris[0] ) * count );
+	qsort( sbSortTris, solidCount, sizeof( sbSortTris[0] ), sortByRenderState );
+	qsort( sbSortTris + solidCount, count - solidCount, sizeof( sbSortTris[0] ), sortByDepth );
+	sink += sbSortTris[0].texture;
+}
+
+static void triSortQSort_CleanUp( int count )
+{
+	sb_Release( sbSourceTris );
+	sb_Release( sbSortTris );
+}
+
+static void triSortRadix_Setup( int count )
+{
+	addTriangles( count );
+}
+
+// makes the keys and sorts them, same as an upload does
+static void triSortRadix_Run( int count )
+{
+	triRenderer_SortAdded( );
+}
+
+static void triSortRadix_CleanUp( int count )
+{
+	triRenderer_Clear( );
+}
+
+//***** Mixing
+#define MIX_BUFFER_FRAMES 1024
+#define MIX_SAMPLE_LENGTH 44100
+static Uint8 mixBuffer[MIX_BUFFER_FRAMES * 2 * sizeof( float )];
+static int mixSample = -1;
+static EntityID mixVoices[64];
+
+static void mixer_Setup( int count )
+{
+	float* sbNoise = NULL;
+	sb_Add( sbNoise, MIX_SAMPLE_LENGTH );
+	for( int i = 0; i < MIX_SAMPLE_LENGTH; ++i ) {
+		sbNoise[i] = rand_GetRangeFloat( NULL, -1.0f, 1.0f );
+	}
+	mixSample = snd_CreateSample( sbNoise, MIX_SAMPLE_LENGTH, 1, true );
+	sb_Release( sbNoise );
+
+	for( int i = 0; i < count; ++i ) {
+		mixVoices[i] = snd_Play( mixSample, 0.5f, 1.0f, rand_GetRangeFloat( NULL, -1.0f, 1.0f ), 0 );
+	}
+}
+
+// the device was opened asking for 16-bit stereo, the dummy driver gives us what we ask for
+static void mixer_Run( int count )
+{
+	mixerCallback( NULL, mixBuffer, MIX_BUFFER_FRAMES * 2 * sizeof( Sint16 ) );
+}
+
+static void mixer_CleanUp( int count )
+{
+	for( int i = 0; i < count; ++i ) {
+		snd_Stop( mixVoices[i] );
+	}
+	snd_UnloadSample( mixSample );
+	mixSample = -1;
+}
+
+//***** Images
+// queues up the images once and times culling them and handing the rest to the triangle renderer, the spread version
+//  scatters them over four times the screen so most of them are culled
+static int benchmarkImage = -1;
+
+static void queueImages( int count, float spread )
+{
+	if( benchmarkImage < 0 ) {
+		uint8_t pixels[4 * 4 * 4];
+		memset( pixels, 0xFF, sizeof( pixels ) );
+		Vector2 uvMin = VEC2_ZERO;
+		Vector2 uvMax = VEC2_ONE;
+		img_SplitRGBABitmap( pixels, 4, 4, 1, ST_DEFAULT, &uvMin, &uvMax, &benchmarkImage );
+	}
+
+	img_ClearDrawInstructions( );
+	for( int i = 0; i < count; ++i ) {
+		Vector2 pos;
+		pos.x = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_WIDTH * spread );
+		pos.y = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_HEIGHT * spread );
+		float rot = rand_GetRangeFloat( NULL, 0.0f, 6.0f );
+		img_Draw_c_r( benchmarkImage, 1, pos, pos, CLR_WHITE, CLR_WHITE, rot, rot + 0.1f, (int8_t)rand_GetRangeS32( NULL, -16, 16 ) );
+	}
+}
+
+static void imgRender_Setup( int count )
+{
+	queueImages( count, 1.0f );
+	cam_PrepareRenderCulling( 1.0f );
+}
+
+static void imgRender_SpreadSetup( int count )
+{
+	queueImages( count, 4.0f );
+	cam_PrepareRenderCulling( 1.0f );
+}
+
+static void imgRender_Run( int count )
+{
+	triRenderer_Clear( );
+	img_Render( );
+}
+
+static void imgRender_CleanUp( int count )
+{
+	img_ClearDrawInstructions( );
+	triRenderer_Clear( );
+}
+
+//***** Mostly static scene
+// a full tick of a scene where only every tenth sprite moves, done once by drawing every image again and once with
+//  retained sprites that only send the ones that moved
+#define STATIC_SCENE_MOVING_EVERY 10
+
+static Vector2* sbScenePositions = NULL;
+static float* sbSceneRotations = NULL;
+static int* sbSceneSprites = NULL;
+static int sceneTick = 0;
+
+static void staticScene_Setup( int count )
+{
+	queueImages( 0, 1.0f );
+	sb_Clear( sbScenePositions );
+	sb_Clear( sbSceneRotations );
+	for( int i = 0; i < count; ++i ) {
+		Vector2 pos;
+		pos.x = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_WIDTH );
+		pos.y = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_HEIGHT );
+		sb_Push( sbScenePositions, pos );
+		sb_Push( sbSceneRotations, rand_GetRangeFloat( NULL, 0.0f, 6.0f ) );
+	}
+	sceneTick = 0;
+	cam_PrepareRenderCulling( 1.0f );
+}
+
+static void retainedScene_Setup( int count )
+{
+	staticScene_Setup( count );
+
+	spr_Init( );
+	sb_Clear( sbSceneSprites );
+	for( int i = 0; i < count; ++i ) {
+		sb_Push( sbSceneSprites, spr_Create( benchmarkImage, 1, sbScenePositions[i], VEC2_ONE, sbSceneRotations[i], CLR_WHITE, 0 ) );
+	}
+
+	// get everything on to the GPU, after this only the changes are sent
+	spr_Draw( );
+	triRenderer_Clear( );
+	spr_Render( );
+	triRenderer_Upload( );
+}
+
+static Vector2 moveScenePosition( int idx )
+{
+	Vector2 pos = sbScenePositions[idx];
+	pos.x += ( sceneTick & 1 ) ? 1.0f : -1.0f;
+	sbScenePositions[idx] = pos;
+	return pos;
+}
+
+static void immediateScene_Run( int count )
+{
+	++sceneTick;
+	img_ClearDrawInstructions( );
+	for( int i = 0; i < count; ++i ) {
+		Vector2 startPos = sbScenePositions[i];
+		Vector2 endPos = ( ( i % STATIC_SCENE_MOVING_EVERY ) == 0 ) ? moveScenePosition( i ) : startPos;
+		img_Draw_r( benchmarkImage, 1, startPos, endPos, sbSceneRotations[i], sbSceneRotations[i], 0 );
+	}
+
+	triRenderer_Clear( );
+	img_Render( );
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+}
+
+static void retainedScene_Run( int count )
+{
+	++sceneTick;
+	for( int i = 0; i < count; i += STATIC_SCENE_MOVING_EVERY ) {
+		Vector2 pos = moveScenePosition( i );
+		spr_Update_p( sbSceneSprites[i], &pos );
+	}
+	spr_Draw( );
+
+	triRenderer_Clear( );
+	spr_Render( );
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+}
+
+static void staticScene_CleanUp( int count )
+{
+	img_ClearDrawInstructions( );
+	triRenderer_Clear( );
+}
+
+static void retainedScene_CleanUp( int count )
+{
+	for( size_t i = 0; i < sb_Count( sbSceneSprites ); ++i ) {
+		spr_Destroy( sbSceneSprites[i] );
+	}
+	sb_Clear( sbSceneSprites );
+
+	// empty out the groups in the triangle renderer
+	spr_Draw( );
+	spr_Render( );
+	triRenderer_Upload( );
+	staticScene_CleanUp( count );
+}
+
+//***** Tile maps
+// a square map count tiles across, times rebuilding every chunk, rebuilding the one chunk with a tile that changed,
+//  and redrawing when nothing changed, which only has to draw the chunks the camera can see, the immediate version
+//  draws every tile as its own image like the explore grid used to
+#define TILEMAP_TILE_SIZE 16.0f
+
+static int benchmarkTilemap = -1;
+static int* sbTilemapTiles = NULL;
+
+static void tilemap_Setup( int count )
+{
+	queueImages( 0, 1.0f );
+	cam_PrepareRenderCulling( 1.0f );
+
+	int atlas[] = { benchmarkImage, benchmarkImage, benchmarkImage, benchmarkImage };
+	benchmarkTilemap = tilemap_Create( count, count, atlas, 4, VEC2_ZERO, vec2( TILEMAP_TILE_SIZE, TILEMAP_TILE_SIZE ), 1, 0 );
+
+	sb_Clear( sbTilemapTiles );
+	for( int i = 0; i < ( count * count ); ++i ) {
+		sb_Push( sbTilemapTiles, rand_GetRangeS32( NULL, 0, 3 ) );
+	}
+	tilemap_SetTiles( benchmarkTilemap, sbTilemapTiles );
+	tilemap_SnapshotTiles( );
+
+	triRenderer_Clear( );
+	tilemap_Render( );
+	triRenderer_Upload( );
+	sceneTick = 0;
+}
+
+static void tilemapRebuild_Run( int count )
+{
+	// every tile changes so every chunk is rebuilt
+	for( int i = 0; i < ( count * count ); ++i ) {
+		sbTilemapTiles[i] ^= 1;
+	}
+	tilemap_SetTiles( benchmarkTilemap, sbTilemapTiles );
+	tilemap_SnapshotTiles( );
+
+	triRenderer_Clear( );
+	tilemap_Render( );
+	triRenderer_Upload( );
+}
+
+static void tilemapEdit_Run( int count )
+{
+	++sceneTick;
+	int column = sceneTick % count;
+	tilemap_SetTile( benchmarkTilemap, column, column, tilemap_GetTile( benchmarkTilemap, column, column ) ^ 1 );
+	tilemap_SnapshotTiles( );
+
+	triRenderer_Clear( );
+	tilemap_Render( );
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+}
+
+static void tilemapRedraw_Run( int count )
+{
+	triRenderer_Clear( );
+	tilemap_Render( );
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+}
+
+static void tilemapImmediate_Run( int count )
+{
+	img_ClearDrawInstructions( );
+	for( int row = 0; row < count; ++row ) {
+		for( int column = 0; column < count; ++column ) {
+			Vector2 pos = vec2( ( (float)column + 0.5f ) * TILEMAP_TILE_SIZE, ( (float)row + 0.5f ) * TILEMAP_TILE_SIZE );
+			img_Draw( benchmarkImage, 1, pos, pos, 0 );
+		}
+	}
+
+	triRenderer_Clear( );
+	img_Render( );
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+}
+
+static void tilemap_CleanUp( int count )
+{
+	tilemap_Destroy( benchmarkTilemap );
+	benchmarkTilemap = -1;
+
+	// releases the chunks in the triangle renderer
+	tilemap_SnapshotTiles( );
+	tilemap_Render( );
+	triRenderer_Upload( );
+	staticScene_CleanUp( count );
+}
+
+//***** Layer caching
+// a scene where nothing moves, drawn every tick with and without the camera being cached, and rendered again without
+//  a new upload like the render thread does when it runs ahead, nothing reaches a GPU here so this only shows what the
+//  cache costs and saves on the CPU, the fill rate it saves isn't measured
+static void layerScene_Setup( int count )
+{
+	queueImages( 0, 1.0f );
+	glViewport( 0, 0, RENDER_WIDTH, RENDER_HEIGHT );
+	sb_Clear( sbScenePositions );
+	sb_Clear( sbSceneRotations );
+	for( int i = 0; i < count; ++i ) {
+		Vector2 pos;
+		pos.x = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_WIDTH );
+		pos.y = rand_GetRangeFloat( NULL, 0.0f, (float)RENDER_HEIGHT );
+		sb_Push( sbScenePositions, pos );
+		sb_Push( sbSceneRotations, rand_GetRangeFloat( NULL, 0.0f, 6.0f ) );
+	}
+	cam_PrepareRenderCulling( 1.0f );
+}
+
+static void cachedLayerScene_Setup( int count )
+{
+	layerScene_Setup( count );
+	layerCache_Enable( 0 );
+}
+
+static void layerScene_Run( int count )
+{
+	img_ClearDrawInstructions( );
+	for( int i = 0; i < count; ++i ) {
+		img_Draw_r( benchmarkImage, 1, sbScenePositions[i], sbScenePositions[i], sbSceneRotations[i], sbSceneRotations[i], 0 );
+	}
+
+	triRenderer_Clear( );
+	img_Render( );
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+}
+
+static void layerSceneRenderOnly_Setup( int count )
+{
+	layerScene_Setup( count );
+	layerScene_Run( count );
+}
+
+static void cachedLayerSceneRenderOnly_Setup( int count )
+{
+	cachedLayerScene_Setup( count );
+	layerScene_Run( count );
+}
+
+static void layerSceneRenderOnly_Run( int count )
+{
+	triRenderer_Render( 1.0f );
+}
+
+static void layerScene_CleanUp( int count )
+{
+	// the layer is released the next time the camera is rendered
+	layerCache_Disable( 0 );
+	triRenderer_Render( 1.0f );
+	staticScene_CleanUp( count );
+}
+
+//***** Text
+static int benchmarkFont = -1;
+static const char* benchmarkString = "The quick brown fox jumps over the lazy dog. <R>0123456789<G>!?";
+
+static void text_Run( int count )
+{
+	img_ClearDrawInstructions( );
+	Vector2 pos = VEC2_ZERO;
+	for( int i = 0; i < count; ++i ) {
+		pos.y = (float)( i * 20 );
+		txt_DisplayString( benchmarkString, pos, CLR_WHITE, HORIZ_ALIGN_LEFT, VERT_ALIGN_TOP, benchmarkFont, 1, 0 );
+	}
+}
+
+//***** Path finding
+static void pathing_Setup( int count )
+{
+	levels_Setup( );
+}
+
+static void pathing_Run( int count )
+{
+	int dx, dy;
+	int startX = forest.entrance % LEVEL_WIDTH;
+	int startY = forest.entrance / LEVEL_WIDTH;
+	int endX = forest.exit % LEVEL_WIDTH;
+	int endY = forest.exit / LEVEL_WIDTH;
+	for( int i = 0; i < count; ++i ) {
+		levels_MoveToward( &forest, startX, startY, endX, endY, &dx, &dy );
+		sink += (uint32_t)( dx + dy );
+	}
+}
+
+//***** Random
+static void random_Run( int count )
+{
+	uint32_t total = 0;
+	for( int i = 0; i < count; ++i ) {
+		total += rand_GetU32( NULL );
+		total += (uint32_t)rand_GetRangeFloat( NULL, 0.0f, 100.0f );
+	}
+	sink += total;
+}
+
+static int writeResults( FILE* out )
+{
+	fprintf( out, "{\n" );
+	fprintf( out, "\t\"seed\": %u,\n", BENCHMARK_SEED );
+	fprintf( out, "\t\"minSecondsPerBenchmark\": %f,\n", minSeconds );
+	fprintf( out, "\t\"results\": [\n" );
+	for( int i = 0; i <= lastResult; ++i ) {
+		fprintf( out, "\t\t{ \"name\": \"%s\", \"param\": %i, \"iterations\": %i, \"meanNS\": %.1f, \"minNS\": %.1f, \"maxNS\": %.1f }%s\n",
+			results[i].name, results[i].param, results[i].iterations, results[i].meanNS, results[i].minNS, results[i].maxNS,
+			( i < lastResult ) ? "," : "" );
+	}
+	fprintf( out, "\t],\n" );
+	fprintf( out, "\t\"skipped\": [" );
+	for( int i = 0; i <= lastSkipped; ++i ) {
+		fprintf( out, " \"%s\"%s", skipped[i], ( i < lastSkipped ) ? "," : " " );
+	}
+	fprintf( out, "]\n" );
+	fprintf( out, "}\n" );
+
+	return ferror( out ) ? -1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+	const char* outFileName = NULL;
+	const char* fontFileName = NULL;
+
+	for( int i = 1; i < argc; ++i ) {
+		if( ( strcmp( argv[i], "-o" ) == 0 ) && ( ( i + 1 ) < argc ) ) {
+			outFileName = argv[++i];
+		} else if( ( strcmp( argv[i], "-f" ) == 0 ) && ( ( i + 1 ) < argc ) ) {
+			fontFileName = argv[++i];
+		} else if( ( strcmp( argv[i], "-t" ) == 0 ) && ( ( i + 1 ) < argc ) ) {
+			minSeconds = atof( argv[++i] );
+		} else {
+			fprintf( stderr, "usage: %s [-o output.json] [-f font.ttf] [-t minSecondsPerBenchmark]\n", argv[0] );
+			return 1;
+		}
+	}
+
+	mem_Init( 64 * 1024 * 1024 );
+
+	// we never want to actually output any sound
+	SDL_setenv( "SDL_AUDIODRIVER", "dummy", 0 );
+	if( SDL_Init( SDL_INIT_TIMER | SDL_INIT_AUDIO ) != 0 ) {
+		llog( LOG_ERROR, "Unable to initialize SDL: %s", SDL_GetError( ) );
+		return 1;
+	}
+	nsPerCount = 1000000000.0 / (double)SDL_GetPerformanceFrequency( );
+
+	cam_Init( );
+	cam_SetProjectionMatrices( RENDER_WIDTH, RENDER_HEIGHT );
+	cam_TurnOnFlags( 0, 1 );
+	cam_FinalizeStates( 0.0f );
+	cam_SnapshotStates( );
+	if( ( glState_Init( ) < 0 ) || ( img_Init( ) < 0 ) || ( debugRenderer_Init( ) < 0 ) || ( triRenderer_Init( RENDER_WIDTH, RENDER_HEIGHT ) < 0 ) ||
+		( scissor_Init( RENDER_WIDTH, RENDER_HEIGHT ) < 0 ) || ( tilemap_Init( ) < 0 ) || ( layerCache_Init( ) < 0 ) ) {
+		llog( LOG_ERROR, "Unable to initialize rendering." );
+		return 1;
+	}
+
+	runBenchmark( "mem_AllocateRelease", 64, NULL, memAllocRelease_Run, NULL );
+	runBenchmark( "mem_AllocateRelease", 1024, NULL, memAllocRelease_Run, NULL );
+	runBenchmark( "mem_AllocateRelease", MAX_LIVE_ALLOCATIONS, NULL, memAllocRelease_Run, NULL );
+	runBenchmark( "mem_StretchyBufferGrowth", 1024, NULL, memStretchyBuffer_Run, NULL );
+	runBenchmark( "mem_StretchyBufferGrowth", 65536, NULL, memStretchyBuffer_Run, NULL );
+
+	runBenchmark( "collision_DetectAllInternal", 100, collision_Setup, collision_Run, collision_CleanUp );
+	runBenchmark( "collision_DetectAllInternal", 1000, collision_Setup, collision_Run, collision_CleanUp );
+	runBenchmark( "collision_DetectAllInternal", 10000, collision_Setup, collision_Run, collision_CleanUp );
+
+	runBenchmark( "triRenderer_AddAndRender", 512, NULL, triRenderer_Run, NULL );
+	runBenchmark( "triRenderer_AddAndRender", 2048, NULL, triRenderer_Run, NULL );
+	runBenchmark( "triRenderer_AddAndRender", 4096, NULL, triRenderer_Run, NULL );
+	runBenchmark( "triRenderer_AddAndRender", 65536, NULL, triRenderer_Run, NULL );
+	runBenchmark( "triRenderer_SpritesAndRender", 4096, NULL, triRenderer_SpritesRun, NULL );
+	runBenchmark( "triRenderer_SpritesAndRender", 65536, NULL, triRenderer_SpritesRun, NULL );
+	runBenchmark( "triRenderer_SubmitPerTriangle", 65536, triRenderer_SubmitSetup, triRenderer_SubmitPerTriangle, NULL );
+	runBenchmark( "triRenderer_SubmitMesh", 65536, triRenderer_SubmitSetup, triRenderer_SubmitMesh, NULL );
+	runBenchmark( "triRenderer_SubmitSpriteEach", 1000, triRenderer_SpriteSubmitSetup, triRenderer_SubmitSpriteEach, triRenderer_SpriteSubmitCleanUp );
+	runBenchmark( "triRenderer_SubmitSprites", 1000, triRenderer_SpriteSubmitSetup, triRenderer_SubmitSprites, triRenderer_SpriteSubmitCleanUp );
+	runBenchmark( "triRenderer_SubmitSpriteEach", 10000, triRenderer_SpriteSubmitSetup, triRenderer_SubmitSpriteEach, triRenderer_SpriteSubmitCleanUp );
+	runBenchmark( "triRenderer_SubmitSprites", 10000, triRenderer_SpriteSubmitSetup, triRenderer_SubmitSprites, triRenderer_SpriteSubmitCleanUp );
+	runBenchmark( "triRenderer_SubmitSpriteEach", 100000, triRenderer_SpriteSubmitSetup, triRenderer_SubmitSpriteEach, triRenderer_SpriteSubmitCleanUp );
+	runBenchmark( "triRenderer_SubmitSprites", 100000, triRenderer_SpriteSubmitSetup, triRenderer_SubmitSprites, triRenderer_SpriteSubmitCleanUp );
+	runBenchmark( "triRenderer_Redraw", 4096, triRenderer_RedrawSetup, triRenderer_Redraw, NULL );
+	runBenchmark( "triRenderer_Redraw", 65536, triRenderer_RedrawSetup, triRenderer_Redraw, NULL );
+
+	runBenchmark( "img_Render", 1000, imgRender_Setup, imgRender_Run, imgRender_CleanUp );
+	runBenchmark( "img_Render", 10000, imgRender_Setup, imgRender_Run, imgRender_CleanUp );
+	runBenchmark( "img_Render", 100000, imgRender_Setup, imgRender_Run, imgRender_CleanUp );
+	runBenchmark( "img_RenderSpread", 10000, imgRender_SpreadSetup, imgRender_Run, imgRender_CleanUp );
+	runBenchmark( "img_RenderSpread", 100000, imgRender_SpreadSetup, imgRender_Run, imgRender_CleanUp );
+
+	runBenchmark( "scene_StaticImmediate", 10000, staticScene_Setup, immediateScene_Run, staticScene_CleanUp );
+	runBenchmark( "scene_StaticRetained", 10000, retainedScene_Setup, retainedScene_Run, retainedScene_CleanUp );
+	runBenchmark( "scene_StaticImmediate", 100000, staticScene_Setup, immediateScene_Run, staticScene_CleanUp );
+	runBenchmark( "scene_StaticRetained", 100000, retainedScene_Setup, retainedScene_Run, retainedScene_CleanUp );
+
+	runBenchmark( "tilemap_Immediate", 128, tilemap_Setup, tilemapImmediate_Run, tilemap_CleanUp );
+	runBenchmark( "tilemap_Redraw", 128, tilemap_Setup, tilemapRedraw_Run, tilemap_CleanUp );
+	runBenchmark( "tilemap_Redraw", 1024, tilemap_Setup, tilemapRedraw_Run, tilemap_CleanUp );
+	runBenchmark( "tilemap_EditOne", 1024, tilemap_Setup, tilemapEdit_Run, tilemap_CleanUp );
+	runBenchmark( "tilemap_Rebuild", 128, tilemap_Setup, tilemapRebuild_Run, tilemap_CleanUp );
+	runBenchmark( "tilemap_Rebuild", 1024, tilemap_Setup, tilemapRebuild_Run, tilemap_CleanUp );
+
+	runBenchmark( "layer_StaticUncached", 10000, layerScene_Setup, layerScene_Run, layerScene_CleanUp );
+	runBenchmark( "layer_StaticCached", 10000, cachedLayerScene_Setup, layerScene_Run, layerScene_CleanUp );
+	runBenchmark( "layer_RenderOnlyUncached", 10000, layerSceneRenderOnly_Setup, layerSceneRenderOnly_Run, layerScene_CleanUp );
+	runBenchmark( "layer_RenderOnlyCached", 10000, cachedLayerSceneRenderOnly_Setup, layerSceneRenderOnly_Run, layerScene_CleanUp );
+
+	runBenchmark( "triSort_QSort", 2000, triSortQSort_Setup, triSortQSort_Run, triSortQSort_CleanUp );
+	runBenchmark( "triSort_Radix", 2000, triSortRadix_Setup, triSortRadix_Run, triSortRadix_CleanUp );
+	runBenchmark( "triSort_QSort", 20000, triSortQSort_Setup, triSortQSort_Run, triSortQSort_CleanUp );
+	runBenchmark( "triSort_Radix", 20000, triSortRadix_Setup, triSortRadix_Run, triSortRadix_CleanUp );
+	runBenchmark( "triSort_QSort", 200000, triSortQSort_Setup, triSortQSort_Run, triSortQSort_CleanUp );
+	runBenchmark( "triSort_Radix", 200000, triSortRadix_Setup, triSortRadix_Run, triSortRadix_CleanUp );
+
+	if( snd_Init( 1 ) < 0 ) {
+		skipBenchmark( "mixerCallback", "unable to initialize sound" );
+	} else {
+		// pause the device so the audio thread isn't mixing at the same time we are
+		snd_SetFocus( false );
+		runBenchmark( "mixerCallback", 1, mixer_Setup, mixer_Run, mixer_CleanUp );
+		runBenchmark( "mixerCallback", 8, mixer_Setup, mixer_Run, mixer_CleanUp );
+		runBenchmark( "mixerCallback", 32, mixer_Setup, mixer_Run, mixer_CleanUp );
+	}
+
+	txt_Init( );
+	if( fontFileName == NULL ) {
+		skipBenchmark( "txt_DisplayString", "no font given, use -f" );
+	} else if( ( benchmarkFont = txt_LoadFont( fontFileName, 16.0f ) ) < 0 ) {
+		skipBenchmark( "txt_DisplayString", "unable to load font" );
+	} else {
+		runBenchmark( "txt_DisplayString", 1, NULL, text_Run, NULL );
+		runBenchmark( "txt_DisplayString", 16, NULL, text_Run, NULL );
+	}
+
+	runBenchmark( "levels_MoveToward", 1, pathing_Setup, pathing_Run, NULL );
+	runBenchmark( "levels_MoveToward", 64, pathing_Setup, pathing_Run, NULL );
+
+	runBenchmark( "rand_GetU32AndRangeFloat", 100000, NULL, random_Run, NULL );
+
+	int ret = 0;
+	if( outFileName != NULL ) {
+		FILE* outFile = fopen( outFileName, "w" );
+		if( outFile == NULL ) {
+			llog( LOG_ERROR, "Unable to open %s for writing.", outFileName );
+			ret = 1;
+		} else {
+			ret = ( writeResults( outFile ) < 0 ) ? 1 : 0;
+			fclose( outFile );
+		}
+	} else {
+		ret = ( writeResults( stdout ) < 0 ) ? 1 : 0;
+	}
+
+	snd_CleanUp( );
+	SDL_Quit( );
+
+	return ret;
+}
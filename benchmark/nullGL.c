@@ -0,0 +1,191 @@
+#include "../src/Graphics/glPlatform.h"
+
+#include <stdlib.h>
+
+/*
+Stand in for the OpenGL ES 3 library so the rendering code can be benchmarked without a context. Nothing is
+ drawn, the functions that return something give back values that let the engine think everything succeeded.
+ Only the functions the engine currently uses are here, if something new gets used it'll need to be added.
+*/
+
+static GLuint nextName = 1;
+
+// kept so whatever reads the viewport back gets what was set
+static GLint viewport[4] = { 0, 0, 0, 0 };
+
+static void genNames( GLsizei n, GLuint* names )
+{
+	for( GLsizei i = 0; i < n; ++i ) {
+		names[i] = nextName++;
+	}
+}
+
+// object creation and destruction
+GL_APICALL void GL_APIENTRY glGenBuffers( GLsizei n, GLuint* buffers ) { genNames( n, buffers ); }
+GL_APICALL void GL_APIENTRY glGenTextures( GLsizei n, GLuint* textures ) { genNames( n, textures ); }
+GL_APICALL void GL_APIENTRY glGenVertexArrays( GLsizei n, GLuint* arrays ) { genNames( n, arrays ); }
+GL_APICALL void GL_APIENTRY glGenFramebuffers( GLsizei n, GLuint* framebuffers ) { genNames( n, framebuffers ); }
+GL_APICALL void GL_APIENTRY glGenRenderbuffers( GLsizei n, GLuint* renderbuffers ) { genNames( n, renderbuffers ); }
+GL_APICALL void GL_APIENTRY glDeleteBuffers( GLsizei n, const GLuint* buffers ) { }
+GL_APICALL void GL_APIENTRY glDeleteTextures( GLsizei n, const GLuint* textures ) { }
+GL_APICALL void GL_APIENTRY glDeleteFramebuffers( GLsizei n, const GLuint* framebuffers ) { }
+GL_APICALL void GL_APIENTRY glDeleteRenderbuffers( GLsizei n, const GLuint* renderbuffers ) { }
+GL_APICALL void GL_APIENTRY glDeleteVertexArrays( GLsizei n, const GLuint* arrays ) { }
+GL_APICALL GLuint GL_APIENTRY glCreateShader( GLenum type ) { return nextName++; }
+GL_APICALL GLuint GL_APIENTRY glCreateProgram( void ) { return nextName++; }
+GL_APICALL void GL_APIENTRY glDeleteShader( GLuint shader ) { }
+GL_APICALL void GL_APIENTRY glDeleteProgram( GLuint program ) { }
+
+// shaders
+GL_APICALL void GL_APIENTRY glShaderSource( GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length ) { }
+GL_APICALL void GL_APIENTRY glCompileShader( GLuint shader ) { }
+GL_APICALL void GL_APIENTRY glAttachShader( GLuint program, GLuint shader ) { }
+GL_APICALL void GL_APIENTRY glLinkProgram( GLuint program ) { }
+GL_APICALL GLboolean GL_APIENTRY glIsShader( GLuint shader ) { return GL_TRUE; }
+GL_APICALL void GL_APIENTRY glUseProgram( GLuint program ) { }
+GL_APICALL GLint GL_APIENTRY glGetUniformLocation( GLuint program, const GLchar* name ) { return 0; }
+GL_APICALL void GL_APIENTRY glUniform1i( GLint location, GLint v0 ) { }
+GL_APICALL void GL_APIENTRY glUniform2f( GLint location, GLfloat v0, GLfloat v1 ) { }
+GL_APICALL void GL_APIENTRY glUniform3f( GLint location, GLfloat v0, GLfloat v1, GLfloat v2 ) { }
+GL_APICALL void GL_APIENTRY glUniformMatrix4fv( GLint location, GLsizei count, GLboolean transpose, const GLfloat* value ) { }
+GL_APICALL GLuint GL_APIENTRY glGetUniformBlockIndex( GLuint program, const GLchar* uniformBlockName ) { return 0; }
+GL_APICALL void GL_APIENTRY glUniformBlockBinding( GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding ) { }
+
+static void getObjectiv( GLenum pname, GLint* params )
+{
+	switch( pname ) {
+	case GL_COMPILE_STATUS:
+	case GL_LINK_STATUS:
+	case GL_VALIDATE_STATUS:
+		(*params) = GL_TRUE;
+		break;
+	default:
+		(*params) = 0;
+		break;
+	}
+}
+
+GL_APICALL void GL_APIENTRY glGetShaderiv( GLuint shader, GLenum pname, GLint* params ) { getObjectiv( pname, params ); }
+GL_APICALL void GL_APIENTRY glGetProgramiv( GLuint program, GLenum pname, GLint* params ) { getObjectiv( pname, params ); }
+
+GL_APICALL void GL_APIENTRY glGetShaderInfoLog( GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog )
+{
+	if( length != NULL ) (*length) = 0;
+	if( ( infoLog != NULL ) && ( bufSize > 0 ) ) infoLog[0] = 0;
+}
+
+GL_APICALL void GL_APIENTRY glGetProgramInfoLog( GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog )
+{
+	glGetShaderInfoLog( program, bufSize, length, infoLog );
+}
+
+GL_APICALL void GL_APIENTRY glGetActiveUniform( GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name )
+{
+	if( length != NULL ) (*length) = 0;
+	if( size != NULL ) (*size) = 0;
+	if( type != NULL ) (*type) = GL_FLOAT;
+	if( ( name != NULL ) && ( bufSize > 0 ) ) name[0] = 0;
+}
+
+// buffers and textures
+GL_APICALL void GL_APIENTRY glBindBuffer( GLenum target, GLuint buffer ) { }
+GL_APICALL void GL_APIENTRY glBindBufferRange( GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size ) { }
+GL_APICALL void GL_APIENTRY glBindVertexArray( GLuint array ) { }
+GL_APICALL void GL_APIENTRY glBufferData( GLenum target, GLsizeiptr size, const void* data, GLenum usage ) { }
+GL_APICALL void GL_APIENTRY glBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void* data ) { }
+// mapped ranges all point at the same scratch memory, grown to fit the largest request
+static void* mappedMemory = NULL;
+static GLsizeiptr mappedSize = 0;
+
+GL_APICALL void* GL_APIENTRY glMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+	if( length > mappedSize ) {
+		void* newMemory = realloc( mappedMemory, (size_t)length );
+		if( newMemory == NULL ) {
+			return NULL;
+		}
+		mappedMemory = newMemory;
+		mappedSize = length;
+	}
+	return mappedMemory;
+}
+
+GL_APICALL GLboolean GL_APIENTRY glUnmapBuffer( GLenum target ) { return GL_TRUE; }
+GL_APICALL void GL_APIENTRY glEnableVertexAttribArray( GLuint index ) { }
+GL_APICALL void GL_APIENTRY glVertexAttribPointer( GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer ) { }
+GL_APICALL void GL_APIENTRY glVertexAttribDivisor( GLuint index, GLuint divisor ) { }
+GL_APICALL void GL_APIENTRY glActiveTexture( GLenum texture ) { }
+GL_APICALL void GL_APIENTRY glBindTexture( GLenum target, GLuint texture ) { }
+GL_APICALL void GL_APIENTRY glTexParameteri( GLenum target, GLenum pname, GLint param ) { }
+GL_APICALL void GL_APIENTRY glTexImage2D( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+	GLenum format, GLenum type, const void* pixels ) { }
+GL_APICALL void GL_APIENTRY glTexImage3D( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+	GLint border, GLenum format, GLenum type, const void* pixels ) { }
+GL_APICALL void GL_APIENTRY glTexSubImage3D( GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+	GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels ) { }
+GL_APICALL void GL_APIENTRY glCopyTexSubImage3D( GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x,
+	GLint y, GLsizei width, GLsizei height ) { }
+GL_APICALL void GL_APIENTRY glBindFramebuffer( GLenum target, GLuint framebuffer ) { }
+GL_APICALL void GL_APIENTRY glFramebufferTextureLayer( GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer ) { }
+GL_APICALL void GL_APIENTRY glFramebufferTexture2D( GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level ) { }
+GL_APICALL void GL_APIENTRY glBindRenderbuffer( GLenum target, GLuint renderbuffer ) { }
+GL_APICALL void GL_APIENTRY glRenderbufferStorage( GLenum target, GLenum internalformat, GLsizei width, GLsizei height ) { }
+GL_APICALL void GL_APIENTRY glFramebufferRenderbuffer( GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer ) { }
+
+// state and drawing
+GL_APICALL void GL_APIENTRY glEnable( GLenum cap ) { }
+GL_APICALL void GL_APIENTRY glDisable( GLenum cap ) { }
+GL_APICALL void GL_APIENTRY glBlendFunc( GLenum sfactor, GLenum dfactor ) { }
+GL_APICALL void GL_APIENTRY glBlendFuncSeparate( GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha ) { }
+GL_APICALL void GL_APIENTRY glDepthFunc( GLenum func ) { }
+GL_APICALL void GL_APIENTRY glDepthMask( GLboolean flag ) { }
+GL_APICALL void GL_APIENTRY glScissor( GLint x, GLint y, GLsizei width, GLsizei height ) { }
+GL_APICALL void GL_APIENTRY glViewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+}
+GL_APICALL void GL_APIENTRY glClearColor( GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha ) { }
+GL_APICALL void GL_APIENTRY glClear( GLbitfield mask ) { }
+GL_APICALL void GL_APIENTRY glDrawElements( GLenum mode, GLsizei count, GLenum type, const void* indices ) { }
+GL_APICALL void GL_APIENTRY glDrawArrays( GLenum mode, GLint first, GLsizei count ) { }
+GL_APICALL void GL_APIENTRY glDrawArraysInstanced( GLenum mode, GLint first, GLsizei count, GLsizei instancecount ) { }
+
+// syncing, nothing is ever running on the GPU so everything is always done
+GL_APICALL GLsync GL_APIENTRY glFenceSync( GLenum condition, GLbitfield flags ) { return (GLsync)(size_t)( nextName++ ); }
+GL_APICALL GLenum GL_APIENTRY glClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout ) { return GL_ALREADY_SIGNALED; }
+GL_APICALL void GL_APIENTRY glDeleteSync( GLsync sync ) { }
+
+// timer queries, nothing takes any time
+GL_APICALL void GL_APIENTRY glGenQueries( GLsizei n, GLuint* ids ) { genNames( n, ids ); }
+GL_APICALL void GL_APIENTRY glDeleteQueries( GLsizei n, const GLuint* ids ) { }
+GL_APICALL void GL_APIENTRY glBeginQuery( GLenum target, GLuint id ) { }
+GL_APICALL void GL_APIENTRY glEndQuery( GLenum target ) { }
+GL_APICALL void GL_APIENTRY glGetQueryObjectuiv( GLuint id, GLenum pname, GLuint* params ) { (*params) = ( pname == GL_QUERY_RESULT_AVAILABLE ) ? GL_TRUE : 0; }
+
+GL_APICALL GLenum GL_APIENTRY glCheckFramebufferStatus( GLenum target ) { return GL_FRAMEBUFFER_COMPLETE; }
+GL_APICALL GLenum GL_APIENTRY glGetError( void ) { return GL_NO_ERROR; }
+GL_APICALL const GLubyte* GL_APIENTRY glGetString( GLenum name ) { return (const GLubyte*)"null"; }
+
+GL_APICALL void GL_APIENTRY glGetIntegerv( GLenum pname, GLint* data )
+{
+	switch( pname ) {
+	case GL_MAX_TEXTURE_SIZE:
+	case GL_MAX_RENDERBUFFER_SIZE:
+		(*data) = 4096;
+		break;
+	case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+		(*data) = 256;
+		break;
+	case GL_VIEWPORT:
+		for( int i = 0; i < 4; ++i ) {
+			data[i] = viewport[i];
+		}
+		break;
+	default:
+		(*data) = 0;
+		break;
+	}
+}
@@ -0,0 +1,195 @@
+/*
+Replays a triangle upload captured with triRenderer_CaptureUpload( ), sorting and batching it over and over without a
+ window so the CPU side of the renderer can be measured with a real workload. Every upload starts from the order the
+ capture was taken in. The sprite groups are only sent by the first upload, like they would be once a game settles.
+ Rendering goes through the null OpenGL implementation in nullGL.c. The capture has to come from a build that lays
+ out the triangles and sprites the same way, so capture and replay with the same compiler and platform. Captures
+ with tile chunks can't be replayed.
+
+ usage: xturosReplay capture.bin [-n iterations]
+*/
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../src/System/memory.h"
+#include "../src/System/platformLog.h"
+#include "../src/Graphics/camera.h"
+#include "../src/Graphics/glState.h"
+#include "../src/Graphics/layerCache.h"
+#include "../src/Graphics/renderStats.h"
+#include "../src/Graphics/scissor.h"
+#include "../src/Graphics/triRendering.h"
+
+// the capture sets the scissor areas, the render size only matters for the projection which isn't looked at
+#define RENDER_WIDTH 800
+#define RENDER_HEIGHT 600
+
+#define DEFAULT_ITERATIONS 200
+
+// captures can be a lot bigger than anything the benchmarks make
+#define MEMORY_SIZE ( 512 * 1024 * 1024 )
+
+typedef enum {
+	STAGE_SORT,
+	STAGE_VERTICES,
+	STAGE_ORDER,
+	STAGE_BATCH,
+	STAGE_SEND,
+	STAGE_TOTAL,
+	NUM_STAGES
+} Stage;
+
+static const char* stageNames[NUM_STAGES] = { "sort", "vertices", "order", "batch", "send", "total" };
+
+typedef struct {
+	double totalMS;
+	double minMS;
+	double maxMS;
+} StageTimes;
+
+static StageTimes stageTimes[NUM_STAGES];
+
+static void addStageTime( Stage stage, double ms )
+{
+	StageTimes* times = &( stageTimes[stage] );
+	times->totalMS += ms;
+	times->minMS = ( ms < times->minMS ) ? ms : times->minMS;
+	times->maxMS = ( ms > times->maxMS ) ? ms : times->maxMS;
+}
+
+// draws the replayed upload once so the draw calls and why the batches broke up can be reported, the stats for a
+//  frame only come in once the frames after it have been started
+static bool renderOnce( RenderFrameStats* outStats )
+{
+	for( int i = 0; i < 8; ++i ) {
+		renderStats_BeginFrame( );
+		glState_BeginFrame( );
+		renderStats_BeginPass( RP_TRIANGLES );
+		triRenderer_Render( 1.0f );
+		renderStats_EndPass( RP_TRIANGLES );
+		glState_EndFrame( );
+		renderStats_EndFrame( );
+
+		if( renderStats_GetLastFrame( outStats ) ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int main( int argc, char** argv )
+{
+	const char* captureFileName = NULL;
+	int iterations = DEFAULT_ITERATIONS;
+
+	for( int i = 1; i < argc; ++i ) {
+		if( ( strcmp( argv[i], "-n" ) == 0 ) && ( ( i + 1 ) < argc ) ) {
+			iterations = atoi( argv[++i] );
+		} else if( ( argv[i][0] != '-' ) && ( captureFileName == NULL ) ) {
+			captureFileName = argv[i];
+		} else {
+			captureFileName = NULL;
+			break;
+		}
+	}
+
+	if( ( captureFileName == NULL ) || ( iterations <= 0 ) ) {
+		fprintf( stderr, "usage: %s capture.bin [-n iterations]\n", argv[0] );
+		return 1;
+	}
+
+	if( mem_Init( MEMORY_SIZE ) < 0 ) {
+		fprintf( stderr, "Unable to allocate memory.\n" );
+		return 1;
+	}
+
+	if( SDL_Init( SDL_INIT_TIMER ) != 0 ) {
+		llog( LOG_ERROR, "Unable to initialize SDL: %s", SDL_GetError( ) );
+		return 1;
+	}
+
+	cam_Init( );
+	cam_SetProjectionMatrices( RENDER_WIDTH, RENDER_HEIGHT );
+	if( ( glState_Init( ) < 0 ) || ( renderStats_Init( ) < 0 ) || ( triRenderer_Init( RENDER_WIDTH, RENDER_HEIGHT ) < 0 ) ||
+		( scissor_Init( RENDER_WIDTH, RENDER_HEIGHT ) < 0 ) || ( layerCache_Init( ) < 0 ) ) {
+		llog( LOG_ERROR, "Unable to initialize rendering." );
+		return 1;
+	}
+
+	if( triRenderer_LoadCapture( captureFileName ) < 0 ) {
+		return 1;
+	}
+
+	int cameras = 0;
+	for( int camera = cam_StartRenderIteration( ); camera != -1; camera = cam_GetNextActiveRenderCam( ) ) {
+		++cameras;
+	}
+
+	// the first upload grows all the buffers, and drawing it sends it off so the bytes it sent can be counted
+	int triangles;
+	int vertexBytes;
+	int indexBytes;
+	int groupSprites;
+	triRenderer_Upload( );
+	triRenderer_Render( 1.0f );
+	triRenderer_GetLastRenderStats( &triangles, NULL, NULL );
+	triRenderer_GetLastUploadStats( &vertexBytes, &indexBytes );
+	triRenderer_GetLastSpriteGroupStats( &groupSprites, NULL );
+
+	for( int s = 0; s < NUM_STAGES; ++s ) {
+		stageTimes[s].totalMS = 0.0;
+		stageTimes[s].minMS = 1e30;
+		stageTimes[s].maxMS = 0.0;
+	}
+
+	double msPerCount = 1000.0 / (double)SDL_GetPerformanceFrequency( );
+	for( int i = 0; i < iterations; ++i ) {
+		triRenderer_RestoreCapture( );
+
+		Uint64 start = SDL_GetPerformanceCounter( );
+		triRenderer_Upload( );
+		double totalMS = (double)( SDL_GetPerformanceCounter( ) - start ) * msPerCount;
+
+		float stageMS[STAGE_TOTAL];
+		triRenderer_GetLastUploadTimings( &( stageMS[STAGE_SORT] ), &( stageMS[STAGE_VERTICES] ), &( stageMS[STAGE_ORDER] ),
+			&( stageMS[STAGE_BATCH] ), &( stageMS[STAGE_SEND] ) );
+		for( int s = 0; s < STAGE_TOTAL; ++s ) {
+			addStageTime( (Stage)s, stageMS[s] );
+		}
+		addStageTime( STAGE_TOTAL, totalMS );
+	}
+
+	RenderFrameStats frameStats;
+	bool rendered = renderOnce( &frameStats );
+
+	int drawCalls;
+	int programBinds;
+	triRenderer_GetLastDrawStats( &drawCalls, &programBinds );
+
+	printf( "capture %s\n", captureFileName );
+	printf( "  %i triangles, sprites count as two, %i cameras\n", triangles, cameras );
+	printf( "  %i sprites in groups\n", groupSprites );
+	printf( "  %i vertex bytes and %i index bytes sent\n", vertexBytes, indexBytes );
+	printf( "\n%-10s %10s %10s %10s   over %i uploads\n", "stage", "mean ms", "min ms", "max ms", iterations );
+	for( int s = 0; s < NUM_STAGES; ++s ) {
+		printf( "%-10s %10.4f %10.4f %10.4f\n", stageNames[s], stageTimes[s].totalMS / (double)iterations, stageTimes[s].minMS, stageTimes[s].maxMS );
+	}
+
+	printf( "\n%i draw calls, %i program binds\n", drawCalls, programBinds );
+	if( rendered ) {
+		printf( "batch breaks:" );
+		for( int b = 0; b < NUM_BATCH_BREAKS; ++b ) {
+			printf( " %s %i", renderStats_GetBatchBreakName( (BatchBreak)b ), frameStats.batchBreaks[b] );
+		}
+		printf( "\n" );
+	}
+
+	SDL_Quit( );
+
+	return 0;
+}
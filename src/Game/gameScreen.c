@@ -9,6 +9,8 @@
 #include "../Graphics/camera.h"
 #include "../Graphics/debugRendering.h"
 #include "../Graphics/imageSheets.h"
+#include "../Graphics/tilemap.h"
+#include "../Graphics/layerCache.h"
 #include "../Input/input.h"
 #include "../System/platformLog.h"
 #include "../Utils/helpers.h"
@@ -1614,8 +1616,46 @@ static void exploreHelp( void )
 	gsmEnterState( &gameScreenStateMachine, &gameScreenHelpState );
 }
 
+// the level is drawn as a tile map, so only the cells that changed since the last draw have to be rebuilt, the atlas is
+//  every image a cell can show
+static int exploreTilemap = -1;
+static int* sbExploreAtlas = NULL;
+
+static void createExploreTilemap( void )
+{
+	int images[] = { forestFloorImg, caveFloorImg, forestObstacleImg, caveObstacleImg, entranceImg, exitImg,
+		sbWolfImgs[IDLE_SPR], sbScoutImgs[IDLE_SPR], sbGuardImgs[IDLE_SPR], sbWarriorImgs[IDLE_SPR], sbRaiderImgs[IDLE_SPR],
+		sbBossImgs[IDLE_SPR] };
+	sb_Clear( sbExploreAtlas );
+	for( int i = 0; i < ARRAY_SIZE( images ); ++i ) {
+		sb_Push( sbExploreAtlas, images[i] );
+	}
+
+	// the cells are centered at the same spots wldToScr( ) gives
+	exploreTilemap = tilemap_Create( LEVEL_WIDTH, LEVEL_HEIGHT, sbExploreAtlas, (int)sb_Count( sbExploreAtlas ), VEC2_ZERO,
+		vec2( 32.0f, 32.0f ), 1, 0 );
+	if( exploreTilemap < 0 ) {
+		llog( LOG_WARN, "Unable to create tile map for exploring." );
+	}
+}
+
+static int exploreTile( int image )
+{
+	for( int i = 0; i < (int)sb_Count( sbExploreAtlas ); ++i ) {
+		if( sbExploreAtlas[i] == image ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
 static int gameScreen_Explore_Enter( void )
 {
+	createExploreTilemap( );
+
+	// exploring is turn based so the screen only changes when the player does something
+	layerCache_Enable( 0 );
+
 	input_BindOnKeyPress( SDLK_w, exploreUp );
 	input_BindOnKeyPress( SDLK_s, exploreDown );
 	input_BindOnKeyPress( SDLK_a, exploreLeft );
@@ -1630,6 +1670,10 @@ static int gameScreen_Explore_Enter( void )
 
 static int gameScreen_Explore_Exit( void )
 {
+	tilemap_Destroy( exploreTilemap );
+	exploreTilemap = -1;
+	layerCache_Disable( 0 );
+
 	input_ClearAllKeyBinds( );
 
 	snd_StopStreaming( exploreMusic );
@@ -1650,7 +1694,10 @@ static void gameScreen_Explore_Draw( void )
 	// draw the current level
 	for( int y = 0; y < LEVEL_HEIGHT; ++y ) {
 		for( int x = 0; x < LEVEL_WIDTH; ++x ) {
-			if( !isVisibleFrom( x, y, exploreX, exploreY ) ) continue;
+			if( !isVisibleFrom( x, y, exploreX, exploreY ) ) {
+				tilemap_SetTile( exploreTilemap, x, y, -1 );
+				continue;
+			}
 			char data = levels_GetData( currentLevel, x, y );
 			int image = -1;
 
@@ -1694,11 +1741,7 @@ static void gameScreen_Explore_Draw( void )
 				break;
 			}
 
-			if( image < 0 ) continue;
-
-			Vector2 pos = wldToScr( x, y );
-
-			img_Draw( image, 1, pos, pos, 0 );
+			tilemap_SetTile( exploreTilemap, x, y, exploreTile( image ) );
 		}
 	}
 
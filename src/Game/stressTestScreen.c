@@ -0,0 +1,415 @@
+#include "stressTestScreen.h"
+
+#include <SDL.h>
+#include <math.h>
+
+#include "../Graphics/graphics.h"
+#include "../Graphics/images.h"
+#include "../Graphics/sprites.h"
+#include "../Graphics/spineGfx.h"
+#include "../Graphics/camera.h"
+#include "../UI/text.h"
+#include "../UI/button.h"
+#include "../particles.h"
+#include "../collisionDetection.h"
+#include "../System/random.h"
+#include "../System/platformLog.h"
+#include "../Utils/stretchyBuffer.h"
+#include "../Utils/cfgFile.h"
+#include "../Math/mathUtil.h"
+#include "resources.h"
+
+#define AREA_WIDTH 512.0f
+#define AREA_HEIGHT 288.0f
+
+#define MIN_SPEED 16.0f
+#define MAX_SPEED 128.0f
+
+#define PARTICLE_LIFE_TIME 1.0f
+
+#define SPINE_TEMPLATE "Spine/stressTest"
+
+typedef struct {
+	Vector2 pos;
+	Vector2 vel;
+} Mover;
+
+typedef struct {
+	int sprites;
+	int particles;
+	int spineInstances;
+	int strings;
+	int buttons;
+	int colliders;
+	int ticks;
+	int seed;
+	int quitWhenDone;
+} StressTestSettings;
+
+static StressTestSettings settings;
+static RandomGroup randGroup;
+
+static int* sbImages = NULL;
+
+static int* sbSprites = NULL;
+static Mover* sbSpriteMovers = NULL;
+
+static int* sbSpineInstances = NULL;
+static Mover* sbSpineMovers = NULL;
+static int spineTemplate = -1;
+
+static Mover* sbStringMovers = NULL;
+
+static int* sbButtons = NULL;
+
+static Collider* sbColliders = NULL;
+static Vector2* sbColliderVels = NULL;
+static int collisionsThisTick;
+
+static float particleSpawnAcc;
+
+// statistics
+static int ticksRun;
+static bool reported;
+static double totalTickMS;
+static double maxTickMS;
+static int maxQueuedInstructions;
+static int totalCollisions;
+
+static void loadSettings( void )
+{
+	void* cfgFile = cfg_OpenFile( "stress.cfg" );
+	cfg_GetInt( cfgFile, "SPRITES", 500, &settings.sprites );
+	cfg_GetInt( cfgFile, "PARTICLES", 256, &settings.particles );
+	cfg_GetInt( cfgFile, "SPINE_INSTANCES", 0, &settings.spineInstances );
+	cfg_GetInt( cfgFile, "STRINGS", 8, &settings.strings );
+	cfg_GetInt( cfgFile, "BUTTONS", 16, &settings.buttons );
+	cfg_GetInt( cfgFile, "COLLIDERS", 500, &settings.colliders );
+	cfg_GetInt( cfgFile, "TICKS", 1200, &settings.ticks );
+	cfg_GetInt( cfgFile, "SEED", 1234, &settings.seed );
+	cfg_GetInt( cfgFile, "QUIT_WHEN_DONE", 1, &settings.quitWhenDone );
+	cfg_CloseFile( cfgFile );
+}
+
+static Mover createMover( void )
+{
+	Mover m;
+	m.pos.x = rand_GetRangeFloat( &randGroup, 0.0f, AREA_WIDTH );
+	m.pos.y = rand_GetRangeFloat( &randGroup, 0.0f, AREA_HEIGHT );
+	float speed = rand_GetRangeFloat( &randGroup, MIN_SPEED, MAX_SPEED );
+	float angle = rand_GetRangeFloat( &randGroup, 0.0f, M_TWO_PI_F );
+	m.vel.x = cosf( angle ) * speed;
+	m.vel.y = sinf( angle ) * speed;
+	return m;
+}
+
+// moves the position, bouncing it off the edges of the screen
+static void move( Vector2* pos, Vector2* vel, float dt )
+{
+	vec2_AddScaled( pos, vel, dt, pos );
+	if( ( pos->x < 0.0f ) || ( pos->x > AREA_WIDTH ) ) {
+		vel->x = -vel->x;
+		pos->x = clamp( 0.0f, AREA_WIDTH, pos->x );
+	}
+	if( ( pos->y < 0.0f ) || ( pos->y > AREA_HEIGHT ) ) {
+		vel->y = -vel->y;
+		pos->y = clamp( 0.0f, AREA_HEIGHT, pos->y );
+	}
+}
+
+static int randomImage( void )
+{
+	return sbImages[rand_GetRangeS32( &randGroup, 0, (int32_t)sb_Count( sbImages ) - 1 )];
+}
+
+static void collisionResponse( int firstColliderIdx, int secondColliderIdx, Vector2 separation )
+{
+	++collisionsThisTick;
+}
+
+static void createImageList( void )
+{
+	sb_Push( sbImages, forestObstacleImg );
+	sb_Push( sbImages, caveObstacleImg );
+	sb_Push( sbImages, exitImg );
+	sb_Push( sbImages, entranceImg );
+	sb_Push( sbImages, gridMarkerImg );
+	if( sbPlayerImgs != NULL ) sb_Push( sbImages, sbPlayerImgs[IDLE_SPR] );
+	if( sbWolfImgs != NULL ) sb_Push( sbImages, sbWolfImgs[IDLE_SPR] );
+	if( sbScoutImgs != NULL ) sb_Push( sbImages, sbScoutImgs[IDLE_SPR] );
+	if( sbGuardImgs != NULL ) sb_Push( sbImages, sbGuardImgs[IDLE_SPR] );
+	if( sbWarriorImgs != NULL ) sb_Push( sbImages, sbWarriorImgs[IDLE_SPR] );
+	if( sbRaiderImgs != NULL ) sb_Push( sbImages, sbRaiderImgs[IDLE_SPR] );
+	if( sbBossImgs != NULL ) sb_Push( sbImages, sbBossImgs[IDLE_SPR] );
+}
+
+static void createSpineInstances( void )
+{
+	if( settings.spineInstances <= 0 ) return;
+
+	spineTemplate = spine_LoadTemplate( SPINE_TEMPLATE );
+	if( spineTemplate < 0 ) {
+		llog( LOG_WARN, "Unable to load spine template %s, no spine instances will be created.", SPINE_TEMPLATE );
+		return;
+	}
+
+	spSkeletonData* skeletonData = spine_GetTemplateSkeletonData( spineTemplate );
+	for( int i = 0; i < settings.spineInstances; ++i ) {
+		Mover m = createMover( );
+		int id = spine_CreateInstance( spineTemplate, m.pos, 1, 0, NULL, NULL );
+		if( id < 0 ) {
+			llog( LOG_WARN, "Only able to create %i spine instances.", i );
+			break;
+		}
+
+		if( skeletonData->animationsCount > 0 ) {
+			spAnimationState_setAnimation( spine_GetInstanceAnimState( id ), 0, skeletonData->animations[0], 1 );
+		}
+
+		sb_Push( sbSpineInstances, id );
+		sb_Push( sbSpineMovers, m );
+	}
+}
+
+static void resetStatistics( void )
+{
+	ticksRun = 0;
+	reported = false;
+	gfx_ResetFrameTimes( );
+	totalTickMS = 0.0;
+	maxTickMS = 0.0;
+	maxQueuedInstructions = 0;
+	totalCollisions = 0;
+}
+
+static void report( void )
+{
+	int instructionCapacity;
+	img_GetDrawInstructionStats( NULL, NULL, &instructionCapacity );
+
+	// gathered by the renderer, the simulation may be on a different thread
+	UploadTotals uploads;
+	gfx_GetUploadTotals( &uploads );
+
+	llog( LOG_INFO, "Stress test finished after %i ticks.", ticksRun );
+	llog( LOG_INFO, "  Spawned: %i sprites, %i particles, %i spine instances, %i strings, %i buttons, %i colliders",
+		(int)sb_Count( sbSprites ), settings.particles, (int)sb_Count( sbSpineInstances ), settings.strings,
+		(int)sb_Count( sbButtons ), settings.colliders );
+	// timed around the rendering so it's the frames that were presented and not the simulation updates
+	int framesTimed;
+	double totalFrameMS, minFrameMS, maxFrameMS;
+	gfx_GetFrameTimes( &framesTimed, &totalFrameMS, &minFrameMS, &maxFrameMS );
+	if( framesTimed > 0 ) {
+		llog( LOG_INFO, "  Frames: %i, avg %.3fms, min %.3fms, max %.3fms",
+			framesTimed, totalFrameMS / framesTimed, minFrameMS, maxFrameMS );
+	}
+	int latenciesRecorded;
+	double totalLatencyMS, minLatencyMS, maxLatencyMS;
+	gfx_GetInputLatencies( &latenciesRecorded, &totalLatencyMS, &minLatencyMS, &maxLatencyMS );
+	if( latenciesRecorded > 0 ) {
+		llog( LOG_INFO, "  Input latency: %i inputs, avg %.3fms, min %.3fms, max %.3fms",
+			latenciesRecorded, totalLatencyMS / latenciesRecorded, minLatencyMS, maxLatencyMS );
+	}
+	if( ticksRun > 0 ) {
+		llog( LOG_INFO, "  Tick: avg %.3fms, max %.3fms", totalTickMS / ticksRun, maxTickMS );
+	}
+	llog( LOG_INFO, "  Draw instructions: peak %i, capacity grew to %i", maxQueuedInstructions, instructionCapacity );
+	llog( LOG_INFO, "  Triangles: peak %i, capacity grew to %i", uploads.peakTriangles, uploads.triangleCapacity );
+	if( uploads.uploads > 0 ) {
+		llog( LOG_INFO, "  Triangle uploads: %i, avg %.1fKB per upload", uploads.uploads,
+			( uploads.uploadedBytes / uploads.uploads ) / 1024.0 );
+		llog( LOG_INFO, "  Draw calls: avg %.1f per upload, avg %.1f program binds per upload",
+			uploads.drawCalls / uploads.uploads, uploads.programBinds / uploads.uploads );
+		llog( LOG_INFO, "  Culling: avg %.1f visible per upload, avg %.1f culled per upload",
+			uploads.visible / uploads.uploads, uploads.culled / uploads.uploads );
+	}
+	llog( LOG_INFO, "  Collisions: %i", totalCollisions );
+
+	reported = true;
+
+	if( settings.quitWhenDone ) {
+		SDL_Event quitEvent;
+		quitEvent.type = SDL_QUIT;
+		SDL_PushEvent( &quitEvent );
+	}
+}
+
+static int stressTestScreen_Enter( void )
+{
+	loadSettings( );
+	rand_Seed( &randGroup, (uint32_t)settings.seed );
+	resetStatistics( );
+
+	cam_TurnOnFlags( 0, 1 );
+	gfx_SetClearColor( CLR_BLACK );
+
+	createImageList( );
+
+	spr_Init( );
+	spr_RegisterSystem( );
+	particles_Init( );
+	btn_Init( );
+	btn_RegisterSystem( );
+
+	for( int i = 0; i < settings.sprites; ++i ) {
+		Mover m = createMover( );
+		int id = spr_Create( randomImage( ), 1, m.pos, VEC2_ONE, rand_GetRangeFloat( &randGroup, 0.0f, M_TWO_PI_F ), CLR_WHITE,
+			(int8_t)rand_GetRangeS32( &randGroup, -8, 8 ) );
+		if( id < 0 ) {
+			llog( LOG_WARN, "Only able to create %i sprites.", i );
+			break;
+		}
+		sb_Push( sbSprites, id );
+		sb_Push( sbSpriteMovers, m );
+	}
+
+	createSpineInstances( );
+
+	for( int i = 0; i < settings.strings; ++i ) {
+		sb_Push( sbStringMovers, createMover( ) );
+	}
+
+	for( int i = 0; i < settings.buttons; ++i ) {
+		Vector2 pos = createMover( ).pos;
+		int id = btn_Create( pos, vec2( 64.0f, 24.0f ), vec2( 60.0f, 22.0f ), "Button", inGameFont, CLR_WHITE, VEC2_ZERO,
+			NULL, gridBGImg, CLR_WHITE, 1, 10, NULL, NULL );
+		if( id < 0 ) {
+			llog( LOG_WARN, "Only able to create %i buttons.", i );
+			break;
+		}
+		sb_Push( sbButtons, id );
+	}
+
+	sb_Add( sbColliders, settings.colliders );
+	sb_Add( sbColliderVels, settings.colliders );
+	for( int i = 0; i < settings.colliders; ++i ) {
+		Mover m = createMover( );
+		if( rand_Choice( &randGroup ) ) {
+			sbColliders[i].aabb.type = CT_AABB;
+			sbColliders[i].aabb.center = m.pos;
+			sbColliders[i].aabb.halfDim.x = rand_GetRangeFloat( &randGroup, 2.0f, 8.0f );
+			sbColliders[i].aabb.halfDim.y = rand_GetRangeFloat( &randGroup, 2.0f, 8.0f );
+		} else {
+			sbColliders[i].circle.type = CT_CIRCLE;
+			sbColliders[i].circle.center = m.pos;
+			sbColliders[i].circle.radius = rand_GetRangeFloat( &randGroup, 2.0f, 8.0f );
+		}
+		sbColliderVels[i] = m.vel;
+	}
+
+	particleSpawnAcc = 0.0f;
+
+	return 1;
+}
+
+static int stressTestScreen_Exit( void )
+{
+	for( size_t i = 0; i < sb_Count( sbSprites ); ++i ) {
+		spr_Destroy( sbSprites[i] );
+	}
+	spr_UnRegisterSystem( );
+	particles_CleanUp( );
+	btn_DestroyAll( );
+	btn_UnRegisterSystem( );
+
+	for( size_t i = 0; i < sb_Count( sbSpineInstances ); ++i ) {
+		spine_CleanInstance( sbSpineInstances[i] );
+	}
+	if( spineTemplate >= 0 ) {
+		spine_CleanTemplate( spineTemplate );
+		spineTemplate = -1;
+	}
+
+	sb_Release( sbImages );
+	sb_Release( sbSprites );
+	sb_Release( sbSpriteMovers );
+	sb_Release( sbSpineInstances );
+	sb_Release( sbSpineMovers );
+	sb_Release( sbStringMovers );
+	sb_Release( sbButtons );
+	sb_Release( sbColliders );
+	sb_Release( sbColliderVels );
+
+	return 1;
+}
+
+static void stressTestScreen_ProcessEvents( SDL_Event* e )
+{
+}
+
+static void stressTestScreen_Process( void )
+{
+}
+
+static void stressTestScreen_Draw( void )
+{
+	for( size_t i = 0; i < sb_Count( sbStringMovers ); ++i ) {
+		txt_DisplayString( "The quick brown fox jumps over the lazy dog", sbStringMovers[i].pos, CLR_YELLOW,
+			HORIZ_ALIGN_CENTER, VERT_ALIGN_CENTER, inGameFont, 1, 20 );
+	}
+
+	// everything for this frame has been queued now
+	int queued;
+	img_GetDrawInstructionStats( &queued, NULL, NULL );
+	maxQueuedInstructions = MAX( maxQueuedInstructions, queued );
+}
+
+static void stressTestScreen_PhysicsTick( float dt )
+{
+	if( ticksRun >= settings.ticks ) {
+		if( !reported ) {
+			report( );
+		}
+		return;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter( );
+
+	for( size_t i = 0; i < sb_Count( sbSprites ); ++i ) {
+		move( &( sbSpriteMovers[i].pos ), &( sbSpriteMovers[i].vel ), dt );
+		spr_Update_p( sbSprites[i], &( sbSpriteMovers[i].pos ) );
+	}
+
+	for( size_t i = 0; i < sb_Count( sbSpineInstances ); ++i ) {
+		move( &( sbSpineMovers[i].pos ), &( sbSpineMovers[i].vel ), dt );
+		spine_SetInstancePosition( sbSpineInstances[i], &( sbSpineMovers[i].pos ) );
+	}
+
+	for( size_t i = 0; i < sb_Count( sbStringMovers ); ++i ) {
+		move( &( sbStringMovers[i].pos ), &( sbStringMovers[i].vel ), dt );
+	}
+
+	// keep roughly the requested number of particles alive
+	particleSpawnAcc += ( (float)settings.particles * dt ) / PARTICLE_LIFE_TIME;
+	while( particleSpawnAcc >= 1.0f ) {
+		Mover m = createMover( );
+		particles_Spawn( m.pos, m.vel, vec2( 0.0f, 64.0f ), 0.0f, PARTICLE_LIFE_TIME, PARTICLE_LIFE_TIME * 0.5f,
+			randomImage( ), 1, 15 );
+		particleSpawnAcc -= 1.0f;
+	}
+
+	for( size_t i = 0; i < sb_Count( sbColliders ); ++i ) {
+		// both collider types have the center in the same spot
+		move( &( sbColliders[i].aabb.center ), &( sbColliderVels[i] ), dt );
+	}
+
+	if( sb_Count( sbColliders ) > 0 ) {
+		ColliderCollection collection;
+		collection.firstCollider = sbColliders;
+		collection.stride = sizeof( sbColliders[0] );
+		collection.count = (int)sb_Count( sbColliders );
+
+		collisionsThisTick = 0;
+		collision_DetectAllInternal( collection, collisionResponse );
+		totalCollisions += collisionsThisTick;
+	}
+
+	double tickMS = ( (double)( SDL_GetPerformanceCounter( ) - start ) * 1000.0 ) / (double)SDL_GetPerformanceFrequency( );
+	totalTickMS += tickMS;
+	maxTickMS = MAX( maxTickMS, tickMS );
+
+	++ticksRun;
+}
+
+struct GameState stressTestScreenState = { stressTestScreen_Enter, stressTestScreen_Exit, stressTestScreen_ProcessEvents,
+	stressTestScreen_Process, stressTestScreen_Draw, stressTestScreen_PhysicsTick };
@@ -0,0 +1,20 @@
+#ifndef STRESS_TEST_SCREEN_H
+#define STRESS_TEST_SCREEN_H
+
+/*
+Synthetic scene used to benchmark rendering and simulation. Spawns configurable numbers of sprites, particles,
+ spine instances, strings, buttons, and colliders that all move deterministically from a fixed seed. After a
+ fixed number of ticks it logs the frame statistics and, if configured to, quits.
+
+The counts are read from stress.cfg:
+ SPRITES, PARTICLES, SPINE_INSTANCES, STRINGS, BUTTONS, COLLIDERS - how many of each to create
+ TICKS - how many physics ticks to run for
+ SEED - seed used for all the random values
+ QUIT_WHEN_DONE - if non-zero the game will exit after reporting
+*/
+
+#include "../gameState.h"
+
+struct GameState stressTestScreenState;
+
+#endif // inclusion guard
@@ -3,6 +3,8 @@
 #include <string.h>
 #include <assert.h>
 
+#include "graphics.h"
+
 typedef struct {
 	Vector2 pos;
 	float scale;
@@ -15,13 +17,35 @@ typedef struct {
 	Matrix4 projectionMat;
 } Camera;
 
-#define NUM_CAMERAS 16
 static Camera cameras[NUM_CAMERAS];
 
+// what the renderer uses, copied from the cameras once everything for a frame has been drawn
+static Camera packetCameras[NUM_FRAME_PACKETS][NUM_CAMERAS];
+static int writePacket = 0;
+static int readPacket = 0;
+
 static float currentTime;
 static float endTime;
 
+// where between the start and end states the renderer is drawing, the same one everything else is drawn with
+static float renderTime = 1.0f;
+
 static int currCamera;
+static int currRenderCamera;
+
+// the world space area each active render camera could show, found when culling is prepared
+typedef struct {
+	uint32_t renderFlags;
+	bool unbounded;
+	Vector2 min;
+	Vector2 max;
+} CameraCullArea;
+
+static CameraCullArea cullAreas[NUM_CAMERAS];
+static int cullAreaCount = 0;
+static float cullMaxLerpTime = 1.0f;
+static int cullVisibleCount = 0;
+static int cullCulledCount = 0;
 
 /*
 Initialize all the cameras, set them to the identity.
@@ -34,6 +58,14 @@ void cam_Init( void )
 		cameras[i].start.scale = 1.0f;
 		cameras[i].end.scale = 1.0f;
 	}
+
+	memset( packetCameras, 0, sizeof( packetCameras ) );
+	for( int p = 0; p < NUM_FRAME_PACKETS; ++p ) {
+		for( int i = 0; i < NUM_CAMERAS; ++i ) {
+			packetCameras[p][i] = cameras[i];
+		}
+	}
+	renderTime = 1.0f;
 }
 
 /*
@@ -46,6 +78,9 @@ void cam_SetProjectionMatrices( int width, int height)
 
 	for( int i = 0; i < NUM_CAMERAS; ++i ) {
 		cameras[i].projectionMat = proj;
+		for( int p = 0; p < NUM_FRAME_PACKETS; ++p ) {
+			packetCameras[p][i].projectionMat = proj;
+		}
 	}
 }
 
@@ -82,8 +117,43 @@ void cam_FinalizeStates( float timeToEnd )
 	for( int i = 0; i < NUM_CAMERAS; ++i ) {
 		cameras[i].start = cameras[i].end;
 	}
-	currentTime = 0.0f;
 	endTime = timeToEnd;
+
+	// if we're rendering from a different packet than we're writing to the time is reset when it's acquired
+	if( writePacket == readPacket ) {
+		currentTime = 0.0f;
+	}
+}
+
+/*
+Copies the camera states into the frame packet being written to. Call this after everything has been drawn so
+ any changes made while drawing end up in the packet, the start states will be where the cameras ended when the
+ states were last finalized.
+*/
+void cam_SnapshotStates( void )
+{
+	for( int i = 0; i < NUM_CAMERAS; ++i ) {
+		packetCameras[writePacket][i] = cameras[i];
+	}
+}
+
+/*
+Sets which frame packet the camera states are copied into when they're snapshotted.
+*/
+void cam_SetWritePacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	writePacket = packet;
+}
+
+/*
+Sets which frame packet the renderer will use the camera states from, resets the time used for interpolation.
+*/
+void cam_SetReadPacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	readPacket = packet;
+	currentTime = 0.0f;
 }
 
 /*
@@ -94,6 +164,15 @@ void cam_Update( float dt )
 	currentTime += dt;
 }
 
+/*
+Sets where between their start and end states the render cameras are, should be the same value used to draw
+ everything else so they stay together. Anything past 1 will extrapolate past the end state.
+*/
+void cam_SetRenderTime( float t )
+{
+	renderTime = t;
+}
+
 /*
 Gets the view projection matrix for the specified camera.
  Returns <0 if there's a problem.
@@ -106,17 +185,19 @@ int cam_GetVPMatrix( int camera, Matrix4* out )
 	Vector2 invPos;
 	Matrix4 transTf, scaleTf;
 	Matrix4 view;
-	float t = clamp( 0.0f, 1.0f, ( currentTime / endTime ) );
-	vec2_Lerp( &( cameras[camera].start.pos ), &( cameras[camera].end.pos ), t, &pos );
+	Camera* renderCam = &( packetCameras[readPacket][camera] );
+	float t = renderTime;
+	vec2_Lerp( &( renderCam->start.pos ), &( renderCam->end.pos ), t, &pos );
 	vec2_Scale( &pos, -1.0f, &invPos ); // object movement is inverted from camera movement
 	mat4_CreateTranslation( invPos.x, invPos.y, 0.0f, &transTf );
 
-	float scale = lerp( cameras[camera].start.scale, cameras[camera].end.scale, t );
+	// lerp( ) clamps, the scale has to be able to go past the end with everything else
+	float scale = renderCam->start.scale + ( ( renderCam->end.scale - renderCam->start.scale ) * t );
 	mat4_CreateScale( scale, scale, 1.0f, &scaleTf );
 
 	mat4_Multiply( &transTf, &scaleTf, &view );
 	
-	mat4_Multiply( &( cameras[camera].projectionMat ), &view, out );
+	mat4_Multiply( &( renderCam->projectionMat ), &view, out );
 	
 	return 0;
 }
@@ -215,4 +296,149 @@ int cam_GetNextActiveCam( void )
 
 	currCamera = nextCamera;
 	return currCamera;
-}
\ No newline at end of file
+}
+
+/*
+Same as the normal iteration and flag functions but uses the camera states stored in the frame packet being rendered.
+ Needed so the renderer and the game can iterate through the cameras at the same time.
+*/
+uint32_t cam_GetRenderFlags( int camera )
+{
+	assert( camera < NUM_CAMERAS );
+	return packetCameras[readPacket][camera].renderFlags;
+}
+
+int cam_StartRenderIteration( void )
+{
+	currRenderCamera = 0;
+
+	while( ( currRenderCamera < NUM_CAMERAS ) && ( packetCameras[readPacket][currRenderCamera].renderFlags == 0 ) ) {
+		++currRenderCamera;
+	}
+
+	if( currRenderCamera >= NUM_CAMERAS ) {
+		return -1;
+	}
+
+	return currRenderCamera;
+}
+
+int cam_GetNextActiveRenderCam( void )
+{
+	int nextCamera = currRenderCamera + 1;
+	while ( ( nextCamera < NUM_CAMERAS ) && ( packetCameras[readPacket][nextCamera].renderFlags == 0 ) ) {
+		++nextCamera;
+	}
+
+	if( nextCamera >= NUM_CAMERAS ) {
+		return -1;
+	}
+
+	currRenderCamera = nextCamera;
+	return currRenderCamera;
+}
+
+// finds the range of world positions along one axis the camera could show, the view is screen = ( world * scale ) - pos
+//  so the ends of the range are ( screenEdge + pos ) / scale, with pos and scale anywhere between their start and
+//  furthest values the extremes are found from the extremes of each, the camera is drawn past the end state the same
+//  as everything else so the furthest values are found with the overshoot
+static bool findCullRange( float screenMin, float screenMax, float posStart, float posEnd, float scaleStart, float scaleEnd,
+	float overshoot, float* outMin, float* outMax )
+{
+	float posFar = posEnd + ( ( posEnd - posStart ) * overshoot );
+	float scaleFar = scaleEnd + ( ( scaleEnd - scaleStart ) * overshoot );
+	float minScale = MIN( scaleStart, MIN( scaleEnd, scaleFar ) );
+	float maxScale = MAX( scaleStart, MAX( scaleEnd, scaleFar ) );
+	if( minScale <= 0.0f ) {
+		return false;
+	}
+
+	float low = screenMin + MIN( posStart, MIN( posEnd, posFar ) );
+	float high = screenMax + MAX( posStart, MAX( posEnd, posFar ) );
+	(*outMin) = MIN( low / minScale, low / maxScale );
+	(*outMax) = MAX( high / minScale, high / maxScale );
+	return true;
+}
+
+/*
+Finds the area each active render camera could show between its start and end states, call this before testing
+ anything with cam_IsRenderAreaVisible( ). maxLerpTime is how far past the end state anything being tested will be
+ drawn, 1 if it never goes past the end state. Resets the culling counts.
+*/
+void cam_PrepareRenderCulling( float maxLerpTime )
+{
+	cullAreaCount = 0;
+	cullMaxLerpTime = MAX( 1.0f, maxLerpTime );
+	float overshoot = cullMaxLerpTime - 1.0f;
+	cullVisibleCount = 0;
+	cullCulledCount = 0;
+
+	for( int i = 0; i < NUM_CAMERAS; ++i ) {
+		Camera* renderCam = &( packetCameras[readPacket][i] );
+		if( renderCam->renderFlags == 0 ) {
+			continue;
+		}
+
+		CameraCullArea* area = &( cullAreas[cullAreaCount++] );
+		area->renderFlags = renderCam->renderFlags;
+
+		// the projection is orthographic, so the screen area is where it maps to the edges of clip space
+		const Matrix4* proj = &( renderCam->projectionMat );
+		if( ( proj->m[0] == 0.0f ) || ( proj->m[5] == 0.0f ) ) {
+			area->unbounded = true;
+			continue;
+		}
+		float screenX0 = ( -1.0f - proj->m[12] ) / proj->m[0];
+		float screenX1 = ( 1.0f - proj->m[12] ) / proj->m[0];
+		float screenY0 = ( -1.0f - proj->m[13] ) / proj->m[5];
+		float screenY1 = ( 1.0f - proj->m[13] ) / proj->m[5];
+
+		area->unbounded =
+			!findCullRange( MIN( screenX0, screenX1 ), MAX( screenX0, screenX1 ), renderCam->start.pos.x, renderCam->end.pos.x,
+				renderCam->start.scale, renderCam->end.scale, overshoot, &( area->min.x ), &( area->max.x ) ) ||
+			!findCullRange( MIN( screenY0, screenY1 ), MAX( screenY0, screenY1 ), renderCam->start.pos.y, renderCam->end.pos.y,
+				renderCam->start.scale, renderCam->end.scale, overshoot, &( area->min.y ), &( area->max.y ) );
+	}
+}
+
+/*
+Tests if an area moving from the start bounds to the end bounds could be seen by any active render camera with any
+ of the flags. The test is conservative, anything that could be seen at any point will be treated as visible.
+ Only valid after cam_PrepareRenderCulling( ) has been called.
+*/
+bool cam_IsRenderAreaVisible( uint32_t camFlags, Vector2 startMin, Vector2 startMax, Vector2 endMin, Vector2 endMax )
+{
+	// the area moves linearly, so it covers everything between the start and the furthest it can be drawn past the end
+	float overshoot = cullMaxLerpTime - 1.0f;
+	Vector2 min, max;
+	min.x = MIN( startMin.x, MIN( endMin.x, endMin.x + ( ( endMin.x - startMin.x ) * overshoot ) ) );
+	min.y = MIN( startMin.y, MIN( endMin.y, endMin.y + ( ( endMin.y - startMin.y ) * overshoot ) ) );
+	max.x = MAX( startMax.x, MAX( endMax.x, endMax.x + ( ( endMax.x - startMax.x ) * overshoot ) ) );
+	max.y = MAX( startMax.y, MAX( endMax.y, endMax.y + ( ( endMax.y - startMax.y ) * overshoot ) ) );
+
+	for( int i = 0; i < cullAreaCount; ++i ) {
+		CameraCullArea* area = &( cullAreas[i] );
+		if( ( area->renderFlags & camFlags ) == 0 ) {
+			continue;
+		}
+
+		if( area->unbounded ||
+			( ( min.x <= area->max.x ) && ( max.x >= area->min.x ) && ( min.y <= area->max.y ) && ( max.y >= area->min.y ) ) ) {
+			++cullVisibleCount;
+			return true;
+		}
+	}
+
+	++cullCulledCount;
+	return false;
+}
+
+/*
+Gets how many areas have been tested as visible and how many culled since the last call to
+ cam_PrepareRenderCulling( ). Either of the out parameters can be NULL.
+*/
+void cam_GetCullingStats( int* outVisible, int* outCulled )
+{
+	if( outVisible != NULL ) (*outVisible) = cullVisibleCount;
+	if( outCulled != NULL ) (*outCulled) = cullCulledCount;
+}
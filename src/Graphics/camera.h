@@ -2,11 +2,14 @@
 #define CAMERA_H
 
 #include <SDL.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "../Math/vector2.h"
 #include "../Math/matrix4.h"
 
+#define NUM_CAMERAS 16
+
 /*
 Initialize all the cameras, set them to the identity.
 */
@@ -34,13 +37,36 @@ Do everything that needs to be done when starting a new render set.
 */
 void cam_FinalizeStates( float timeToEnd );
 
+/*
+Copies the camera states into the frame packet being written to. Call this after everything has been drawn so
+ any changes made while drawing end up in the packet, the start states will be where the cameras ended when the
+ states were last finalized.
+*/
+void cam_SnapshotStates( void );
+
+/*
+Sets which frame packet the camera states are copied into when they're snapshotted.
+*/
+void cam_SetWritePacket( int packet );
+
+/*
+Sets which frame packet the renderer will use the camera states from, resets the time used for interpolation.
+*/
+void cam_SetReadPacket( int packet );
+
 /*
 Update all the cameras, call this before rendering stuff.
 */
 void cam_Update( float dt );
 
 /*
-s
+Sets where between their start and end states the render cameras are, should be the same value used to draw
+ everything else so they stay together. Anything past 1 will extrapolate past the end state.
+*/
+void cam_SetRenderTime( float t );
+
+/*
+Gets the view projection matrix for the specified camera.
  Returns <0 if there's a problem.
 */
 int cam_GetVPMatrix( int camera, Matrix4* out );
@@ -82,4 +108,32 @@ Gets the next active camera. A camera is active if it has any flags on.
 */
 int cam_GetNextActiveCam( void );
 
+/*
+Same as the normal iteration and flag functions but uses the camera states stored in the frame packet being rendered.
+ Needed so the renderer and the game can iterate through the cameras at the same time.
+*/
+uint32_t cam_GetRenderFlags( int camera );
+int cam_StartRenderIteration( void );
+int cam_GetNextActiveRenderCam( void );
+
+/*
+Finds the area each active render camera could show between its start and end states, call this before testing
+ anything with cam_IsRenderAreaVisible( ). maxLerpTime is how far past the end state anything being tested will be
+ drawn, 1 if it never goes past the end state. Resets the culling counts.
+*/
+void cam_PrepareRenderCulling( float maxLerpTime );
+
+/*
+Tests if an area moving from the start bounds to the end bounds could be seen by any active render camera with any
+ of the flags. The test is conservative, anything that could be seen at any point will be treated as visible.
+ Only valid after cam_PrepareRenderCulling( ) has been called.
+*/
+bool cam_IsRenderAreaVisible( uint32_t camFlags, Vector2 startMin, Vector2 startMax, Vector2 endMin, Vector2 endMax );
+
+/*
+Gets how many areas have been tested as visible and how many culled since the last call to
+ cam_PrepareRenderCulling( ). Either of the out parameters can be NULL.
+*/
+void cam_GetCullingStats( int* outVisible, int* outCulled );
+
 #endif /* inclusion guard */
\ No newline at end of file
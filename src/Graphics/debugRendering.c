@@ -2,22 +2,27 @@
 
 #include "glPlatform.h"
 #include <math.h>
+#include <assert.h>
 
 #include "../Math/matrix4.h"
 #include "color.h"
 #include "camera.h"
 #include "shaderManager.h"
 #include "glDebugging.h"
+#include "graphics.h"
+#include "gfxUtil.h"
+#include "glState.h"
+#include "renderStats.h"
 #include "../System/platformLog.h"
+#include "../Utils/stretchyBuffer.h"
+#include "../Math/mathUtil.h"
 
 static GLuint debugVAO;
 static GLuint debugVBO;
 static GLuint debugIBO;
 
-#define MAX_VERTS 2048
-#if MAX_VERTS % 2 == 1
-	#error "debugRendering MAX_VERTS needs to be divisible by 2."
-#endif
+// how many vertices the queues and buffers start with space for, they'll grow past this as needed
+#define INITIAL_VERTS 2048
 
 #define NUM_CIRC_VERTS 8
 
@@ -27,11 +32,16 @@ typedef struct {
 	unsigned int camFlags;
 } DebugVertex;
 
-static DebugVertex debugBuffer[MAX_VERTS];
-static int lastDebugVert;
+// one buffer per frame packet, vertices are queued into the write packet and rendered from the read packet
+static DebugVertex* sbDebugBuffers[NUM_FRAME_PACKETS] = { NULL };
+static int peakDebugVerts = 0;
+static int writePacket = 0;
+static int readPacket = 0;
 
-static GLuint debugIndicesBuffer[MAX_VERTS];
-static int lastDebugIndex;
+static GLuint* sbDebugIndices = NULL;
+
+static GPUBufferSize debugVBOSize;
+static GPUBufferSize debugIBOSize;
 
 static ShaderProgram debugShaderProgram;
 
@@ -46,13 +56,15 @@ static int createOGLObjects( void )
 	}
 
 	// reserver space for the buffers
-	GL( glBindVertexArray( debugVAO ) );
+	glState_BindVertexArray( debugVAO );
 
 	GL( glBindBuffer( GL_ARRAY_BUFFER, debugVBO ) );
-	GL( glBufferData( GL_ARRAY_BUFFER, sizeof( debugBuffer ), NULL, GL_DYNAMIC_DRAW ) );
+	gfxUtil_InitGPUBufferSize( &debugVBOSize, sizeof( DebugVertex ) * INITIAL_VERTS );
+	GL( glBufferData( GL_ARRAY_BUFFER, debugVBOSize.capacity, NULL, GL_DYNAMIC_DRAW ) );
 
 	GL( glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, debugIBO ) );
-	GL( glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( debugIndicesBuffer ), debugIndicesBuffer, GL_DYNAMIC_DRAW ) );
+	gfxUtil_InitGPUBufferSize( &debugIBOSize, sizeof( GLuint ) * INITIAL_VERTS );
+	GL( glBufferData( GL_ELEMENT_ARRAY_BUFFER, debugIBOSize.capacity, NULL, GL_DYNAMIC_DRAW ) );
 
 	GL( glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( DebugVertex ), (const GLvoid*)offsetof( DebugVertex, pos ) ) );
 	GL( glVertexAttribPointer( 2, 4, GL_FLOAT, GL_FALSE, sizeof( DebugVertex ), (const GLvoid*)offsetof( DebugVertex, color ) ) );
@@ -60,7 +72,7 @@ static int createOGLObjects( void )
 	GL( glEnableVertexAttribArray( 0 ) );
 	GL( glEnableVertexAttribArray( 2 ) );
 	
-	GL( glBindVertexArray( 0 ) );
+	glState_BindVertexArray( 0 );
 
 	return 0;
 }
@@ -80,13 +92,15 @@ static int createShader( void )
 	debugProgDef.fragmentShader = 1;
 	debugProgDef.vertexShader = 0;
 	debugProgDef.geometryShader = -1;
-	debugProgDef.uniformNames = "mvpMatrix";
+	// the view projection matrix comes from the camera block
+	debugProgDef.uniformNames = "";
 
 	if( shaders_Load( &( debugShaderDefs[0] ), sizeof( debugShaderDefs ) / sizeof( ShaderDefinition ),
 		&debugProgDef, &debugShaderProgram, 1 ) <= 0 ) {
 		llog( LOG_INFO, "Error compiling debug shaders.\n" );
 		return -1;
 	}
+	glState_SetupCameraBlock( debugShaderProgram.programID );
 
 	return 0;
 }
@@ -103,7 +117,12 @@ int debugRenderer_Init( void )
 		return -1;
 	}
 
-	lastDebugVert = -1;
+	for( int i = 0; i < NUM_FRAME_PACKETS; ++i ) {
+		sb_Reserve( sbDebugBuffers[i], INITIAL_VERTS );
+		sb_Clear( sbDebugBuffers[i] );
+	}
+	sb_Reserve( sbDebugIndices, INITIAL_VERTS );
+	peakDebugVerts = 0;
 
 	return 0;
 }
@@ -113,7 +132,36 @@ Empties the list of debug things to draw.
 */
 void debugRenderer_ClearVertices( void )
 {
-	lastDebugVert = -1;
+	sb_Clear( sbDebugBuffers[writePacket] );
+}
+
+/*
+Gets how many debug vertices have been queued since the last clear, the most that have been queued in a single
+ frame, and how many the current queue has space for before it has to grow. Any of the out parameters can be NULL.
+*/
+void debugRenderer_GetVertexStats( int* outQueued, int* outPeak, int* outCapacity )
+{
+	if( outQueued != NULL ) (*outQueued) = (int)sb_Count( sbDebugBuffers[writePacket] );
+	if( outPeak != NULL ) (*outPeak) = peakDebugVerts;
+	if( outCapacity != NULL ) (*outCapacity) = (int)sb_Reserved( sbDebugBuffers[writePacket] );
+}
+
+/*
+Sets which frame packet new debug vertices are queued into.
+*/
+void debugRenderer_SetWritePacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	writePacket = packet;
+}
+
+/*
+Sets which frame packet the debug vertices are rendered from.
+*/
+void debugRenderer_SetReadPacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	readPacket = packet;
 }
 
 /*
@@ -122,16 +170,13 @@ Some basic debug drawing functions.
 */
 static int queueDebugVert( unsigned int camFlags, Vector2 pos, Color color )
 {
-	if( lastDebugVert >= ( MAX_VERTS - 1 ) ) {
-		llog( LOG_VERBOSE, "Debug instruction queue full." );
-		return -1;
-	}
+	DebugVertex* vert = sb_Add( sbDebugBuffers[writePacket], 1 );
+	peakDebugVerts = MAX( peakDebugVerts, (int)sb_Count( sbDebugBuffers[writePacket] ) );
 
-	++lastDebugVert;
-	vec2ToVec3( &pos, 0.0f, &( debugBuffer[lastDebugVert].pos ) );
-	debugBuffer[lastDebugVert].color = color;
-	debugBuffer[lastDebugVert].color.a = 1.0f;
-	debugBuffer[lastDebugVert].camFlags = camFlags;
+	vec2ToVec3( &pos, 0.0f, &( vert->pos ) );
+	vert->color = color;
+	vert->color.a = 1.0f;
+	vert->camFlags = camFlags;
 
 	return 0;
 }
@@ -202,15 +247,16 @@ Draw all the debug lines.
 */
 void debugRenderer_Render( void )
 {
-	Matrix4 vpMat;
+	DebugVertex* debugBuffer = sbDebugBuffers[readPacket];
+	int lastDebugVert = (int)sb_Count( debugBuffer ) - 1;
 
 	if( lastDebugVert >= 0 ) {
-		GL( glDisable( GL_DEPTH_TEST ) );
-		GL( glDepthMask( GL_FALSE ) );
-		GL( glDisable( GL_BLEND ) );
+		glState_SetEnabled( GL_DEPTH_TEST, false );
+		glState_DepthMask( GL_FALSE );
+		glState_SetEnabled( GL_BLEND, false );
 
-		GL( glUseProgram( debugShaderProgram.programID ) );
-		GL( glBindVertexArray( debugVAO ) );
+		glState_UseProgram( debugShaderProgram.programID );
+		glState_BindVertexArray( debugVAO );
 
 		// using glGetIntegerv with GL_ARAY_BUFFER_BINDING returns the correct buffer name
 		//  but glBufferSubData will fail, the buffer is not mapped, so it seems like the
@@ -218,12 +264,18 @@ void debugRenderer_Render( void )
 		// so we shouldn't have to do this, but we do
 		// or i don't understand OpenGL as well as i think i do (most likely)
 		GL( glBindBuffer( GL_ARRAY_BUFFER, debugVBO ) );
+		gfxUtil_FitGPUBuffer( GL_ARRAY_BUFFER, &debugVBOSize, sizeof( DebugVertex ) * ( lastDebugVert + 1 ) );
 		GL( glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( DebugVertex ) * ( lastDebugVert + 1 ), debugBuffer ) );
+		renderStats_CountUpload( sizeof( DebugVertex ) * ( lastDebugVert + 1 ) );
 
-		for( int currCamera = cam_StartIteration( ); currCamera != -1; currCamera = cam_GetNextActiveCam( ) ) {
-			unsigned int camFlags = cam_GetFlags( currCamera );
-			cam_GetVPMatrix( currCamera, &vpMat );
-			GL( glUniformMatrix4fv( debugShaderProgram.uniformLocs[0], 1, GL_FALSE, &( vpMat.m[0] ) ) );
+		// every camera could see every vertex
+		sb_Clear( sbDebugIndices );
+		GLuint* debugIndicesBuffer = sb_Add( sbDebugIndices, lastDebugVert + 1 );
+		gfxUtil_FitGPUBuffer( GL_ELEMENT_ARRAY_BUFFER, &debugIBOSize, sizeof( GLuint ) * ( lastDebugVert + 1 ) );
+
+		for( int currCamera = cam_StartRenderIteration( ); currCamera != -1; currCamera = cam_GetNextActiveRenderCam( ) ) {
+			unsigned int camFlags = cam_GetRenderFlags( currCamera );
+			glState_BindCamera( currCamera );
 
 			// build the index array and render use it
 			int lastDebugIndex = -1;
@@ -236,9 +288,13 @@ void debugRenderer_Render( void )
 
 			GL( glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, sizeof( GLuint ) * ( lastDebugIndex + 1 ), debugIndicesBuffer ) );
 			GL( glDrawElements( GL_LINES, lastDebugIndex + 1, GL_UNSIGNED_INT, NULL ) );
+			renderStats_CountUpload( sizeof( GLuint ) * ( lastDebugIndex + 1 ) );
+			renderStats_CountDraw( 0 );
 		}
 
-		GL( glBindVertexArray( 0 ) );
-		GL( glUseProgram( 0 ) );
+		glState_BindVertexArray( 0 );
+		glState_UseProgram( 0 );
 	}
+
+	glDebugging_CheckPass( "debug renderer" );
 }
\ No newline at end of file
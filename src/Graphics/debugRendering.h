@@ -11,6 +11,22 @@ Empties the list of debug things to draw.
 */
 void debugRenderer_ClearVertices( void );
 
+/*
+Gets how many debug vertices have been queued since the last clear, the most that have been queued in a single
+ frame, and how many the current queue has space for before it has to grow. Any of the out parameters can be NULL.
+*/
+void debugRenderer_GetVertexStats( int* outQueued, int* outPeak, int* outCapacity );
+
+/*
+Sets which frame packet new debug vertices are queued into.
+*/
+void debugRenderer_SetWritePacket( int packet );
+
+/*
+Sets which frame packet the debug vertices are rendered from.
+*/
+void debugRenderer_SetReadPacket( int packet );
+
 /*
 Some basic debug drawing functions. The alpha value of colors are ignored.
   Returns 0 on success. Prints an error message to the log if it fails and returns -1.
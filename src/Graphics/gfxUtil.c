@@ -19,14 +19,164 @@
 #include <stb_rect_pack.h>
 
 #include "glDebugging.h"
+#include "glState.h"
 
 #include "../System/platformLog.h"
+#include "../Math/mathUtil.h"
+#include "../Utils/stretchyBuffer.h"
+
+// how many frames a buffer has to be mostly empty before it shrinks
+#define GPU_BUFFER_SHRINK_FRAMES 300
+
+// the most layers an array texture will hold before another one is made for the same size, fits in the used mask
+#define MAX_ARRAY_LAYERS 32
 
 typedef struct {
 	unsigned char* data;
 	int width, height, reqComp, comp;
 } LoadedImage;
 
+// the layers are only as many as have been needed, the array grows a layer at a time as textures are added to it
+typedef struct {
+	GLuint textureID;
+	int width;
+	int height;
+	int layerCount;
+	uint32_t usedLayers;
+} TextureArray;
+
+static bool useTextureArrays = false;
+static TextureArray* sbTextureArrays = NULL;
+static GLuint layerCopyFBO = 0;
+
+/*
+Sets whether RGBA textures created after this are put into layers of array textures. Textures with the same size
+ share an array so they can be drawn together without switching textures. Alpha bitmaps and textures created from
+ surfaces are never put into arrays.
+*/
+void gfxUtil_SetTextureArraysEnabled( bool enabled )
+{
+	useTextureArrays = enabled;
+}
+
+static void setArrayStorage( GLuint textureID, int width, int height, int layerCount )
+{
+	glState_BindTexture( 0, GL_TEXTURE_2D_ARRAY, textureID );
+
+	GL( glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR ) );
+	GL( glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR ) );
+
+	GL( glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE ) );
+	GL( glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE ) );
+
+	GL( glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL ) );
+}
+
+// copies the first count layers from one array texture to another through a framebuffer, leaves dest bound
+static void copyArrayLayers( GLuint src, GLuint dest, int count, int width, int height )
+{
+	if( layerCopyFBO == 0 ) {
+		GL( glGenFramebuffers( 1, &layerCopyFBO ) );
+	}
+
+	GLint prevReadFBO;
+	GL( glGetIntegerv( GL_READ_FRAMEBUFFER_BINDING, &prevReadFBO ) );
+
+	GL( glBindFramebuffer( GL_READ_FRAMEBUFFER, layerCopyFBO ) );
+	glState_BindTexture( 0, GL_TEXTURE_2D_ARRAY, dest );
+	for( int i = 0; i < count; ++i ) {
+		GL( glFramebufferTextureLayer( GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, src, 0, i ) );
+		GL( glCopyTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, 0, 0, width, height ) );
+	}
+	GL( glFramebufferTextureLayer( GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0 ) );
+
+	GL( glBindFramebuffer( GL_READ_FRAMEBUFFER, (GLuint)prevReadFBO ) );
+}
+
+// adds a layer to the end of the array, the storage can't be resized so the existing layers are copied out to a
+//  temporary array and back in, that way the id stays the same for the textures already using the array
+static void growTextureArray( TextureArray* array )
+{
+	GLuint tempID = 0;
+	if( array->layerCount > 0 ) {
+		GL( glGenTextures( 1, &tempID ) );
+		setArrayStorage( tempID, array->width, array->height, array->layerCount );
+		copyArrayLayers( array->textureID, tempID, array->layerCount, array->width, array->height );
+	}
+
+	setArrayStorage( array->textureID, array->width, array->height, array->layerCount + 1 );
+
+	if( tempID != 0 ) {
+		copyArrayLayers( tempID, array->textureID, array->layerCount, array->width, array->height );
+		glState_DeleteTextures( 1, &tempID );
+	}
+
+	++array->layerCount;
+}
+
+// finds an unused layer in an array for textures of this size, creating or growing an array if needed, the array
+//  the layer is in is left bound
+static int reserveArrayLayer( int width, int height, GLuint* outTextureID, int* outLayer )
+{
+	TextureArray* array = NULL;
+	TextureArray* emptySlot = NULL;
+	for( size_t i = 0; ( i < sb_Count( sbTextureArrays ) ) && ( array == NULL ); ++i ) {
+		TextureArray* test = &( sbTextureArrays[i] );
+		if( test->textureID == 0 ) {
+			emptySlot = test;
+		} else if( ( test->width == width ) && ( test->height == height ) && ( test->usedLayers != UINT32_MAX ) ) {
+			array = test;
+		}
+	}
+
+	if( array == NULL ) {
+		array = ( emptySlot != NULL ) ? emptySlot : sb_Add( sbTextureArrays, 1 );
+		GL( glGenTextures( 1, &( array->textureID ) ) );
+		if( array->textureID == 0 ) {
+			llog( LOG_INFO, "Unable to create array texture object." );
+			return -1;
+		}
+		array->width = width;
+		array->height = height;
+		array->layerCount = 0;
+		array->usedLayers = 0;
+	}
+
+	int layer = 0;
+	while( ( layer < array->layerCount ) && ( array->usedLayers & ( 1u << layer ) ) ) {
+		++layer;
+	}
+
+	if( layer >= array->layerCount ) {
+		growTextureArray( array );
+	} else {
+		glState_BindTexture( 0, GL_TEXTURE_2D_ARRAY, array->textureID );
+	}
+
+	array->usedLayers |= ( 1u << layer );
+	(*outTextureID) = array->textureID;
+	(*outLayer) = layer;
+	return 0;
+}
+
+static void releaseArrayLayer( GLuint textureID, int layer )
+{
+	for( size_t i = 0; i < sb_Count( sbTextureArrays ); ++i ) {
+		TextureArray* array = &( sbTextureArrays[i] );
+		if( array->textureID != textureID ) {
+			continue;
+		}
+
+		array->usedLayers &= ~( 1u << layer );
+		if( array->usedLayers == 0 ) {
+			glState_DeleteTextures( 1, &( array->textureID ) );
+			array->textureID = 0;
+			array->layerCount = 0;
+		}
+		return;
+	}
+}
+
 /*
 Converts the LoadedImage into a texture, putting everything in outTexture. All LoadedImages are assumed to be in RGBA format.
  Returns >= 0 if everything went fine, < 0 if something went wrong.
@@ -35,23 +185,33 @@ int createTextureFromLoadedImage( GLenum texFormat, LoadedImage* image, Texture*
 {
 	//GLenum texFormat = GL_RGBA;
 
-	GL( glGenTextures( 1, &( outTexture->textureID ) ) );
+	if( useTextureArrays && ( texFormat == GL_RGBA ) ) {
+		if( reserveArrayLayer( image->width, image->height, &( outTexture->textureID ), &( outTexture->layer ) ) < 0 ) {
+			return -1;
+		}
 
-	if( outTexture->textureID == 0 ) {
-		llog( LOG_INFO, "Unable to create texture object." );
-		return -1;
-	}
+		GL( glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, outTexture->layer, image->width, image->height, 1,
+			texFormat, GL_UNSIGNED_BYTE, image->data ) );
+	} else {
+		GL( glGenTextures( 1, &( outTexture->textureID ) ) );
+
+		if( outTexture->textureID == 0 ) {
+			llog( LOG_INFO, "Unable to create texture object." );
+			return -1;
+		}
+		outTexture->layer = -1;
 
-	GL( glBindTexture( GL_TEXTURE_2D, outTexture->textureID ) );
+		glState_BindTexture( 0, GL_TEXTURE_2D, outTexture->textureID );
 
-	// assuming these will look good for now, we shouldn't be too much resizing, but if we do we can go over these again
-	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR ) );
-	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR ) );
+		// assuming these will look good for now, we shouldn't be too much resizing, but if we do we can go over these again
+		GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR ) );
+		GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR ) );
 
-	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE ) );
-	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE ) );
+		GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE ) );
+		GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE ) );
 
-	GL( glTexImage2D( GL_TEXTURE_2D, 0, texFormat, image->width, image->height, 0, texFormat, GL_UNSIGNED_BYTE, image->data ) );
+		GL( glTexImage2D( GL_TEXTURE_2D, 0, texFormat, image->width, image->height, 0, texFormat, GL_UNSIGNED_BYTE, image->data ) );
+	}
 
 	outTexture->width = image->width;
 	outTexture->height = image->height;
@@ -157,8 +317,9 @@ int gfxUtil_CreateTextureFromSurface( SDL_Surface* surface, Texture* outTexture
 		llog( LOG_INFO, "Unable to create texture object." );
 		return -1;
 	}
+	outTexture->layer = -1;
 
-	glBindTexture( GL_TEXTURE_2D, outTexture->textureID );
+	glState_BindTexture( 0, GL_TEXTURE_2D, outTexture->textureID );
 
 	// assuming these will look good for now, we shouldn't be too much resizing, but if we do we can go over these again
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
@@ -214,6 +375,7 @@ clean_up:
 
 /*
 Turns a single channel bitmap into a texture. Takes in a pointer to a Texture structure that it puts all the generated data into.
+ The texture samples as white with the bitmap in the alpha channel.
  Returns >= 0 on success, < 0 on failure.
 */
 int gfxUtil_CreateTextureFromAlphaBitmap( uint8_t* data, int width, int height, Texture* outTexture )
@@ -235,17 +397,50 @@ int gfxUtil_CreateTextureFromAlphaBitmap( uint8_t* data, int width, int height,
 		goto clean_up;
 	}
 
+	// the texture has to sample as white with the coverage in the alpha so the default shader can draw it
+#if defined( __EMSCRIPTEN__ )
+	// WebGL doesn't support texture swizzles, so store the white along with the coverage
+	uint8_t* luminanceAlpha = mem_Allocate( (size_t)( width * height * 2 ) );
+	if( luminanceAlpha == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate memory for alpha bitmap." );
+		returnCode = -1;
+		goto clean_up;
+	}
+
+	for( int i = 0; i < ( width * height ); ++i ) {
+		luminanceAlpha[i*2] = 0xFF;
+		luminanceAlpha[(i*2)+1] = data[i];
+	}
+	image.data = luminanceAlpha;
+	image.reqComp = image.comp = 2;
+
+	returnCode = createTextureFromLoadedImage( GL_LUMINANCE_ALPHA, &image, outTexture );
+	mem_Release( luminanceAlpha );
+	if( returnCode < 0 ) {
+		goto clean_up;
+	}
+#else
 	GLenum texFormat;
-#if defined( __ANDROID__ ) || defined( __EMSCRIPTEN__ )
+	GLint coverageSwizzle;
+#if defined( __ANDROID__ )
 	texFormat = GL_ALPHA;
+	coverageSwizzle = GL_ALPHA;
 #else
 	texFormat = GL_RED;
+	coverageSwizzle = GL_RED;
 #endif
 	if( createTextureFromLoadedImage( texFormat, &image, outTexture ) < 0 ) {
 		returnCode = -1;
 		goto clean_up;
 	}
 
+	// the texture is still bound from being created
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ONE ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, coverageSwizzle ) );
+#endif
+
 clean_up:
 	return returnCode;
 }
@@ -255,8 +450,13 @@ Unloads the passed in texture. After doing this the texture will be invalid and
 */
 void gfxUtil_UnloadTexture( Texture* texture )
 {
-	glDeleteTextures( 1, &( texture->textureID ) );
+	if( texture->layer >= 0 ) {
+		releaseArrayLayer( texture->textureID, texture->layer );
+	} else {
+		glState_DeleteTextures( 1, &( texture->textureID ) );
+	}
 	texture->textureID = 0;
+	texture->layer = -1;
 	texture->flags = 0;
 }
 
@@ -296,4 +496,62 @@ int gfxUtil_SurfaceIsTranslucent( SDL_Surface* surface )
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
+
+/*
+Sets up the size tracking for a growable buffer object. The buffer will never shrink below the initial capacity.
+*/
+void gfxUtil_InitGPUBufferSize( GPUBufferSize* size, size_t initialCapacity )
+{
+	size->capacity = initialCapacity;
+	size->minCapacity = initialCapacity;
+	size->underusedFrames = 0;
+}
+
+/*
+Updates the capacity of a growable buffer for how much it needs to hold this frame. It grows past what's needed so
+ a scene getting slightly busier doesn't reallocate every frame, and only shrinks after the usage has stayed well
+ under the capacity for a while. Doesn't touch the buffer object itself, should be called once a frame.
+ Returns 1 if the capacity changed and the buffer needs to be reallocated, 0 otherwise.
+*/
+int gfxUtil_UpdateGPUBufferSize( GPUBufferSize* size, size_t neededSize )
+{
+	size_t newCapacity = size->capacity;
+
+	if( neededSize > size->capacity ) {
+		newCapacity = neededSize + ( neededSize / 2 );
+		size->underusedFrames = 0;
+	} else if( ( neededSize < ( size->capacity / 4 ) ) && ( size->capacity > size->minCapacity ) ) {
+		// only halve it at a time, everything used in the last while has fit in a quarter so this still leaves room
+		++size->underusedFrames;
+		if( size->underusedFrames >= GPU_BUFFER_SHRINK_FRAMES ) {
+			newCapacity = MAX( size->minCapacity, ( size->capacity / 2 ) );
+			size->underusedFrames = 0;
+		}
+	} else {
+		size->underusedFrames = 0;
+	}
+
+	if( newCapacity == size->capacity ) {
+		return 0;
+	}
+
+	llog( LOG_VERBOSE, "Resizing buffer from %i to %i bytes.", (int)size->capacity, (int)newCapacity );
+	size->capacity = newCapacity;
+	return 1;
+}
+
+/*
+Makes sure the buffer currently bound to target can hold at least neededSize bytes, reallocating it if it can't.
+ Uses gfxUtil_UpdateGPUBufferSize to decide the size so should be called once a frame for each buffer.
+ Returns 1 if the buffer was reallocated, which throws away its contents, 0 otherwise.
+*/
+int gfxUtil_FitGPUBuffer( GLenum target, GPUBufferSize* size, size_t neededSize )
+{
+	if( !gfxUtil_UpdateGPUBufferSize( size, neededSize ) ) {
+		return 0;
+	}
+
+	GL( glBufferData( target, (GLsizeiptr)size->capacity, NULL, GL_DYNAMIC_DRAW ) );
+	return 1;
+}
@@ -1,6 +1,8 @@
 #ifndef GFX_UTIL_H
 #define GFX_UTIL_H
 
+#include <stdbool.h>
+
 #include "../Graphics/glPlatform.h"
 #include "../Math/vector2.h"
 #include <SDL_surface.h>
@@ -10,8 +12,11 @@ enum TextureFlags {
 	TF_IS_TRANSPARENT = 0x1
 };
 
+// if the layer is >= 0 the texture id is for an array texture, bound to GL_TEXTURE_2D_ARRAY, that's shared with other
+//  textures of the same size, otherwise it's a normal GL_TEXTURE_2D
 typedef struct {
 	GLuint textureID;
+	int layer;
 	int width;
 	int height;
 	int flags;
@@ -23,6 +28,20 @@ typedef struct {
 	Texture texture;
 } AtlasResult;
 
+// tracks the size of a buffer object that grows and shrinks with how much is being put into it
+typedef struct {
+	size_t capacity;
+	size_t minCapacity;
+	int underusedFrames;
+} GPUBufferSize;
+
+/*
+Sets whether RGBA textures created after this are put into layers of array textures. Textures with the same size
+ share an array so they can be drawn together without switching textures. Alpha bitmaps and textures created from
+ surfaces are never put into arrays.
+*/
+void gfxUtil_SetTextureArraysEnabled( bool enabled );
+
 /*
 Loads the image at the file name. Takes in a pointer to a Texture structure that it puts all the generated data into.
  Returns >= 0 on success, < 0 on failure.
@@ -43,6 +62,7 @@ int gfxUtil_CreateTextureFromRGBABitmap( uint8_t* data, int width, int height, T
 
 /*
 Turns a single channel bitmap into a texture. Takes in a pointer to a Texture structure that it puts all the generated data into.
+ The texture samples as white with the bitmap in the alpha channel.
  Returns >= 0 on success, < 0 on failure.
 */
 int gfxUtil_CreateTextureFromAlphaBitmap( uint8_t* data, int width, int height, Texture* outTexture );
@@ -57,4 +77,24 @@ Returns whether the SDL_Surface has any pixels that have a transparency that are
 */
 int gfxUtil_SurfaceIsTranslucent( SDL_Surface* surface );
 
+/*
+Sets up the size tracking for a growable buffer object. The buffer will never shrink below the initial capacity.
+*/
+void gfxUtil_InitGPUBufferSize( GPUBufferSize* size, size_t initialCapacity );
+
+/*
+Updates the capacity of a growable buffer for how much it needs to hold this frame. It grows past what's needed so
+ a scene getting slightly busier doesn't reallocate every frame, and only shrinks after the usage has stayed well
+ under the capacity for a while. Doesn't touch the buffer object itself, should be called once a frame.
+ Returns 1 if the capacity changed and the buffer needs to be reallocated, 0 otherwise.
+*/
+int gfxUtil_UpdateGPUBufferSize( GPUBufferSize* size, size_t neededSize );
+
+/*
+Makes sure the buffer currently bound to target can hold at least neededSize bytes, reallocating it if it can't.
+ Uses gfxUtil_UpdateGPUBufferSize to decide the size so should be called once a frame for each buffer.
+ Returns 1 if the buffer was reallocated, which throws away its contents, 0 otherwise.
+*/
+int gfxUtil_FitGPUBuffer( GLenum target, GPUBufferSize* size, size_t neededSize );
+
 #endif /* inclusion guard */
\ No newline at end of file
@@ -1,18 +1,194 @@
 #include "glDebugging.h"
 
+#include <SDL_video.h>
+
 #include "../System/platformLog.h"
 
+// the KHR_debug functions aren't in the headers on every platform, so they're loaded when the mode is chosen
+typedef void ( GL_PROC_API *DebugOutputCallback )( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+	const GLchar* message, const void* userParam );
+typedef void ( GL_PROC_API *DebugMessageCallbackFunc )( DebugOutputCallback callback, const void* userParam );
+typedef void ( GL_PROC_API *DebugMessageControlFunc )( GLenum source, GLenum type, GLenum severity, GLsizei count,
+	const GLuint* ids, GLboolean enabled );
+
+static GLErrorCheckMode checkMode = DEFAULT_GL_ERROR_CHECK_MODE;
+bool glCheckEveryCall = ( DEFAULT_GL_ERROR_CHECK_MODE == GLEC_CALL );
+
+static DebugMessageCallbackFunc debugMessageCallback = NULL;
+static DebugMessageControlFunc debugMessageControl = NULL;
+
+// the messages can come in from any thread the driver wants, so this only logs
+static void GL_PROC_API debugOutput( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+	const GLchar* message, const void* userParam )
+{
+	const char* severityName;
+	switch( severity ) {
+	case GL_DEBUG_SEVERITY_HIGH:
+		severityName = "high";
+		break;
+	case GL_DEBUG_SEVERITY_MEDIUM:
+		severityName = "medium";
+		break;
+	case GL_DEBUG_SEVERITY_LOW:
+		severityName = "low";
+		break;
+	default:
+		severityName = "notification";
+		break;
+	}
+
+	if( ( type == GL_DEBUG_TYPE_ERROR ) || ( severity == GL_DEBUG_SEVERITY_HIGH ) ) {
+		llog( LOG_ERROR, "GL debug %u (%s): %s", id, severityName, message );
+	} else if( severity == GL_DEBUG_SEVERITY_NOTIFICATION ) {
+		llog( LOG_VERBOSE, "GL debug %u (%s): %s", id, severityName, message );
+	} else {
+		llog( LOG_WARN, "GL debug %u (%s): %s", id, severityName, message );
+	}
+}
+
+// KHR_debug is core in newer versions so the functions may or may not have the suffix
+static bool loadDebugOutput( void )
+{
+	if( debugMessageCallback != NULL ) {
+		return true;
+	}
+
+	if( !SDL_GL_ExtensionSupported( "GL_KHR_debug" ) ) {
+		return false;
+	}
+
+	debugMessageCallback = (DebugMessageCallbackFunc)SDL_GL_GetProcAddress( "glDebugMessageCallback" );
+	debugMessageControl = (DebugMessageControlFunc)SDL_GL_GetProcAddress( "glDebugMessageControl" );
+	if( ( debugMessageCallback == NULL ) || ( debugMessageControl == NULL ) ) {
+		debugMessageCallback = (DebugMessageCallbackFunc)SDL_GL_GetProcAddress( "glDebugMessageCallbackKHR" );
+		debugMessageControl = (DebugMessageControlFunc)SDL_GL_GetProcAddress( "glDebugMessageControlKHR" );
+	}
+
+	if( ( debugMessageCallback == NULL ) || ( debugMessageControl == NULL ) ) {
+		debugMessageCallback = NULL;
+		debugMessageControl = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+// throws away any errors that are waiting so they aren't blamed on something later
+static void clearErrors( void )
+{
+	while( glGetError( ) != GL_NO_ERROR ) {
+		;
+	}
+}
+
+/*
+Chooses how OpenGL errors are looked for. GLEC_DEBUG_OUTPUT needs a current context, if KHR_debug isn't supported
+ it falls back to GLEC_FRAME. Returns the mode that's being used.
+*/
+GLErrorCheckMode glDebugging_SetErrorCheckMode( GLErrorCheckMode mode )
+{
+	if( ( (int)mode < 0 ) || ( mode >= NUM_GL_ERROR_CHECK_MODES ) ) {
+		llog( LOG_WARN, "Unknown GL error check mode %i, checking every frame instead.", (int)mode );
+		mode = GLEC_FRAME;
+	}
+
+	if( mode == GLEC_DEBUG_OUTPUT ) {
+		if( loadDebugOutput( ) ) {
+			clearErrors( );
+			glEnable( GL_DEBUG_OUTPUT );
+			debugMessageCallback( debugOutput, NULL );
+			// notifications are mostly drivers describing what they're doing
+			debugMessageControl( GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE );
+		} else {
+			llog( LOG_WARN, "KHR_debug isn't supported, checking for GL errors every frame instead." );
+			mode = GLEC_FRAME;
+		}
+	} else if( ( checkMode == GLEC_DEBUG_OUTPUT ) && ( debugMessageCallback != NULL ) ) {
+		debugMessageCallback( NULL, NULL );
+		glDisable( GL_DEBUG_OUTPUT );
+	}
+
+	checkMode = mode;
+	glCheckEveryCall = ( mode == GLEC_CALL );
+
+	return mode;
+}
+
+GLErrorCheckMode glDebugging_GetErrorCheckMode( void )
+{
+	return checkMode;
+}
+
+/*
+Filters the messages the driver sends when using GLEC_DEBUG_OUTPUT. Anything less severe than minSeverity, which is
+ one of the GL_DEBUG_SEVERITY_* values, isn't sent. Has to be called after the mode is set.
+*/
+void glDebugging_SetDebugOutputSeverity( GLenum minSeverity )
+{
+	if( ( checkMode != GLEC_DEBUG_OUTPUT ) || ( debugMessageControl == NULL ) ) {
+		return;
+	}
+
+	// from most to least severe
+	GLenum severities[] = { GL_DEBUG_SEVERITY_HIGH, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_NOTIFICATION };
+	bool enabled = true;
+	for( size_t i = 0; i < ( sizeof( severities ) / sizeof( severities[0] ) ); ++i ) {
+		debugMessageControl( GL_DONT_CARE, GL_DONT_CARE, severities[i], 0, NULL, enabled ? GL_TRUE : GL_FALSE );
+		if( severities[i] == minSeverity ) {
+			enabled = false;
+		}
+	}
+}
+
+/*
+Stops the driver sending the message with the id when using GLEC_DEBUG_OUTPUT. For messages that are known and
+ don't matter but would otherwise fill up the log. Has to be called after the mode is set.
+*/
+void glDebugging_IgnoreDebugOutputMessage( GLuint id )
+{
+	if( ( checkMode != GLEC_DEBUG_OUTPUT ) || ( debugMessageControl == NULL ) ) {
+		return;
+	}
+
+	debugMessageControl( GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 1, &id, GL_FALSE );
+}
+
+/*
+Called after each rendering pass and at the end of each frame, they only check for errors if the mode wants them to.
+*/
+void glDebugging_CheckPass( const char* passName )
+{
+	if( checkMode == GLEC_PASS ) {
+		checkAndLogErrors( passName );
+	}
+}
+
+void glDebugging_CheckFrame( void )
+{
+	switch( checkMode ) {
+	case GLEC_FRAME:
+	case GLEC_PASS:
+		// anything done between the passes is caught here
+		checkAndLogErrors( "end of frame" );
+		break;
+	case GLEC_DEBUG_OUTPUT:
+		// the driver has already reported these
+		clearErrors( );
+		break;
+	default:
+		break;
+	}
+}
+
 // some error check dumping, returns < 0 if there was an error
+//  the errors are always logged, the modes that only check occasionally are meant to be left on in release builds
 int checkAndLogErrors( const char* extraInfo )
 {
-#ifdef _DEBUG
 	char* errorMsg;
-#endif
 	int ret = 0;
 	GLenum error = glGetError( );
 
 	while( error != GL_NO_ERROR ) {
-#ifdef _DEBUG
 		switch( error ) {
 		case GL_INVALID_ENUM:
 			errorMsg = "Invalid enumeration";
@@ -39,7 +215,6 @@ int checkAndLogErrors( const char* extraInfo )
 		} else {
 			llog( LOG_ERROR, "Error: %s at %s", errorMsg, extraInfo );
 		}
-#endif
 		ret = -1;
 		error = glGetError( );
 	}
@@ -1,33 +1,92 @@
 #ifndef GL_DEBUGGING_H
 #define GL_DEBUGGING_H
 
+#include <stdbool.h>
+
 #include "../Graphics/glPlatform.h"
 
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
 
+// KHR_debug isn't part of the headers on every platform
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+#ifndef GL_DEBUG_TYPE_ERROR
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#endif
+#ifndef GL_DEBUG_SEVERITY_HIGH
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#endif
+#ifndef GL_DEBUG_SEVERITY_MEDIUM
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#endif
+#ifndef GL_DEBUG_SEVERITY_LOW
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#endif
+#ifndef GL_DEBUG_SEVERITY_NOTIFICATION
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#endif
+#ifndef GL_DONT_CARE
+#define GL_DONT_CARE 0x1100
+#endif
+
+// uncomment to check for errors after every call unless something else is chosen
 //#define DEBUG_GL
 
-// all the different combinations D: Description, R: GL function return, C: Check error return
+typedef enum {
+	GLEC_OFF, // never checks
+	GLEC_FRAME, // checks once at the end of each frame
+	GLEC_PASS, // checks after each rendering pass
+	GLEC_CALL, // checks after every call, this forces the driver to sync on a lot of platforms so it's slow
+	GLEC_DEBUG_OUTPUT, // the driver reports problems through KHR_debug as they happen, needs a debug context
+	NUM_GL_ERROR_CHECK_MODES
+} GLErrorCheckMode;
+
 #ifdef DEBUG_GL
-#define GL(x) do { (x); checkAndLogErrors( __FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#define GLD(d,x) do { (x); checkAndLogErrors( d" "__FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#define GLR(r,x) do { (r)=(x); checkAndLogErrors( __FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#define GLC(c,x) do { (x); (c)=checkAndLogErrors( __FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#define GLDR(d,r,x) do { (r)=(x); checkAndLogErrors( d" "__FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#define GLDC(d,c,x) do { (x); (c)=checkAndLogErrors( d" "__FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#define GLRC(r,c,x) do { (r)=(x); (c)=checkAndLogErrors( __FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#define GLDRC(d,r,c,x) do { (r)=(x); (c)=checkAndLogErrors( d" "__FILE__":"TOSTRING(__LINE__) ); } while(0,0)
+#define DEFAULT_GL_ERROR_CHECK_MODE GLEC_CALL
 #else
-#define GL(x) do { (x); } while(0,0)
-#define GLD(d,x) do { (x); } while(0,0)
-#define GLR(r,x) do { (r)=(x); } while(0,0)
+#define DEFAULT_GL_ERROR_CHECK_MODE GLEC_FRAME
+#endif
+
+// only used by the macros below, use glDebugging_SetErrorCheckMode( ) to change it
+extern bool glCheckEveryCall;
+
+// all the different combinations D: Description, R: GL function return, C: Check error return
+//  the ones that don't return the check only check when checking every call
+#define GL(x) do { (x); if( glCheckEveryCall ) checkAndLogErrors( __FILE__":"TOSTRING(__LINE__) ); } while(0,0)
+#define GLD(d,x) do { (x); if( glCheckEveryCall ) checkAndLogErrors( d" "__FILE__":"TOSTRING(__LINE__) ); } while(0,0)
+#define GLR(r,x) do { (r)=(x); if( glCheckEveryCall ) checkAndLogErrors( __FILE__":"TOSTRING(__LINE__) ); } while(0,0)
 #define GLC(c,x) do { (x); (c)=checkAndLogErrors( __FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#define GLDR(d,r,x) do { (r)=(x); } while(0,0)
+#define GLDR(d,r,x) do { (r)=(x); if( glCheckEveryCall ) checkAndLogErrors( d" "__FILE__":"TOSTRING(__LINE__) ); } while(0,0)
 #define GLDC(d,c,x) do { (x); (c)=checkAndLogErrors( d" "__FILE__":"TOSTRING(__LINE__) ); } while(0,0)
 #define GLRC(r,c,x) do { (r)=(x); (c)=checkAndLogErrors( __FILE__":"TOSTRING(__LINE__) ); } while(0,0)
 #define GLDRC(d,r,c,x) do { (r)=(x); (c)=checkAndLogErrors( d" "__FILE__":"TOSTRING(__LINE__) ); } while(0,0)
-#endif
+
+/*
+Chooses how OpenGL errors are looked for. GLEC_DEBUG_OUTPUT needs a current context, if KHR_debug isn't supported
+ it falls back to GLEC_FRAME. Returns the mode that's being used.
+*/
+GLErrorCheckMode glDebugging_SetErrorCheckMode( GLErrorCheckMode mode );
+GLErrorCheckMode glDebugging_GetErrorCheckMode( void );
+
+/*
+Filters the messages the driver sends when using GLEC_DEBUG_OUTPUT. Anything less severe than minSeverity, which is
+ one of the GL_DEBUG_SEVERITY_* values, isn't sent. Has to be called after the mode is set.
+*/
+void glDebugging_SetDebugOutputSeverity( GLenum minSeverity );
+
+/*
+Stops the driver sending the message with the id when using GLEC_DEBUG_OUTPUT. For messages that are known and
+ don't matter but would otherwise fill up the log. Has to be called after the mode is set.
+*/
+void glDebugging_IgnoreDebugOutputMessage( GLuint id );
+
+/*
+Called after each rendering pass and at the end of each frame, they only check for errors if the mode wants them to.
+*/
+void glDebugging_CheckPass( const char* passName );
+void glDebugging_CheckFrame( void );
 
 int checkAndLogErrors( const char* extraInfo );
 int checkAndLogFrameBufferCompleteness( GLenum target, const char* extraInfo );
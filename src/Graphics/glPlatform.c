@@ -20,6 +20,9 @@ int glInit( void )
 	return 0;
 #elif defined( __EMSCRIPTEN__ )
 	return 0;
+#elif defined( XTUROS_GLES )
+	// linked directly against the OpenGL ES library, nothing to load
+	return 0;
 #else
 	llog( LOG_ERROR, "OpenGL not setup for this platform." );
 	return -1;
@@ -4,9 +4,10 @@
 #include <SDL_video.h>
 
 /*
-Handles the platform specific OpenGL stuff.
+Handles the platform specific OpenGL stuff. Any other build that wants the OpenGL ES 3 path, like the benchmarks,
+ defines XTUROS_GLES.
 */
-#if defined( __ANDROID__ ) || defined( __EMSCRIPTEN__ )
+#if defined( __ANDROID__ ) || defined( __EMSCRIPTEN__ ) || defined( XTUROS_GLES )
 
 #include <GLES3/gl3.h>
 #if defined( __EMSCRIPTEN__ )
@@ -23,57 +24,133 @@ Handles the platform specific OpenGL stuff.
 // some default shaders
 #define DEFAULT_VERTEX_SHADER \
 	"#version 300 es\n" \
-	"uniform mat4 vpMatrix;\n" \
-	"layout(location = 0) in vec3 vVertex;\n" \
+	"layout(std140) uniform CameraBlock { mat4 vpMatrix; };\n" \
+	"uniform vec2 lerpTimes;\n" \
+	"layout(location = 0) in vec2 vStartPos;\n" \
 	"layout(location = 1) in vec2 vTexCoord0;\n" \
-	"layout(location = 2) in vec4 vColor;\n" \
+	"layout(location = 2) in vec4 vStartColor;\n" \
+	"layout(location = 3) in vec2 vEndPos;\n" \
+	"layout(location = 4) in vec4 vEndColor;\n" \
+	"layout(location = 5) in float vDepth;\n" \
+	"layout(location = 6) in float vLayer;\n" \
 	"out vec2 vTex;\n" \
+	"flat out float vTexLayer;\n" \
 	"out vec4 vCol;\n" \
 	"void main( void )\n" \
 	"{\n" \
 	"	vTex = vTexCoord0;\n" \
-	"	vCol = vColor;\n" \
-	"	gl_Position = vpMatrix * vec4( vVertex, 1.0f );\n" \
+	"	vTexLayer = vLayer;\n" \
+	"	vCol = mix( vStartColor, vEndColor, lerpTimes.y );\n" \
+	"	gl_Position = vpMatrix * vec4( mix( vStartPos, vEndPos, lerpTimes.x ), vDepth, 1.0f );\n" \
+	"}\n"
+
+// expands a sprite instance into one corner of its quad, the corner is scaled and offset and then rotated around the position
+#define SPRITE_VERTEX_SHADER \
+	"#version 300 es\n" \
+	"layout(std140) uniform CameraBlock { mat4 vpMatrix; };\n" \
+	"uniform vec2 lerpTimes;\n" \
+	"layout(location = 0) in vec2 vCorner;\n" \
+	"layout(location = 1) in vec2 vStartPos;\n" \
+	"layout(location = 2) in vec2 vEndPos;\n" \
+	"layout(location = 3) in vec2 vStartScale;\n" \
+	"layout(location = 4) in vec2 vEndScale;\n" \
+	"layout(location = 5) in vec2 vOffset;\n" \
+	"layout(location = 6) in vec3 vRotsDepth;\n" \
+	"layout(location = 7) in vec4 vUVRect;\n" \
+	"layout(location = 8) in vec4 vStartColor;\n" \
+	"layout(location = 9) in vec4 vEndColor;\n" \
+	"layout(location = 10) in float vLayer;\n" \
+	"out vec2 vTex;\n" \
+	"flat out float vTexLayer;\n" \
+	"out vec4 vCol;\n" \
+	"void main( void )\n" \
+	"{\n" \
+	"	vTex = mix( vUVRect.xy, vUVRect.zw, vCorner + vec2( 0.5f, 0.5f ) );\n" \
+	"	vTexLayer = vLayer;\n" \
+	"	vCol = mix( vStartColor, vEndColor, lerpTimes.y );\n" \
+	"	float rot = mix( vRotsDepth.x, vRotsDepth.y, lerpTimes.y );\n" \
+	"	vec2 local = ( vCorner * mix( vStartScale, vEndScale, lerpTimes.y ) ) + vOffset;\n" \
+	"	vec2 rotated = vec2( ( local.x * cos( rot ) ) - ( local.y * sin( rot ) ), ( local.x * sin( rot ) ) + ( local.y * cos( rot ) ) );\n" \
+	"	gl_Position = vpMatrix * vec4( mix( vStartPos, vEndPos, lerpTimes.x ) + rotated, vRotsDepth.z, 1.0f );\n" \
+	"}\n"
+
+// expands a tile instance into one corner of its quad, the tiles only store which cell of the chunk they're in so
+//  the rest of the position comes from the chunk
+#define TILE_VERTEX_SHADER \
+	"#version 300 es\n" \
+	"layout(std140) uniform CameraBlock { mat4 vpMatrix; };\n" \
+	"uniform vec3 chunkOrigin;\n" \
+	"uniform vec2 tileSize;\n" \
+	"layout(location = 0) in vec2 vCorner;\n" \
+	"layout(location = 1) in vec2 vCell;\n" \
+	"layout(location = 2) in vec4 vRect;\n" \
+	"layout(location = 3) in vec4 vUVRect;\n" \
+	"layout(location = 4) in float vLayer;\n" \
+	"out vec2 vTex;\n" \
+	"flat out float vTexLayer;\n" \
+	"out vec4 vCol;\n" \
+	"void main( void )\n" \
+	"{\n" \
+	"	vec2 corner = vCorner + vec2( 0.5f, 0.5f );\n" \
+	"	vTex = mix( vUVRect.xy, vUVRect.zw, corner );\n" \
+	"	vTexLayer = vLayer;\n" \
+	"	vCol = vec4( 1.0f, 1.0f, 1.0f, 1.0f );\n" \
+	"	vec2 cellCenter = chunkOrigin.xy + ( ( vCell + vec2( 0.5f, 0.5f ) ) * tileSize );\n" \
+	"	gl_Position = vpMatrix * vec4( cellCenter + mix( vRect.xy, vRect.zw, corner ), chunkOrigin.z, 1.0f );\n" \
 	"}\n"
 
 #define DEFAULT_FRAG_SHADER \
 	"#version 300 es\n" \
 	"in highp vec2 vTex;\n" \
+	"flat in highp float vTexLayer;\n" \
 	"in highp vec4 vCol;\n" \
 	"uniform sampler2D textureUnit0;\n" \
+	"uniform highp sampler2DArray arrayUnit;\n" \
 	"out highp vec4 outCol;\n" \
 	"void main( void )\n" \
 	"{\n" \
-	"	outCol = texture(textureUnit0, vTex) * vCol;\n" \
+	"	if( vTexLayer < 0.0f ) {\n" \
+	"		outCol = texture(textureUnit0, vTex);\n" \
+	"	} else {\n" \
+	"		outCol = texture(arrayUnit, vec3( vTex, vTexLayer ));\n" \
+	"	}\n" \
+	"	outCol *= vCol;\n" \
 	"	if( outCol.w <= 0.0f ) {\n" \
 	"		discard;\n" \
 	"	}\n" \
 	"}\n"
 
-#define FONT_FRAG_SHADER \
+// draws a cached layer over the whole render area, the layers hold premultiplied colors
+#define LAYER_VERT_SHADER \
+	"#version 300 es\n" \
+	"layout(location = 0) in vec2 vCorner;\n" \
+	"out vec2 vTex;\n" \
+	"void main( void )\n" \
+	"{\n" \
+	"	vTex = vCorner + vec2( 0.5f, 0.5f );\n" \
+	"	gl_Position = vec4( vCorner * 2.0f, 0.0f, 1.0f );\n" \
+	"}\n"
+
+#define LAYER_FRAG_SHADER \
 	"#version 300 es\n" \
 	"in highp vec2 vTex;\n" \
-	"in highp vec4 vCol;\n" \
-	"uniform sampler2D textureUnit0;\n" \
+	"uniform sampler2D layerUnit;\n" \
 	"out highp vec4 outCol;\n" \
 	"void main( void )\n" \
 	"{\n" \
-	"	outCol = vec4( vCol.r, vCol.g, vCol.b, texture(textureUnit0, vTex).a * vCol.a );\n" \
-	"	if( outCol.w <= 0.0f ) {\n" \
-	"		discard;\n" \
-	"	}\n" \
+	"	outCol = texture(layerUnit, vTex);\n" \
 	"}\n"
 
 #define DEBUG_VERT_SHADER \
 	"#version 300 es\n" \
-	"uniform mat4 mvpMatrix;\n" \
+	"layout(std140) uniform CameraBlock { mat4 vpMatrix; };\n" \
 	"layout(location = 0) in vec4 vertex;\n" \
 	"layout(location = 2) in vec4 color;\n" \
 	"out vec4 vertCol;\n" \
 	"void main( void )\n" \
 	"{\n" \
 	"	vertCol = color;\n" \
-	"	gl_Position = mvpMatrix * vertex;\n" \
+	"	gl_Position = vpMatrix * vertex;\n" \
 	"}\n"
 
 #define DEBUG_FRAG_SHADER \
@@ -94,57 +171,133 @@ Handles the platform specific OpenGL stuff.
 // some default shaders
 #define DEFAULT_VERTEX_SHADER \
 	"#version 330\n" \
-	"uniform mat4 vpMatrix;\n" \
-	"layout(location = 0) in vec3 vVertex;\n" \
+	"layout(std140) uniform CameraBlock { mat4 vpMatrix; };\n" \
+	"uniform vec2 lerpTimes;\n" \
+	"layout(location = 0) in vec2 vStartPos;\n" \
 	"layout(location = 1) in vec2 vTexCoord0;\n" \
-	"layout(location = 2) in vec4 vColor;\n" \
+	"layout(location = 2) in vec4 vStartColor;\n" \
+	"layout(location = 3) in vec2 vEndPos;\n" \
+	"layout(location = 4) in vec4 vEndColor;\n" \
+	"layout(location = 5) in float vDepth;\n" \
+	"layout(location = 6) in float vLayer;\n" \
 	"out vec2 vTex;\n" \
+	"flat out float vTexLayer;\n" \
 	"out vec4 vCol;\n" \
 	"void main( void )\n" \
 	"{\n" \
 	"	vTex = vTexCoord0;\n" \
-	"	vCol = vColor;\n" \
-	"	gl_Position = vpMatrix * vec4( vVertex, 1.0f );\n" \
+	"	vTexLayer = vLayer;\n" \
+	"	vCol = mix( vStartColor, vEndColor, lerpTimes.y );\n" \
+	"	gl_Position = vpMatrix * vec4( mix( vStartPos, vEndPos, lerpTimes.x ), vDepth, 1.0f );\n" \
+	"}\n"
+
+// expands a sprite instance into one corner of its quad, the corner is scaled and offset and then rotated around the position
+#define SPRITE_VERTEX_SHADER \
+	"#version 330\n" \
+	"layout(std140) uniform CameraBlock { mat4 vpMatrix; };\n" \
+	"uniform vec2 lerpTimes;\n" \
+	"layout(location = 0) in vec2 vCorner;\n" \
+	"layout(location = 1) in vec2 vStartPos;\n" \
+	"layout(location = 2) in vec2 vEndPos;\n" \
+	"layout(location = 3) in vec2 vStartScale;\n" \
+	"layout(location = 4) in vec2 vEndScale;\n" \
+	"layout(location = 5) in vec2 vOffset;\n" \
+	"layout(location = 6) in vec3 vRotsDepth;\n" \
+	"layout(location = 7) in vec4 vUVRect;\n" \
+	"layout(location = 8) in vec4 vStartColor;\n" \
+	"layout(location = 9) in vec4 vEndColor;\n" \
+	"layout(location = 10) in float vLayer;\n" \
+	"out vec2 vTex;\n" \
+	"flat out float vTexLayer;\n" \
+	"out vec4 vCol;\n" \
+	"void main( void )\n" \
+	"{\n" \
+	"	vTex = mix( vUVRect.xy, vUVRect.zw, vCorner + vec2( 0.5f, 0.5f ) );\n" \
+	"	vTexLayer = vLayer;\n" \
+	"	vCol = mix( vStartColor, vEndColor, lerpTimes.y );\n" \
+	"	float rot = mix( vRotsDepth.x, vRotsDepth.y, lerpTimes.y );\n" \
+	"	vec2 local = ( vCorner * mix( vStartScale, vEndScale, lerpTimes.y ) ) + vOffset;\n" \
+	"	vec2 rotated = vec2( ( local.x * cos( rot ) ) - ( local.y * sin( rot ) ), ( local.x * sin( rot ) ) + ( local.y * cos( rot ) ) );\n" \
+	"	gl_Position = vpMatrix * vec4( mix( vStartPos, vEndPos, lerpTimes.x ) + rotated, vRotsDepth.z, 1.0f );\n" \
+	"}\n"
+
+// expands a tile instance into one corner of its quad, the tiles only store which cell of the chunk they're in so
+//  the rest of the position comes from the chunk
+#define TILE_VERTEX_SHADER \
+	"#version 330\n" \
+	"layout(std140) uniform CameraBlock { mat4 vpMatrix; };\n" \
+	"uniform vec3 chunkOrigin;\n" \
+	"uniform vec2 tileSize;\n" \
+	"layout(location = 0) in vec2 vCorner;\n" \
+	"layout(location = 1) in vec2 vCell;\n" \
+	"layout(location = 2) in vec4 vRect;\n" \
+	"layout(location = 3) in vec4 vUVRect;\n" \
+	"layout(location = 4) in float vLayer;\n" \
+	"out vec2 vTex;\n" \
+	"flat out float vTexLayer;\n" \
+	"out vec4 vCol;\n" \
+	"void main( void )\n" \
+	"{\n" \
+	"	vec2 corner = vCorner + vec2( 0.5f, 0.5f );\n" \
+	"	vTex = mix( vUVRect.xy, vUVRect.zw, corner );\n" \
+	"	vTexLayer = vLayer;\n" \
+	"	vCol = vec4( 1.0f, 1.0f, 1.0f, 1.0f );\n" \
+	"	vec2 cellCenter = chunkOrigin.xy + ( ( vCell + vec2( 0.5f, 0.5f ) ) * tileSize );\n" \
+	"	gl_Position = vpMatrix * vec4( cellCenter + mix( vRect.xy, vRect.zw, corner ), chunkOrigin.z, 1.0f );\n" \
 	"}\n"
 
 #define DEFAULT_FRAG_SHADER \
 	"#version 330\n" \
 	"in vec2 vTex;\n" \
+	"flat in float vTexLayer;\n" \
 	"in vec4 vCol;\n" \
 	"uniform sampler2D textureUnit0;\n" \
+	"uniform sampler2DArray arrayUnit;\n" \
 	"out vec4 outCol;\n" \
 	"void main( void )\n" \
 	"{\n" \
-	"	outCol = texture2D(textureUnit0, vTex) * vCol;\n" \
+	"	if( vTexLayer < 0.0f ) {\n" \
+	"		outCol = texture(textureUnit0, vTex);\n" \
+	"	} else {\n" \
+	"		outCol = texture(arrayUnit, vec3( vTex, vTexLayer ));\n" \
+	"	}\n" \
+	"	outCol *= vCol;\n" \
 	"	if( outCol.w <= 0.0f ) {\n" \
 	"		discard;\n" \
 	"	}\n" \
 	"}\n"
 
-#define FONT_FRAG_SHADER \
+// draws a cached layer over the whole render area, the layers hold premultiplied colors
+#define LAYER_VERT_SHADER \
+	"#version 330\n" \
+	"layout(location = 0) in vec2 vCorner;\n" \
+	"out vec2 vTex;\n" \
+	"void main( void )\n" \
+	"{\n" \
+	"	vTex = vCorner + vec2( 0.5f, 0.5f );\n" \
+	"	gl_Position = vec4( vCorner * 2.0f, 0.0f, 1.0f );\n" \
+	"}\n"
+
+#define LAYER_FRAG_SHADER \
 	"#version 330\n" \
 	"in vec2 vTex;\n" \
-	"in vec4 vCol;\n" \
-	"uniform sampler2D textureUnit0;\n" \
+	"uniform sampler2D layerUnit;\n" \
 	"out vec4 outCol;\n" \
 	"void main( void )\n" \
 	"{\n" \
-	"	outCol = vec4( vCol.r, vCol.g, vCol.b, texture2D(textureUnit0, vTex).r * vCol.a );\n" \
-	"	if( outCol.w <= 0.0f ) {\n" \
-	"		discard;\n" \
-	"	}\n" \
+	"	outCol = texture(layerUnit, vTex);\n" \
 	"}\n"
 
 #define DEBUG_VERT_SHADER \
 	"#version 330\n" \
-	"uniform mat4 mvpMatrix;\n" \
+	"layout(std140) uniform CameraBlock { mat4 vpMatrix; };\n" \
 	"layout(location = 0) in vec4 vertex;\n" \
 	"layout(location = 2) in vec4 color;\n" \
 	"out vec4 vertCol;\n" \
 	"void main( void )\n" \
 	"{\n" \
 	"	vertCol = color;\n" \
-	"	gl_Position = mvpMatrix * vertex;\n" \
+	"	gl_Position = vpMatrix * vertex;\n" \
 	"}\n"
 
 #define DEBUG_FRAG_SHADER \
@@ -157,6 +310,13 @@ Handles the platform specific OpenGL stuff.
 	"}\n"
 #endif
 
+// calling convention for the functions that are loaded with SDL_GL_GetProcAddress( )
+#if defined( WIN32 )
+#define GL_PROC_API APIENTRY
+#else
+#define GL_PROC_API GL_APIENTRY
+#endif
+
 int glInit( void );
 
 #endif // inclusion guard
\ No newline at end of file
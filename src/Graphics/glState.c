@@ -0,0 +1,347 @@
+#include "glState.h"
+
+#include <string.h>
+
+#include "glDebugging.h"
+#include "camera.h"
+#include "../Math/matrix4.h"
+#include "../System/platformLog.h"
+#include "../System/memory.h"
+
+// only the first few units are ever used, anything past them is always sent
+#define MAX_TRACKED_UNITS 4
+
+// names and values that haven't been set since the last reset
+#define UNKNOWN_NAME 0xFFFFFFFF
+#define UNKNOWN_FLAG -1
+
+typedef enum {
+	TT_2D,
+	TT_2D_ARRAY,
+	NUM_TRACKED_TARGETS
+} TrackedTarget;
+
+typedef enum {
+	TC_BLEND,
+	TC_DEPTH_TEST,
+	TC_SCISSOR_TEST,
+	TC_CULL_FACE,
+	NUM_TRACKED_CAPABILITIES
+} TrackedCapability;
+
+static GLuint currProgram;
+static GLuint currVAO;
+static GLuint currActiveUnit;
+static GLuint currTextures[MAX_TRACKED_UNITS][NUM_TRACKED_TARGETS];
+static int currCapabilities[NUM_TRACKED_CAPABILITIES];
+static bool blendKnown;
+static GLenum currBlend[4];
+static int currDepthMask;
+static int currCamera;
+
+static int frameIssued = 0;
+static int frameSkipped = 0;
+static int lastIssued = 0;
+static int lastSkipped = 0;
+
+// the matrices are spaced out so each camera's range starts where the GPU needs uniform buffer ranges to start
+static GLuint cameraUBO = 0;
+static GLsizeiptr cameraStride = 0;
+static uint8_t* cameraStaging = NULL;
+
+/*
+Forgets everything that was tracked, the next change to anything will always be sent.
+*/
+void glState_Reset( void )
+{
+	currProgram = UNKNOWN_NAME;
+	currVAO = UNKNOWN_NAME;
+	currActiveUnit = UNKNOWN_NAME;
+	for( int u = 0; u < MAX_TRACKED_UNITS; ++u ) {
+		for( int t = 0; t < NUM_TRACKED_TARGETS; ++t ) {
+			currTextures[u][t] = UNKNOWN_NAME;
+		}
+	}
+	for( int i = 0; i < NUM_TRACKED_CAPABILITIES; ++i ) {
+		currCapabilities[i] = UNKNOWN_FLAG;
+	}
+	blendKnown = false;
+	currDepthMask = UNKNOWN_FLAG;
+	currCamera = -1;
+}
+
+/*
+Sets up the camera uniform buffer and forgets anything that was tracked.
+ Returns a number < 0 if there was a problem.
+*/
+int glState_Init( void )
+{
+	glState_Reset( );
+
+	GLint alignment = 0;
+	GL( glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment ) );
+	if( alignment <= 0 ) {
+		alignment = 1;
+	}
+	cameraStride = ( ( (GLsizeiptr)sizeof( Matrix4 ) + alignment - 1 ) / alignment ) * alignment;
+
+	if( cameraStaging != NULL ) {
+		mem_Release( cameraStaging );
+	}
+	cameraStaging = mem_Allocate( cameraStride * NUM_CAMERAS );
+	if( cameraStaging == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate space for camera matrices." );
+		return -1;
+	}
+	memset( cameraStaging, 0, cameraStride * NUM_CAMERAS );
+
+	GL( glGenBuffers( 1, &cameraUBO ) );
+	if( cameraUBO == 0 ) {
+		llog( LOG_ERROR, "Unable to create camera uniform buffer." );
+		return -1;
+	}
+	GL( glBindBuffer( GL_UNIFORM_BUFFER, cameraUBO ) );
+	GL( glBufferData( GL_UNIFORM_BUFFER, cameraStride * NUM_CAMERAS, cameraStaging, GL_STREAM_DRAW ) );
+	GL( glBindBuffer( GL_UNIFORM_BUFFER, 0 ) );
+
+	return 0;
+}
+
+// all the render cameras are sent in one go, the whole buffer is replaced so it never has to wait on the last frame
+static void uploadCameras( void )
+{
+	if( cameraUBO == 0 ) {
+		return;
+	}
+
+	for( int camera = cam_StartRenderIteration( ); camera != -1; camera = cam_GetNextActiveRenderCam( ) ) {
+		if( camera < NUM_CAMERAS ) {
+			cam_GetVPMatrix( camera, (Matrix4*)( cameraStaging + ( cameraStride * camera ) ) );
+		}
+	}
+
+	GL( glBindBuffer( GL_UNIFORM_BUFFER, cameraUBO ) );
+	GL( glBufferData( GL_UNIFORM_BUFFER, cameraStride * NUM_CAMERAS, cameraStaging, GL_STREAM_DRAW ) );
+	GL( glBindBuffer( GL_UNIFORM_BUFFER, 0 ) );
+}
+
+/*
+Called at the start of each frame before anything is drawn. Forgets what was bound, so nothing done outside the
+ engine can leave it wrong for longer than a frame, and uploads the camera matrices.
+*/
+void glState_BeginFrame( void )
+{
+	glState_Reset( );
+	uploadCameras( );
+}
+
+/*
+Called at the end of each frame, finishes off the counts for the frame.
+*/
+void glState_EndFrame( void )
+{
+	lastIssued = frameIssued;
+	lastSkipped = frameSkipped;
+	frameIssued = 0;
+	frameSkipped = 0;
+}
+
+// returns if the value has to be sent, and updates what's tracked and the counts
+static bool changeName( GLuint* curr, GLuint value )
+{
+	if( (*curr) == value ) {
+		++frameSkipped;
+		return false;
+	}
+	(*curr) = value;
+	++frameIssued;
+	return true;
+}
+
+static bool changeFlag( int* curr, int value )
+{
+	if( (*curr) == value ) {
+		++frameSkipped;
+		return false;
+	}
+	(*curr) = value;
+	++frameIssued;
+	return true;
+}
+
+void glState_UseProgram( GLuint program )
+{
+	if( changeName( &currProgram, program ) ) {
+		GL( glUseProgram( program ) );
+	}
+}
+
+void glState_BindVertexArray( GLuint vao )
+{
+	if( changeName( &currVAO, vao ) ) {
+		GL( glBindVertexArray( vao ) );
+	}
+}
+
+static int getTrackedTarget( GLenum target )
+{
+	switch( target ) {
+	case GL_TEXTURE_2D:
+		return TT_2D;
+	case GL_TEXTURE_2D_ARRAY:
+		return TT_2D_ARRAY;
+	default:
+		return -1;
+	}
+}
+
+/*
+Binds the texture to the target on the texture unit, the unit is an offset from GL_TEXTURE0.
+*/
+void glState_BindTexture( int unit, GLenum target, GLuint texture )
+{
+	int trackedTarget = getTrackedTarget( target );
+	if( ( unit >= 0 ) && ( unit < MAX_TRACKED_UNITS ) && ( trackedTarget >= 0 ) ) {
+		if( currTextures[unit][trackedTarget] == texture ) {
+			++frameSkipped;
+			return;
+		}
+		currTextures[unit][trackedTarget] = texture;
+	}
+
+	if( changeName( &currActiveUnit, (GLuint)unit ) ) {
+		GL( glActiveTexture( GL_TEXTURE0 + unit ) );
+	}
+	GL( glBindTexture( target, texture ) );
+	++frameIssued;
+}
+
+static int getTrackedCapability( GLenum capability )
+{
+	switch( capability ) {
+	case GL_BLEND:
+		return TC_BLEND;
+	case GL_DEPTH_TEST:
+		return TC_DEPTH_TEST;
+	case GL_SCISSOR_TEST:
+		return TC_SCISSOR_TEST;
+	case GL_CULL_FACE:
+		return TC_CULL_FACE;
+	default:
+		return -1;
+	}
+}
+
+/*
+Turns GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST, or GL_CULL_FACE on or off.
+*/
+void glState_SetEnabled( GLenum capability, bool enabled )
+{
+	int tracked = getTrackedCapability( capability );
+	if( ( tracked >= 0 ) && !changeFlag( &( currCapabilities[tracked] ), enabled ? 1 : 0 ) ) {
+		return;
+	}
+
+	if( tracked < 0 ) {
+		++frameIssued;
+	}
+
+	if( enabled ) {
+		GL( glEnable( capability ) );
+	} else {
+		GL( glDisable( capability ) );
+	}
+}
+
+void glState_BlendFunc( GLenum srcFactor, GLenum destFactor )
+{
+	glState_BlendFuncSeparate( srcFactor, destFactor, srcFactor, destFactor );
+}
+
+void glState_BlendFuncSeparate( GLenum srcRGB, GLenum destRGB, GLenum srcAlpha, GLenum destAlpha )
+{
+	if( blendKnown && ( currBlend[0] == srcRGB ) && ( currBlend[1] == destRGB ) &&
+		( currBlend[2] == srcAlpha ) && ( currBlend[3] == destAlpha ) ) {
+		++frameSkipped;
+		return;
+	}
+
+	blendKnown = true;
+	currBlend[0] = srcRGB;
+	currBlend[1] = destRGB;
+	currBlend[2] = srcAlpha;
+	currBlend[3] = destAlpha;
+	++frameIssued;
+	GL( glBlendFuncSeparate( srcRGB, destRGB, srcAlpha, destAlpha ) );
+}
+
+void glState_DepthMask( GLboolean write )
+{
+	if( changeFlag( &currDepthMask, write ? 1 : 0 ) ) {
+		GL( glDepthMask( write ) );
+	}
+}
+
+/*
+Deletes the objects and forgets them if they were bound.
+*/
+void glState_DeleteTextures( GLsizei count, const GLuint* textures )
+{
+	for( GLsizei i = 0; i < count; ++i ) {
+		for( int u = 0; u < MAX_TRACKED_UNITS; ++u ) {
+			for( int t = 0; t < NUM_TRACKED_TARGETS; ++t ) {
+				if( currTextures[u][t] == textures[i] ) {
+					currTextures[u][t] = 0;
+				}
+			}
+		}
+	}
+	GL( glDeleteTextures( count, textures ) );
+}
+
+void glState_DeleteVertexArrays( GLsizei count, const GLuint* vaos )
+{
+	for( GLsizei i = 0; i < count; ++i ) {
+		if( currVAO == vaos[i] ) {
+			currVAO = 0;
+		}
+	}
+	GL( glDeleteVertexArrays( count, vaos ) );
+}
+
+/*
+Points the program's CameraBlock uniform block at the camera matrices. Does nothing if the program doesn't use it.
+*/
+void glState_SetupCameraBlock( GLuint program )
+{
+	GLuint blockIdx;
+	GLR( blockIdx, glGetUniformBlockIndex( program, "CameraBlock" ) );
+	if( blockIdx != GL_INVALID_INDEX ) {
+		GL( glUniformBlockBinding( program, blockIdx, CAMERA_BLOCK_BINDING ) );
+	}
+}
+
+/*
+Makes the camera's matrix the one the CameraBlock uniform block reads.
+*/
+void glState_BindCamera( int camera )
+{
+	if( ( camera < 0 ) || ( camera >= NUM_CAMERAS ) ) {
+		return;
+	}
+
+	if( !changeFlag( &currCamera, camera ) ) {
+		return;
+	}
+	GL( glBindBufferRange( GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, cameraUBO, cameraStride * camera, sizeof( Matrix4 ) ) );
+}
+
+/*
+Gets how many state changes were sent to OpenGL in the last frame and how many were skipped since they wouldn't have
+ changed anything. Either of the out parameters can be NULL.
+*/
+void glState_GetLastStats( int* outIssued, int* outSkipped )
+{
+	if( outIssued != NULL ) (*outIssued) = lastIssued;
+	if( outSkipped != NULL ) (*outSkipped) = lastSkipped;
+}
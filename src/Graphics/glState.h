@@ -0,0 +1,86 @@
+/*
+Keeps track of the OpenGL state the engine changes the most so calls that wouldn't change anything can be skipped.
+ Everything that binds programs, vertex arrays, or textures, or changes the blending, depth, or scissor state has to
+ go through here, otherwise what's tracked won't match what's really bound. Textures and vertex arrays have to be
+ deleted through here as well since deleting them unbinds them.
+
+Also holds the view projection matrices for all the cameras in a uniform buffer. They're uploaded once at the start
+ of each frame and the range for a camera is bound before each pass, so the shaders don't need the matrix set every
+ time their program is bound. Any shader that uses them declares the CameraBlock uniform block with a single mat4
+ named vpMatrix in it.
+
+Only used from the thread that owns the context.
+*/
+
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <stdbool.h>
+
+#include "glPlatform.h"
+
+// what the camera uniform block is bound to
+#define CAMERA_BLOCK_BINDING 0
+
+/*
+Sets up the camera uniform buffer and forgets anything that was tracked.
+ Returns a number < 0 if there was a problem.
+*/
+int glState_Init( void );
+
+/*
+Called at the start of each frame before anything is drawn. Forgets what was bound, so nothing done outside the
+ engine can leave it wrong for longer than a frame, and uploads the camera matrices.
+*/
+void glState_BeginFrame( void );
+
+/*
+Called at the end of each frame, finishes off the counts for the frame.
+*/
+void glState_EndFrame( void );
+
+/*
+Forgets everything that was tracked, the next change to anything will always be sent.
+*/
+void glState_Reset( void );
+
+void glState_UseProgram( GLuint program );
+void glState_BindVertexArray( GLuint vao );
+
+/*
+Binds the texture to the target on the texture unit, the unit is an offset from GL_TEXTURE0.
+*/
+void glState_BindTexture( int unit, GLenum target, GLuint texture );
+
+/*
+Turns GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST, or GL_CULL_FACE on or off.
+*/
+void glState_SetEnabled( GLenum capability, bool enabled );
+
+void glState_BlendFunc( GLenum srcFactor, GLenum destFactor );
+void glState_BlendFuncSeparate( GLenum srcRGB, GLenum destRGB, GLenum srcAlpha, GLenum destAlpha );
+void glState_DepthMask( GLboolean write );
+
+/*
+Deletes the objects and forgets them if they were bound.
+*/
+void glState_DeleteTextures( GLsizei count, const GLuint* textures );
+void glState_DeleteVertexArrays( GLsizei count, const GLuint* vaos );
+
+/*
+Points the program's CameraBlock uniform block at the camera matrices. Does nothing if the program doesn't use it.
+*/
+void glState_SetupCameraBlock( GLuint program );
+
+/*
+Makes the camera's matrix the one the CameraBlock uniform block reads.
+*/
+void glState_BindCamera( int camera );
+
+/*
+Gets how many state changes were sent to OpenGL in the last frame and how many were skipped since they wouldn't have
+ changed anything. Either of the out parameters can be NULL.
+*/
+void glState_GetLastStats( int* outIssued, int* outSkipped );
+
+#endif // inclusion guard
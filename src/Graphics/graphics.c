@@ -15,6 +15,11 @@
 #include "images.h"
 #include "debugRendering.h"
 #include "spineGfx.h"
+#include "sprites.h"
+#include "tilemap.h"
+#include "layerCache.h"
+#include "glState.h"
+#include "renderStats.h"
 #include "triRendering.h"
 #include "scissor.h"
 
@@ -23,12 +28,47 @@
 #include "../Graphics/glPlatform.h"
 
 #include "../System/platformLog.h"
+#include "../Utils/helpers.h"
 
 static SDL_GLContext glContext;
 
 static float currentTime;
 static float endTime;
 
+// how far past the latest state we're allowed to extrapolate, in ticks
+#define MAX_EXTRAPOLATION 1.0f
+static PresentationMode presentationMode = PM_INTERPOLATE;
+static float lastRenderTime;
+
+// the triangles are only rebuilt when there's a new state to draw, the frames in between just interpolate them
+static bool newDrawState = true;
+
+// frame packet handling, when not using them all the reading and writing is done to the first packet
+static bool usingFramePackets = false;
+static SDL_mutex* framePacketMutex = NULL;
+static int writePacket = 0;
+static int readyPacket = 0;
+static int readPacket = 0;
+static bool packetReady = false;
+static float packetEndTimes[NUM_FRAME_PACKETS];
+
+// time between the frames that were rendered, the lock is because they can be read from the simulation thread
+static SDL_SpinLock frameTimesLock = 0;
+static Uint64 lastFrameCounter = 0;
+static int framesTimed = 0;
+static double totalFrameMS = 0.0;
+static double minFrameMS = 0.0;
+static double maxFrameMS = 0.0;
+
+// input latencies recorded by the main loop, kept with the frame times so they can be reported together
+static int latenciesRecorded = 0;
+static double totalLatencyMS = 0.0;
+static double minLatencyMS = 0.0;
+static double maxLatencyMS = 0.0;
+
+// what the triangle uploads sent, also kept with the frame times
+static UploadTotals uploadTotals;
+
 // both the clear colors default to black
 static Color gameClearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
 static Color windowClearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
@@ -138,6 +178,16 @@ int gfx_Init( SDL_Window* window, int desiredRenderWidth, int desiredRenderHeigh
 	gfx_SetWindowSize( windowWidth, windowHeight );
 
 	// initialize everything else
+	if( glState_Init( ) < 0 ) {
+		return -1;
+	}
+	llog( LOG_INFO, "GL state tracking initialized." );
+
+	if( renderStats_Init( ) < 0 ) {
+		return -1;
+	}
+	llog( LOG_INFO, "Render stats initialized." );
+
 	if( img_Init( ) < 0 ) {
 		return -1;
 	}
@@ -156,6 +206,16 @@ int gfx_Init( SDL_Window* window, int desiredRenderWidth, int desiredRenderHeigh
 	}
 	llog( LOG_INFO, "Triangle renderer initialized." );
 
+	if( tilemap_Init( ) < 0 ) {
+		return -1;
+	}
+	llog( LOG_INFO, "Tile maps initialized." );
+
+	if( layerCache_Init( ) < 0 ) {
+		return -1;
+	}
+	llog( LOG_INFO, "Layer cache initialized." );
+
 	if( scissor_Init( desiredRenderWidth, desiredRenderHeight ) < 0 ) {
 		return -1;
 	}
@@ -210,6 +270,8 @@ void gfx_CleanUp( void )
 {
 	GL( glDeleteRenderbuffers( RBO_COUNT, &( mainRenderRBOs[0] ) ) ); 
 	GL( glDeleteFramebuffers( 1, &mainRenderFBO ) );
+
+	gfx_StopUsingFramePackets( );
 }
 
 /*
@@ -228,6 +290,140 @@ void gfx_SetWindowClearColor( Color newClearColor )
 	windowClearColor = newClearColor;
 }
 
+/*
+Sets how the drawing instructions are presented between physics ticks.
+*/
+void gfx_SetPresentationMode( PresentationMode mode )
+{
+	presentationMode = mode;
+}
+
+/*
+Returns if the last frame rendered was showing the state from the latest physics tick, or a state past it when
+ extrapolating.
+*/
+bool gfx_IsShowingLatestState( void )
+{
+	return ( lastRenderTime >= 1.0f );
+}
+
+/*
+Starts timing the rendered frames over again, also resets the input latencies and upload totals.
+*/
+void gfx_ResetFrameTimes( void )
+{
+	SDL_AtomicLock( &frameTimesLock );
+		lastFrameCounter = 0;
+		framesTimed = 0;
+		totalFrameMS = 0.0;
+		minFrameMS = 0.0;
+		maxFrameMS = 0.0;
+		latenciesRecorded = 0;
+		totalLatencyMS = 0.0;
+		minLatencyMS = 0.0;
+		maxLatencyMS = 0.0;
+		memset( &uploadTotals, 0, sizeof( uploadTotals ) );
+	SDL_AtomicUnlock( &frameTimesLock );
+}
+
+/*
+Gets how many frames were timed and the total, shortest, and longest time between them since the last call to
+ gfx_ResetFrameTimes( ). Every frame rendered is presented right after, so this is the time between presented
+ frames. Any of the out parameters can be NULL.
+*/
+void gfx_GetFrameTimes( int* outFrames, double* outTotalMS, double* outMinMS, double* outMaxMS )
+{
+	SDL_AtomicLock( &frameTimesLock );
+		if( outFrames != NULL ) (*outFrames) = framesTimed;
+		if( outTotalMS != NULL ) (*outTotalMS) = totalFrameMS;
+		if( outMinMS != NULL ) (*outMinMS) = minFrameMS;
+		if( outMaxMS != NULL ) (*outMaxMS) = maxFrameMS;
+	SDL_AtomicUnlock( &frameTimesLock );
+}
+
+/*
+Records how long it took from an input being polled to the first frame showing its results being presented.
+*/
+void gfx_RecordInputLatency( double latencyMS )
+{
+	SDL_AtomicLock( &frameTimesLock );
+		minLatencyMS = ( latenciesRecorded == 0 ) ? latencyMS : MIN( minLatencyMS, latencyMS );
+		maxLatencyMS = MAX( maxLatencyMS, latencyMS );
+		totalLatencyMS += latencyMS;
+		++latenciesRecorded;
+	SDL_AtomicUnlock( &frameTimesLock );
+}
+
+/*
+Gets how many input latencies were recorded and the total, shortest, and longest of them since the last call to
+ gfx_ResetFrameTimes( ). Any of the out parameters can be NULL.
+*/
+void gfx_GetInputLatencies( int* outRecorded, double* outTotalMS, double* outMinMS, double* outMaxMS )
+{
+	SDL_AtomicLock( &frameTimesLock );
+		if( outRecorded != NULL ) (*outRecorded) = latenciesRecorded;
+		if( outTotalMS != NULL ) (*outTotalMS) = totalLatencyMS;
+		if( outMinMS != NULL ) (*outMinMS) = minLatencyMS;
+		if( outMaxMS != NULL ) (*outMaxMS) = maxLatencyMS;
+	SDL_AtomicUnlock( &frameTimesLock );
+}
+
+/*
+Gets the totals of the triangle uploads done since the last call to gfx_ResetFrameTimes( ). They're gathered on
+ the thread doing the rendering after each frame that uploaded a new state, so they're safe to read from any thread.
+*/
+void gfx_GetUploadTotals( UploadTotals* outTotals )
+{
+	assert( outTotals != NULL );
+
+	SDL_AtomicLock( &frameTimesLock );
+		(*outTotals) = uploadTotals;
+	SDL_AtomicUnlock( &frameTimesLock );
+}
+
+// adds what the last triangle upload sent to the totals, the sent bytes and draw calls are only known once it's drawn
+static void totalUpload( void )
+{
+	int triangles, capacity;
+	triRenderer_GetLastRenderStats( &triangles, NULL, &capacity );
+
+	int vertexBytes, indexBytes;
+	triRenderer_GetLastUploadStats( &vertexBytes, &indexBytes );
+
+	int drawCalls, programBinds;
+	triRenderer_GetLastDrawStats( &drawCalls, &programBinds );
+
+	int visible, culled;
+	cam_GetCullingStats( &visible, &culled );
+
+	SDL_AtomicLock( &frameTimesLock );
+		++uploadTotals.uploads;
+		uploadTotals.peakTriangles = MAX( uploadTotals.peakTriangles, triangles );
+		uploadTotals.triangleCapacity = MAX( uploadTotals.triangleCapacity, capacity );
+		uploadTotals.uploadedBytes += (double)( vertexBytes + indexBytes );
+		uploadTotals.drawCalls += (double)drawCalls;
+		uploadTotals.programBinds += (double)programBinds;
+		uploadTotals.visible += (double)visible;
+		uploadTotals.culled += (double)culled;
+	SDL_AtomicUnlock( &frameTimesLock );
+}
+
+static void timeFrame( void )
+{
+	Uint64 now = SDL_GetPerformanceCounter( );
+
+	SDL_AtomicLock( &frameTimesLock );
+		if( lastFrameCounter != 0 ) {
+			double frameMS = ( (double)( now - lastFrameCounter ) * 1000.0 ) / (double)SDL_GetPerformanceFrequency( );
+			minFrameMS = ( framesTimed == 0 ) ? frameMS : MIN( minFrameMS, frameMS );
+			maxFrameMS = MAX( maxFrameMS, frameMS );
+			totalFrameMS += frameMS;
+			++framesTimed;
+		}
+		lastFrameCounter = now;
+	SDL_AtomicUnlock( &frameTimesLock );
+}
+
 /*
 Clears all the drawing instructions.
 */
@@ -237,8 +433,153 @@ void gfx_ClearDrawCommands( float timeToEnd )
 	img_ClearDrawInstructions( );
 	scissor_Clear( );
 	
-	endTime = timeToEnd;
-	currentTime = 0.0f;
+	packetEndTimes[writePacket] = timeToEnd;
+
+	// when using frame packets the time is reset when the packet is acquired
+	if( !usingFramePackets ) {
+		endTime = timeToEnd;
+		currentTime = 0.0f;
+		newDrawState = true;
+	}
+}
+
+static void setWritePacket( int packet )
+{
+	img_SetWritePacket( packet );
+	debugRenderer_SetWritePacket( packet );
+	scissor_SetWritePacket( packet );
+	cam_SetWritePacket( packet );
+	spine_SetWritePacket( packet );
+	tilemap_SetWritePacket( packet );
+	nk_xu_setWritePacket( &inGameIMGUI, packet );
+	nk_xu_setWritePacket( &editorIMGUI, packet );
+}
+
+static void setReadPacket( int packet )
+{
+	img_SetReadPacket( packet );
+	debugRenderer_SetReadPacket( packet );
+	scissor_SetReadPacket( packet );
+	cam_SetReadPacket( packet );
+	spine_SetReadPacket( packet );
+	tilemap_SetReadPacket( packet );
+	nk_xu_setReadPacket( &inGameIMGUI, packet );
+	nk_xu_setReadPacket( &editorIMGUI, packet );
+}
+
+/*
+Switches over to using separate frame packets for writing and rendering the drawing instructions. Call this
+ before the drawing instructions start being generated on a thread other than the one doing the rendering.
+ Returns a negative number on failure.
+*/
+int gfx_UseFramePackets( void )
+{
+	if( usingFramePackets ) {
+		return 0;
+	}
+
+	framePacketMutex = SDL_CreateMutex( );
+	if( framePacketMutex == NULL ) {
+		llog( LOG_ERROR, "Unable to create frame packet mutex: %s", SDL_GetError( ) );
+		return -1;
+	}
+
+	writePacket = 0;
+	readyPacket = 1;
+	readPacket = 2;
+	packetReady = false;
+
+	setWritePacket( writePacket );
+	setReadPacket( readPacket );
+
+	usingFramePackets = true;
+
+	return 0;
+}
+
+/*
+Switches back to reading and writing all the drawing instructions with the first packet. Call this once the thread
+ generating the drawing instructions has stopped.
+*/
+void gfx_StopUsingFramePackets( void )
+{
+	if( framePacketMutex != NULL ) {
+		SDL_DestroyMutex( framePacketMutex );
+		framePacketMutex = NULL;
+	}
+
+	if( !usingFramePackets ) {
+		return;
+	}
+
+	writePacket = 0;
+	readyPacket = 0;
+	readPacket = 0;
+	packetReady = false;
+
+	setWritePacket( writePacket );
+	setReadPacket( readPacket );
+
+	usingFramePackets = false;
+}
+
+/*
+Called by the thread generating the drawing instructions after it's done, makes the packet available to the
+ rendering thread and switches to a new packet to write to. Has to be called even when not using frame packets,
+ the camera states, spine instances, tile changes, and converted ui used for rendering are taken when it's called.
+*/
+void gfx_PublishFramePacket( void )
+{
+	// the cameras, spine instances, tiles, and ui can be changed while drawing, so they're only copied into the packet
+	//  once it's done
+	cam_SnapshotStates( );
+	spine_SnapshotInstances( packetEndTimes[writePacket] );
+	tilemap_SnapshotTiles( );
+	nk_xu_snapshot( &inGameIMGUI );
+	nk_xu_snapshot( &editorIMGUI );
+
+	if( !usingFramePackets ) {
+		return;
+	}
+
+	// if the previously published packet was never acquired it just gets overwritten
+	SDL_LockMutex( framePacketMutex );
+		SWAP( writePacket, readyPacket, int );
+		packetReady = true;
+	SDL_UnlockMutex( framePacketMutex );
+
+	setWritePacket( writePacket );
+}
+
+/*
+Called by the rendering thread before rendering, switches to the most recently published frame packet if there
+ is one.
+ Returns if a new packet was acquired.
+*/
+bool gfx_AcquireFramePacket( void )
+{
+	bool acquired = false;
+
+	if( !usingFramePackets ) {
+		return false;
+	}
+
+	SDL_LockMutex( framePacketMutex );
+		if( packetReady ) {
+			SWAP( readPacket, readyPacket, int );
+			packetReady = false;
+			acquired = true;
+		}
+	SDL_UnlockMutex( framePacketMutex );
+
+	if( acquired ) {
+		setReadPacket( readPacket );
+		endTime = packetEndTimes[readPacket];
+		currentTime = 0.0f;
+		newDrawState = true;
+	}
+
+	return acquired;
 }
 
 static void dynamicSizeRender( float dt, float t )
@@ -254,25 +595,26 @@ static void dynamicSizeRender( float dt, float t )
 		GL( glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE ) );
 		GL( glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT ) );
 
-		spine_UpdateInstances( dt );
-		spine_FlipInstancePositions( );
-	
 		// draw all the stuff that routes through the triangle rendering
-		triRenderer_Clear( );
-			img_Render( t );
-			spine_RenderInstances( t );
-		triRenderer_Render( );
+		renderStats_BeginPass( RP_TRIANGLES );
+		triRenderer_Render( t );
+		renderStats_EndPass( RP_TRIANGLES );
 
 		// in game ui stuff
 		//  note: this sets the glViewport, so if the render width and height of the imgui instance doesn't match the
 		//   render width and height used above that will cause issues with the UI and the debug rendering
+		renderStats_BeginPass( RP_GAME_IMGUI );
 		nk_xu_render( &inGameIMGUI );
+		renderStats_EndPass( RP_GAME_IMGUI );
 
 		// now draw all the debug stuff over everything
+		renderStats_BeginPass( RP_DEBUG );
 		debugRenderer_Render( );
+		renderStats_EndPass( RP_DEBUG );
 	GL( glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 ) );
 
 	// now render everything to the screen, scaling based on the size of the window
+	renderStats_BeginPass( RP_BLIT );
 	GL( glDrawBuffers( 1, &screenBuffer ) );
 	
 	GL( glClearColor( windowClearColor.r, windowClearColor.g, windowClearColor.b, windowClearColor.a) );
@@ -286,9 +628,13 @@ static void dynamicSizeRender( float dt, float t )
 					GL_COLOR_BUFFER_BIT,
 					GL_NEAREST ) );
 	GL( glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 ) );
+	glDebugging_CheckPass( "scaling to the window" );
+	renderStats_EndPass( RP_BLIT );
 
 	// editor and debugging ui stuff
+	renderStats_BeginPass( RP_EDITOR_IMGUI );
 	nk_xu_render( &editorIMGUI );
+	renderStats_EndPass( RP_EDITOR_IMGUI );
 }
 
 static void staticSizeRender( float dt, float t )
@@ -298,17 +644,37 @@ static void staticSizeRender( float dt, float t )
 	glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
 	glClear( GL_COLOR_BUFFER_BIT );
 
-	spine_UpdateInstances( dt );
-	spine_FlipInstancePositions( );
-	
 	// draw all the stuff that routes through the triangle rendering
-	triRenderer_Clear( );
-		img_Render( t );
-		spine_RenderInstances( t );
-	triRenderer_Render( );
+	renderStats_BeginPass( RP_TRIANGLES );
+	triRenderer_Render( t );
+	renderStats_EndPass( RP_TRIANGLES );
 
 	// now draw all the debug stuff over everything
+	renderStats_BeginPass( RP_DEBUG );
 	debugRenderer_Render( );
+	renderStats_EndPass( RP_DEBUG );
+}
+
+// sends the start and end states of everything that routes through the triangle rendering over to the GPU
+static void uploadTriangles( void )
+{
+	// anything the cameras can't see over the time this upload is drawn for is left out
+	cam_PrepareRenderCulling( ( presentationMode == PM_EXTRAPOLATE ) ? ( 1.0f + MAX_EXTRAPOLATION ) : 1.0f );
+
+	triRenderer_Clear( );
+		renderStats_BeginPass( RP_IMAGES );
+		img_Render( );
+		renderStats_EndPass( RP_IMAGES );
+
+		renderStats_BeginPass( RP_SPINE );
+		spine_RenderInstances( );
+		renderStats_EndPass( RP_SPINE );
+
+		renderStats_BeginPass( RP_UPLOAD );
+		spr_Render( );
+		tilemap_Render( );
+	triRenderer_Upload( );
+	renderStats_EndPass( RP_UPLOAD );
 }
 
 /*
@@ -317,13 +683,36 @@ Resets the render buffer.
 */
 void gfx_Render( float dt )
 {
+	timeFrame( );
+	renderStats_BeginFrame( );
+
+	bool uploaded = newDrawState;
+	if( newDrawState ) {
+		uploadTriangles( );
+		newDrawState = false;
+	}
+
 	float t;
 	currentTime += dt;
-	t = clamp( 0.0f, 1.0f, ( currentTime / endTime ) );
+	if( presentationMode == PM_EXTRAPOLATE ) {
+		// the start state is the previous tick and the end state is the latest, so anything past 1 is a projection
+		t = 1.0f + clamp( 0.0f, MAX_EXTRAPOLATION, ( currentTime / endTime ) );
+	} else {
+		t = clamp( 0.0f, 1.0f, ( currentTime / endTime ) );
+	}
+	lastRenderTime = t;
+	cam_SetRenderTime( t );
 
+	glState_BeginFrame( );
 #if defined( __EMSCRIPTEN__ )
 	staticSizeRender( dt, t );
 #else
 	dynamicSizeRender( dt, t );
 #endif
+	glState_EndFrame( );
+	glDebugging_CheckFrame( );
+	if( uploaded ) {
+		totalUpload( );
+	}
+	renderStats_EndFrame( );
 }
\ No newline at end of file
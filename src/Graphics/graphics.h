@@ -2,9 +2,44 @@
 #define ENGINE_GRAPHICS_H
 
 #include <SDL.h>
+#include <stdbool.h>
 #include "../Math/vector2.h"
 #include "color.h"
 
+/*
+All the drawing instructions for a frame are stored in a frame packet. When the drawing instructions are being
+ generated on the same thread that does the rendering there is only ever one packet used. When they're generated
+ on a separate thread the packets are triple buffered: one being written to, one waiting to be rendered, and one
+ being rendered. The packet being rendered is never modified.
+*/
+#define NUM_FRAME_PACKETS 3
+
+/*
+How the drawing instructions are presented between physics ticks. Interpolating shows a state between the previous
+ tick and the latest one, so what's on screen trails the simulation by up to one tick. Extrapolating projects
+ forward from the latest tick using the previous one, which removes that lag but means there will be a correction
+ when the next tick arrives. The projection is limited to one tick so the size of the correction is bounded.
+*/
+typedef enum {
+	PM_INTERPOLATE,
+	PM_EXTRAPOLATE
+} PresentationMode;
+
+/*
+Totals of the triangle uploads done since the frame times were last reset. The peak and capacity are the most
+ triangles in a single upload and the most the lists had space for, everything else is summed over all the uploads.
+*/
+typedef struct {
+	int uploads;
+	int peakTriangles;
+	int triangleCapacity;
+	double uploadedBytes;
+	double drawCalls;
+	double programBinds;
+	double visible;
+	double culled;
+} UploadTotals;
+
 /* ======= Rendering ======= */
 /*
 Initial setup for the rendering instruction buffer.
@@ -32,15 +67,87 @@ Sets the non render area clearing color.
 */
 void gfx_SetWindowClearColor( Color newClearColor );
 
+/*
+Sets how the drawing instructions are presented between physics ticks.
+*/
+void gfx_SetPresentationMode( PresentationMode mode );
+
+/*
+Returns if the last frame rendered was showing the state from the latest physics tick, or a state past it when
+ extrapolating.
+*/
+bool gfx_IsShowingLatestState( void );
+
+/*
+Starts timing the rendered frames over again, also resets the input latencies and upload totals.
+*/
+void gfx_ResetFrameTimes( void );
+
+/*
+Gets how many frames were timed and the total, shortest, and longest time between them since the last call to
+ gfx_ResetFrameTimes( ). Every frame rendered is presented right after, so this is the time between presented
+ frames. Any of the out parameters can be NULL.
+*/
+void gfx_GetFrameTimes( int* outFrames, double* outTotalMS, double* outMinMS, double* outMaxMS );
+
+/*
+Records how long it took from an input being polled to the first frame showing its results being presented.
+*/
+void gfx_RecordInputLatency( double latencyMS );
+
+/*
+Gets how many input latencies were recorded and the total, shortest, and longest of them since the last call to
+ gfx_ResetFrameTimes( ). Any of the out parameters can be NULL.
+*/
+void gfx_GetInputLatencies( int* outRecorded, double* outTotalMS, double* outMinMS, double* outMaxMS );
+
+/*
+Gets the totals of the triangle uploads done since the last call to gfx_ResetFrameTimes( ). They're gathered on
+ the thread doing the rendering after each frame that uploaded a new state, so they're safe to read from any thread.
+*/
+void gfx_GetUploadTotals( UploadTotals* outTotals );
+
 /*
 Clears all the drawing instructions.
 */
 void gfx_ClearDrawCommands( float endTime );
 
+/*
+Switches over to using separate frame packets for writing and rendering the drawing instructions. Call this
+ before the drawing instructions start being generated on a thread other than the one doing the rendering.
+ Returns a negative number on failure.
+*/
+int gfx_UseFramePackets( void );
+
+/*
+Switches back to reading and writing all the drawing instructions with the first packet. Call this once the thread
+ generating the drawing instructions has stopped.
+*/
+void gfx_StopUsingFramePackets( void );
+
+/*
+Called by the thread generating the drawing instructions after it's done, makes the packet available to the
+ rendering thread and switches to a new packet to write to. Has to be called even when not using frame packets,
+ the camera states, spine instances, tile changes, and converted ui used for rendering are taken when it's called.
+*/
+void gfx_PublishFramePacket( void );
+
+/*
+Called by the rendering thread before rendering, switches to the most recently published frame packet if there
+ is one.
+ Returns if a new packet was acquired.
+*/
+bool gfx_AcquireFramePacket( void );
+
 /*
 Goes through everything in the render buffer and does the actual rendering.
 Resets the render buffer.
 */
 void gfx_Render( float deltaTime );
 
+/*
+Cleans up all the rendering resources.
+*/
+void gfx_CleanUp( void );
+
 #endif
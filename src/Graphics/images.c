@@ -9,8 +9,11 @@
 #include "../Math/matrix4.h"
 #include "gfxUtil.h"
 #include "scissor.h"
+#include "graphics.h"
+#include "camera.h"
 #include "../System/platformLog.h"
 #include "../Math/mathUtil.h"
+#include "../System/memory.h"
 
 /* Image loading types and variables */
 #define MAX_IMAGES 512
@@ -22,6 +25,7 @@ enum {
 
 typedef struct {
 	GLuint textureObj;
+	int textureLayer;
 	Vector2 uvMin;
 	Vector2 uvMax;
 	Vector2 size;
@@ -35,40 +39,104 @@ typedef struct {
 static Image images[MAX_IMAGES];
 
 /* Rendering types and variables */
-#define MAX_RENDER_INSTRUCTIONS 1024
-typedef struct {
-	Vector2 pos;
-	Vector2 scaleSize;
-	Color color;
-	float rotation;
-} DrawInstructionState;
+// how many draw instructions each queue starts with space for, they'll grow past this as needed
+#define INITIAL_RENDER_INSTRUCTIONS 1024
 
+// the draw instructions are stored with an array for each field instead of an array of structures, that way they can
+//  be handed to the triangle renderer as they are and it can work through several of them at once
 typedef struct {
-	GLuint textureObj;
-	int imageObj;
-	Vector2 offset;
-	Vector2 uvs[4];
-	DrawInstructionState start;
-	DrawInstructionState end;
-	int flags;
-	int scissorID;
-	uint32_t camFlags;
-	int8_t depth;
-	ShaderType shaderType;
-} DrawInstruction;
+	int count;
+	int capacity;
+
+	int* imageObj;
+	Vector2* startPos;
+	Vector2* endPos;
+	Vector2* startScale;
+	Vector2* endScale;
+	Vector2* offset;
+	float* startRot;
+	float* endRot;
+	Color* startColor;
+	Color* endColor;
+	Vector2* uvMin;
+	Vector2* uvMax;
+	GLuint* textureObj;
+	int* textureLayer;
+	int* scissorID;
+	uint32_t* camFlags;
+	int8_t* depth;
+	uint8_t* transparent;
+} DrawQueue;
+
+// one queue per frame packet, draw instructions are added to the write packet and rendered from the read packet
+static DrawQueue renderQueues[NUM_FRAME_PACKETS];
+static int peakDrawInstructions = 0;
+static int writePacket = 0;
+static int readPacket = 0;
 
-static DrawInstruction renderBuffer[MAX_RENDER_INSTRUCTIONS];
-static int lastDrawInstruction;
+static GLint maxTextureSize;
 
-static const DrawInstruction DEFAULT_DRAW_INSTRUCTION = {
-	0, -1, { 0.0f, 0.0f },
-	{ { 0.0f, 0.0f }, { 0.0f, 1.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f } },
-	{ { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 0.0f },
-	{ { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 0.0f },
-	0, 0, 0
-};
+/*
+Resizes all the arrays in the queue so it can hold at least capacity draw instructions.
+ Returns < 0 if there's a problem, the queue will still be usable at its old capacity.
+*/
+static int growDrawQueue( DrawQueue* queue, int capacity )
+{
+#define GROW_FIELD( field ) { \
+		void* grown = mem_Resize( queue->field, sizeof( queue->field[0] ) * capacity ); \
+		if( grown == NULL ) { \
+			llog( LOG_ERROR, "Unable to grow draw instruction queue." ); \
+			return -1; \
+		} \
+		queue->field = grown; }
+
+	GROW_FIELD( imageObj );
+	GROW_FIELD( startPos );
+	GROW_FIELD( endPos );
+	GROW_FIELD( startScale );
+	GROW_FIELD( endScale );
+	GROW_FIELD( offset );
+	GROW_FIELD( startRot );
+	GROW_FIELD( endRot );
+	GROW_FIELD( startColor );
+	GROW_FIELD( endColor );
+	GROW_FIELD( uvMin );
+	GROW_FIELD( uvMax );
+	GROW_FIELD( textureObj );
+	GROW_FIELD( textureLayer );
+	GROW_FIELD( scissorID );
+	GROW_FIELD( camFlags );
+	GROW_FIELD( depth );
+	GROW_FIELD( transparent );
+
+#undef GROW_FIELD
+
+	queue->capacity = capacity;
+	return 0;
+}
 
-static GLint maxTextureSize;
+// copies the draw instruction at from over the one at to
+static void copyDrawInstruction( DrawQueue* queue, int to, int from )
+{
+	queue->imageObj[to] = queue->imageObj[from];
+	queue->startPos[to] = queue->startPos[from];
+	queue->endPos[to] = queue->endPos[from];
+	queue->startScale[to] = queue->startScale[from];
+	queue->endScale[to] = queue->endScale[from];
+	queue->offset[to] = queue->offset[from];
+	queue->startRot[to] = queue->startRot[from];
+	queue->endRot[to] = queue->endRot[from];
+	queue->startColor[to] = queue->startColor[from];
+	queue->endColor[to] = queue->endColor[from];
+	queue->uvMin[to] = queue->uvMin[from];
+	queue->uvMax[to] = queue->uvMax[from];
+	queue->textureObj[to] = queue->textureObj[from];
+	queue->textureLayer[to] = queue->textureLayer[from];
+	queue->scissorID[to] = queue->scissorID[from];
+	queue->camFlags[to] = queue->camFlags[from];
+	queue->depth[to] = queue->depth[from];
+	queue->transparent[to] = queue->transparent[from];
+}
 
 /*
 Initializes images.
@@ -78,6 +146,13 @@ int img_Init( void )
 {
 	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxTextureSize );
 	memset( images, 0, sizeof(images) );
+	for( int i = 0; i < NUM_FRAME_PACKETS; ++i ) {
+		if( renderQueues[i].capacity < INITIAL_RENDER_INSTRUCTIONS ) {
+			growDrawQueue( &( renderQueues[i] ), INITIAL_RENDER_INSTRUCTIONS );
+		}
+		renderQueues[i].count = 0;
+	}
+	peakDrawInstructions = 0;
 	return 0;
 }
 
@@ -124,6 +199,7 @@ int img_Load( const char* fileName, ShaderType shaderType )
 	}
 
 	images[newIdx].textureObj = texture.textureID;
+	images[newIdx].textureLayer = texture.layer;
 	images[newIdx].size.v[0] = (float)texture.width;
 	images[newIdx].size.v[1] = (float)texture.height;
 	images[newIdx].offset = VEC2_ZERO;
@@ -160,6 +236,7 @@ int img_Create( SDL_Surface* surface, ShaderType shaderType )
 		llog( LOG_INFO, "Unable to convert surface to texture! SDL Error: %s", SDL_GetError( ) );
 		return -1;
 	} else {
+		images[newIdx].textureLayer = texture.layer;
 		images[newIdx].size.v[0] = (float)texture.width;
 		images[newIdx].size.v[1] = (float)texture.height;
 		images[newIdx].offset = VEC2_ZERO;
@@ -186,20 +263,19 @@ void img_Clean( int idx )
 	assert( idx >= 0 );
 	assert( images[idx].flags & IMGFLAG_IN_USE );
 
-	int bufIdx;
-
 	if( ( idx < 0 ) || ( ( images[idx].size.v[0] == 0.0f ) && ( images[idx].size.v[1] == 0.0f ) ) || ( idx >= MAX_IMAGES ) ) {
 		return;
 	}
 
 	/* clean up anything we're wanting to draw */
-	for( bufIdx = 0; bufIdx <= lastDrawInstruction; ++bufIdx ) {
-		if( renderBuffer[bufIdx].imageObj == idx ) {
-			if( lastDrawInstruction > 0 ) {
-				renderBuffer[bufIdx] = renderBuffer[lastDrawInstruction-1];
+	for( int packet = 0; packet < NUM_FRAME_PACKETS; ++packet ) {
+		DrawQueue* queue = &( renderQueues[packet] );
+		for( int bufIdx = 0; bufIdx < queue->count; ++bufIdx ) {
+			if( queue->imageObj[bufIdx] == idx ) {
+				--queue->count;
+				copyDrawInstruction( queue, bufIdx, queue->count );
+				--bufIdx;
 			}
-			--lastDrawInstruction;
-			--bufIdx;
 		}
 	}
 
@@ -207,13 +283,18 @@ void img_Clean( int idx )
 	//  TODO: See if this needs to be sped up
 	int deleteTexture = 1;
 	for( int i = 0; ( i < MAX_IMAGES ) && deleteTexture; ++i ) {
-		if( ( images[i].flags & IMGFLAG_IN_USE ) && ( images[i].textureObj == images[idx].textureObj ) ) {
+		if( ( i != idx ) && ( images[i].flags & IMGFLAG_IN_USE ) && ( images[i].textureObj == images[idx].textureObj ) &&
+			( images[i].textureLayer == images[idx].textureLayer ) ) {
 			deleteTexture = 0;
 		}
 	}
 
 	if( deleteTexture ) {
-		glDeleteTextures( 1, &( images[idx].textureObj ) );
+		// textures in array layers share the texture object, so let the texture handling decide what to release
+		Texture texture;
+		texture.textureID = images[idx].textureObj;
+		texture.layer = images[idx].textureLayer;
+		gfxUtil_UnloadTexture( &texture );
 	}
 	images[idx].size = VEC2_ZERO;
 	images[idx].flags = 0;
@@ -256,6 +337,7 @@ int split( Texture* texture, int packageID, ShaderType shaderType, int count, Ve
 		}
 
 		images[newIdx].textureObj = texture->textureID;
+		images[newIdx].textureLayer = texture->layer;
 		vec2_Subtract( &( maxes[i] ), &( mins[i] ), &( images[newIdx].size ) );
 		images[newIdx].offset = VEC2_ZERO;
 		images[newIdx].packageID = packageID;
@@ -379,54 +461,68 @@ int img_GetSize( int idx, Vector2* out )
 }
 
 /*
-initializes the structure so only what's used needs to be set, also fill in
-  some stuff that all of the queueRenderImage functions use, returns the pointer
-  for further setting of other stuff
- returns NULL if there's a problem
+Gets everything needed to draw the image as a sprite: the texture and the layer in it (< 0 if it isn't an array
+ texture), the uvs of the corners, the size, the offset, and whether it has any transparency. Any of the out
+ parameters can be NULL. Returns a negative number if there's an issue.
 */
-static DrawInstruction* GetNextRenderInstruction( int imgObj, uint32_t camFlags, Vector2 startPos, Vector2 endPos, int8_t depth )
+int img_GetSpriteData( int idx, GLuint* outTexture, int* outTextureLayer, Vector2* outUVMin, Vector2* outUVMax,
+	Vector2* outSize, Vector2* outOffset, bool* outTransparent )
+{
+	if( ( idx < 0 ) || ( idx >= MAX_IMAGES ) || ( !( images[idx].flags & IMGFLAG_IN_USE ) ) ) {
+		return -1;
+	}
+
+	if( outTexture != NULL ) (*outTexture) = images[idx].textureObj;
+	if( outTextureLayer != NULL ) (*outTextureLayer) = images[idx].textureLayer;
+	if( outUVMin != NULL ) (*outUVMin) = images[idx].uvMin;
+	if( outUVMax != NULL ) (*outUVMax) = images[idx].uvMax;
+	if( outSize != NULL ) (*outSize) = images[idx].size;
+	if( outOffset != NULL ) (*outOffset) = images[idx].offset;
+	if( outTransparent != NULL ) (*outTransparent) = ( images[idx].flags & IMGFLAG_HAS_TRANSPARENCY ) != 0;
+	return 0;
+}
+
+/*
+initializes the instruction so only what's used needs to be set, also fill in
+  some stuff that all of the queueRenderImage functions use, returns the index
+  of the instruction in the write queue for further setting of other stuff
+ returns -1 if there's a problem
+*/
+static int GetNextRenderInstruction( int imgObj, uint32_t camFlags, Vector2 startPos, Vector2 endPos, int8_t depth )
 {
 	if( !( images[imgObj].flags & IMGFLAG_IN_USE ) ) {
 		llog( LOG_VERBOSE, "Attempting to draw invalid image: %i", imgObj );
-		return NULL;
+		return -1;
 	}
 
-	if( lastDrawInstruction >= MAX_RENDER_INSTRUCTIONS ) {
-		llog( LOG_VERBOSE, "Render instruction queue full." );
-		return NULL;
+	DrawQueue* queue = &( renderQueues[writePacket] );
+	if( queue->count >= queue->capacity ) {
+		if( growDrawQueue( queue, queue->capacity + ( queue->capacity / 2 ) + 1 ) < 0 ) {
+			return -1;
+		}
 	}
 
-	++lastDrawInstruction;
-	DrawInstruction* ri = &( renderBuffer[lastDrawInstruction] );
-
-	*ri = DEFAULT_DRAW_INSTRUCTION;
-	ri->textureObj = images[imgObj].textureObj;
-	ri->imageObj = imgObj;
-	ri->start.pos = startPos;
-	ri->end.pos = endPos;
-	ri->start.scaleSize = images[imgObj].size;
-	ri->end.scaleSize = images[imgObj].size;
-	ri->start.color = CLR_WHITE;
-	ri->end.color = CLR_WHITE;
-	ri->start.rotation = 0.0f;
-	ri->end.rotation = 0.0f;
-	ri->offset = images[imgObj].offset;
-	ri->flags = images[imgObj].flags;
-	ri->camFlags = camFlags;
-	ri->shaderType = images[imgObj].shaderType;
-	ri->depth = depth;
-	ri->scissorID = scissor_GetTopID( );
-	memcpy( ri->uvs, DEFAULT_DRAW_INSTRUCTION.uvs, sizeof( ri->uvs ) );
-
-	ri->uvs[0] = images[imgObj].uvMin;
-
-	ri->uvs[1].x = images[imgObj].uvMin.x;
-	ri->uvs[1].y = images[imgObj].uvMax.y;
-
-	ri->uvs[2].x = images[imgObj].uvMax.x;
-	ri->uvs[2].y = images[imgObj].uvMin.y;
-
-	ri->uvs[3] = images[imgObj].uvMax;
+	int ri = queue->count++;
+	peakDrawInstructions = MAX( peakDrawInstructions, queue->count );
+
+	queue->imageObj[ri] = imgObj;
+	queue->startPos[ri] = startPos;
+	queue->endPos[ri] = endPos;
+	queue->startScale[ri] = images[imgObj].size;
+	queue->endScale[ri] = images[imgObj].size;
+	queue->offset[ri] = images[imgObj].offset;
+	queue->startRot[ri] = 0.0f;
+	queue->endRot[ri] = 0.0f;
+	queue->startColor[ri] = CLR_WHITE;
+	queue->endColor[ri] = CLR_WHITE;
+	queue->uvMin[ri] = images[imgObj].uvMin;
+	queue->uvMax[ri] = images[imgObj].uvMax;
+	queue->textureObj[ri] = images[imgObj].textureObj;
+	queue->textureLayer[ri] = images[imgObj].textureLayer;
+	queue->scissorID[ri] = scissor_GetTopID( );
+	queue->camFlags[ri] = camFlags;
+	queue->depth[ri] = depth;
+	queue->transparent[ri] = ( images[imgObj].flags & IMGFLAG_HAS_TRANSPARENCY ) ? 1 : 0;
 
 	return ri;
 }
@@ -435,28 +531,28 @@ static DrawInstruction* GetNextRenderInstruction( int imgObj, uint32_t camFlags,
 Adds to the list of images to draw.
 */
 #define DRAW_INSTRUCTION_START \
-	DrawInstruction* ri = GetNextRenderInstruction( imgID, camFlags, startPos, endPos, depth ); \
-	if( ri == NULL ) { return -1; }
+	int ri = GetNextRenderInstruction( imgID, camFlags, startPos, endPos, depth ); \
+	if( ri < 0 ) { return -1; }
 
 #define DRAW_INSTRUCTION_END \
 	return 0;
 
 #define SET_DRAW_INSTRUCTION_SCALE( startX, startY, endX, endY ) \
-	ri->start.scaleSize.x *= startX; \
-	ri->start.scaleSize.y *= startY; \
-	ri->end.scaleSize.x *= endX; \
-	ri->end.scaleSize.y *= endY;
+	renderQueues[writePacket].startScale[ri].x *= startX; \
+	renderQueues[writePacket].startScale[ri].y *= startY; \
+	renderQueues[writePacket].endScale[ri].x *= endX; \
+	renderQueues[writePacket].endScale[ri].y *= endY;
 
 #define SET_DRAW_INSTRUCTION_COLOR( startColor, endColor ) \
-	ri->start.color = startColor; \
-	ri->end.color = endColor; \
+	renderQueues[writePacket].startColor[ri] = startColor; \
+	renderQueues[writePacket].endColor[ri] = endColor; \
 	if( ( ( startColor.a > 0 ) && ( startColor.a < 1.0f ) ) || \
 		( ( endColor.a > 0 ) && ( endColor.a < 1.0f ) )) { \
-		ri->flags |= IMGFLAG_HAS_TRANSPARENCY; }
+		renderQueues[writePacket].transparent[ri] = 1; }
 
 #define SET_DRAW_INSTRUCTION_ROT( startRotRad, endRotRad ) \
-	ri->start.rotation = startRotRad; \
-	ri->end.rotation = endRotRad;
+	renderQueues[writePacket].startRot[ri] = startRotRad; \
+	renderQueues[writePacket].endRot[ri] = endRotRad;
 
 int img_Draw( int imgID, uint32_t camFlags, Vector2 startPos, Vector2 endPos, int8_t depth )
 {
@@ -682,82 +778,110 @@ Clears the image draw list.
 */
 void img_ClearDrawInstructions( void )
 {
-	lastDrawInstruction = -1;
+	renderQueues[writePacket].count = 0;
 }
 
-static void createRenderTransform( Vector2* pos, Vector2* scale, float rot,  Vector2* offset, Matrix4* out )
+/*
+Gets how many draw instructions have been queued since the last clear, the most that have been queued in a
+ single frame, and how many the current queue has space for before it has to grow. Any of the out parameters
+ can be NULL.
+*/
+void img_GetDrawInstructionStats( int* outQueued, int* outPeak, int* outCapacity )
 {
-	memcpy( out, &IDENTITY_MATRIX, sizeof( Matrix4 ) );
-	// this is the fully multiplied out multiplication of the transform, scale, and z-rotation
-	// pos * rot * offset * scale
-	//  problem here if the scale is different in each dimension (e.g scale = { 16, 24 }), the rotation isn't taken
-	//  into account so you end up with an oddly stretched image
+	if( outQueued != NULL ) (*outQueued) = renderQueues[writePacket].count;
+	if( outPeak != NULL ) (*outPeak) = peakDrawInstructions;
+	if( outCapacity != NULL ) (*outCapacity) = renderQueues[writePacket].capacity;
+}
 
-	
-	float cosRot = cosf( rot );
-	float sinRot = sinf( rot );
+/*
+Sets which frame packet new draw instructions are added to.
+*/
+void img_SetWritePacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	writePacket = packet;
+}
 
-	out->m[0] = cosRot * scale->v[0];
-	out->m[1] = sinRot * scale->v[0];
-	out->m[4] = -sinRot * scale->v[1];
-	out->m[5] = cosRot * scale->v[1];
-	//out->m[10] = scale->v[2];
-	out->m[12] = pos->v[0] - ( offset->v[1] * sinRot ) + ( offset->v[0] * cosRot );
-	out->m[13] = pos->v[1] + ( offset->v[0] * sinRot ) + ( offset->v[1] * cosRot );
-	//out->m[14] = -pos->v[2]; //*/
+/*
+Sets which frame packet the draw instructions are rendered from.
+*/
+void img_SetReadPacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	readPacket = packet;
+}
 
-	// pos * rot * scale * offset
-	/*out->m[0] = cosRot * scale->v[0];
-	out->m[1] = sinRot * scale->v[0];
-	out->m[4] = -sinRot * scale->v[1];
-	out->m[5] = cosRot * scale->v[1];
+// sends the instructions from first up to end to the triangle renderer
+static void addSpriteRun( DrawQueue* queue, int first, int end )
+{
+	SpriteArrays sprites;
+	sprites.startPos = &( queue->startPos[first] );
+	sprites.endPos = &( queue->endPos[first] );
+	sprites.startScale = &( queue->startScale[first] );
+	sprites.endScale = &( queue->endScale[first] );
+	sprites.offset = &( queue->offset[first] );
+	sprites.startRot = &( queue->startRot[first] );
+	sprites.endRot = &( queue->endRot[first] );
+	sprites.startColor = &( queue->startColor[first] );
+	sprites.endColor = &( queue->endColor[first] );
+	sprites.uvMin = &( queue->uvMin[first] );
+	sprites.uvMax = &( queue->uvMax[first] );
+	sprites.texture = &( queue->textureObj[first] );
+	sprites.textureLayer = &( queue->textureLayer[first] );
+	sprites.clippingID = &( queue->scissorID[first] );
+	sprites.camFlags = &( queue->camFlags[first] );
+	sprites.depth = &( queue->depth[first] );
+	sprites.transparent = &( queue->transparent[first] );
 
-	out->m[12] = pos->v[0] + ( offset->v[0] * scale->v[0] * cosRot ) + ( offset->v[1] * scale->v[1] * -sinRot );
-	out->m[13] = pos->v[1] + ( offset->v[0] * scale->v[0] * sinRot ) + ( offset->v[1] * scale->v[1] * cosRot );//*/
+	triRenderer_AddSprites( &sprites, end - first );
 }
 
-/*
-Draw all the images.
-*/
-void img_Render( float normTimeElapsed )
+// the sprite can be rotated any amount between its states, so use the circle around the scaled and offset quad
+static float spriteRadius( Vector2 scale, Vector2 offset )
 {
-	Vector2 unitSqVertPos[] = { { -0.5f, -0.5f }, { -0.5f, 0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f } };
-	GLuint indices[] = {
-		0, 1, 2,
-		1, 2, 3,
-	};
+	return ( vec2_Mag( &offset ) + ( 0.5f * vec2_Mag( &scale ) ) );
+}
 
-	for( int idx = 0; idx <= lastDrawInstruction; ++idx ) {
-		Vector2 verts[4];
+static bool isInstructionVisible( DrawQueue* queue, int idx )
+{
+	float startRadius = spriteRadius( queue->startScale[idx], queue->offset[idx] );
+	float endRadius = spriteRadius( queue->endScale[idx], queue->offset[idx] );
 
-		// generate the sprites matrix
-		Matrix4 modelTf;
-		Vector2 pos, sclSz;
-		float rot;
-		Color col;
+	Vector2 startMin, startMax, endMin, endMax;
+	startMin.x = queue->startPos[idx].x - startRadius;
+	startMin.y = queue->startPos[idx].y - startRadius;
+	startMax.x = queue->startPos[idx].x + startRadius;
+	startMax.y = queue->startPos[idx].y + startRadius;
+	endMin.x = queue->endPos[idx].x - endRadius;
+	endMin.y = queue->endPos[idx].y - endRadius;
+	endMax.x = queue->endPos[idx].x + endRadius;
+	endMax.y = queue->endPos[idx].y + endRadius;
 
-		vec2_Lerp( &( renderBuffer[idx].start.pos ), &( renderBuffer[idx].end.pos ), normTimeElapsed, &pos );
-		clr_Lerp( &( renderBuffer[idx].start.color ), &( renderBuffer[idx].end.color ), normTimeElapsed, &col );
-		vec2_Lerp( &( renderBuffer[idx].start.scaleSize ), &( renderBuffer[idx].end.scaleSize ), normTimeElapsed, &sclSz );
+	return cam_IsRenderAreaVisible( queue->camFlags[idx], startMin, startMax, endMin, endMax );
+}
 
-		rot = radianRotLerp( renderBuffer[idx].start.rotation, renderBuffer[idx].end.rotation, normTimeElapsed );
-		createRenderTransform( &pos, &sclSz, rot, &renderBuffer[idx].offset, &modelTf );
+/*
+Sends all the images to the triangle renderer. Each image is sent as a single sprite with both its start and end
+ states, the quad is built and interpolated when it's drawn. Images no camera can see are skipped, everything else
+ is handed over in runs.
+*/
+void img_Render( void )
+{
+	DrawQueue* queue = &( renderQueues[readPacket] );
 
-		for( int i = 0; i < 4; ++i ) {
-			mat4_TransformVec2Pos( &modelTf, &( unitSqVertPos[i] ), &( verts[i] ) );
+	int runStart = -1;
+	for( int i = 0; i < queue->count; ++i ) {
+		if( isInstructionVisible( queue, i ) ) {
+			if( runStart < 0 ) {
+				runStart = i;
+			}
+		} else if( runStart >= 0 ) {
+			addSpriteRun( queue, runStart, i );
+			runStart = -1;
 		}
+	}
 
-		int transparent = ( renderBuffer[idx].flags & IMGFLAG_HAS_TRANSPARENCY ) != 0;
-
-		triRenderer_Add( verts[indices[0]], verts[indices[1]], verts[indices[2]],
-			renderBuffer[idx].uvs[indices[0]], renderBuffer[idx].uvs[indices[1]], renderBuffer[idx].uvs[indices[2]],
-			renderBuffer[idx].shaderType, renderBuffer[idx].textureObj, col,
-			renderBuffer[idx].scissorID, renderBuffer[idx].camFlags, renderBuffer[idx].depth,
-			transparent );
-		triRenderer_Add( verts[indices[3]], verts[indices[4]], verts[indices[5]],
-			renderBuffer[idx].uvs[indices[3]], renderBuffer[idx].uvs[indices[4]], renderBuffer[idx].uvs[indices[5]],
-			renderBuffer[idx].shaderType, renderBuffer[idx].textureObj, col,
-			renderBuffer[idx].scissorID, renderBuffer[idx].camFlags, renderBuffer[idx].depth,
-			transparent );
+	if( runStart >= 0 ) {
+		addSpriteRun( queue, runStart, queue->count );
 	}
-}
\ No newline at end of file
+}
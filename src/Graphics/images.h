@@ -2,6 +2,7 @@
 #define IMAGES_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <SDL.h>
 #include "../Math/vector2.h"
 #include "color.h"
@@ -63,6 +64,14 @@ Gets the size of the image, putting it into the out Vector2. Returns a negative
 */
 int img_GetSize( int idx, Vector2* out );
 
+/*
+Gets everything needed to draw the image as a sprite: the texture and the layer in it (< 0 if it isn't an array
+ texture), the uvs of the corners, the size, the offset, and whether it has any transparency. Any of the out
+ parameters can be NULL. Returns a negative number if there's an issue.
+*/
+int img_GetSpriteData( int idx, GLuint* outTexture, int* outTextureLayer, Vector2* outUVMin, Vector2* outUVMax,
+	Vector2* outSize, Vector2* outOffset, bool* outTransparent );
+
 /*
 Adds to the list of images to draw.
 */
@@ -103,8 +112,26 @@ Clears the image draw list.
 void img_ClearDrawInstructions( void );
 
 /*
-Draw all the images.
+Gets how many draw instructions have been queued since the last clear, the most that have been queued in a
+ single frame, and how many the current queue has space for before it has to grow. Any of the out parameters
+ can be NULL.
+*/
+void img_GetDrawInstructionStats( int* outQueued, int* outPeak, int* outCapacity );
+
+/*
+Sets which frame packet new draw instructions are added to.
+*/
+void img_SetWritePacket( int packet );
+
+/*
+Sets which frame packet the draw instructions are rendered from.
+*/
+void img_SetReadPacket( int packet );
+
+/*
+Sends all the images to the triangle renderer. Each image is sent as a single sprite with both its start and end
+ states, the quad is built and interpolated when it's drawn.
 */
-void img_Render( float normTimeElapsed );
+void img_Render( void );
 
 #endif /* inclusion guard */
\ No newline at end of file
@@ -0,0 +1,506 @@
+#include "layerCache.h"
+
+#include <math.h>
+#include <string.h>
+#include <SDL_mutex.h>
+
+#include "glDebugging.h"
+#include "shaderManager.h"
+#include "glState.h"
+#include "renderStats.h"
+#include "../Math/mathUtil.h"
+#include "../System/platformLog.h"
+
+// one for each camera
+#define MAX_LAYERS 16
+
+typedef struct {
+	// what's been asked for, shared with whoever is turning the layers on and invalidating them
+	bool enabled;
+	bool invalidateAll;
+	bool hasRegion;
+	Vector2 regionMin;
+	Vector2 regionMax;
+
+	// everything below is only used by the rendering
+	GLuint texture;
+	GLsizei width;
+	GLsizei height;
+	bool valid;
+	bool overBudget;
+
+	bool contentKnown;
+	uint64_t contentSignature;
+	bool contentAnimated;
+
+	uint64_t drawnSignature;
+	Matrix4 drawnVPMat;
+
+	// set while the layer is bound for drawing
+	bool drawing;
+	GLint previousFramebuffer;
+} Layer;
+
+static Layer layers[MAX_LAYERS];
+static SDL_mutex* layerMutex = NULL;
+
+// all the layers share the same framebuffer and depth buffer, the depth is cleared before every camera is drawn so
+//  there's no need for one each
+static GLuint layerFBO = 0;
+static GLuint depthRBO = 0;
+static GLsizei depthWidth = 0;
+static GLsizei depthHeight = 0;
+
+static GLuint quadVAO = 0;
+static GLuint quadVBO = 0;
+static ShaderProgram compositeProgram;
+
+static size_t memoryBudget = 0;
+static size_t usedBytes = 0;
+static int numCachedLayers = 0;
+
+static int totalHits = 0;
+static int totalMisses = 0;
+static int totalRegionRedraws = 0;
+
+// each pixel of a layer and the depth buffer is four bytes
+#define BYTES_PER_PIXEL 4
+
+static int createShader( void )
+{
+	ShaderDefinition shaderDefs[2];
+	ShaderProgramDefinition progDef;
+	shaderDefs[0].fileName = NULL;
+	shaderDefs[0].type = GL_VERTEX_SHADER;
+	shaderDefs[0].shaderText = LAYER_VERT_SHADER;
+
+	shaderDefs[1].fileName = NULL;
+	shaderDefs[1].type = GL_FRAGMENT_SHADER;
+	shaderDefs[1].shaderText = LAYER_FRAG_SHADER;
+
+	progDef.fragmentShader = 1;
+	progDef.vertexShader = 0;
+	progDef.geometryShader = -1;
+	progDef.uniformNames = "layerUnit";
+
+	if( shaders_Load( &( shaderDefs[0] ), sizeof( shaderDefs ) / sizeof( ShaderDefinition ), &progDef, &compositeProgram, 1 ) <= 0 ) {
+		llog( LOG_ERROR, "Error compiling layer cache shaders." );
+		return -1;
+	}
+
+	return 0;
+}
+
+static int createOGLObjects( void )
+{
+	float quadCorners[] = { -0.5f, -0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f, 0.5f };
+
+	GL( glGenFramebuffers( 1, &layerFBO ) );
+	GL( glGenRenderbuffers( 1, &depthRBO ) );
+	GL( glGenVertexArrays( 1, &quadVAO ) );
+	GL( glGenBuffers( 1, &quadVBO ) );
+	if( ( layerFBO == 0 ) || ( depthRBO == 0 ) || ( quadVAO == 0 ) || ( quadVBO == 0 ) ) {
+		llog( LOG_ERROR, "Unable to create one or more storage objects for the layer cache." );
+		return -1;
+	}
+
+	glState_BindVertexArray( quadVAO );
+	GL( glBindBuffer( GL_ARRAY_BUFFER, quadVBO ) );
+	GL( glBufferData( GL_ARRAY_BUFFER, sizeof( quadCorners ), quadCorners, GL_STATIC_DRAW ) );
+	GL( glEnableVertexAttribArray( 0 ) );
+	GL( glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof( float ) * 2, NULL ) );
+	glState_BindVertexArray( 0 );
+	GL( glBindBuffer( GL_ARRAY_BUFFER, 0 ) );
+
+	return 0;
+}
+
+/*
+Sets up everything needed for caching layers.
+ Returns a number < 0 if there was a problem.
+*/
+int layerCache_Init( void )
+{
+	memset( layers, 0, sizeof( layers ) );
+
+	if( layerMutex == NULL ) {
+		layerMutex = SDL_CreateMutex( );
+		if( layerMutex == NULL ) {
+			llog( LOG_ERROR, "Unable to create layer cache mutex: %s", SDL_GetError( ) );
+			return -1;
+		}
+	}
+
+	if( ( createOGLObjects( ) < 0 ) || ( createShader( ) < 0 ) ) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Sets the most memory the cached layers can use on the GPU, 0 means there's no limit. Any layer that would go over it
+ isn't cached.
+*/
+void layerCache_SetMemoryBudget( size_t bytes )
+{
+	SDL_LockMutex( layerMutex );
+		memoryBudget = bytes;
+		for( int i = 0; i < MAX_LAYERS; ++i ) {
+			layers[i].overBudget = false;
+		}
+	SDL_UnlockMutex( layerMutex );
+}
+
+static Layer* getLayer( int camera )
+{
+	if( ( layerMutex == NULL ) || ( camera < 0 ) || ( camera >= MAX_LAYERS ) ) {
+		return NULL;
+	}
+	return &( layers[camera] );
+}
+
+/*
+Turns caching on or off for what a camera draws.
+*/
+void layerCache_Enable( int camera )
+{
+	Layer* layer = getLayer( camera );
+	if( layer == NULL ) {
+		return;
+	}
+
+	SDL_LockMutex( layerMutex );
+		layer->enabled = true;
+		layer->invalidateAll = true;
+	SDL_UnlockMutex( layerMutex );
+}
+
+void layerCache_Disable( int camera )
+{
+	Layer* layer = getLayer( camera );
+	if( layer == NULL ) {
+		return;
+	}
+
+	SDL_LockMutex( layerMutex );
+		layer->enabled = false;
+	SDL_UnlockMutex( layerMutex );
+}
+
+/*
+Makes the camera's layer be drawn again. Invalidating a region only draws the area of the layer that the world space
+ area from min to max covers.
+*/
+void layerCache_Invalidate( int camera )
+{
+	Layer* layer = getLayer( camera );
+	if( layer == NULL ) {
+		return;
+	}
+
+	SDL_LockMutex( layerMutex );
+		layer->invalidateAll = true;
+	SDL_UnlockMutex( layerMutex );
+}
+
+void layerCache_InvalidateRegion( int camera, Vector2 min, Vector2 max )
+{
+	Layer* layer = getLayer( camera );
+	if( layer == NULL ) {
+		return;
+	}
+
+	SDL_LockMutex( layerMutex );
+		if( layer->hasRegion ) {
+			layer->regionMin.x = MIN( layer->regionMin.x, MIN( min.x, max.x ) );
+			layer->regionMin.y = MIN( layer->regionMin.y, MIN( min.y, max.y ) );
+			layer->regionMax.x = MAX( layer->regionMax.x, MAX( min.x, max.x ) );
+			layer->regionMax.y = MAX( layer->regionMax.y, MAX( min.y, max.y ) );
+		} else {
+			layer->regionMin = vec2( MIN( min.x, max.x ), MIN( min.y, max.y ) );
+			layer->regionMax = vec2( MAX( min.x, max.x ), MAX( min.y, max.y ) );
+			layer->hasRegion = true;
+		}
+	SDL_UnlockMutex( layerMutex );
+}
+
+/*
+Gets how many layers are cached and how many bytes they're using on the GPU, and the number of times since the cache
+ was set up that a layer was drawn straight from the cache, had to be drawn again, or only had a region drawn
+ again. Any of the out parameters can be NULL.
+*/
+void layerCache_GetStats( int* outLayers, size_t* outBytes, int* outHits, int* outMisses, int* outRegionRedraws )
+{
+	if( outLayers != NULL ) (*outLayers) = numCachedLayers;
+	if( outBytes != NULL ) (*outBytes) = usedBytes;
+	if( outHits != NULL ) (*outHits) = totalHits;
+	if( outMisses != NULL ) (*outMisses) = totalMisses;
+	if( outRegionRedraws != NULL ) (*outRegionRedraws) = totalRegionRedraws;
+}
+
+/*
+Used by the triangle renderer. Returns whether the camera is cached.
+*/
+bool layerCache_IsEnabled( int camera )
+{
+	Layer* layer = getLayer( camera );
+	if( layer == NULL ) {
+		return false;
+	}
+
+	SDL_LockMutex( layerMutex );
+		bool enabled = layer->enabled;
+	SDL_UnlockMutex( layerMutex );
+
+	return enabled;
+}
+
+/*
+Used by the triangle renderer after the triangles are uploaded. Sets what the camera's layer shows now, the signature
+ changes whenever anything the camera can see changes, and animated is if anything it can see is moving.
+*/
+void layerCache_SetContent( int camera, uint64_t signature, bool animated )
+{
+	Layer* layer = getLayer( camera );
+	if( layer == NULL ) {
+		return;
+	}
+
+	layer->contentKnown = true;
+	layer->contentSignature = signature;
+	layer->contentAnimated = animated;
+}
+
+static void releaseTexture( Layer* layer )
+{
+	if( layer->texture == 0 ) {
+		return;
+	}
+
+	glState_DeleteTextures( 1, &( layer->texture ) );
+	layer->texture = 0;
+	usedBytes -= (size_t)layer->width * (size_t)layer->height * BYTES_PER_PIXEL;
+	layer->width = 0;
+	layer->height = 0;
+	layer->valid = false;
+	--numCachedLayers;
+
+	// the depth buffer is only needed while there's a layer to draw into
+	if( ( numCachedLayers == 0 ) && ( depthWidth > 0 ) ) {
+		GL( glBindRenderbuffer( GL_RENDERBUFFER, depthRBO ) );
+		GL( glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT32, 0, 0 ) );
+		GL( glBindRenderbuffer( GL_RENDERBUFFER, 0 ) );
+		usedBytes -= (size_t)depthWidth * (size_t)depthHeight * BYTES_PER_PIXEL;
+		depthWidth = 0;
+		depthHeight = 0;
+	}
+}
+
+// makes sure the layer has a texture the size of the area being drawn to, returns false if it can't have one
+static bool prepareTexture( Layer* layer, GLsizei width, GLsizei height )
+{
+	// if the budget was lowered below what's in use the layer is let go so it can be checked against it again
+	if( ( layer->texture != 0 ) && ( layer->width == width ) && ( layer->height == height ) &&
+		( ( memoryBudget == 0 ) || ( usedBytes <= memoryBudget ) ) ) {
+		return true;
+	}
+
+	releaseTexture( layer );
+
+	size_t layerBytes = (size_t)width * (size_t)height * BYTES_PER_PIXEL;
+	if( ( memoryBudget > 0 ) && ( ( usedBytes + layerBytes ) > memoryBudget ) ) {
+		if( !layer->overBudget ) {
+			llog( LOG_WARN, "Caching layer would go over the memory budget, it won't be cached." );
+			layer->overBudget = true;
+		}
+		return false;
+	}
+
+	GL( glGenTextures( 1, &( layer->texture ) ) );
+	if( layer->texture == 0 ) {
+		llog( LOG_ERROR, "Unable to create texture for layer." );
+		return false;
+	}
+
+	glState_BindTexture( 0, GL_TEXTURE_2D, layer->texture );
+	GL( glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE ) );
+	glState_BindTexture( 0, GL_TEXTURE_2D, 0 );
+
+	layer->width = width;
+	layer->height = height;
+	layer->valid = false;
+	usedBytes += layerBytes;
+	++numCachedLayers;
+
+	return true;
+}
+
+// all the layers share one depth buffer, it's resized to match the layer whenever one of a different size is drawn,
+//  returns false if it can't be
+static bool prepareDepth( Layer* layer )
+{
+	if( ( depthWidth == layer->width ) && ( depthHeight == layer->height ) ) {
+		return true;
+	}
+
+	size_t oldDepthBytes = (size_t)depthWidth * (size_t)depthHeight * BYTES_PER_PIXEL;
+	size_t newDepthBytes = (size_t)layer->width * (size_t)layer->height * BYTES_PER_PIXEL;
+	if( ( memoryBudget > 0 ) && ( ( usedBytes - oldDepthBytes + newDepthBytes ) > memoryBudget ) ) {
+		if( !layer->overBudget ) {
+			llog( LOG_WARN, "Caching layer would go over the memory budget, it won't be cached." );
+			layer->overBudget = true;
+		}
+		return false;
+	}
+
+	GL( glBindRenderbuffer( GL_RENDERBUFFER, depthRBO ) );
+	GL( glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT32, layer->width, layer->height ) );
+	GL( glBindRenderbuffer( GL_RENDERBUFFER, 0 ) );
+	usedBytes = usedBytes - oldDepthBytes + newDepthBytes;
+	depthWidth = layer->width;
+	depthHeight = layer->height;
+
+	return true;
+}
+
+// converts the world space region to the area of pixels it covers
+static void regionToPixels( const Layer* layer, const Matrix4* vpMat, const GLint* viewport, GLint* outArea )
+{
+	Vector2 corners[2] = { layer->regionMin, layer->regionMax };
+	float minX = (float)viewport[2];
+	float minY = (float)viewport[3];
+	float maxX = 0.0f;
+	float maxY = 0.0f;
+	for( int i = 0; i < 2; ++i ) {
+		Vector2 ndc;
+		mat4_TransformVec2Pos( vpMat, &( corners[i] ), &ndc );
+		float x = ( ndc.x + 1.0f ) * 0.5f * (float)viewport[2];
+		float y = ( ndc.y + 1.0f ) * 0.5f * (float)viewport[3];
+		minX = MIN( minX, x );
+		minY = MIN( minY, y );
+		maxX = MAX( maxX, x );
+		maxY = MAX( maxY, y );
+	}
+
+	// grow it out to whole pixels so anything partially covered is drawn again
+	GLint x0 = (GLint)clamp( 0.0f, (float)viewport[2], floorf( minX ) );
+	GLint y0 = (GLint)clamp( 0.0f, (float)viewport[3], floorf( minY ) );
+	GLint x1 = (GLint)clamp( 0.0f, (float)viewport[2], ceilf( maxX ) );
+	GLint y1 = (GLint)clamp( 0.0f, (float)viewport[3], ceilf( maxY ) );
+	outArea[0] = viewport[0] + x0;
+	outArea[1] = viewport[1] + y0;
+	outArea[2] = MAX( 0, x1 - x0 );
+	outArea[3] = MAX( 0, y1 - y0 );
+}
+
+/*
+Used by the triangle renderer before drawing a camera. Works out if the camera's layer has to be drawn, if it does
+ the layer is bound and cleared inside the redraw area, which is given as x, y, width, and height in pixels.
+*/
+LayerDraw layerCache_Begin( int camera, const Matrix4* vpMat, GLint* outRedrawArea )
+{
+	Layer* layer = getLayer( camera );
+	if( layer == NULL ) {
+		return LD_UNCACHED;
+	}
+
+	SDL_LockMutex( layerMutex );
+		bool enabled = layer->enabled;
+		bool invalidateAll = layer->invalidateAll;
+		bool hasRegion = layer->hasRegion;
+		layer->invalidateAll = false;
+		layer->hasRegion = false;
+	SDL_UnlockMutex( layerMutex );
+
+	if( !enabled ) {
+		releaseTexture( layer );
+		return LD_UNCACHED;
+	}
+
+	// the layer is drawn with the same viewport it's shown with, so it has to start at the corner of the target
+	GLint viewport[4];
+	GL( glGetIntegerv( GL_VIEWPORT, viewport ) );
+	if( ( viewport[0] != 0 ) || ( viewport[1] != 0 ) ) {
+		return LD_UNCACHED;
+	}
+
+	if( !prepareTexture( layer, viewport[2], viewport[3] ) ) {
+		return LD_UNCACHED;
+	}
+
+	bool redrawAll = !layer->valid || invalidateAll || !layer->contentKnown || layer->contentAnimated ||
+		( layer->contentSignature != layer->drawnSignature ) || ( memcmp( vpMat, &( layer->drawnVPMat ), sizeof( Matrix4 ) ) != 0 );
+
+	// anything drawn into the layer needs the depth buffer, if there's no room for it the layer is dropped
+	if( ( redrawAll || hasRegion ) && !prepareDepth( layer ) ) {
+		releaseTexture( layer );
+		return LD_UNCACHED;
+	}
+
+	if( redrawAll ) {
+		++totalMisses;
+		memcpy( outRedrawArea, viewport, sizeof( viewport ) );
+	} else if( hasRegion ) {
+		++totalRegionRedraws;
+		regionToPixels( layer, vpMat, viewport, outRedrawArea );
+	} else {
+		++totalHits;
+		return LD_REUSE;
+	}
+
+	layer->valid = true;
+	layer->drawnSignature = layer->contentSignature;
+	memcpy( &( layer->drawnVPMat ), vpMat, sizeof( Matrix4 ) );
+
+	GL( glGetIntegerv( GL_DRAW_FRAMEBUFFER_BINDING, &( layer->previousFramebuffer ) ) );
+	GL( glBindFramebuffer( GL_DRAW_FRAMEBUFFER, layerFBO ) );
+	GL( glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer->texture, 0 ) );
+	GL( glFramebufferRenderbuffer( GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO ) );
+	layer->drawing = true;
+
+	// everything is drawn over a transparent layer
+	glState_SetEnabled( GL_SCISSOR_TEST, true );
+	GL( glScissor( outRedrawArea[0], outRedrawArea[1], outRedrawArea[2], outRedrawArea[3] ) );
+	GL( glClearColor( 0.0f, 0.0f, 0.0f, 0.0f ) );
+	GL( glClear( GL_COLOR_BUFFER_BIT ) );
+
+	return LD_REDRAW;
+}
+
+/*
+Used by the triangle renderer after drawing a camera, or instead of drawing it if it was reused. Draws the layer
+ over whatever was drawn before it. Leaves the depth and scissor tests on.
+*/
+void layerCache_End( int camera )
+{
+	Layer* layer = getLayer( camera );
+	if( ( layer == NULL ) || ( layer->texture == 0 ) ) {
+		return;
+	}
+
+	if( layer->drawing ) {
+		GL( glBindFramebuffer( GL_DRAW_FRAMEBUFFER, (GLuint)layer->previousFramebuffer ) );
+		layer->drawing = false;
+	}
+
+	// the colors in the layer were blended with their alpha already
+	glState_SetEnabled( GL_DEPTH_TEST, false );
+	glState_SetEnabled( GL_SCISSOR_TEST, false );
+	glState_SetEnabled( GL_BLEND, true );
+	glState_BlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+
+	glState_UseProgram( compositeProgram.programID );
+	GL( glUniform1i( compositeProgram.uniformLocs[0], 0 ) );
+	glState_BindTexture( 0, GL_TEXTURE_2D, layer->texture );
+	glState_BindVertexArray( quadVAO );
+	GL( glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 ) );
+	renderStats_CountDraw( 2 );
+
+	glState_SetEnabled( GL_DEPTH_TEST, true );
+	glState_SetEnabled( GL_SCISSOR_TEST, true );
+}
@@ -0,0 +1,83 @@
+/*
+Caches what a camera draws so it only has to be drawn again when something it shows changes. Every camera is drawn
+ over the ones before it, so each one is a layer, a cached camera is drawn into its own texture and that's drawn
+ over the cameras before it instead. The layer is drawn again if anything the camera can see changed when the
+ triangles were uploaded, if anything it can see is moving, if the camera itself moved, or if it was invalidated.
+ Invalidating a region only draws the layer again inside that area.
+
+The layers can be turned on and off and invalidated from any one thread while the rendering is running on another.
+*/
+
+#ifndef LAYER_CACHE_H
+#define LAYER_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "glPlatform.h"
+#include "../Math/vector2.h"
+#include "../Math/matrix4.h"
+
+typedef enum {
+	LD_UNCACHED, // the camera isn't cached, draw it like normal
+	LD_REUSE, // the cached layer is still good, there's nothing to draw
+	LD_REDRAW // the layer is bound and has to be drawn inside the redraw area
+} LayerDraw;
+
+/*
+Sets up everything needed for caching layers.
+ Returns a number < 0 if there was a problem.
+*/
+int layerCache_Init( void );
+
+/*
+Sets the most memory the cached layers can use on the GPU, 0 means there's no limit. Any layer that would go over it
+ isn't cached.
+*/
+void layerCache_SetMemoryBudget( size_t bytes );
+
+/*
+Turns caching on or off for what a camera draws.
+*/
+void layerCache_Enable( int camera );
+void layerCache_Disable( int camera );
+
+/*
+Makes the camera's layer be drawn again. Invalidating a region only draws the area of the layer that the world space
+ area from min to max covers.
+*/
+void layerCache_Invalidate( int camera );
+void layerCache_InvalidateRegion( int camera, Vector2 min, Vector2 max );
+
+/*
+Gets how many layers are cached and how many bytes they're using on the GPU, and the number of times since the cache
+ was set up that a layer was drawn straight from the cache, had to be drawn again, or only had a region drawn
+ again. Any of the out parameters can be NULL.
+*/
+void layerCache_GetStats( int* outLayers, size_t* outBytes, int* outHits, int* outMisses, int* outRegionRedraws );
+
+/*
+Used by the triangle renderer. Returns whether the camera is cached.
+*/
+bool layerCache_IsEnabled( int camera );
+
+/*
+Used by the triangle renderer after the triangles are uploaded. Sets what the camera's layer shows now, the signature
+ changes whenever anything the camera can see changes, and animated is if anything it can see is moving.
+*/
+void layerCache_SetContent( int camera, uint64_t signature, bool animated );
+
+/*
+Used by the triangle renderer before drawing a camera. Works out if the camera's layer has to be drawn, if it does
+ the layer is bound and cleared inside the redraw area, which is given as x, y, width, and height in pixels.
+*/
+LayerDraw layerCache_Begin( int camera, const Matrix4* vpMat, GLint* outRedrawArea );
+
+/*
+Used by the triangle renderer after drawing a camera, or instead of drawing it if it was reused. Draws the layer
+ over whatever was drawn before it. Leaves the depth and scissor tests on.
+*/
+void layerCache_End( int camera );
+
+#endif // inclusion guard
@@ -0,0 +1,325 @@
+#include "renderStats.h"
+
+#include <string.h>
+#include <SDL.h>
+
+#include "glPlatform.h"
+#include "glDebugging.h"
+#include "glState.h"
+#include "triRendering.h"
+#include "../System/platformLog.h"
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT
+#define GL_GPU_DISJOINT 0x8FBB
+#endif
+
+// deep enough that the GPU is always done with a frame before its queries come around again
+#define RING_SIZE 3
+
+typedef void ( GL_PROC_API *GetQueryObjectui64vFunc )( GLuint id, GLenum pname, GLuint64* params );
+
+typedef struct {
+	RenderFrameStats stats;
+	GLuint queries[NUM_RENDER_PASSES];
+	bool queried[NUM_RENDER_PASSES];
+	bool pending;
+} FrameSlot;
+
+static FrameSlot ring[RING_SIZE];
+static unsigned int frameCount = 0;
+static FrameSlot* currSlot = NULL;
+static int currPass = -1;
+static Uint64 passStart = 0;
+
+static bool gpuTimers = false;
+static bool checkDisjoint = false;
+static GetQueryObjectui64vFunc getQueryObjectui64v = NULL;
+
+static RenderFrameStats lastStats;
+static bool haveLastStats = false;
+
+static SDL_RWops* csvFile = NULL;
+
+static const char* passNames[] = { "images", "spine", "upload", "triangles", "game_imgui", "debug", "blit", "editor_imgui" };
+static const char* batchBreakNames[] = { "texture", "shader", "scissor", "camera", "order" };
+
+/*
+Sets up the timer queries if they're supported, needs the context to be current.
+ Returns a number < 0 if there was a problem.
+*/
+int renderStats_Init( void )
+{
+	memset( ring, 0, sizeof( ring ) );
+	frameCount = 0;
+	currSlot = NULL;
+	currPass = -1;
+	haveLastStats = false;
+
+#if defined( WIN32 )
+	// timer queries are core in 3.3
+	gpuTimers = true;
+	checkDisjoint = false;
+#else
+	checkDisjoint = SDL_GL_ExtensionSupported( "GL_EXT_disjoint_timer_query" ) ||
+		SDL_GL_ExtensionSupported( "GL_EXT_disjoint_timer_query_webgl2" );
+	gpuTimers = checkDisjoint;
+#endif
+
+	if( gpuTimers ) {
+		getQueryObjectui64v = (GetQueryObjectui64vFunc)SDL_GL_GetProcAddress( "glGetQueryObjectui64v" );
+		if( getQueryObjectui64v == NULL ) {
+			getQueryObjectui64v = (GetQueryObjectui64vFunc)SDL_GL_GetProcAddress( "glGetQueryObjectui64vEXT" );
+		}
+		gpuTimers = ( getQueryObjectui64v != NULL );
+	}
+
+	if( !gpuTimers ) {
+		llog( LOG_INFO, "Timer queries aren't supported, only the CPU side of the render passes will be timed." );
+		return 0;
+	}
+
+	for( int i = 0; i < RING_SIZE; ++i ) {
+		GL( glGenQueries( NUM_RENDER_PASSES, ring[i].queries ) );
+	}
+
+	// the first read of the disjoint flag clears anything from before we started
+	if( checkDisjoint ) {
+		GLint disjoint;
+		GL( glGetIntegerv( GL_GPU_DISJOINT, &disjoint ) );
+	}
+
+	return 0;
+}
+
+/*
+Whether the GPU times are available.
+*/
+bool renderStats_HasGPUTimers( void )
+{
+	return gpuTimers;
+}
+
+static void writeCSVHeader( void )
+{
+	char line[2048];
+	int len = SDL_snprintf( line, sizeof( line ), "frame" );
+	for( int p = 0; p < NUM_RENDER_PASSES; ++p ) {
+		len += SDL_snprintf( line + len, sizeof( line ) - len, ",%s_cpu_ms,%s_gpu_ms,%s_draws,%s_triangles",
+			passNames[p], passNames[p], passNames[p], passNames[p] );
+	}
+	len += SDL_snprintf( line + len, sizeof( line ) - len, ",state_changes,state_changes_skipped,bytes_uploaded" );
+	for( int b = 0; b < NUM_BATCH_BREAKS; ++b ) {
+		len += SDL_snprintf( line + len, sizeof( line ) - len, ",breaks_%s", batchBreakNames[b] );
+	}
+	len += SDL_snprintf( line + len, sizeof( line ) - len, "\n" );
+	SDL_RWwrite( csvFile, line, 1, len );
+}
+
+static void writeCSVLine( const RenderFrameStats* stats )
+{
+	char line[2048];
+	int len = SDL_snprintf( line, sizeof( line ), "%u", stats->frame );
+	for( int p = 0; p < NUM_RENDER_PASSES; ++p ) {
+		len += SDL_snprintf( line + len, sizeof( line ) - len, ",%.4f,%.4f,%i,%i",
+			stats->cpuMS[p], stats->gpuMS[p], stats->drawCalls[p], stats->triangles[p] );
+	}
+	len += SDL_snprintf( line + len, sizeof( line ) - len, ",%i,%i,%u",
+		stats->stateChanges, stats->stateChangesSkipped, (unsigned int)stats->bytesUploaded );
+	for( int b = 0; b < NUM_BATCH_BREAKS; ++b ) {
+		len += SDL_snprintf( line + len, sizeof( line ) - len, ",%i", stats->batchBreaks[b] );
+	}
+	len += SDL_snprintf( line + len, sizeof( line ) - len, "\n" );
+	SDL_RWwrite( csvFile, line, 1, len );
+}
+
+// reads back the slot's timers, anything the GPU isn't done with yet is left untimed instead of waiting on it
+static void finishSlot( FrameSlot* slot )
+{
+	if( gpuTimers ) {
+		bool disjoint = false;
+		if( checkDisjoint ) {
+			GLint disjointVal = 0;
+			GL( glGetIntegerv( GL_GPU_DISJOINT, &disjointVal ) );
+			disjoint = ( disjointVal != 0 );
+		}
+
+		for( int p = 0; p < NUM_RENDER_PASSES; ++p ) {
+			if( !slot->queried[p] ) {
+				continue;
+			}
+
+			GLuint available = GL_FALSE;
+			GL( glGetQueryObjectuiv( slot->queries[p], GL_QUERY_RESULT_AVAILABLE, &available ) );
+			if( available && !disjoint ) {
+				GLuint64 elapsedNS = 0;
+				GL( getQueryObjectui64v( slot->queries[p], GL_QUERY_RESULT, &elapsedNS ) );
+				slot->stats.gpuMS[p] = (float)( (double)elapsedNS / 1000000.0 );
+			}
+		}
+	}
+
+	lastStats = slot->stats;
+	haveLastStats = true;
+	slot->pending = false;
+
+	if( csvFile != NULL ) {
+		writeCSVLine( &lastStats );
+	}
+}
+
+/*
+Called at the start and end of each frame. Starting a frame picks up the results of the oldest frame in the ring if
+ the GPU is done with it.
+*/
+void renderStats_BeginFrame( void )
+{
+	currSlot = &( ring[frameCount % RING_SIZE] );
+	if( currSlot->pending ) {
+		finishSlot( currSlot );
+	}
+
+	memset( &( currSlot->stats ), 0, sizeof( currSlot->stats ) );
+	currSlot->stats.frame = frameCount;
+	for( int p = 0; p < NUM_RENDER_PASSES; ++p ) {
+		currSlot->stats.gpuMS[p] = -1.0f;
+		currSlot->queried[p] = false;
+	}
+	currPass = -1;
+}
+
+void renderStats_EndFrame( void )
+{
+	if( currSlot == NULL ) {
+		return;
+	}
+
+	glState_GetLastStats( &( currSlot->stats.stateChanges ), &( currSlot->stats.stateChangesSkipped ) );
+
+	int vertexBytes;
+	int indexBytes;
+	triRenderer_GetLastUploadStats( &vertexBytes, &indexBytes );
+	currSlot->stats.bytesUploaded += (size_t)vertexBytes + (size_t)indexBytes;
+
+	currSlot->pending = true;
+	currSlot = NULL;
+	++frameCount;
+}
+
+/*
+Called around each pass, the passes can't overlap.
+*/
+void renderStats_BeginPass( RenderPass pass )
+{
+	if( ( currSlot == NULL ) || ( currPass >= 0 ) ) {
+		return;
+	}
+
+	currPass = (int)pass;
+	passStart = SDL_GetPerformanceCounter( );
+	if( gpuTimers ) {
+		GL( glBeginQuery( GL_TIME_ELAPSED, currSlot->queries[pass] ) );
+		currSlot->queried[pass] = true;
+	}
+}
+
+void renderStats_EndPass( RenderPass pass )
+{
+	if( ( currSlot == NULL ) || ( currPass != (int)pass ) ) {
+		return;
+	}
+
+	if( gpuTimers ) {
+		GL( glEndQuery( GL_TIME_ELAPSED ) );
+	}
+	currSlot->stats.cpuMS[pass] += (float)( ( (double)( SDL_GetPerformanceCounter( ) - passStart ) * 1000.0 ) / (double)SDL_GetPerformanceFrequency( ) );
+	currPass = -1;
+}
+
+/*
+Counts work for the current frame, draws go to the pass that's running.
+*/
+void renderStats_CountDraw( int triangles )
+{
+	if( ( currSlot == NULL ) || ( currPass < 0 ) ) {
+		return;
+	}
+
+	++currSlot->stats.drawCalls[currPass];
+	currSlot->stats.triangles[currPass] += triangles;
+}
+
+void renderStats_CountUpload( size_t bytes )
+{
+	if( currSlot == NULL ) {
+		return;
+	}
+
+	currSlot->stats.bytesUploaded += bytes;
+}
+
+void renderStats_CountBatchBreak( BatchBreak reason )
+{
+	if( currSlot == NULL ) {
+		return;
+	}
+
+	++currSlot->stats.batchBreaks[reason];
+}
+
+/*
+Gets the stats for the latest frame that has finished on the GPU. Returns false if there hasn't been one yet.
+*/
+bool renderStats_GetLastFrame( RenderFrameStats* outStats )
+{
+	if( !haveLastStats ) {
+		return false;
+	}
+
+	(*outStats) = lastStats;
+	return true;
+}
+
+const char* renderStats_GetPassName( RenderPass pass )
+{
+	if( ( (int)pass < 0 ) || ( pass >= NUM_RENDER_PASSES ) ) {
+		return "unknown";
+	}
+	return passNames[pass];
+}
+
+const char* renderStats_GetBatchBreakName( BatchBreak reason )
+{
+	if( ( (int)reason < 0 ) || ( reason >= NUM_BATCH_BREAKS ) ) {
+		return "unknown";
+	}
+	return batchBreakNames[reason];
+}
+
+/*
+Writes a line to the CSV file for every frame once its stats are done, until it's stopped.
+ Returns a number < 0 if the file couldn't be opened.
+*/
+int renderStats_StartCSV( const char* fileName )
+{
+	renderStats_StopCSV( );
+
+	csvFile = SDL_RWFromFile( fileName, "w" );
+	if( csvFile == NULL ) {
+		llog( LOG_ERROR, "Unable to open %s for writing render stats: %s", fileName, SDL_GetError( ) );
+		return -1;
+	}
+
+	writeCSVHeader( );
+	return 0;
+}
+
+void renderStats_StopCSV( void )
+{
+	if( csvFile != NULL ) {
+		SDL_RWclose( csvFile );
+		csvFile = NULL;
+	}
+}
@@ -0,0 +1,98 @@
+/*
+Times each rendering pass on the CPU and, where timer queries are supported, on the GPU, and counts what each frame
+ did: draw calls and triangles for each pass, state changes, bytes uploaded, and why the triangle renderer's batches
+ were broken up.
+
+The GPU times aren't known until the GPU gets through the frame, so the queries for each frame are kept in a ring
+ that's three frames deep and only read once they're done, nothing ever waits on them. The stats for a frame are
+ held until its GPU times come in, so the last frame's stats are always a few frames behind but always match up.
+
+Only used from the thread that owns the context.
+*/
+
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+	RP_IMAGES, // submitting the images to the triangle renderer
+	RP_SPINE, // submitting the spine instances to the triangle renderer
+	RP_UPLOAD, // submitting the sprites and tile maps, and sending everything to the GPU
+	RP_TRIANGLES, // drawing everything that goes through the triangle renderer
+	RP_GAME_IMGUI,
+	RP_DEBUG,
+	RP_BLIT, // scaling what was drawn to the window
+	RP_EDITOR_IMGUI,
+	NUM_RENDER_PASSES
+} RenderPass;
+
+typedef enum {
+	BB_TEXTURE,
+	BB_SHADER, // switching between triangles and sprite instances
+	BB_SCISSOR,
+	BB_CAMERA, // what can see the triangles changed
+	BB_ORDER, // a new vertex page or a transparent sprite group had to be drawn in between
+	NUM_BATCH_BREAKS
+} BatchBreak;
+
+typedef struct {
+	unsigned int frame;
+	float cpuMS[NUM_RENDER_PASSES];
+	float gpuMS[NUM_RENDER_PASSES]; // < 0 if it couldn't be timed
+	int drawCalls[NUM_RENDER_PASSES];
+	int triangles[NUM_RENDER_PASSES];
+	int stateChanges;
+	int stateChangesSkipped;
+	size_t bytesUploaded;
+	int batchBreaks[NUM_BATCH_BREAKS];
+} RenderFrameStats;
+
+/*
+Sets up the timer queries if they're supported, needs the context to be current.
+ Returns a number < 0 if there was a problem.
+*/
+int renderStats_Init( void );
+
+/*
+Whether the GPU times are available.
+*/
+bool renderStats_HasGPUTimers( void );
+
+/*
+Called at the start and end of each frame. Starting a frame picks up the results of the oldest frame in the ring if
+ the GPU is done with it.
+*/
+void renderStats_BeginFrame( void );
+void renderStats_EndFrame( void );
+
+/*
+Called around each pass, the passes can't overlap.
+*/
+void renderStats_BeginPass( RenderPass pass );
+void renderStats_EndPass( RenderPass pass );
+
+/*
+Counts work for the current frame, draws go to the pass that's running.
+*/
+void renderStats_CountDraw( int triangles );
+void renderStats_CountUpload( size_t bytes );
+void renderStats_CountBatchBreak( BatchBreak reason );
+
+/*
+Gets the stats for the latest frame that has finished on the GPU. Returns false if there hasn't been one yet.
+*/
+bool renderStats_GetLastFrame( RenderFrameStats* outStats );
+
+const char* renderStats_GetPassName( RenderPass pass );
+const char* renderStats_GetBatchBreakName( BatchBreak reason );
+
+/*
+Writes a line to the CSV file for every frame once its stats are done, until it's stopped.
+ Returns a number < 0 if the file couldn't be opened.
+*/
+int renderStats_StartCSV( const char* fileName );
+void renderStats_StopCSV( void );
+
+#endif // inclusion guard
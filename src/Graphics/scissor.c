@@ -1,5 +1,9 @@
 #include "scissor.h"
 
+#include <assert.h>
+
+#include "graphics.h"
+
 typedef struct {
 	Vector2 upperLeft;
 	Vector2 size;
@@ -10,19 +14,23 @@ typedef struct {
 static int stack[MAX_SCISSOR_STACK_SIZE];
 static int stackTop;
 
+// the areas are referenced by the draw instructions, so each frame packet needs it's own set
 #define MAX_SCISSOR_AREAS 64
-static ScissorArea areas[MAX_SCISSOR_AREAS];
-static int lastAreaIdx;
+static ScissorArea packetAreas[NUM_FRAME_PACKETS][MAX_SCISSOR_AREAS];
+static int lastAreaIdxs[NUM_FRAME_PACKETS];
+static int writePacket = 0;
+static int readPacket = 0;
 
 int scissor_Init( int renderWidth, int renderHeight )
 {
-	areas[0].upperLeft = VEC2_ZERO;
-	areas[0].size.w = (float)renderWidth;
-	areas[0].size.h = (float)renderHeight;
+	for( int i = 0; i < NUM_FRAME_PACKETS; ++i ) {
+		packetAreas[i][0].upperLeft = VEC2_ZERO;
+		packetAreas[i][0].size.w = (float)renderWidth;
+		packetAreas[i][0].size.h = (float)renderHeight;
+		lastAreaIdxs[i] = 0;
+	}
 
 	stack[0] = 0;
-
-	lastAreaIdx = 0;
 	stackTop = 0;
 
 	return 0;
@@ -30,13 +38,32 @@ int scissor_Init( int renderWidth, int renderHeight )
 
 void scissor_Clear( void )
 {
-	lastAreaIdx = 0;
+	lastAreaIdxs[writePacket] = 0;
 	stackTop = 0;
 }
 
+/*
+Sets which frame packet new scissor areas are added to.
+*/
+void scissor_SetWritePacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	writePacket = packet;
+}
+
+/*
+Sets which frame packet the scissor areas are retrieved from when rendering.
+*/
+void scissor_SetReadPacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	readPacket = packet;
+}
+
 int scissor_Push( const Vector2* upperLeft, const Vector2* size )
 {
-	if( lastAreaIdx >= ( MAX_SCISSOR_AREAS - 1 ) ) {
+	int* lastAreaIdx = &( lastAreaIdxs[writePacket] );
+	if( (*lastAreaIdx) >= ( MAX_SCISSOR_AREAS - 1 ) ) {
 		return -1;
 	}
 
@@ -44,12 +71,12 @@ int scissor_Push( const Vector2* upperLeft, const Vector2* size )
 		return -1;
 	}
 
-	++lastAreaIdx;
+	++(*lastAreaIdx);
 	++stackTop;
 
-	areas[lastAreaIdx].upperLeft = (*upperLeft);
-	areas[lastAreaIdx].size = (*size);
-	stack[stackTop] = lastAreaIdx;
+	packetAreas[writePacket][(*lastAreaIdx)].upperLeft = (*upperLeft);
+	packetAreas[writePacket][(*lastAreaIdx)].size = (*size);
+	stack[stackTop] = (*lastAreaIdx);
 
 	return 0;
 }
@@ -72,13 +99,13 @@ int scissor_GetTopID( void )
 int scissor_GetScissorArea( int id, Vector2* outUpperLeft, Vector2* outSize )
 {
 	int ret = 0;
-	if( id > lastAreaIdx ) {
+	if( id > lastAreaIdxs[readPacket] ) {
 		id = 0;
 		ret = -1;
 	}
 
-	(*outUpperLeft) = areas[id].upperLeft;
-	(*outSize) = areas[id].size;
+	(*outUpperLeft) = packetAreas[readPacket][id].upperLeft;
+	(*outSize) = packetAreas[readPacket][id].size;
 
 	return ret;
 }
@@ -92,7 +119,7 @@ int scissor_GetScissorAreaGL( int id, GLint* outX, GLint* outY, GLsizei* outW, G
 	ret = scissor_GetScissorArea( id, &upperLeft, &size );
 
 	(*outX) = (GLint)upperLeft.x;
-	(*outY) = (GLint)( areas[0].size.h - ( upperLeft.y + size.h ) );
+	(*outY) = (GLint)( packetAreas[readPacket][0].size.h - ( upperLeft.y + size.h ) );
 	(*outW) = (GLint)size.x;
 	(*outH) = (GLint)size.y;
 
@@ -13,6 +13,12 @@ Manages the scissor commmands we want to use so we can have different types of r
 int scissor_Init( int renderWidth, int renderHeight );
 
 void scissor_Clear( void );
+
+/*
+Sets which frame packet new scissor areas are added to, and which frame packet they're retrieved from when rendering.
+*/
+void scissor_SetWritePacket( int packet );
+void scissor_SetReadPacket( int packet );
 int scissor_Push( const Vector2* upperLeft, const Vector2* size );
 int scissor_Pop( void );
 
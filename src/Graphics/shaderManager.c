@@ -1,6 +1,8 @@
 #define _CRT_SECURE_NO_DEPRECATE
 #include <string.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <SDL.h>
 #include "../Graphics/glPlatform.h"
 
@@ -11,21 +13,278 @@
 #include "../System/memory.h"
 #include "../System/platformLog.h"
 
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
 // Loaded shader.
 struct Shader
 {
 	GLenum type;
 	GLuint id;
+	const char* source;
+	bool ownsSource;
+	bool needed;
 };
 
 // Maximum length in characters a shader can be.
 //TODO: Switch over to a dynamic string.
 #define MAX_SHADER_SIZE 2048
-static char shaderContents[MAX_SHADER_SIZE + 1];
 
 static struct Shader* shaders;
 static int numShaders;
 
+// program binaries and parallel compiling aren't in the headers on every platform, so they're loaded the first time
+//  anything is loaded
+typedef void ( GL_PROC_API *GetProgramBinaryFunc )( GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary );
+typedef void ( GL_PROC_API *ProgramBinaryFunc )( GLuint program, GLenum binaryFormat, const void* binary, GLsizei length );
+typedef void ( GL_PROC_API *ProgramParameteriFunc )( GLuint program, GLenum pname, GLint value );
+typedef void ( GL_PROC_API *MaxShaderCompilerThreadsFunc )( GLuint count );
+
+static bool driverChecked = false;
+static GetProgramBinaryFunc getProgramBinary = NULL;
+static ProgramBinaryFunc programBinary = NULL;
+static ProgramParameteriFunc programParameteri = NULL;
+
+// where the linked programs are stored, empty if they aren't
+#define MAX_CACHE_PATH_LEN 512
+static char cacheDirectory[MAX_CACHE_PATH_LEN] = { 0 };
+
+// the driver is part of what identifies a cached program, so a new driver never tries to load a binary it can't use
+static uint64_t driverHash = 0;
+
+// stored at the start of each cached program
+#define CACHE_MAGIC 0x43425358 // XSBC
+#define CACHE_VERSION 1
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t length;
+} CacheHeader;
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t hashBytes( uint64_t hash, const void* data, size_t size )
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	for( size_t i = 0; i < size; ++i ) {
+		hash = ( hash ^ bytes[i] ) * FNV_PRIME;
+	}
+	return hash;
+}
+
+static uint64_t hashString( uint64_t hash, const char* str )
+{
+	if( str == NULL ) {
+		return hash;
+	}
+	// include the terminator so strings that run together don't match
+	return hashBytes( hash, str, strlen( str ) + 1 );
+}
+
+static uint64_t hashGLString( uint64_t hash, GLenum name )
+{
+	const GLubyte* str;
+	GLR( str, glGetString( name ) );
+	return hashString( hash, (const char*)str );
+}
+
+// finds out what the driver can do the first time anything is loaded, needs the context to be current
+static void checkDriver( void )
+{
+	if( driverChecked ) {
+		return;
+	}
+	driverChecked = true;
+
+	driverHash = FNV_OFFSET;
+	driverHash = hashGLString( driverHash, GL_VENDOR );
+	driverHash = hashGLString( driverHash, GL_RENDERER );
+	driverHash = hashGLString( driverHash, GL_VERSION );
+	driverHash = hashGLString( driverHash, GL_SHADING_LANGUAGE_VERSION );
+
+	// the driver can return program binaries but have no formats it will take back
+	GLint numFormats = 0;
+	GL( glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats ) );
+	if( numFormats > 0 ) {
+		getProgramBinary = (GetProgramBinaryFunc)SDL_GL_GetProcAddress( "glGetProgramBinary" );
+		programBinary = (ProgramBinaryFunc)SDL_GL_GetProcAddress( "glProgramBinary" );
+		programParameteri = (ProgramParameteriFunc)SDL_GL_GetProcAddress( "glProgramParameteri" );
+	}
+	if( ( getProgramBinary == NULL ) || ( programBinary == NULL ) || ( programParameteri == NULL ) ) {
+		getProgramBinary = NULL;
+		programBinary = NULL;
+		programParameteri = NULL;
+		llog( LOG_INFO, "Program binaries aren't supported, shaders won't be cached." );
+	}
+
+	// lets the driver compile and link on other threads, nothing has to be done differently as long as nothing asks
+	//  how a compile or link went until everything has been started
+	MaxShaderCompilerThreadsFunc maxShaderCompilerThreads = NULL;
+	if( SDL_GL_ExtensionSupported( "GL_KHR_parallel_shader_compile" ) ) {
+		maxShaderCompilerThreads = (MaxShaderCompilerThreadsFunc)SDL_GL_GetProcAddress( "glMaxShaderCompilerThreadsKHR" );
+	} else if( SDL_GL_ExtensionSupported( "GL_ARB_parallel_shader_compile" ) ) {
+		maxShaderCompilerThreads = (MaxShaderCompilerThreadsFunc)SDL_GL_GetProcAddress( "glMaxShaderCompilerThreadsARB" );
+	}
+	if( maxShaderCompilerThreads != NULL ) {
+		// let the driver choose how many
+		maxShaderCompilerThreads( 0xFFFFFFFF );
+		llog( LOG_INFO, "Compiling shaders in parallel." );
+	}
+}
+
+/*
+Sets the directory linked shader programs are cached in, it has to exist already. Pass in NULL to not cache them.
+ Programs are only cached if the driver supports program binaries.
+*/
+void shaders_SetCacheDirectory( const char* path )
+{
+	if( path == NULL ) {
+		cacheDirectory[0] = 0;
+		return;
+	}
+
+	if( strlen( path ) >= ( MAX_CACHE_PATH_LEN - 32 ) ) {
+		llog( LOG_WARN, "Shader cache path is too long, shaders won't be cached." );
+		cacheDirectory[0] = 0;
+		return;
+	}
+
+	strcpy( cacheDirectory, path );
+}
+
+static bool usingCache( void )
+{
+	return ( cacheDirectory[0] != 0 ) && ( programBinary != NULL );
+}
+
+static void getCachePath( uint64_t key, char* outPath, size_t pathSize )
+{
+	SDL_snprintf( outPath, pathSize, "%sprogram_%016llx.bin", cacheDirectory, (unsigned long long)key );
+}
+
+// the key covers the driver and the source and type of every shader in the program
+static uint64_t programKey( const ShaderProgramDefinition* def )
+{
+	int stages[] = { def->vertexShader, def->fragmentShader, def->geometryShader };
+
+	uint64_t key = hashBytes( FNV_OFFSET, &driverHash, sizeof( driverHash ) );
+	for( size_t i = 0; i < ARRAY_SIZE( stages ); ++i ) {
+		if( ( stages[i] < 0 ) || ( stages[i] >= numShaders ) ) {
+			key = hashBytes( key, &( stages[i] ), sizeof( stages[i] ) );
+		} else {
+			key = hashBytes( key, &( shaders[stages[i]].type ), sizeof( shaders[stages[i]].type ) );
+			key = hashString( key, shaders[stages[i]].source );
+		}
+	}
+	return key;
+}
+
+// returns the program id, 0 if it wasn't cached or the driver wouldn't take it
+static GLuint loadCachedProgram( uint64_t key )
+{
+	char path[MAX_CACHE_PATH_LEN];
+	getCachePath( key, path, sizeof( path ) );
+
+	SDL_RWops* file = SDL_RWFromFile( path, "rb" );
+	if( file == NULL ) {
+		return 0;
+	}
+
+	GLuint programID = 0;
+	void* binary = NULL;
+	CacheHeader header;
+	if( ( SDL_RWread( file, &header, sizeof( header ), 1 ) != 1 ) ||
+		( header.magic != CACHE_MAGIC ) || ( header.version != CACHE_VERSION ) || ( header.key != key ) || ( header.length == 0 ) ) {
+		llog( LOG_VERBOSE, "Cached shader program %s isn't usable.", path );
+		goto clean_up;
+	}
+
+	binary = mem_Allocate( header.length );
+	if( binary == NULL ) {
+		llog( LOG_WARN, "Unable to allocate memory for cached shader program %s.", path );
+		goto clean_up;
+	}
+
+	if( SDL_RWread( file, binary, header.length, 1 ) != 1 ) {
+		llog( LOG_VERBOSE, "Cached shader program %s is truncated.", path );
+		goto clean_up;
+	}
+
+	GLR( programID, glCreateProgram( ) );
+	if( programID == 0 ) {
+		goto clean_up;
+	}
+
+	// the driver can refuse a binary even if it made it, then it's just built from the source again
+	GLint linked = GL_FALSE;
+	GL( programBinary( programID, (GLenum)header.format, binary, (GLsizei)header.length ) );
+	GL( glGetProgramiv( programID, GL_LINK_STATUS, &linked ) );
+	if( linked == GL_FALSE ) {
+		llog( LOG_VERBOSE, "Driver wouldn't take cached shader program %s.", path );
+		GL( glDeleteProgram( programID ) );
+		programID = 0;
+	}
+
+clean_up:
+	if( binary != NULL ) {
+		mem_Release( binary );
+	}
+	SDL_RWclose( file );
+	return programID;
+}
+
+static void saveCachedProgram( uint64_t key, GLuint programID )
+{
+	GLint length = 0;
+	GL( glGetProgramiv( programID, GL_PROGRAM_BINARY_LENGTH, &length ) );
+	if( length <= 0 ) {
+		return;
+	}
+
+	void* binary = mem_Allocate( length );
+	if( binary == NULL ) {
+		llog( LOG_WARN, "Unable to allocate memory for caching shader program." );
+		return;
+	}
+
+	CacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+	GLsizei written = 0;
+	GLenum format = 0;
+	GL( getProgramBinary( programID, (GLsizei)length, &written, &format, binary ) );
+	if( written > 0 ) {
+		header.magic = CACHE_MAGIC;
+		header.version = CACHE_VERSION;
+		header.key = key;
+		header.format = (uint32_t)format;
+		header.length = (uint32_t)written;
+
+		char path[MAX_CACHE_PATH_LEN];
+		getCachePath( key, path, sizeof( path ) );
+		SDL_RWops* file = SDL_RWFromFile( path, "wb" );
+		if( file != NULL ) {
+			if( ( SDL_RWwrite( file, &header, sizeof( header ), 1 ) != 1 ) || ( SDL_RWwrite( file, binary, written, 1 ) != 1 ) ) {
+				llog( LOG_WARN, "Unable to write cached shader program %s.", path );
+			}
+			SDL_RWclose( file );
+		} else {
+			llog( LOG_WARN, "Unable to open %s to cache shader program.", path );
+		}
+	}
+
+	mem_Release( binary );
+}
+
 static int isValidShader( int shaderIdx, struct Shader* shaders )
 {
 	// < 0 is the flag for not using that shader, so it doesn't matter
@@ -48,10 +307,10 @@ static int isValidShader( int shaderIdx, struct Shader* shaders )
 	return 1;
 }
 
+// starts compiling the shader, doesn't wait to see how it went so the driver can work on all of them at once
 static GLuint compileShader( const char* text, GLenum type )
 {
 	GLchar *shaderSourceStrs[1];
-	GLint testVal;
 	GLuint shaderID = 0;
 
 	llog( LOG_VERBOSE, "Compiling shader" );
@@ -65,30 +324,6 @@ static GLuint compileShader( const char* text, GLenum type )
 			llog( LOG_VERBOSE, "-- Setting source and compiling" );
 			GL( glShaderSource( shaderID, 1, (const GLchar**)shaderSourceStrs, NULL ) );
 			GL( glCompileShader( shaderID ) );
-
-			// now check for errors
-			GL( glGetShaderiv( shaderID, GL_COMPILE_STATUS, &testVal ) );
-			llog( LOG_VERBOSE, "-- GL_COMPILE_STATUS: %i", testVal );
-
-			GLint logSize = 0;
-			GL( glGetShaderiv( shaderID, GL_INFO_LOG_LENGTH, &logSize ) );
-			if( logSize > 1 ) {
-				GLchar* errorStr = (GLchar*)mem_Allocate( sizeof(GLchar) * logSize );
-				if( errorStr != NULL ) {
-					GL( glGetShaderInfoLog( shaderID, (GLsizei)logSize, NULL, errorStr ) );
-					llog( LOG_ERROR, "Error compiling shader:\n - %s", errorStr );
-					mem_Release( errorStr );
-				} else {
-					llog( LOG_ERROR, "Error allocating memory for error string" );
-				}
-			}
-
-			if( testVal == GL_FALSE ) {
-				llog( LOG_ERROR, "Error compiling shader" );
-
-				GL( glDeleteShader( shaderID ) );
-				shaderID = 0;
-			}
 		} else {
 			llog( LOG_ERROR, "glCreateShader had a problem creating a shader." );
 		}
@@ -99,30 +334,63 @@ static GLuint compileShader( const char* text, GLenum type )
 	return shaderID;
 }
 
-static struct Shader loadShader( const ShaderDefinition* definition )
+// waits for the shader to finish compiling and logs anything that went wrong, returns if it compiled
+static bool checkShaderCompile( GLuint shaderID )
+{
+	GLint testVal;
+
+	GL( glGetShaderiv( shaderID, GL_COMPILE_STATUS, &testVal ) );
+	llog( LOG_VERBOSE, "-- GL_COMPILE_STATUS: %i", testVal );
+
+	GLint logSize = 0;
+	GL( glGetShaderiv( shaderID, GL_INFO_LOG_LENGTH, &logSize ) );
+	if( logSize > 1 ) {
+		GLchar* errorStr = (GLchar*)mem_Allocate( sizeof(GLchar) * logSize );
+		if( errorStr != NULL ) {
+			GL( glGetShaderInfoLog( shaderID, (GLsizei)logSize, NULL, errorStr ) );
+			llog( LOG_ERROR, "Error compiling shader:\n - %s", errorStr );
+			mem_Release( errorStr );
+		} else {
+			llog( LOG_ERROR, "Error allocating memory for error string" );
+		}
+	}
+
+	if( testVal == GL_FALSE ) {
+		llog( LOG_ERROR, "Error compiling shader" );
+		return false;
+	}
+
+	return true;
+}
+
+// gets the text for the shader, it's only copied if it came from a file
+static struct Shader loadShaderSource( const ShaderDefinition* definition )
 {
 	FILE* inFile;
 	size_t amountRead;
-	struct Shader shader = { 0, 0 };
+	struct Shader shader = { 0, 0, NULL, false, false };
 	
 	llog( LOG_VERBOSE, "Loading shader file" );
 	shader.type = definition->type;
 
 	if( ( definition->shaderText != NULL ) && ( strlen( definition->shaderText ) > 0 ) ) {
-		llog( LOG_VERBOSE, "-- Compiling shader from shader text" );
-		shader.id = compileShader( definition->shaderText, shader.type );
-		if( shader.id == 0 ) {
-			llog( LOG_ERROR, "Error opening shader file %s", ( ( definition->fileName == NULL ) ? "<no-file-name>" : definition->fileName ) );
-		}
+		llog( LOG_VERBOSE, "-- Using shader text" );
+		shader.source = definition->shaderText;
 	} else if( ( definition->fileName != NULL ) && ( strlen( definition->fileName ) > 0 ) ) {
-		llog( LOG_VERBOSE, "-- Compiling shader from file" );
+		llog( LOG_VERBOSE, "-- Reading shader from file" );
 		inFile = fopen( definition->fileName, "r" );
 		if( inFile == NULL ) {
 			llog( LOG_ERROR, "Error opening shader file %s", ( ( definition->fileName == NULL ) ? "<no-file-name>" : definition->fileName ) );
 			return shader;
 		}
 
-		memset( shaderContents, 0, sizeof(char) * ( MAX_SHADER_SIZE + 1 ) );
+		char* shaderContents = mem_Allocate( sizeof(char) * ( MAX_SHADER_SIZE + 1 ) );
+		if( shaderContents == NULL ) {
+			llog( LOG_ERROR, "Error allocating memory for shader file %s", definition->fileName );
+			fclose( inFile );
+			return shader;
+		}
+
 		amountRead = fread( shaderContents, sizeof(char), MAX_SHADER_SIZE, inFile );
 		shaderContents[amountRead] = 0; // can't assume that fread won't use some of the buffer for something, so need to set this here
 		llog( LOG_VERBOSE, "-- Read in %u bytes of text", amountRead );
@@ -132,11 +400,13 @@ static struct Shader loadShader( const ShaderDefinition* definition )
 		} else if ( amountRead == MAX_SHADER_SIZE ) {
 			llog( LOG_ERROR, "Shader file %s is too big, increase max size or make shader smaller.", ( ( definition->fileName == NULL ) ? "<no-file-name>" : definition->fileName ) );
 		} else if ( amountRead < MAX_SHADER_SIZE ) {
-			llog( LOG_VERBOSE, "COMPILING SHADER: %s", ( ( definition->fileName == NULL ) ? "<no-file-name>" : definition->fileName ) );
-			shader.id = compileShader( shaderContents, shader.type );
-			if( shader.id == 0 ) {
-				llog( LOG_ERROR, "Error compiling shader file %s", ( ( definition->fileName == NULL ) ? "<no-file-name>" : definition->fileName ) );
-			}
+			llog( LOG_VERBOSE, "LOADED SHADER: %s", ( ( definition->fileName == NULL ) ? "<no-file-name>" : definition->fileName ) );
+			shader.source = shaderContents;
+			shader.ownsSource = true;
+		}
+
+		if( !shader.ownsSource ) {
+			mem_Release( shaderContents );
 		}
 
 		fclose( inFile );
@@ -144,16 +414,16 @@ static struct Shader loadShader( const ShaderDefinition* definition )
 		llog( LOG_ERROR, "Shader definition has no file or text." );
 	}
 
-	llog( LOG_VERBOSE, "-- Done compiling shader" );
+	llog( LOG_VERBOSE, "-- Done loading shader" );
 	return shader;
 }
 
-// Returns the shader program id, as usual for these a value of 0 means it was unsuccessful
+// Returns the shader program id, as usual for these a value of 0 means it was unsuccessful. The link is only started,
+//  checkProgramLink( ) has to be used to see if it worked.
 static GLuint createShaderProgram( const ShaderProgramDefinition* def, int logIdx )
 {
 	int anyMatch;
 	GLuint programID;
-	GLint testVal;
 	llog( LOG_VERBOSE, "Creating shader program %i", logIdx );
 
 	// make sure the shaders to use have been successfully compiled first
@@ -215,22 +485,44 @@ static GLuint createShaderProgram( const ShaderProgramDefinition* def, int logId
 		GL( glAttachShader( programID, shaders[def->geometryShader].id ) );
 	}
 
-	// link the program, and make sure it was successful
+	// link the program, whether it worked is checked after every program has been started
+	if( usingCache( ) ) {
+		GL( programParameteri( programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE ) );
+	}
 	GL( glLinkProgram( programID ) );
+
+	return programID;
+}
+
+// waits for the program to finish linking, if it failed it's deleted and the reason is logged. Returns the program id,
+//  or 0 if it didn't link.
+static GLuint checkProgramLink( const ShaderProgramDefinition* def, GLuint programID, int logIdx )
+{
+	GLint testVal;
 	GL( glGetProgramiv( programID, GL_LINK_STATUS, &testVal ) );
-	llog( LOG_VERBOSE, "-- linking program %s", ( testVal ? "TRUE" : "FALSE" ) );
-	if( testVal == GL_FALSE ) {
-		llog( LOG_WARN, "Shader program at index %i failed to link.", logIdx );
-		GL( glDeleteProgram( programID ) );
-		return 0;
+	llog( LOG_VERBOSE, "-- linking program %i %s", logIdx, ( testVal ? "TRUE" : "FALSE" ) );
+	if( testVal != GL_FALSE ) {
+		return programID;
 	}
 
-	return programID;
+	// a shader not compiling is the most likely reason
+	int stages[] = { def->vertexShader, def->fragmentShader, def->geometryShader };
+	for( size_t i = 0; i < ARRAY_SIZE( stages ); ++i ) {
+		if( stages[i] >= 0 ) {
+			checkShaderCompile( shaders[stages[i]].id );
+		}
+	}
+
+	llog( LOG_WARN, "Shader program at index %i failed to link.", logIdx );
+	GL( glDeleteProgram( programID ) );
+	return 0;
 }
 
 /* You create an array of ShaderDefinitions and ShaderProgramDefinitions that determine what is loaded.
 You also create an empty array of GLuints to use as the final indices for the generated shader programs.
-Returns the number of shader programs successfully created. */
+Returns the number of shader programs successfully created.
+Programs are loaded from the cache if they're there. Everything else is compiled and linked without waiting on any of
+ it, then checked, so drivers that can compile in parallel can do them all at once. */
 size_t shaders_Load( const ShaderDefinition* shaderDefs, size_t numShaderDefs,
 				const ShaderProgramDefinition* shaderProgDefs,
 				ShaderProgram* shaderPrograms, size_t numShaderPrograms )
@@ -239,8 +531,10 @@ size_t shaders_Load( const ShaderDefinition* shaderDefs, size_t numShaderDefs,
 	size_t numSuccessful = 0;
 	size_t i;
 
+	checkDriver( );
+
 	// zero out, this also sets all the programs to invalid
-	memset( shaderPrograms, 0, sizeof(GLuint) * numShaderPrograms );
+	memset( shaderPrograms, 0, sizeof( ShaderProgram ) * numShaderPrograms );
 
 	numShaders = numShaderDefs;
 	shaders = (struct Shader*)mem_Allocate( sizeof(struct Shader) * numShaders );
@@ -249,14 +543,69 @@ size_t shaders_Load( const ShaderDefinition* shaderDefs, size_t numShaderDefs,
 		return 0;
 	}
 
-	// first load all the individual shaders
+	uint64_t* keys = (uint64_t*)mem_Allocate( sizeof(uint64_t) * numShaderPrograms );
+	if( keys == NULL ) {
+		llog( LOG_ERROR, "Problem allocating memory for shader program keys." );
+		mem_Release( shaders );
+		return 0;
+	}
+
+	// first get the text for all the individual shaders
+	for( i = 0; i < numShaderDefs; ++i ) {
+		shaders[i] = loadShaderSource( shaderDefs + i );
+	}
+
+	// anything that's cached doesn't need its shaders compiled
+	for( i = 0; i < numShaderPrograms; ++i ) {
+		keys[i] = programKey( shaderProgDefs + i );
+		if( usingCache( ) ) {
+			shaderPrograms[i].programID = loadCachedProgram( keys[i] );
+		}
+
+		if( shaderPrograms[i].programID != 0 ) {
+			llog( LOG_VERBOSE, "Loaded shader program %i from the cache", i );
+		} else {
+			int stages[] = { shaderProgDefs[i].vertexShader, shaderProgDefs[i].fragmentShader, shaderProgDefs[i].geometryShader };
+			for( size_t st = 0; st < ARRAY_SIZE( stages ); ++st ) {
+				if( ( stages[st] >= 0 ) && ( stages[st] < numShaders ) ) {
+					shaders[stages[st]].needed = true;
+				}
+			}
+		}
+	}
+
+	// start compiling everything that's needed, then start linking the programs
 	for( i = 0; i < numShaderDefs; ++i ) {
-		shaders[i] = loadShader( shaderDefs + i );
+		if( shaders[i].needed ) {
+			shaders[i].id = compileShader( shaders[i].source, shaders[i].type );
+		}
+	}
+
+	bool* linking = (bool*)mem_Allocate( sizeof(bool) * numShaderPrograms );
+	if( linking == NULL ) {
+		llog( LOG_ERROR, "Problem allocating memory for linking shader programs." );
+	} else {
+		for( i = 0; i < numShaderPrograms; ++i ) {
+			linking[i] = ( shaderPrograms[i].programID == 0 );
+			if( linking[i] ) {
+				shaderPrograms[i].programID = createShaderProgram( shaderProgDefs+i, i );
+			}
+		}
+
+		// now wait on them
+		for( i = 0; i < numShaderPrograms; ++i ) {
+			if( linking[i] && ( shaderPrograms[i].programID != 0 ) ) {
+				shaderPrograms[i].programID = checkProgramLink( shaderProgDefs+i, shaderPrograms[i].programID, i );
+				if( ( shaderPrograms[i].programID != 0 ) && usingCache( ) ) {
+					saveCachedProgram( keys[i], shaderPrograms[i].programID );
+				}
+			}
+		}
+
+		mem_Release( linking );
 	}
 
-	// then set up the shader
 	for( i = 0; i < numShaderPrograms; ++i ) {
-		shaderPrograms[i].programID = createShaderProgram( shaderProgDefs+i, i );
 		if( shaderPrograms[i].programID != 0 ) {
 			++numSuccessful;
 			llog( LOG_VERBOSE, "Successfully created shader program %i: %u", i, shaderPrograms[i].programID );
@@ -293,11 +642,15 @@ size_t shaders_Load( const ShaderDefinition* shaderDefs, size_t numShaderDefs,
 	// don't need the shaders any more
 	llog( LOG_VERBOSE, "Deleting shaders" );
 	for( i = 0; i < numShaderDefs; ++i ) {
-		if( isValidShader( i, shaders ) ) {
+		if( ( shaders[i].id != 0 ) && isValidShader( i, shaders ) ) {
 			GL( glDeleteShader( shaders[i].id ) );
 		}
+		if( shaders[i].ownsSource ) {
+			mem_Release( (char*)shaders[i].source );
+		}
 	}
 	llog( LOG_VERBOSE, "Freeing shaders" );
+	mem_Release( keys );
 	mem_Release( shaders );
 
 	return numSuccessful;
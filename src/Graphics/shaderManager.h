@@ -43,9 +43,17 @@ typedef struct {
 	GLint uniformLocs[8];
 } ShaderProgram;
 
+/*
+Sets the directory linked shader programs are cached in, it has to exist already. Pass in NULL to not cache them.
+ Programs are only cached if the driver supports program binaries.
+*/
+void shaders_SetCacheDirectory( const char* path );
+
 /* You create an array of ShaderDefinitions and ShaderProgramDefinitions that determine what is loaded.
 You also create an empty array of GLuints to use as the final indices for the generated shader programs.
-Returns the number of shader programs successfully created. */
+Returns the number of shader programs successfully created.
+Programs are loaded from the cache if they're there. Everything else is compiled and linked without waiting on any of
+ it, then checked, so drivers that can compile in parallel can do them all at once. */
 size_t shaders_Load( const ShaderDefinition* shaderDefs, size_t numShaderDefs,
 			const ShaderProgramDefinition* shaderProgDefs, ShaderProgram* shaderPrograms, size_t numShaderPrograms );
 
@@ -1,12 +1,16 @@
 #include "spineGfx.h"
 
 #include <assert.h>
+#include <string.h>
 #include <spine/extension.h>
 
+#include "graphics.h"
 #include "triRendering.h"
 #include "debugRendering.h"
 #include "gfxUtil.h"
+#include "camera.h"
 #include "../Utils/helpers.h"
+#include "../Utils/stretchyBuffer.h"
 #include "../System/memory.h"
 #include "../System/platformLog.h"
 
@@ -29,12 +33,50 @@ typedef struct {
 	spSkeleton* skeleton;
 	spAnimationState* state;
 	int8_t depth;
+
+	// the world positions of every vertex drawn for the current and previous poses, the triangles are interpolated
+	//  between them when they're drawn
+	Vector2* sbPrevVerts;
+	Vector2* sbCurrVerts;
 } SpineInstance;
 
 #define MAX_INSTANCES 2048
 static SpineInstance instances[MAX_INSTANCES];
 static int lastInstance = -1;
 
+// what's needed to draw the instances, copied out of them when they're snapshotted so the rendering never has to touch
+//  the skeletons while the game is changing them
+typedef struct {
+	TriMeshState meshState;
+	int firstVert;
+	int vertCount;
+	// these belong to the attachments in the templates, which don't change once they're loaded
+	const Vector2* uvs;
+	const uint16_t* indices;
+	int indexCount;
+} SpineMesh;
+
+typedef struct {
+	uint32_t cameraFlags;
+	Vector2 startMin;
+	Vector2 startMax;
+	Vector2 endMin;
+	Vector2 endMax;
+	int firstMesh;
+	int meshCount;
+} SpineDraw;
+
+typedef struct {
+	SpineDraw* sbDraws;
+	SpineMesh* sbMeshes;
+	Vector2* sbStartVerts;
+	Vector2* sbEndVerts;
+} SpinePacket;
+
+static SpinePacket packets[NUM_FRAME_PACKETS];
+static int writePacket = 0;
+static int readPacket = 0;
+
 // working memory
 #define MAX_SPINE_VERTS 1000
 static float spineVertices[MAX_SPINE_VERTS];
@@ -324,6 +366,8 @@ void spine_CleanInstance( int idx )
 
 	spAnimationState_dispose( charState->state );
 	spSkeleton_dispose( charState->skeleton );
+	sb_Release( charState->sbPrevVerts );
+	sb_Release( charState->sbCurrVerts );
 
 	charState->state = NULL;
 	charState->skeleton = NULL;
@@ -417,14 +461,11 @@ void spine_UpdateInstances( float dt )
 	}
 }
 
-static void drawCharacter( SpineInstance* spine )
+// gathers the world positions of all the vertices we'll draw, in the same order snapshotCharacter uses them
+static void computeCharacterVertices( SpineInstance* spine )
 {
-	// just draw bone positions to start with
-	//GLuint texture;
-	Color col;
-	int camFlags = spine->cameraFlags;
-	char depth = spine->depth;
-	Texture* texture;
+	SWAP( spine->sbPrevVerts, spine->sbCurrVerts, Vector2* );
+	sb_Clear( spine->sbCurrVerts );
 
 	for( int i = 0; i < spine->skeleton->slotsCount; ++i ) {
 		spSlot* slot = spine->skeleton->drawOrder[i];
@@ -433,32 +474,125 @@ static void drawCharacter( SpineInstance* spine )
 			continue;
 		}
 
-		col.r = spine->skeleton->r * slot->r;
-		col.g = spine->skeleton->g * slot->g;
-		col.b = spine->skeleton->b * slot->b;
-		col.a = spine->skeleton->a * slot->a;
-
 		switch( attachment->type ) {
 		case SP_ATTACHMENT_REGION: {
 				float vertices[8];
 				spRegionAttachment* regionAttachment = (spRegionAttachment*)attachment;
 				spRegionAttachment_computeWorldVertices( regionAttachment, slot->bone, vertices );
 
-				Vector2 positions[4];
-				Vector2 uvs[4];
-
+				Vector2* positions = sb_Add( spine->sbCurrVerts, 4 );
 				for( int i = 0; i < 4; ++i ) {
 					positions[i].x = vertices[2*i];
 					positions[i].y = vertices[(2*i)+1];
+				}
+			} break;
+		case SP_ATTACHMENT_MESH: {
+				spMeshAttachment* meshAttachment = (spMeshAttachment*)attachment;
+				assert( meshAttachment->super.worldVerticesLength < MAX_SPINE_VERTS );
 
-					uvs[i].s = regionAttachment->uvs[2*i];
-					uvs[i].t = regionAttachment->uvs[(2*i)+1];
+				// todo: come up with a better way than just a preallocated array, possible probems when world vertices > sizeof( spineVertices )
+				spMeshAttachment_computeWorldVertices( meshAttachment, slot, spineVertices );
+
+				int numVerts = meshAttachment->super.worldVerticesLength / 2;
+				Vector2* positions = sb_Add( spine->sbCurrVerts, numVerts );
+				for( int i = 0; i < numVerts; ++i ) {
+					positions[i].x = spineVertices[2*i];
+					positions[i].y = spineVertices[(2*i)+1];
 				}
+			} break;
+		default:
+			break;
+		}
+	}
+}
+
+static void findVertexBounds( const Vector2* verts, int count, Vector2* outMin, Vector2* outMax )
+{
+	(*outMin) = verts[0];
+	(*outMax) = verts[0];
+	for( int i = 1; i < count; ++i ) {
+		outMin->x = MIN( outMin->x, verts[i].x );
+		outMin->y = MIN( outMin->y, verts[i].y );
+		outMax->x = MAX( outMax->x, verts[i].x );
+		outMax->y = MAX( outMax->y, verts[i].y );
+	}
+}
+
+static void addMesh( SpinePacket* packet, SpineDraw* draw, const TriMeshState* meshState, int firstVert, int vertCount,
+	const float* uvs, const uint16_t* indices, int indexCount )
+{
+	SpineMesh* mesh = sb_Add( packet->sbMeshes, 1 );
+	mesh->meshState = (*meshState);
+	mesh->firstVert = firstVert;
+	mesh->vertCount = vertCount;
+	// spine stores the uvs as pairs of floats so they can be used as they are
+	mesh->uvs = (const Vector2*)uvs;
+	mesh->indices = indices;
+	mesh->indexCount = indexCount;
+	++draw->meshCount;
+}
+
+// copies everything needed to draw the instance into the packet, the vertices are copied as they are and each
+//  attachment becomes a mesh that uses a range of them
+static void snapshotCharacter( SpineInstance* spine, SpinePacket* packet )
+{
+	int count = (int)sb_Count( spine->sbCurrVerts );
+	if( count <= 0 ) {
+		return;
+	}
+
+	// if the attachments changed since the last pose the vertices won't line up, so just show the new pose
+	Vector2* endVerts = spine->sbCurrVerts;
+	Vector2* startVerts = ( sb_Count( spine->sbPrevVerts ) == sb_Count( spine->sbCurrVerts ) ) ? spine->sbPrevVerts : spine->sbCurrVerts;
+
+	int packetBaseVert = (int)sb_Count( packet->sbStartVerts );
+	memcpy( sb_Add( packet->sbStartVerts, count ), startVerts, sizeof( Vector2 ) * count );
+	memcpy( sb_Add( packet->sbEndVerts, count ), endVerts, sizeof( Vector2 ) * count );
+
+	SpineDraw* draw = sb_Add( packet->sbDraws, 1 );
+	draw->cameraFlags = spine->cameraFlags;
+	findVertexBounds( startVerts, count, &( draw->startMin ), &( draw->startMax ) );
+	findVertexBounds( endVerts, count, &( draw->endMin ), &( draw->endMax ) );
+	draw->firstMesh = (int)sb_Count( packet->sbMeshes );
+	draw->meshCount = 0;
+
+	//GLuint texture;
+	Texture* texture;
+
+	// everything but the texture and color is the same for every attachment
+	TriMeshState meshState;
+	meshState.shader = ST_DEFAULT;
+	meshState.clippingID = 0;
+	meshState.camFlags = spine->cameraFlags;
+	meshState.depth = spine->depth;
+
+	int baseVert = packetBaseVert;
+
+	for( int i = 0; i < spine->skeleton->slotsCount; ++i ) {
+		spSlot* slot = spine->skeleton->drawOrder[i];
+		spAttachment* attachment = slot->attachment;
+		if( attachment == NULL ) {
+			continue;
+		}
+
+		meshState.color.r = spine->skeleton->r * slot->r;
+		meshState.color.g = spine->skeleton->g * slot->g;
+		meshState.color.b = spine->skeleton->b * slot->b;
+		meshState.color.a = spine->skeleton->a * slot->a;
+
+		switch( attachment->type ) {
+		case SP_ATTACHMENT_REGION: {
+				spRegionAttachment* regionAttachment = (spRegionAttachment*)attachment;
+				static const uint16_t quadIndices[] = { 0, 1, 2, 0, 2, 3 };
 
 				texture = (Texture*)((spAtlasRegion*)regionAttachment->rendererObject)->page->rendererObject;
+				meshState.texture = texture->textureID;
+				meshState.textureLayer = texture->layer;
+				meshState.transparent = texture->flags & TF_IS_TRANSPARENT;
 
-				triRenderer_Add( positions[0], positions[1], positions[2], uvs[0], uvs[1], uvs[2], ST_DEFAULT, texture->textureID, col, 0, camFlags, depth, texture->flags & TF_IS_TRANSPARENT );
-				triRenderer_Add( positions[0], positions[2], positions[3], uvs[0], uvs[2], uvs[3], ST_DEFAULT, texture->textureID, col, 0, camFlags, depth, texture->flags & TF_IS_TRANSPARENT );
+				addMesh( packet, draw, &meshState, baseVert, 4, regionAttachment->uvs, quadIndices, 6 );
+
+				baseVert += 4;
 			} break;
 		/*case SP_ATTACHMENT_BOUNDING_BOX: {
 				// if we're debugging 
@@ -467,7 +601,7 @@ static void drawCharacter( SpineInstance* spine )
 
 				spBoundingBoxAttachment_computeWorldVertices( boundingBoxAttachment, slot->bone, spineVertices );
 
-				for( int i = 0; i <	boundingBoxAttachment->verticesCount; ++i ) {
+				for( int i = 0; i < boundingBoxAttachment->verticesCount; ++i ) {
 					Vector2 pos0, pos1;
 					int j = ( i + 1 ) % boundingBoxAttachment->verticesCount;
 					pos0.x = spineVertices[i*2];
@@ -480,29 +614,17 @@ static void drawCharacter( SpineInstance* spine )
 			} break;*/
 		case SP_ATTACHMENT_MESH: {
 				spMeshAttachment* meshAttachment = (spMeshAttachment*)attachment;
-				assert( meshAttachment->super.worldVerticesLength < MAX_SPINE_VERTS );
-
-				// todo: come up with a better way than just a preallocated array, possible probems when world vertices > sizeof( spineVertices )
-				spMeshAttachment_computeWorldVertices( meshAttachment, slot, spineVertices );
+				int vertCount = meshAttachment->super.worldVerticesLength / 2;
 
 				texture = (Texture*)((spAtlasRegion*)meshAttachment->rendererObject)->page->rendererObject;
+				meshState.texture = texture->textureID;
+				meshState.textureLayer = texture->layer;
+				meshState.transparent = texture->flags & TF_IS_TRANSPARENT;
 
-				for( int i = 0; i < meshAttachment->trianglesCount; i+=3 ) {
-					Vector2 verts[3];
-					Vector2 uvs[3];
-					
-					for( int j = 0; j < 3; ++j ) {
-						int baseIndex = meshAttachment->triangles[i+j] * 2;
-						verts[j].x = spineVertices[baseIndex];
-						verts[j].y = spineVertices[baseIndex+1];
-
-						uvs[j].x = meshAttachment->uvs[baseIndex];
-						uvs[j].y = meshAttachment->uvs[baseIndex+1];
-					}
-
-					//debugRenderer_Triangle( camFlags, verts[0], verts[1], verts[2], CLR_GREEN );
-					triRenderer_AddVertices( verts, uvs, ST_DEFAULT, texture->textureID, col, 0, camFlags, depth, texture->flags & TF_IS_TRANSPARENT );
-				}
+				addMesh( packet, draw, &meshState, baseVert, vertCount, meshAttachment->uvs, meshAttachment->triangles,
+					meshAttachment->trianglesCount );
+
+				baseVert += vertCount;
 			} break;
 		default:
 			llog( LOG_DEBUG, "Unknown attachment type.\n" );
@@ -512,20 +634,70 @@ static void drawCharacter( SpineInstance* spine )
 }
 
 /*
-Draws all the spine instances.
+Updates the instance animations by dt and copies what's needed to draw them into the frame packet being written to.
+ The triangles are interpolated from the pose the last time this was called to the current pose, so this should be
+ called once after everything has been drawn.
 */
-void spine_RenderInstances( float normTimeElapsed )
+void spine_SnapshotInstances( float dt )
 {
+	SpinePacket* packet = &( packets[writePacket] );
+	sb_Clear( packet->sbDraws );
+	sb_Clear( packet->sbMeshes );
+	sb_Clear( packet->sbStartVerts );
+	sb_Clear( packet->sbEndVerts );
+
+	spine_UpdateInstances( dt );
+	spine_FlipInstancePositions( );
+
 	for( int i = 0; i <= lastInstance; ++i ) {
 		if( instances[i].skeleton == NULL ) {
 			continue;
 		}
 
-		Vector2 pos;
-		vec2_Lerp( &( instances[i].startPos ), &( instances[i].endPos ), normTimeElapsed, &pos );
-		instances[i].skeleton->x = pos.x;
-		instances[i].skeleton->y = pos.y;
+		instances[i].skeleton->x = instances[i].endPos.x;
+		instances[i].skeleton->y = instances[i].endPos.y;
+		spSkeleton_updateWorldTransform( instances[i].skeleton );
+
+		computeCharacterVertices( &( instances[i] ) );
+		snapshotCharacter( &( instances[i] ), packet );
+	}
+}
+
+/*
+Sets which frame packet the instances are copied into when they're snapshotted.
+*/
+void spine_SetWritePacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	writePacket = packet;
+}
+
+/*
+Sets which frame packet the instances are rendered from.
+*/
+void spine_SetReadPacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	readPacket = packet;
+}
+
+/*
+Sends the spine instances in the frame packet being rendered to the triangle renderer, any the cameras can't see
+ are left out.
+*/
+void spine_RenderInstances( void )
+{
+	SpinePacket* packet = &( packets[readPacket] );
+	for( size_t i = 0; i < sb_Count( packet->sbDraws ); ++i ) {
+		SpineDraw* draw = &( packet->sbDraws[i] );
+		if( !cam_IsRenderAreaVisible( draw->cameraFlags, draw->startMin, draw->startMax, draw->endMin, draw->endMax ) ) {
+			continue;
+		}
 
-		drawCharacter( &( instances[i] ) );
+		for( int m = draw->firstMesh; m < ( draw->firstMesh + draw->meshCount ); ++m ) {
+			SpineMesh* mesh = &( packet->sbMeshes[m] );
+			triRenderer_AddMesh( &( packet->sbStartVerts[mesh->firstVert] ), &( packet->sbEndVerts[mesh->firstVert] ), mesh->uvs, NULL,
+				mesh->vertCount, mesh->indices, mesh->indexCount, &( mesh->meshState ) );
+		}
 	}
-}
\ No newline at end of file
+}
@@ -74,7 +74,7 @@ spSkeletonData* spine_GetTemplateSkeletonData( int id );
 
 /*
 Returns the skeleton of the spine instance, if there's an issue returns NULL.
- Note: Adjustments to the skeletons x and y are overwritten in spine_RenderInstances( ).
+ Note: Adjustments to the skeletons x and y are overwritten in spine_SnapshotInstances( ).
 */
 spSkeleton* spine_GetInstanceSkeleton( int id );
 
@@ -89,8 +89,26 @@ Updates all the instance animations.
 void spine_UpdateInstances( float dt );
 
 /*
-Draws all the spine instances.
+Updates the instance animations by dt and copies what's needed to draw them into the frame packet being written to.
+ The triangles are interpolated from the pose the last time this was called to the current pose, so this should be
+ called once after everything has been drawn.
 */
-void spine_RenderInstances( float normTimeElapsed );
+void spine_SnapshotInstances( float dt );
+
+/*
+Sets which frame packet the instances are copied into when they're snapshotted.
+*/
+void spine_SetWritePacket( int packet );
+
+/*
+Sets which frame packet the instances are rendered from.
+*/
+void spine_SetReadPacket( int packet );
+
+/*
+Sends the spine instances in the frame packet being rendered to the triangle renderer, any the cameras can't see
+ are left out.
+*/
+void spine_RenderInstances( void );
 
 #endif
\ No newline at end of file
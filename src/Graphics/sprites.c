@@ -1,97 +1,472 @@
 #include "sprites.h"
 
 #include <assert.h>
+#include <string.h>
+#include <SDL_mutex.h>
 
 #include "images.h"
 #include "color.h"
+#include "triRendering.h"
 #include "../System/systems.h"
 #include "../System/platformLog.h"
-
-// Possibly improve this by putting all the storage into a separate thing, so we can have multiple sets of sprites we could draw
-//  at different times without having to create and destroy them constantly, if we start needing something like that
+#include "../Utils/stretchyBuffer.h"
+#include "../Utils/helpers.h"
 
 typedef struct {
 	Vector2 pos;
 	float rot;
 	Color col;
 	Vector2 scale;
-} SpriteState;
+} SpriteValues;
 
 typedef struct {
 	int image;
+	int slot;
+
+	SpriteValues oldState;
+	SpriteValues newState;
 
-	SpriteState oldState;
-	SpriteState newState;
+	// set while the sprite is waiting in the list of changed sprites
+	bool changed;
+} Sprite;
 
+// the sprites are grouped by everything that's shared by a draw call, each group is dense so it can be copied straight
+//  into a group in the triangle renderer, the index of a sprite in its group is also its slot in the renderer's group
+typedef struct {
+	GLuint texture;
+	bool textureArray;
 	uint32_t camFlags;
 	int8_t depth;
-} Sprite;
+	bool transparent;
+
+	Sprite* sbSprites;
+	bool countChanged;
+} SpriteGroup;
+
+// the handles point to a slot that knows where the sprite is, the slot is updated whenever the sprite moves, free slots
+//  use the index to point to the next free slot
+typedef struct {
+	int generation;
+	int group;
+	int index;
+} SpriteSlot;
+
+#define SLOT_BITS 20
+#define SLOT_MASK ( ( 1 << SLOT_BITS ) - 1 )
+#define MAX_GENERATION ( ( 1 << ( 31 - SLOT_BITS ) ) - 1 )
+
+#define HANDLE_SLOT( handle ) ( ( handle ) & SLOT_MASK )
+#define HANDLE_GENERATION( handle ) ( ( handle ) >> SLOT_BITS )
+#define CREATE_HANDLE( slot, generation ) ( ( ( generation ) << SLOT_BITS ) | ( slot ) )
+
+static SpriteGroup* sbGroups = NULL;
+static SpriteSlot* sbSlots = NULL;
+static int firstFreeSlot = -1;
+static int numSprites = 0;
+
+// the handles of the sprites that have to be handed over at the next draw, and the ones that were moving at the last
+//  draw so they have to be sent again to come to rest
+static int* sbChangedSprites = NULL;
+static int* sbSettlingSprites = NULL;
+static int lastChangedCount = 0;
+
+// everything the render thread needs to bring the triangle renderer's groups up to date, written when the sprites are
+//  drawn and swapped out when they're rendered so the lock is only held long enough to copy the changes
+typedef struct {
+	int group;
+	GLuint texture;
+	bool textureArray;
+	uint32_t camFlags;
+	int8_t depth;
+	bool transparent;
+	int count;
+} GroupChange;
+
+typedef struct {
+	int group;
+	int index;
+	int image;
+	SpriteValues start;
+	SpriteValues end;
+} SpriteChange;
 
-#define NUM_SPRITES 1000
-static Sprite sprites[NUM_SPRITES];
+static SDL_mutex* pendingMutex = NULL;
+static GroupChange* sbPendingGroups = NULL;
+static SpriteChange* sbPendingSprites = NULL;
+
+// only used by the render thread, the triangle renderer's group for each of our groups
+static GroupChange* sbRenderGroupChanges = NULL;
+static SpriteChange* sbRenderSpriteChanges = NULL;
+static int* sbRendererGroups = NULL;
 
 static int systemID = -1;
 
-#define SPRITE_ID_VALID( id ) ( ( ( id ) >= 0 ) && ( ( id ) < NUM_SPRITES ) )
+static Sprite* getSprite( int sprite )
+{
+	if( sprite < 0 ) {
+		return NULL;
+	}
+
+	int slot = HANDLE_SLOT( sprite );
+	if( ( slot >= (int)sb_Count( sbSlots ) ) || ( sbSlots[slot].group < 0 ) ||
+		( sbSlots[slot].generation != HANDLE_GENERATION( sprite ) ) ) {
+		return NULL;
+	}
+
+	return &( sbGroups[sbSlots[slot].group].sbSprites[sbSlots[slot].index] );
+}
+
+static void markChanged( Sprite* sprite )
+{
+	if( sprite->changed ) {
+		return;
+	}
+
+	sprite->changed = true;
+	sb_Push( sbChangedSprites, CREATE_HANDLE( sprite->slot, sbSlots[sprite->slot].generation ) );
+}
+
+static bool isPartiallyTransparent( const Color* col )
+{
+	return ( ( col->a > 0.0f ) && ( col->a < 1.0f ) );
+}
+
+// same as when an image is drawn, anything with a color that's partially see through has to be blended
+static bool needsBlending( const Sprite* sprite )
+{
+	bool imageTransparent = false;
+	img_GetSpriteData( sprite->image, NULL, NULL, NULL, NULL, NULL, NULL, &imageTransparent );
+	return ( imageTransparent || isPartiallyTransparent( &( sprite->oldState.col ) ) || isPartiallyTransparent( &( sprite->newState.col ) ) );
+}
+
+static int findGroup( GLuint texture, bool textureArray, uint32_t camFlags, int8_t depth, bool transparent )
+{
+	for( int i = 0; i < (int)sb_Count( sbGroups ); ++i ) {
+		SpriteGroup* group = &( sbGroups[i] );
+		if( ( group->texture == texture ) && ( group->textureArray == textureArray ) && ( group->camFlags == camFlags ) &&
+			( group->depth == depth ) && ( group->transparent == transparent ) ) {
+			return i;
+		}
+	}
+
+	SpriteGroup* newGroup = sb_Add( sbGroups, 1 );
+	newGroup->texture = texture;
+	newGroup->textureArray = textureArray;
+	newGroup->camFlags = camFlags;
+	newGroup->depth = depth;
+	newGroup->transparent = transparent;
+	newGroup->sbSprites = NULL;
+	newGroup->countChanged = true;
+
+	return (int)( sb_Count( sbGroups ) - 1 );
+}
+
+static void addToGroup( int slot, int groupIdx, const Sprite* sprite )
+{
+	SpriteGroup* group = &( sbGroups[groupIdx] );
+	sbSlots[slot].group = groupIdx;
+	sbSlots[slot].index = (int)sb_Count( group->sbSprites );
+	sb_Push( group->sbSprites, *sprite );
+	group->countChanged = true;
+
+	markChanged( &sb_Last( group->sbSprites ) );
+}
+
+// the last sprite in the group is moved into the removed sprite's place so the group stays dense
+static void removeFromGroup( int slot )
+{
+	SpriteGroup* group = &( sbGroups[sbSlots[slot].group] );
+	int index = sbSlots[slot].index;
+	int last = (int)sb_Count( group->sbSprites ) - 1;
+
+	if( index != last ) {
+		group->sbSprites[index] = group->sbSprites[last];
+		sbSlots[group->sbSprites[index].slot].index = index;
+
+		// the renderer's group has to have it in its new place as well
+		markChanged( &( group->sbSprites[index] ) );
+	}
+
+	sb_Pop( group->sbSprites );
+	group->countChanged = true;
+}
+
+// the sprite may have to go to a different group if its color changed whether it needs blending
+static Sprite* updateGroup( int slot )
+{
+	SpriteGroup* group = &( sbGroups[sbSlots[slot].group] );
+	Sprite* sprite = &( group->sbSprites[sbSlots[slot].index] );
+
+	bool transparent = needsBlending( sprite );
+	if( transparent == group->transparent ) {
+		return sprite;
+	}
+
+	Sprite moved = *sprite;
+	int newGroup = findGroup( group->texture, group->textureArray, group->camFlags, group->depth, transparent );
+	removeFromGroup( slot );
+	addToGroup( slot, newGroup, &moved );
 
-void spr_Init( void )
+	return &( sbGroups[newGroup].sbSprites[sbSlots[slot].index] );
+}
+
+/*
+Sets up the sprites, destroying any that already exist.
+ Returns a number < 0 if there was a problem.
+*/
+int spr_Init( void )
 {
-	for( int i = 0; i < NUM_SPRITES; ++i ) {
-		sprites[i].image = -1;
+	if( pendingMutex == NULL ) {
+		pendingMutex = SDL_CreateMutex( );
+		if( pendingMutex == NULL ) {
+			llog( LOG_ERROR, "Unable to create sprite mutex: %s", SDL_GetError( ) );
+			return -1;
+		}
 	}
+
+	// destroy them instead of just clearing everything so the groups in the triangle renderer are emptied as well
+	for( int i = 0; i < (int)sb_Count( sbSlots ); ++i ) {
+		if( sbSlots[i].group >= 0 ) {
+			spr_Destroy( CREATE_HANDLE( i, sbSlots[i].generation ) );
+		}
+	}
+
+	return 0;
 }
 
+static bool valuesDiffer( const SpriteValues* left, const SpriteValues* right )
+{
+	return ( ( left->pos.x != right->pos.x ) || ( left->pos.y != right->pos.y ) || ( left->rot != right->rot ) ||
+		( left->scale.x != right->scale.x ) || ( left->scale.y != right->scale.y ) ||
+		( left->col.r != right->col.r ) || ( left->col.g != right->col.g ) || ( left->col.b != right->col.b ) ||
+		( left->col.a != right->col.a ) );
+}
+
+/*
+Hands all the changes made to the sprites since the last call over to the rendering. Sprites that moved are sent
+ again on the next call so they come to rest at their new state.
+*/
 void spr_Draw( void )
 {
-	for( int i = 0; i < ( sizeof( sprites ) / sizeof( sprites[0] ) ); ++i ) {
-		if( sprites[i].image != -1 ) {
-			img_Draw_sv_c_r( sprites[i].image, sprites[i].camFlags, sprites[i].oldState.pos, sprites[i].newState.pos,
-				sprites[i].oldState.scale, sprites[i].newState.scale, sprites[i].oldState.col, sprites[i].newState.col,
-				sprites[i].oldState.rot, sprites[i].newState.rot, sprites[i].depth );
-			sprites[i].oldState = sprites[i].newState;
+	if( pendingMutex == NULL ) {
+		return;
+	}
+
+	for( size_t i = 0; i < sb_Count( sbSettlingSprites ); ++i ) {
+		Sprite* sprite = getSprite( sbSettlingSprites[i] );
+		if( sprite != NULL ) {
+			markChanged( sprite );
 		}
 	}
+	sb_Clear( sbSettlingSprites );
+
+	SDL_LockMutex( pendingMutex );
+		// moving a sprite to a different group can add to the list, so the count has to be checked every time, a
+		//  sprite can be in the list more than once if it was moved after it was handed over
+		for( size_t i = 0; i < sb_Count( sbChangedSprites ); ++i ) {
+			int handle = sbChangedSprites[i];
+			Sprite* sprite = getSprite( handle );
+			if( ( sprite == NULL ) || !sprite->changed ) {
+				continue;
+			}
+
+			int slot = HANDLE_SLOT( handle );
+			sprite = updateGroup( slot );
+			sprite->changed = false;
+
+			SpriteChange* change = sb_Add( sbPendingSprites, 1 );
+			change->group = sbSlots[slot].group;
+			change->index = sbSlots[slot].index;
+			change->image = sprite->image;
+			change->start = sprite->oldState;
+			change->end = sprite->newState;
+
+			if( valuesDiffer( &( sprite->oldState ), &( sprite->newState ) ) ) {
+				sb_Push( sbSettlingSprites, handle );
+			}
+			sprite->oldState = sprite->newState;
+		}
+		lastChangedCount = (int)sb_Count( sbChangedSprites );
+		sb_Clear( sbChangedSprites );
+
+		for( int i = 0; i < (int)sb_Count( sbGroups ); ++i ) {
+			SpriteGroup* group = &( sbGroups[i] );
+			if( !group->countChanged ) {
+				continue;
+			}
+			group->countChanged = false;
+
+			GroupChange* change = sb_Add( sbPendingGroups, 1 );
+			change->group = i;
+			change->texture = group->texture;
+			change->textureArray = group->textureArray;
+			change->camFlags = group->camFlags;
+			change->depth = group->depth;
+			change->transparent = group->transparent;
+			change->count = (int)sb_Count( group->sbSprites );
+		}
+	SDL_UnlockMutex( pendingMutex );
 }
 
+static void toRenderState( const SpriteValues* values, Vector2 imageSize, SpriteState* outState )
+{
+	outState->pos = values->pos;
+	outState->scaleSize.x = imageSize.x * values->scale.x;
+	outState->scaleSize.y = imageSize.y * values->scale.y;
+	outState->color = values->col;
+	outState->rotation = values->rot;
+}
+
+/*
+Applies all the changes handed over by spr_Draw( ) to the sprite groups in the triangle renderer. Called by the
+ rendering before the triangles are uploaded.
+*/
+void spr_Render( void )
+{
+	if( pendingMutex == NULL ) {
+		return;
+	}
+
+	SDL_LockMutex( pendingMutex );
+		SWAP( sbPendingGroups, sbRenderGroupChanges, GroupChange* );
+		SWAP( sbPendingSprites, sbRenderSpriteChanges, SpriteChange* );
+	SDL_UnlockMutex( pendingMutex );
+
+	// the counts have to be set first so all the slots being set exist, if there were several draws since the last
+	//  render any slot that was removed afterwards is just ignored
+	for( size_t i = 0; i < sb_Count( sbRenderGroupChanges ); ++i ) {
+		GroupChange* change = &( sbRenderGroupChanges[i] );
+		while( (int)sb_Count( sbRendererGroups ) <= change->group ) {
+			sb_Push( sbRendererGroups, -1 );
+		}
+
+		if( sbRendererGroups[change->group] < 0 ) {
+			sbRendererGroups[change->group] = triRenderer_CreateSpriteGroup( change->texture, change->textureArray,
+				change->camFlags, change->depth, change->transparent ? 1 : 0 );
+		}
+		triRenderer_SetSpriteGroupCount( sbRendererGroups[change->group], change->count );
+	}
+
+	for( size_t i = 0; i < sb_Count( sbRenderSpriteChanges ); ++i ) {
+		SpriteChange* change = &( sbRenderSpriteChanges[i] );
+		if( ( change->group >= (int)sb_Count( sbRendererGroups ) ) || ( sbRendererGroups[change->group] < 0 ) ) {
+			continue;
+		}
+
+		int textureLayer;
+		Vector2 uvMin, uvMax, size, offset;
+		if( img_GetSpriteData( change->image, NULL, &textureLayer, &uvMin, &uvMax, &size, &offset, NULL ) < 0 ) {
+			continue;
+		}
+
+		SpriteState start, end;
+		toRenderState( &( change->start ), size, &start );
+		toRenderState( &( change->end ), size, &end );
+		triRenderer_SetGroupSprite( sbRendererGroups[change->group], change->index, &start, &end, offset, uvMin, uvMax, textureLayer );
+	}
+
+	sb_Clear( sbRenderGroupChanges );
+	sb_Clear( sbRenderSpriteChanges );
+}
+
+/*
+Creates a sprite that will be drawn until it's destroyed.
+ Returns the handle for the sprite, or a number < 0 if there was a problem.
+*/
 int spr_Create( int image, uint32_t camFlags, Vector2 pos, Vector2 scale, float rotRad, Color col, int8_t depth )
 {
-	int idx;
-	for( idx = 0; ( idx < NUM_SPRITES ) && ( sprites[idx].image != -1 ); ++idx ) ;
-	if( idx >= NUM_SPRITES ) {
-		llog( LOG_DEBUG, "Failed to create sprite, storage full.");
+	GLuint texture;
+	int textureLayer;
+	if( img_GetSpriteData( image, &texture, &textureLayer, NULL, NULL, NULL, NULL, NULL ) < 0 ) {
+		llog( LOG_DEBUG, "Failed to create sprite, invalid image." );
 		return -1;
 	}
 
-	sprites[idx].image = image;
-	sprites[idx].depth = depth;
-	sprites[idx].newState.pos = pos;
-	sprites[idx].newState.scale = scale;
-	sprites[idx].newState.rot = rotRad;
-	sprites[idx].newState.col = col;
-	sprites[idx].oldState = sprites[idx].newState;
-	sprites[idx].camFlags = camFlags;
+	int slot = firstFreeSlot;
+	if( slot >= 0 ) {
+		firstFreeSlot = sbSlots[slot].index;
+	} else {
+		if( sb_Count( sbSlots ) > SLOT_MASK ) {
+			llog( LOG_DEBUG, "Failed to create sprite, storage full." );
+			return -1;
+		}
+
+		slot = (int)sb_Count( sbSlots );
+		SpriteSlot* newSlot = sb_Add( sbSlots, 1 );
+		newSlot->generation = 0;
+	}
+
+	// zero is never used so a handle can't be all zeros
+	sbSlots[slot].generation = ( sbSlots[slot].generation >= MAX_GENERATION ) ? 1 : ( sbSlots[slot].generation + 1 );
+
+	Sprite sprite;
+	sprite.image = image;
+	sprite.slot = slot;
+	sprite.newState.pos = pos;
+	sprite.newState.scale = scale;
+	sprite.newState.rot = rotRad;
+	sprite.newState.col = col;
+	sprite.oldState = sprite.newState;
+	sprite.changed = false;
+
+	addToGroup( slot, findGroup( texture, ( textureLayer >= 0 ), camFlags, depth, needsBlending( &sprite ) ), &sprite );
+	++numSprites;
 
-	return idx;
+	return CREATE_HANDLE( slot, sbSlots[slot].generation );
 }
 
 void spr_Destroy( int sprite )
 {
-	sprites[sprite].image = -1;
+	if( getSprite( sprite ) == NULL ) {
+		return;
+	}
+
+	int slot = HANDLE_SLOT( sprite );
+	removeFromGroup( slot );
+
+	sbSlots[slot].group = -1;
+	sbSlots[slot].index = firstFreeSlot;
+	firstFreeSlot = slot;
+	--numSprites;
+}
+
+/*
+Returns whether the handle refers to a sprite that hasn't been destroyed.
+*/
+bool spr_IsValid( int sprite )
+{
+	return ( getSprite( sprite ) != NULL );
 }
 
 void spr_GetColor( int sprite, Color* outCol )
 {
-	(*outCol) = sprites[sprite].newState.col;
+	assert( outCol != NULL );
+
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
+
+	(*outCol) = spr->newState.col;
 }
 
 void spr_SetColor( int sprite, Color* col )
 {
-	sprites[sprite].newState.col = *col;
+	assert( col != NULL );
+
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
+
+	spr->newState.col = *col;
+	markChanged( spr );
 }
 
 void spr_GetPosition( int sprite, Vector2* outPos )
 {
-	(*outPos) = sprites[sprite].oldState.pos;
+	assert( outPos != NULL );
+
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
+
+	(*outPos) = spr->oldState.pos;
 }
 
 void spr_Update( int sprite, const Vector2* newPos, const Vector2* newScale, float newRot )
@@ -99,20 +474,24 @@ void spr_Update( int sprite, const Vector2* newPos, const Vector2* newScale, flo
 	assert( newPos != NULL );
 	assert( newScale != NULL );
 
-	if( !SPRITE_ID_VALID( sprite ) ) return;
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
 
-	sprites[sprite].newState.pos = *newPos;
-	sprites[sprite].newState.rot = newRot;
-	sprites[sprite].newState.scale = *newScale;
+	spr->newState.pos = *newPos;
+	spr->newState.rot = newRot;
+	spr->newState.scale = *newScale;
+	markChanged( spr );
 }
 
 void spr_Update_p( int sprite, const Vector2* newPos )
 {
 	assert( newPos != NULL );
 
-	if( !SPRITE_ID_VALID( sprite ) ) return;
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
 
-	sprites[sprite].newState.pos = *newPos;
+	spr->newState.pos = *newPos;
+	markChanged( spr );
 }
 
 void spr_Update_pc( int sprite, const Vector2* newPos, const Color* clr )
@@ -120,19 +499,23 @@ void spr_Update_pc( int sprite, const Vector2* newPos, const Color* clr )
 	assert( newPos != NULL );
 	assert( clr != NULL );
 
-	if( !SPRITE_ID_VALID( sprite ) ) return;
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
 
-	sprites[sprite].newState.pos = *newPos;
-	sprites[sprite].newState.col = *clr;
+	spr->newState.pos = *newPos;
+	spr->newState.col = *clr;
+	markChanged( spr );
 }
 
 void spr_Update_c( int sprite, const Color* clr )
 {
 	assert( clr != NULL );
 
-	if( !SPRITE_ID_VALID( sprite ) ) return;
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
 
-	sprites[sprite].newState.col = *clr;
+	spr->newState.col = *clr;
+	markChanged( spr );
 }
 
 void spr_Update_sc( int sprite, const Vector2* newScale, const Color* clr )
@@ -140,10 +523,12 @@ void spr_Update_sc( int sprite, const Vector2* newScale, const Color* clr )
 	assert( newScale != NULL );
 	assert( clr != NULL );
 
-	if( !SPRITE_ID_VALID( sprite ) ) return;
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
 
-	sprites[sprite].newState.col = *clr;
-	sprites[sprite].newState.scale = *newScale;
+	spr->newState.col = *clr;
+	spr->newState.scale = *newScale;
+	markChanged( spr );
 }
 
 void spr_Update_psc( int sprite, const Vector2* newPos, const Vector2* newScale, const Color* clr )
@@ -152,11 +537,13 @@ void spr_Update_psc( int sprite, const Vector2* newPos, const Vector2* newScale,
 	assert( newScale != NULL );
 	assert( clr != NULL );
 
-	if( !SPRITE_ID_VALID( sprite ) ) return;
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
 
-	sprites[sprite].newState.pos = *newPos;
-	sprites[sprite].newState.scale = *newScale;
-	sprites[sprite].newState.col = *clr;
+	spr->newState.pos = *newPos;
+	spr->newState.scale = *newScale;
+	spr->newState.col = *clr;
+	markChanged( spr );
 }
 
 void spr_UpdateDelta( int sprite, const Vector2* posOffset, const Vector2* scaleOffset, float rotOffset )
@@ -164,11 +551,23 @@ void spr_UpdateDelta( int sprite, const Vector2* posOffset, const Vector2* scale
 	assert( posOffset != NULL );
 	assert( scaleOffset != NULL );
 
-	if( !SPRITE_ID_VALID( sprite ) ) return;
+	Sprite* spr = getSprite( sprite );
+	if( spr == NULL ) return;
+
+	vec2_Add( &( spr->newState.pos ), posOffset, &( spr->newState.pos ) );
+	vec2_Add( &( spr->newState.scale ), scaleOffset, &( spr->newState.scale ) );
+	spr->newState.rot += rotOffset;
+	markChanged( spr );
+}
 
-	vec2_Add( &( sprites[sprite].newState.pos ), posOffset, &( sprites[sprite].newState.pos ) );
-	vec2_Add( &( sprites[sprite].newState.scale ), scaleOffset, &( sprites[sprite].newState.scale ) );
-	sprites[sprite].newState.rot += rotOffset;
+/*
+Gets how many sprites exist and how many of them were handed over to the rendering by the last spr_Draw( ). Either
+ of the out parameters can be NULL.
+*/
+void spr_GetStats( int* outSprites, int* outChanged )
+{
+	if( outSprites != NULL ) (*outSprites) = numSprites;
+	if( outChanged != NULL ) (*outChanged) = lastChangedCount;
 }
 
 int spr_RegisterSystem( void )
@@ -181,4 +580,4 @@ void spr_UnRegisterSystem( void )
 {
 	sys_UnRegister( systemID );
 	systemID = -1;
-}
\ No newline at end of file
+}
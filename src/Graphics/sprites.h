@@ -1,19 +1,54 @@
 /*
 This will be used to more easily store and process the states of the images.
+
+Sprites are retained, once created they stay on screen until they're destroyed and only what changes has to be
+ sent to the GPU. The sprites are kept in dense groups of ones that can be drawn together, which are mirrored by
+ sprite groups in the triangle renderer. The sprites are referred to by handles that hold a generation, so a handle
+ to a destroyed sprite stays invalid even after its slot is reused.
+
+The changes made during a tick are handed over to the rendering when spr_Draw( ) is called, and applied when the
+ triangles are next uploaded. When drawing on a separate thread from the rendering the sprites always show the last
+ changes handed over, which may be a tick ahead of the frame packet being rendered.
 */
 
 #ifndef SPRITES_H
 #define SPRITES_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "../Math/vector2.h"
 #include "color.h"
 
-void spr_Init( void );
+/*
+Sets up the sprites, destroying any that already exist.
+ Returns a number < 0 if there was a problem.
+*/
+int spr_Init( void );
+
+/*
+Hands all the changes made to the sprites since the last call over to the rendering. Sprites that moved are sent
+ again on the next call so they come to rest at their new state.
+*/
 void spr_Draw( void );
+
+/*
+Applies all the changes handed over by spr_Draw( ) to the sprite groups in the triangle renderer. Called by the
+ rendering before the triangles are uploaded.
+*/
+void spr_Render( void );
+
+/*
+Creates a sprite that will be drawn until it's destroyed.
+ Returns the handle for the sprite, or a number < 0 if there was a problem.
+*/
 int spr_Create( int image, uint32_t camFlags, Vector2 pos, Vector2 scale, float rotRad, Color col, int8_t depth );
 void spr_Destroy( int sprite );
 
+/*
+Returns whether the handle refers to a sprite that hasn't been destroyed.
+*/
+bool spr_IsValid( int sprite );
+
 void spr_GetColor( int sprite, Color* outCol );
 void spr_SetColor( int sprite, Color* col );
 
@@ -27,6 +62,12 @@ void spr_Update_sc( int sprite, const Vector2* newScale, const Color* clr );
 void spr_Update_psc( int sprite, const Vector2* newPos, const Vector2* newScale, const Color* clr );
 void spr_UpdateDelta( int sprite, const Vector2* posOffset, const Vector2* scaleOffset, float rotOffset );
 
+/*
+Gets how many sprites exist and how many of them were handed over to the rendering by the last spr_Draw( ). Either
+ of the out parameters can be NULL.
+*/
+void spr_GetStats( int* outSprites, int* outChanged );
+
 /*
 Handles the system level stuff.
  Returns a number < 0 if there was a problem.
@@ -34,4 +75,4 @@ Handles the system level stuff.
 int spr_RegisterSystem( void );
 void spr_UnRegisterSystem( void );
 
-#endif // inclusion guard
\ No newline at end of file
+#endif // inclusion guard
@@ -0,0 +1,170 @@
+#include "streamBuffer.h"
+
+#include <string.h>
+
+#include "glDebugging.h"
+#include "../System/platformLog.h"
+
+// segments start on this boundary so the offsets are valid for vertex attributes and indices
+#define SEGMENT_ALIGNMENT 256
+
+// how long we'll wait on the GPU before complaining about it, in nanoseconds
+#define FENCE_TIMEOUT 1000000000
+
+static size_t segmentStride( StreamBuffer* stream )
+{
+	return ( ( stream->frameSize.capacity + ( SEGMENT_ALIGNMENT - 1 ) ) / SEGMENT_ALIGNMENT ) * SEGMENT_ALIGNMENT;
+}
+
+static size_t totalSize( StreamBuffer* stream )
+{
+	return stream->useMapping ? ( segmentStride( stream ) * NUM_STREAM_SEGMENTS ) : stream->frameSize.capacity;
+}
+
+static void destroyFences( StreamBuffer* stream )
+{
+	for( int i = 0; i < NUM_STREAM_SEGMENTS; ++i ) {
+		if( stream->fences[i] != NULL ) {
+			GL( glDeleteSync( stream->fences[i] ) );
+			stream->fences[i] = NULL;
+		}
+	}
+}
+
+static void waitForSegment( StreamBuffer* stream, int segment )
+{
+	GLsync fence = stream->fences[segment];
+	if( fence == NULL ) {
+		return;
+	}
+
+	GLenum result;
+	GLR( result, glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT ) );
+	if( ( result == GL_TIMEOUT_EXPIRED ) || ( result == GL_WAIT_FAILED ) ) {
+		llog( LOG_WARN, "Problem waiting for the GPU to finish with a stream buffer segment." );
+	}
+
+	GL( glDeleteSync( fence ) );
+	stream->fences[segment] = NULL;
+}
+
+/*
+Creates the buffer object and binds it to target. If the target is GL_ELEMENT_ARRAY_BUFFER the vertex array object
+ it should be used with has to be bound first. initialFrameSize is how many bytes we expect to write each frame.
+ Returns < 0 if there's a problem.
+*/
+int streamBuffer_Create( StreamBuffer* stream, GLenum target, size_t initialFrameSize )
+{
+	memset( stream, 0, sizeof( StreamBuffer ) );
+	stream->target = target;
+	stream->liveSegment = -1;
+
+	GL( glGenBuffers( 1, &( stream->buffer ) ) );
+	if( stream->buffer == 0 ) {
+		llog( LOG_ERROR, "Unable to create stream buffer." );
+		return -1;
+	}
+
+	gfxUtil_InitGPUBufferSize( &( stream->frameSize ), initialFrameSize );
+
+#if defined( __EMSCRIPTEN__ )
+	// WebGL doesn't support mapping buffers
+	stream->useMapping = false;
+#else
+	stream->useMapping = true;
+#endif
+
+	GL( glBindBuffer( target, stream->buffer ) );
+	GL( glBufferData( target, (GLsizeiptr)totalSize( stream ), NULL, GL_STREAM_DRAW ) );
+
+	return 0;
+}
+
+/*
+Cleans up the buffer object and any fences still waiting.
+*/
+void streamBuffer_Destroy( StreamBuffer* stream )
+{
+	destroyFences( stream );
+	if( stream->buffer != 0 ) {
+		GL( glDeleteBuffers( 1, &( stream->buffer ) ) );
+		stream->buffer = 0;
+	}
+}
+
+/*
+Copies the data into the part of the buffer for this frame, growing the buffer if it won't fit. The buffer has to
+ be bound to the target it was created with. Should only be called once a frame, the data stays in the buffer for
+ the frames after it until the next write.
+ Returns the offset in bytes in the buffer that the data was written to.
+*/
+GLintptr streamBuffer_Write( StreamBuffer* stream, const void* data, size_t size )
+{
+	if( gfxUtil_UpdateGPUBufferSize( &( stream->frameSize ), size ) ) {
+		// anything the GPU could still be reading is in the old storage, so none of the new storage needs waiting on
+		destroyFences( stream );
+		stream->currSegment = 0;
+		stream->liveSegment = -1;
+		GL( glBufferData( stream->target, (GLsizeiptr)totalSize( stream ), NULL, GL_STREAM_DRAW ) );
+	}
+
+	if( size == 0 ) {
+		return 0;
+	}
+
+	if( stream->useMapping ) {
+		GLintptr offset = (GLintptr)( segmentStride( stream ) * stream->currSegment );
+		waitForSegment( stream, stream->currSegment );
+
+		void* dest;
+		GLR( dest, glMapBufferRange( stream->target, offset, (GLsizeiptr)size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT ) );
+		if( dest != NULL ) {
+			memcpy( dest, data, size );
+			GLboolean unmapped;
+			GLR( unmapped, glUnmapBuffer( stream->target ) );
+			if( unmapped == GL_TRUE ) {
+				stream->written = true;
+				return offset;
+			}
+		}
+
+		llog( LOG_WARN, "Unable to map stream buffer, falling back to orphaning it." );
+		destroyFences( stream );
+		stream->useMapping = false;
+	}
+
+	// give the old storage to the driver so we don't have to wait for the GPU to finish with it
+	GL( glBufferData( stream->target, (GLsizeiptr)totalSize( stream ), NULL, GL_STREAM_DRAW ) );
+	GL( glBufferSubData( stream->target, 0, (GLsizeiptr)size, data ) );
+	return 0;
+}
+
+/*
+Call at the end of every frame, after all the draws that use the buffer have been issued.
+*/
+void streamBuffer_EndFrame( StreamBuffer* stream )
+{
+	if( !stream->useMapping ) {
+		return;
+	}
+
+	// frames that didn't write anything drew from the last segment written, so that's the one that has to be fenced
+	//  and the ring only moves on when there's new data
+	int segment = stream->written ? stream->currSegment : stream->liveSegment;
+	if( segment < 0 ) {
+		return;
+	}
+
+	// a segment that was only drawn from has a fence that was never waited on
+	if( stream->fences[segment] != NULL ) {
+		GL( glDeleteSync( stream->fences[segment] ) );
+	}
+	GLR( stream->fences[segment], glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 ) );
+
+	if( stream->written ) {
+		stream->liveSegment = stream->currSegment;
+		stream->currSegment = ( stream->currSegment + 1 ) % NUM_STREAM_SEGMENTS;
+		stream->written = false;
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "glPlatform.h"
+#include "gfxUtil.h"
+
+/*
+Buffer objects for data that's completely rewritten whenever it changes. The buffer is split into a ring of segments,
+ each write goes into the next segment with an unsynchronized map and a fence makes sure we don't write into a segment
+ the GPU is still reading from. Frames that don't write anything keep drawing from the last segment written, so only
+ its fence is moved up. If mapping isn't available or fails the buffer is orphaned for every write instead.
+*/
+
+#define NUM_STREAM_SEGMENTS 3
+
+typedef struct {
+	GLuint buffer;
+	GLenum target;
+	GPUBufferSize frameSize;
+	GLsync fences[NUM_STREAM_SEGMENTS];
+	int currSegment;
+	int liveSegment; // the segment the last write went to, < 0 if there isn't one
+	bool written;
+	bool useMapping;
+} StreamBuffer;
+
+/*
+Creates the buffer object and binds it to target. If the target is GL_ELEMENT_ARRAY_BUFFER the vertex array object
+ it should be used with has to be bound first. initialFrameSize is how many bytes we expect to write each frame.
+ Returns < 0 if there's a problem.
+*/
+int streamBuffer_Create( StreamBuffer* stream, GLenum target, size_t initialFrameSize );
+
+/*
+Cleans up the buffer object and any fences still waiting.
+*/
+void streamBuffer_Destroy( StreamBuffer* stream );
+
+/*
+Copies the data into the part of the buffer for this frame, growing the buffer if it won't fit. The buffer has to
+ be bound to the target it was created with. Should only be called once a frame, the data stays in the buffer for
+ the frames after it until the next write.
+ Returns the offset in bytes in the buffer that the data was written to.
+*/
+GLintptr streamBuffer_Write( StreamBuffer* stream, const void* data, size_t size );
+
+/*
+Call at the end of every frame, after all the draws that use the buffer have been issued.
+*/
+void streamBuffer_EndFrame( StreamBuffer* stream );
+
+#endif /* inclusion guard */
@@ -0,0 +1,506 @@
+#include "tilemap.h"
+
+#include <string.h>
+#include <assert.h>
+#include <SDL_mutex.h>
+
+#include "graphics.h"
+#include "images.h"
+#include "triRendering.h"
+#include "../Math/mathUtil.h"
+#include "../System/memory.h"
+#include "../System/platformLog.h"
+#include "../Utils/stretchyBuffer.h"
+#include "../Utils/helpers.h"
+
+#define MAX_TILEMAPS 16
+
+// every texture used by the tiles in a chunk needs its own chunk in the triangle renderer, usually there's only one
+typedef struct {
+	GLuint texture;
+	int rendererChunk;
+} ChunkPart;
+
+// the dirty flag is only used by the thread setting the tiles, the parts are only used by the rendering
+typedef struct {
+	bool dirty;
+	ChunkPart* sbParts;
+} MapChunk;
+
+typedef struct {
+	bool inUse;
+	// the map isn't released until the rendering has gotten rid of its chunks
+	bool destroyed;
+
+	int width;
+	int height;
+	int chunksWide;
+	int chunksHigh;
+	Vector2 origin;
+	Vector2 tileSize;
+	uint32_t camFlags;
+	int8_t depth;
+
+	int* atlas;
+	int atlasCount;
+
+	int16_t* tiles;
+	MapChunk* chunks;
+	int* sbDirtyChunks;
+} Tilemap;
+
+static Tilemap tilemaps[MAX_TILEMAPS];
+
+// the tiles of each chunk that changed are copied out when they're snapshotted and handed to the rendering along with
+//  the snapshot they were taken in, the rendering only rebuilds a chunk once the frame packet that snapshot went into
+//  is being rendered. a chunk of -1 is the map being destroyed
+typedef struct {
+	int tilemap;
+	int chunk;
+	uint32_t snapshot;
+	int16_t tiles[TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE];
+} ChunkUpdate;
+
+// the updates and which maps are in use are shared with the rendering
+static SDL_mutex* tilemapMutex = NULL;
+static ChunkUpdate* sbChunkUpdates = NULL;
+static ChunkUpdate* sbLaterChunkUpdates = NULL;
+
+// the snapshots go up by one each time, a packet holds everything up to the snapshot stored for it
+static uint32_t lastSnapshot = 0;
+static uint32_t packetSnapshots[NUM_FRAME_PACKETS];
+static int writePacket = 0;
+static int readPacket = 0;
+
+// what the rendering needs to know about each image in the atlas of the map being rebuilt
+typedef struct {
+	bool valid;
+	GLuint texture;
+	int textureLayer;
+	Vector2 uvMin;
+	Vector2 uvMax;
+	Vector2 min;
+	Vector2 max;
+} AtlasEntry;
+
+static AtlasEntry* sbAtlasEntries = NULL;
+
+// the tiles of the chunk being rebuilt, along with which part of the chunk each one goes in
+static ChunkTile* sbChunkTiles = NULL;
+static int* sbChunkTileParts = NULL;
+static ChunkTile* sbPartTiles = NULL;
+
+static int lastRebuiltChunks = 0;
+
+/*
+Sets up the tile maps.
+ Returns a number < 0 if there was a problem.
+*/
+int tilemap_Init( void )
+{
+	if( tilemapMutex == NULL ) {
+		tilemapMutex = SDL_CreateMutex( );
+		if( tilemapMutex == NULL ) {
+			llog( LOG_ERROR, "Unable to create tile map mutex: %s", SDL_GetError( ) );
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static Tilemap* getTilemap( int tilemap )
+{
+	if( ( tilemap < 0 ) || ( tilemap >= MAX_TILEMAPS ) || !tilemaps[tilemap].inUse || tilemaps[tilemap].destroyed ) {
+		return NULL;
+	}
+	return &( tilemaps[tilemap] );
+}
+
+// the chunks and tiles are released by whichever thread notices the map is gone
+static void releaseTilemap( Tilemap* map )
+{
+	if( map->chunks != NULL ) {
+		for( int i = 0; i < ( map->chunksWide * map->chunksHigh ); ++i ) {
+			for( size_t p = 0; p < sb_Count( map->chunks[i].sbParts ); ++p ) {
+				triRenderer_DestroyTileChunk( map->chunks[i].sbParts[p].rendererChunk );
+			}
+			sb_Release( map->chunks[i].sbParts );
+		}
+	}
+
+	mem_Release( map->atlas );
+	mem_Release( map->tiles );
+	mem_Release( map->chunks );
+	sb_Release( map->sbDirtyChunks );
+	memset( map, 0, sizeof( *map ) );
+}
+
+/*
+Creates a map of width by height tiles that all start out empty. The atlas is the list of images the tiles index into,
+ it's copied so it doesn't have to stay around. Every image should fit inside a single tile, each one is drawn
+ centered on its cell the same way img_Draw( ) would draw it. The cells are tileSize apart with the corner of the
+ first one at the origin.
+ Returns the id of the map, or a number < 0 if there was a problem.
+*/
+int tilemap_Create( int width, int height, const int* atlasImages, int atlasCount, Vector2 origin, Vector2 tileSize,
+	uint32_t camFlags, int8_t depth )
+{
+	if( tilemapMutex == NULL ) {
+		llog( LOG_ERROR, "Tile maps haven't been initialized." );
+		return -1;
+	}
+
+	if( ( width <= 0 ) || ( height <= 0 ) || ( atlasImages == NULL ) || ( atlasCount <= 0 ) || ( atlasCount > INT16_MAX ) ) {
+		llog( LOG_ERROR, "Invalid size or atlas for tile map." );
+		return -1;
+	}
+
+	int idx = -1;
+	SDL_LockMutex( tilemapMutex );
+		for( int i = 0; ( i < MAX_TILEMAPS ) && ( idx < 0 ); ++i ) {
+			if( !tilemaps[i].inUse ) {
+				idx = i;
+				tilemaps[i].inUse = true;
+			}
+		}
+	SDL_UnlockMutex( tilemapMutex );
+
+	if( idx < 0 ) {
+		llog( LOG_ERROR, "No free tile maps." );
+		return -1;
+	}
+
+	Tilemap* map = &( tilemaps[idx] );
+	map->width = width;
+	map->height = height;
+	map->chunksWide = ( width + TILEMAP_CHUNK_SIZE - 1 ) / TILEMAP_CHUNK_SIZE;
+	map->chunksHigh = ( height + TILEMAP_CHUNK_SIZE - 1 ) / TILEMAP_CHUNK_SIZE;
+	map->origin = origin;
+	map->tileSize = tileSize;
+	map->camFlags = camFlags;
+	map->depth = depth;
+
+	map->atlas = mem_Allocate( sizeof( int ) * atlasCount );
+	map->tiles = mem_Allocate( sizeof( int16_t ) * width * height );
+	map->chunks = mem_Allocate( sizeof( MapChunk ) * map->chunksWide * map->chunksHigh );
+	if( ( map->atlas == NULL ) || ( map->tiles == NULL ) || ( map->chunks == NULL ) ) {
+		llog( LOG_ERROR, "Unable to allocate tile map." );
+		SDL_LockMutex( tilemapMutex );
+			releaseTilemap( map );
+		SDL_UnlockMutex( tilemapMutex );
+		return -1;
+	}
+
+	memcpy( map->atlas, atlasImages, sizeof( int ) * atlasCount );
+	map->atlasCount = atlasCount;
+	memset( map->tiles, 0xFF, sizeof( int16_t ) * width * height );
+	memset( map->chunks, 0, sizeof( MapChunk ) * map->chunksWide * map->chunksHigh );
+
+	return idx;
+}
+
+/*
+Stops drawing the map and releases everything it was using.
+*/
+void tilemap_Destroy( int tilemap )
+{
+	Tilemap* map = getTilemap( tilemap );
+	if( map == NULL ) {
+		return;
+	}
+
+	// the rendering keeps drawing the map until it gets to the snapshot that it was destroyed in
+	SDL_LockMutex( tilemapMutex );
+		map->destroyed = true;
+		ChunkUpdate* update = sb_Add( sbChunkUpdates, 1 );
+		update->tilemap = tilemap;
+		update->chunk = -1;
+		update->snapshot = lastSnapshot + 1;
+	SDL_UnlockMutex( tilemapMutex );
+}
+
+static void markChunkDirty( Tilemap* map, int column, int row )
+{
+	int chunk = ( ( row / TILEMAP_CHUNK_SIZE ) * map->chunksWide ) + ( column / TILEMAP_CHUNK_SIZE );
+	if( !map->chunks[chunk].dirty ) {
+		map->chunks[chunk].dirty = true;
+		sb_Push( map->sbDirtyChunks, chunk );
+	}
+}
+
+static int16_t toStoredTile( Tilemap* map, int tile )
+{
+	return ( ( tile < 0 ) || ( tile >= map->atlasCount ) ) ? -1 : (int16_t)tile;
+}
+
+/*
+Sets the tile at a cell of the map, the tile is the index of the image in the atlas or < 0 to leave the cell empty.
+*/
+void tilemap_SetTile( int tilemap, int column, int row, int tile )
+{
+	Tilemap* map = getTilemap( tilemap );
+	if( ( map == NULL ) || ( column < 0 ) || ( column >= map->width ) || ( row < 0 ) || ( row >= map->height ) ) {
+		return;
+	}
+
+	int16_t stored = toStoredTile( map, tile );
+	int idx = ( row * map->width ) + column;
+	if( map->tiles[idx] == stored ) {
+		return;
+	}
+
+	map->tiles[idx] = stored;
+	markChunkDirty( map, column, row );
+}
+
+/*
+Sets every tile of the map at once, tiles has to hold width * height tiles with each row after the one before it.
+*/
+void tilemap_SetTiles( int tilemap, const int* tiles )
+{
+	Tilemap* map = getTilemap( tilemap );
+	if( ( map == NULL ) || ( tiles == NULL ) ) {
+		return;
+	}
+
+	for( int row = 0; row < map->height; ++row ) {
+		for( int column = 0; column < map->width; ++column ) {
+			int idx = ( row * map->width ) + column;
+			int16_t stored = toStoredTile( map, tiles[idx] );
+			if( map->tiles[idx] != stored ) {
+				map->tiles[idx] = stored;
+				markChunkDirty( map, column, row );
+			}
+		}
+	}
+}
+
+/*
+Gets the tile at a cell of the map, or -1 if the cell is empty or outside the map.
+*/
+int tilemap_GetTile( int tilemap, int column, int row )
+{
+	Tilemap* map = getTilemap( tilemap );
+	if( ( map == NULL ) || ( column < 0 ) || ( column >= map->width ) || ( row < 0 ) || ( row >= map->height ) ) {
+		return -1;
+	}
+
+	return map->tiles[( row * map->width ) + column];
+}
+
+// copies the tiles of a chunk out with TILEMAP_CHUNK_SIZE tiles in each row, anything past the edge of the map is empty
+static void copyChunkTiles( Tilemap* map, int chunkIdx, int16_t* outTiles )
+{
+	int firstColumn = ( chunkIdx % map->chunksWide ) * TILEMAP_CHUNK_SIZE;
+	int firstRow = ( chunkIdx / map->chunksWide ) * TILEMAP_CHUNK_SIZE;
+	int columns = MIN( TILEMAP_CHUNK_SIZE, map->width - firstColumn );
+	int rows = MIN( TILEMAP_CHUNK_SIZE, map->height - firstRow );
+
+	memset( outTiles, 0xFF, sizeof( int16_t ) * TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE );
+	for( int row = 0; row < rows; ++row ) {
+		memcpy( &( outTiles[row * TILEMAP_CHUNK_SIZE] ), &( map->tiles[( ( firstRow + row ) * map->width ) + firstColumn] ),
+			sizeof( int16_t ) * columns );
+	}
+}
+
+/*
+Copies the tiles of every chunk that changed since the last snapshot into the frame packet being written to, they'll
+ be rebuilt when that packet is rendered. Call this once everything has been drawn.
+*/
+void tilemap_SnapshotTiles( void )
+{
+	if( tilemapMutex == NULL ) {
+		return;
+	}
+
+	SDL_LockMutex( tilemapMutex );
+		++lastSnapshot;
+		for( int i = 0; i < MAX_TILEMAPS; ++i ) {
+			Tilemap* map = &( tilemaps[i] );
+			if( !map->inUse || map->destroyed ) {
+				continue;
+			}
+
+			for( size_t c = 0; c < sb_Count( map->sbDirtyChunks ); ++c ) {
+				int chunk = map->sbDirtyChunks[c];
+				ChunkUpdate* update = sb_Add( sbChunkUpdates, 1 );
+				update->tilemap = i;
+				update->chunk = chunk;
+				update->snapshot = lastSnapshot;
+				copyChunkTiles( map, chunk, update->tiles );
+				map->chunks[chunk].dirty = false;
+			}
+			sb_Clear( map->sbDirtyChunks );
+		}
+		packetSnapshots[writePacket] = lastSnapshot;
+	SDL_UnlockMutex( tilemapMutex );
+}
+
+/*
+Sets which frame packet the changed tiles are copied into when they're snapshotted.
+*/
+void tilemap_SetWritePacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	writePacket = packet;
+}
+
+/*
+Sets which frame packet the changed tiles are rebuilt from.
+*/
+void tilemap_SetReadPacket( int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	readPacket = packet;
+}
+
+static void lookUpAtlas( Tilemap* map )
+{
+	sb_Clear( sbAtlasEntries );
+	AtlasEntry* entries = sb_Add( sbAtlasEntries, map->atlasCount );
+	for( int i = 0; i < map->atlasCount; ++i ) {
+		Vector2 size;
+		Vector2 offset;
+		entries[i].valid = ( img_GetSpriteData( map->atlas[i], &( entries[i].texture ), &( entries[i].textureLayer ),
+			&( entries[i].uvMin ), &( entries[i].uvMax ), &size, &offset, NULL ) >= 0 );
+		if( entries[i].valid ) {
+			entries[i].min = vec2( offset.x - ( size.x * 0.5f ), offset.y - ( size.y * 0.5f ) );
+			entries[i].max = vec2( offset.x + ( size.x * 0.5f ), offset.y + ( size.y * 0.5f ) );
+		}
+	}
+}
+
+static int findChunkPart( Tilemap* map, MapChunk* chunk, int chunkColumn, int chunkRow, const AtlasEntry* entry )
+{
+	for( int i = 0; i < (int)sb_Count( chunk->sbParts ); ++i ) {
+		if( chunk->sbParts[i].texture == entry->texture ) {
+			return i;
+		}
+	}
+
+	Vector2 origin;
+	origin.x = map->origin.x + ( (float)( chunkColumn * TILEMAP_CHUNK_SIZE ) * map->tileSize.x );
+	origin.y = map->origin.y + ( (float)( chunkRow * TILEMAP_CHUNK_SIZE ) * map->tileSize.y );
+
+	ChunkPart part;
+	part.texture = entry->texture;
+	part.rendererChunk = triRenderer_CreateTileChunk( entry->texture, ( entry->textureLayer >= 0 ), map->camFlags, map->depth,
+		origin, map->tileSize );
+	if( part.rendererChunk < 0 ) {
+		return -1;
+	}
+
+	sb_Push( chunk->sbParts, part );
+	return ( (int)sb_Count( chunk->sbParts ) - 1 );
+}
+
+// builds the tiles for each texture used in the chunk and hands them to the triangle renderer, any part whose texture
+//  isn't used anymore is just left empty
+static void rebuildChunk( Tilemap* map, int chunkIdx, const int16_t* tiles )
+{
+	MapChunk* chunk = &( map->chunks[chunkIdx] );
+	int chunkColumn = chunkIdx % map->chunksWide;
+	int chunkRow = chunkIdx / map->chunksWide;
+
+	sb_Clear( sbChunkTiles );
+	sb_Clear( sbChunkTileParts );
+	for( int row = 0; row < TILEMAP_CHUNK_SIZE; ++row ) {
+		const int16_t* rowTiles = &( tiles[row * TILEMAP_CHUNK_SIZE] );
+		for( int column = 0; column < TILEMAP_CHUNK_SIZE; ++column ) {
+			if( rowTiles[column] < 0 ) {
+				continue;
+			}
+
+			const AtlasEntry* entry = &( sbAtlasEntries[rowTiles[column]] );
+			if( !entry->valid ) {
+				continue;
+			}
+
+			int part = findChunkPart( map, chunk, chunkColumn, chunkRow, entry );
+			if( part < 0 ) {
+				continue;
+			}
+
+			ChunkTile* tile = sb_Add( sbChunkTiles, 1 );
+			tile->column = column;
+			tile->row = row;
+			tile->min = entry->min;
+			tile->max = entry->max;
+			tile->uvMin = entry->uvMin;
+			tile->uvMax = entry->uvMax;
+			tile->textureLayer = entry->textureLayer;
+			sb_Push( sbChunkTileParts, part );
+		}
+	}
+
+	int numTiles = (int)sb_Count( sbChunkTiles );
+	for( int part = 0; part < (int)sb_Count( chunk->sbParts ); ++part ) {
+		sb_Clear( sbPartTiles );
+		for( int i = 0; i < numTiles; ++i ) {
+			if( sbChunkTileParts[i] == part ) {
+				sb_Push( sbPartTiles, sbChunkTiles[i] );
+			}
+		}
+		triRenderer_SetTileChunkTiles( chunk->sbParts[part].rendererChunk, sbPartTiles, (int)sb_Count( sbPartTiles ) );
+	}
+}
+
+/*
+Rebuilds all the chunks that changed in the frame packet being rendered, or any before it, and hands them to the
+ triangle renderer. Called by the rendering before the triangles are uploaded.
+*/
+void tilemap_Render( void )
+{
+	if( tilemapMutex == NULL ) {
+		return;
+	}
+
+	lastRebuiltChunks = 0;
+
+	// the updates are in the order they were snapshotted, anything from a later snapshot is kept for a later packet
+	SDL_LockMutex( tilemapMutex );
+		uint32_t renderSnapshot = packetSnapshots[readPacket];
+		Tilemap* atlasMap = NULL;
+		for( size_t i = 0; i < sb_Count( sbChunkUpdates ); ++i ) {
+			ChunkUpdate* update = &( sbChunkUpdates[i] );
+			if( update->snapshot > renderSnapshot ) {
+				sb_Push( sbLaterChunkUpdates, (*update) );
+				continue;
+			}
+
+			Tilemap* map = &( tilemaps[update->tilemap] );
+			if( update->chunk < 0 ) {
+				releaseTilemap( map );
+				atlasMap = NULL;
+				continue;
+			}
+
+			if( map != atlasMap ) {
+				lookUpAtlas( map );
+				atlasMap = map;
+			}
+			rebuildChunk( map, update->chunk, update->tiles );
+			++lastRebuiltChunks;
+		}
+		SWAP( sbChunkUpdates, sbLaterChunkUpdates, ChunkUpdate* );
+		sb_Clear( sbLaterChunkUpdates );
+	SDL_UnlockMutex( tilemapMutex );
+}
+
+/*
+Gets how many chunks there are in all the maps and how many of them were rebuilt by the last tilemap_Render( ).
+ Either of the out parameters can be NULL.
+*/
+void tilemap_GetStats( int* outChunks, int* outRebuilt )
+{
+	if( outChunks != NULL ) {
+		(*outChunks) = 0;
+		for( int i = 0; i < MAX_TILEMAPS; ++i ) {
+			if( tilemaps[i].inUse && !tilemaps[i].destroyed ) {
+				(*outChunks) += tilemaps[i].chunksWide * tilemaps[i].chunksHigh;
+			}
+		}
+	}
+	if( outRebuilt != NULL ) (*outRebuilt) = lastRebuiltChunks;
+}
@@ -0,0 +1,84 @@
+/*
+Draws large grids of tiles. Each tile is an index into the atlas of images the map was created with, and the map is
+ split into square chunks that are each kept on the GPU and drawn with one call for each texture used in them. Only
+ the chunks that had tiles change are rebuilt, so a map that isn't changing costs nothing to keep drawing.
+
+The tiles can be set from any one thread while the rendering is running on another. The chunks that changed are
+ copied into the frame packets and only rebuilt once the packet they went into is rendered, so they show up along with
+ everything else drawn that tick.
+*/
+
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include <stdint.h>
+#include "../Math/vector2.h"
+
+// how many tiles across and down each chunk is
+#define TILEMAP_CHUNK_SIZE 32
+
+/*
+Sets up the tile maps.
+ Returns a number < 0 if there was a problem.
+*/
+int tilemap_Init( void );
+
+/*
+Creates a map of width by height tiles that all start out empty. The atlas is the list of images the tiles index into,
+ it's copied so it doesn't have to stay around. Every image should fit inside a single tile, each one is drawn
+ centered on its cell the same way img_Draw( ) would draw it. The cells are tileSize apart with the corner of the
+ first one at the origin.
+ Returns the id of the map, or a number < 0 if there was a problem.
+*/
+int tilemap_Create( int width, int height, const int* atlasImages, int atlasCount, Vector2 origin, Vector2 tileSize,
+	uint32_t camFlags, int8_t depth );
+
+/*
+Stops drawing the map and releases everything it was using.
+*/
+void tilemap_Destroy( int tilemap );
+
+/*
+Sets the tile at a cell of the map, the tile is the index of the image in the atlas or < 0 to leave the cell empty.
+*/
+void tilemap_SetTile( int tilemap, int column, int row, int tile );
+
+/*
+Sets every tile of the map at once, tiles has to hold width * height tiles with each row after the one before it.
+*/
+void tilemap_SetTiles( int tilemap, const int* tiles );
+
+/*
+Gets the tile at a cell of the map, or -1 if the cell is empty or outside the map.
+*/
+int tilemap_GetTile( int tilemap, int column, int row );
+
+/*
+Copies the tiles of every chunk that changed since the last snapshot into the frame packet being written to, they'll
+ be rebuilt when that packet is rendered. Call this once everything has been drawn.
+*/
+void tilemap_SnapshotTiles( void );
+
+/*
+Sets which frame packet the changed tiles are copied into when they're snapshotted.
+*/
+void tilemap_SetWritePacket( int packet );
+
+/*
+Sets which frame packet the changed tiles are rebuilt from.
+*/
+void tilemap_SetReadPacket( int packet );
+
+/*
+Rebuilds all the chunks that changed in the frame packet being rendered, or any before it, and hands them to the
+ triangle renderer. Called by the rendering before the triangles are uploaded.
+*/
+void tilemap_Render( void );
+
+/*
+Gets how many chunks there are in all the maps and how many of them were rebuilt by the last tilemap_Render( ).
+ Either of the out parameters can be NULL.
+*/
+void tilemap_GetStats( int* outChunks, int* outRebuilt );
+
+#endif // inclusion guard
@@ -1,6 +1,11 @@
 #include "triRendering.h"
 
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
 
 #include "glPlatform.h"
 
@@ -10,62 +15,357 @@
 #include "glDebugging.h"
 #include "scissor.h"
 #include "../System/platformLog.h"
-
+#include "../System/memory.h"
+#include "../Utils/radixSort.h"
+#include "../Utils/stretchyBuffer.h"
+#include "../Math/mathUtil.h"
+#include "gfxUtil.h"
+#include "streamBuffer.h"
+#include "layerCache.h"
+#include "glState.h"
+#include "renderStats.h"
+
+// sprite instances are packed a few at a time with whatever vector instructions the platform has, anything else
+//  falls back to doing them one at a time
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+	#include <emmintrin.h>
+	#define SPRITE_PACK_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+	#include <arm_neon.h>
+	#define SPRITE_PACK_NEON
+#endif
+
+// how many sprites have their rotations fixed up together when they're added in bulk
+#define SPRITE_PACK_WIDTH 4
+
+// both the start and end states are sent so the vertex shader can interpolate between them without the vertices
+//  having to be rebuilt every frame, the uvs are normalized shorts so they have to be in the range [0,1], the layer is
+//  < 0 if the texture isn't an array texture
 typedef struct {
-	Vector3 pos;
-	Color col;
-	Vector2 uv;
+	Vector2 startPos;
+	Vector2 endPos;
+	float z;
+	uint8_t startCol[4];
+	uint8_t endCol[4];
+	uint16_t uv[2];
+	int16_t layer;
 } Vertex;
 
+// sprites are sent as a single instance that the vertex shader expands into a quad, the rotations and z are next
+//  to each other so they can be read as one vec3
 typedef struct {
-	GLuint vertexIndices[3];
-	float zPos;
+	Vector2 startPos;
+	Vector2 endPos;
+	Vector2 startScale;
+	Vector2 endScale;
+	Vector2 offset;
+	float startRot;
+	float endRot;
+	float z;
+	uint16_t uvRect[4];
+	uint8_t startCol[4];
+	uint8_t endCol[4];
+	int16_t layer;
+} SpriteInstance;
+
+// tiles only need to know which cell of their chunk they're in and the corners of their quad around it, everything
+//  else is shared by the whole chunk, the padding keeps every instance starting on four bytes
+typedef struct {
+	uint16_t cell[2];
+	int16_t rect[4];
+	uint16_t uvRect[4];
+	int16_t layer;
+	uint16_t padding;
+} TileInstance;
+
+// everything needed to sort and batch a triangle or sprite
+typedef struct {
+	uint32_t sequence;
 	uint32_t camFlags;
 	GLuint texture;
-
-	ShaderType shaderType;
+	bool textureArray;
 
 	int scissorID;
+	int8_t depth;
+} DrawState;
+
+typedef struct {
+	GLuint vertexIndices[3];
+	DrawState state;
 } Triangle;
 
+typedef struct {
+	SpriteInstance instance;
+	DrawState state;
+} Sprite;
+
 /*
 Ok, so what do we want to optimize for?
 I'd think transferring memory.
 So we have the vertices we transfer at the beginning of the rendering
 Once that is done we generate index buffers to represent what each camera can see
 */
-#define MAX_TRIS 2048
-#define MAX_VERTS ( MAX_TRIS * 3 )
+// how many triangles each list starts with space for, they'll grow past this as needed
+#define INITIAL_TRIS 2048
+#define INITIAL_SPRITES 1024
 
-typedef struct {
-	Vertex startVertices[MAX_VERTS];
-	Vertex endVertices[MAX_VERTS];
+// indices are 16-bit so the vertices are split into pages that they can address, each page holds whole triangles
+#define VERTS_PER_PAGE 65535
+
+// the sort entries for sprites are marked with this so they can be told apart from the triangles
+#define SPRITE_ENTRY 0x80000000
 
-	Triangle triangles[MAX_TRIS];
-	Vertex vertices[MAX_VERTS];
-	GLuint indices[MAX_VERTS];
+typedef struct {
+	Triangle* sbTriangles;
+	Vertex* sbVertices;
+	Sprite* sbSprites;
 	GLuint VAO;
-	GLuint VBO;
-	GLuint IBO;
+	StreamBuffer vertexStream;
+	GLintptr vertexOffset;
+	int boundPage;
 	int lastTriIndex;
-	int lastIndexBufferIndex;
+
+	// the triangles and sprites themselves never move, we sort these and draw through them
+	bool sortByDepth;
+	RadixSortEntry* sbSortEntries;
+	RadixSortEntry* sbSortScratch;
+	RadixSortEntry* sortedTris;
+
+	// the visible triangles and sprites in the order they'll be drawn, and the batches they were split into
+	uint32_t* sbDrawOrder;
+	int firstBatch;
+	int batchCount;
 } TriangleList;
 
 TriangleList solidTriangles;
 TriangleList transparentTriangles;
 
-#define Z_ORDER_OFFSET ( 1.0f / (float)( 2 * ( MAX_TRIS + 1 ) ) )
+// a run of triangles in the frame's index buffer, or sprites in the frame's instance buffer, that can all be drawn
+//  with the same state by the same cameras, plain and array textures are bound to different units so a batch can
+//  use one of each, either is 0 if nothing in the batch uses it
+typedef struct {
+	GLuint texture;
+	GLuint arrayTexture;
+	int scissorID;
+	uint32_t camFlags;
+	bool instanced;
+	int8_t depth;
+	int page;
+	int first;
+	int count;
+	BatchBreak breakReason; // why it couldn't be drawn with the batch before it
+} DrawBatch;
+
+// solid triangles are grouped by which cameras can see them so each camera only has to look at the batches, they're
+//  also grouped by vertex page so the batches don't get split up
+typedef struct {
+	uint32_t camFlags;
+	int page;
+	int triCount;
+	int nextSlot;
+} VisibilityBucket;
+
+// all the indices are built once before anything is drawn so they can be sent all at once, they only have to be
+//  rebuilt when new triangles are uploaded or a camera that couldn't see anything before becomes active
+static GLushort* sbFrameIndices = NULL;
+static DrawBatch* sbDrawBatches = NULL;
+static VisibilityBucket* sbBuckets = NULL;
+static int* sbTriBuckets = NULL;
+static StreamBuffer indexStream;
+static GLintptr indexOffset = 0;
+static uint32_t indexedCamFlags = 0;
+
+// the sprite instances are gathered in draw order along with the indices, each sprite batch points the instance
+//  attributes at where its instances start
+static SpriteInstance* sbFrameInstances = NULL;
+static StreamBuffer instanceStream;
+static GLintptr instanceOffset = 0;
+static GLuint spriteVAO = 0;
+static GLuint spriteQuadVBO = 0;
+
+// the order things are added in is shared between the lists so the depth and blending can be worked out
+static uint32_t nextSequence = 0;
+
+// a run of sprites in a group that have to be sent to the GPU again
+typedef struct {
+	int first;
+	int count;
+} DirtyRange;
+
+// sprites that stay on the GPU between uploads instead of being added again after every clear, everything in a group
+//  shares the same state so the whole group is drawn with one call, the instances are kept on the CPU as well so
+//  only the ranges that changed have to be sent
+typedef struct {
+	bool inUse;
+	GLuint texture;
+	bool textureArray;
+	uint32_t camFlags;
+	int8_t depth;
+	bool transparent;
+
+	int count;
+	int capacity;
+	SpriteInstance* instances;
+	DirtyRange* sbDirtyRanges;
+
+	// changes whenever a sprite is set, so the cached layers can tell if the group changed without looking at it all
+	int version;
+	int checkedVersion;
+	bool moving;
+
+	GLuint buffer;
+	int bufferCapacity;
+} SpriteGroup;
+
+// dirty ranges closer together than this many sprites are sent as one, sending a few sprites that didn't change is
+//  cheaper than another call
+#define DIRTY_RANGE_MERGE_GAP 16
+
+static SpriteGroup* sbSpriteGroups = NULL;
+
+// the transparent groups have to be drawn between the transparent batches in depth order, so the batches are split
+//  at any depth that has a transparent group, indexed by depth + 128
+static int* sbTransparentGroupOrder = NULL;
+static bool transparentGroupDepths[256];
 
-static ShaderProgram shaderPrograms[NUM_SHADERS];
+// tiles that stay on the GPU between uploads, every tile in a chunk shares the same state so the whole chunk is drawn
+//  with one call, the tiles are only kept on the CPU until they've been sent and the whole chunk is sent when it changes
+typedef struct {
+	bool inUse;
+	GLuint texture;
+	bool textureArray;
+	uint32_t camFlags;
+	int8_t depth;
+	Vector2 origin;
+	Vector2 tileSize;
+
+	int count;
+	TileInstance* sbPendingTiles;
+	bool dirty;
+	Vector2 boundsMin;
+	Vector2 boundsMax;
+
+	GLuint buffer;
+	int bufferCapacity;
+	int uploadedCount;
+
+	// changes whenever the tiles are set
+	int version;
+} TileChunk;
+
+static TileChunk* sbTileChunks = NULL;
+
+// the chunks any camera can see in the order they'll be drawn
+static int* sbTileChunkOrder = NULL;
+static GLuint tileVAO = 0;
+
+typedef enum {
+	PT_TRIANGLES,
+	PT_SPRITES,
+	PT_TILES,
+	NUM_PRIMITIVE_TYPES
+} PrimitiveType;
+
+// every shader type is drawn with the same program, alpha only textures are set up to sample as white with the
+//  coverage in the alpha so they don't need their own fragment shader, array textures are bound to their own unit and
+//  picked by the layer so switching between them and plain textures doesn't need a different program
+static ShaderProgram shaderPrograms[NUM_PRIMITIVE_TYPES];
+
+// how many triangles were in the last frame rendered, and the most there have been in a single frame
+static int lastRenderTriangles = 0;
+static int peakTriangles = 0;
+
+// how much was sent to the GPU for the last frame, and how much has been sent for the current one
+static int lastUploadedVertexBytes = 0;
+static int lastUploadedIndexBytes = 0;
+static int frameVertexBytes = 0;
+static int frameIndexBytes = 0;
+
+// how many draw calls and program changes the last frame rendered needed, and the counts for the current one
+static int lastDrawCalls = 0;
+static int lastProgramBinds = 0;
+static int frameDrawCalls = 0;
+static int frameProgramBinds = 0;
+
+// how many sprites were in groups for the last frame rendered, and how many ranges of them had to be sent
+static int lastGroupSprites = 0;
+static int lastGroupRangesSent = 0;
+static int frameGroupRangesSent = 0;
+
+// how many tile chunks had tiles and could be seen for the last frame rendered, and how many of them had to be sent
+static int lastTileChunks = 0;
+static int lastVisibleTileChunks = 0;
+static int lastTileChunksSent = 0;
+static int frameTileChunksSent = 0;
+
+// how long each stage of building the last set of batches took on the CPU
+static float lastSortMS = 0.0f;
+static float lastVertexMS = 0.0f;
+static float lastOrderMS = 0.0f;
+static float lastBatchMS = 0.0f;
+static float lastSendMS = 0.0f;
+
+// where the next upload that takes long enough is written out to, empty if nothing is waiting to be captured
+#define MAX_CAPTURE_PATH_LEN 512
+static char captureFileName[MAX_CAPTURE_PATH_LEN] = { 0 };
+static float captureMinMS = 0.0f;
+
+// the sort entries of a loaded capture in the order they were added, sorting moves them around so they're put back
+//  before each upload of it
+static bool captureLoaded = false;
+static RadixSortEntry* sbCapturedSolidEntries = NULL;
+static RadixSortEntry* sbCapturedTransparentEntries = NULL;
+
+// the lists are written out as is, so a capture can only be loaded by a build that lays them out the same way
+#define CAPTURE_MAGIC 0x50435458 // XTCP
+#define CAPTURE_VERSION 2
+#define CAPTURE_ENTRY_BLOCK 1024
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexSize;
+	uint32_t triangleSize;
+	uint32_t spriteSize;
+	uint32_t spriteInstanceSize;
+	uint32_t nextSequence;
+	uint32_t cameraCount;
+	uint32_t scissorAreaCount;
+	uint32_t spriteGroupCount;
+	uint32_t tileChunkCount; // the tiles aren't kept after they're sent, so captures with any chunks can't be loaded
+} CaptureHeader;
+
+typedef struct {
+	int32_t camera;
+	uint32_t renderFlags;
+	Matrix4 vpMat;
+} CaptureCamera;
+
+// the sort entries are written as just their values, the keys are made again from the states when it's loaded
+typedef struct {
+	uint32_t triangleCount;
+	uint32_t vertexCount;
+	uint32_t spriteCount;
+	uint32_t entryCount;
+} CaptureList;
+
+// each group is followed by its sprites
+typedef struct {
+	uint32_t texture;
+	uint32_t textureArray;
+	uint32_t camFlags;
+	int32_t depth;
+	uint32_t transparent;
+	uint32_t count;
+} CaptureGroup;
 
 int triRenderer_LoadShaders( void )
 {
 	llog( LOG_INFO, "Loading triangle renderer shaders." );
-	ShaderDefinition shaderDefs[3];
-	ShaderProgramDefinition progDefs[NUM_SHADERS];
+	ShaderDefinition shaderDefs[4];
+	ShaderProgramDefinition progDefs[NUM_PRIMITIVE_TYPES];
 
 	llog( LOG_INFO, "  Destroying shaders." );
-	shaders_Destroy( shaderPrograms, NUM_SHADERS );
+	shaders_Destroy( &( shaderPrograms[0] ), NUM_PRIMITIVE_TYPES );
 
 	// Sprite shader
 	shaderDefs[0].fileName = NULL;
@@ -76,63 +376,192 @@ int triRenderer_LoadShaders( void )
 	shaderDefs[1].type = GL_FRAGMENT_SHADER;
 	shaderDefs[1].shaderText = DEFAULT_FRAG_SHADER;
 
-	// for rendering fonts
+	// for expanding sprite instances, uses the same fragment shader as the triangles
 	shaderDefs[2].fileName = NULL;
-	shaderDefs[2].type = GL_FRAGMENT_SHADER;
-	shaderDefs[2].shaderText = FONT_FRAG_SHADER;
-
-	progDefs[0].fragmentShader = 1;
-	progDefs[0].vertexShader = 0;
-	progDefs[0].geometryShader = -1;
-	progDefs[0].uniformNames = "vpMatrix textureUnit0";
-
-	progDefs[1].fragmentShader = 2;
-	progDefs[1].vertexShader = 0;
-	progDefs[1].geometryShader = -1;
-	progDefs[1].uniformNames = "vpMatrix textureUnit0";
+	shaderDefs[2].type = GL_VERTEX_SHADER;
+	shaderDefs[2].shaderText = SPRITE_VERTEX_SHADER;
+
+	// for expanding tile instances, the tiles don't move so they don't use the lerp times but the chunk's position
+	//  and tile size are set for each chunk
+	shaderDefs[3].fileName = NULL;
+	shaderDefs[3].type = GL_VERTEX_SHADER;
+	shaderDefs[3].shaderText = TILE_VERTEX_SHADER;
+
+	for( int i = 0; i < NUM_PRIMITIVE_TYPES; ++i ) {
+		progDefs[i].fragmentShader = 1;
+		progDefs[i].vertexShader = 0;
+		progDefs[i].geometryShader = -1;
+		progDefs[i].uniformNames = "textureUnit0 lerpTimes arrayUnit";
+	}
+	progDefs[PT_SPRITES].vertexShader = 2;
+	progDefs[PT_TILES].vertexShader = 3;
+	progDefs[PT_TILES].uniformNames = "textureUnit0 lerpTimes arrayUnit chunkOrigin tileSize";
 
 	llog( LOG_INFO, "  Loading shaders." );
 	if( shaders_Load( &( shaderDefs[0] ), sizeof( shaderDefs ) / sizeof( ShaderDefinition ),
-		progDefs, shaderPrograms, NUM_SHADERS ) <= 0 ) {
+		&( progDefs[0] ), &( shaderPrograms[0] ), NUM_PRIMITIVE_TYPES ) <= 0 ) {
 		llog( LOG_ERROR, "Error compiling image shaders.\n" );
 		return -1;
 	}
 
+	// the view projection matrices come from the camera block
+	for( int i = 0; i < NUM_PRIMITIVE_TYPES; ++i ) {
+		glState_SetupCameraBlock( shaderPrograms[i].programID );
+	}
+
 	return 0;
 }
 
-static int createTriListGLObjects( TriangleList* triList )
+static void setVertexAttributes( GLintptr baseOffset )
+{
+	GL( glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex ), (const GLvoid*)( baseOffset + offsetof( Vertex, startPos ) ) ) );
+	GL( glVertexAttribPointer( 1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof( Vertex ), (const GLvoid*)( baseOffset + offsetof( Vertex, uv ) ) ) );
+	GL( glVertexAttribPointer( 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( Vertex ), (const GLvoid*)( baseOffset + offsetof( Vertex, startCol ) ) ) );
+	GL( glVertexAttribPointer( 3, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex ), (const GLvoid*)( baseOffset + offsetof( Vertex, endPos ) ) ) );
+	GL( glVertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( Vertex ), (const GLvoid*)( baseOffset + offsetof( Vertex, endCol ) ) ) );
+	GL( glVertexAttribPointer( 5, 1, GL_FLOAT, GL_FALSE, sizeof( Vertex ), (const GLvoid*)( baseOffset + offsetof( Vertex, z ) ) ) );
+	GL( glVertexAttribPointer( 6, 1, GL_SHORT, GL_FALSE, sizeof( Vertex ), (const GLvoid*)( baseOffset + offsetof( Vertex, layer ) ) ) );
+}
+
+// points the vertex attributes at the start of the page, the vertex array has to be bound
+static void bindVertexPage( TriangleList* triList, int page )
+{
+	GL( glBindBuffer( GL_ARRAY_BUFFER, triList->vertexStream.buffer ) );
+	setVertexAttributes( triList->vertexOffset + (GLintptr)( sizeof( Vertex ) * VERTS_PER_PAGE * page ) );
+	triList->boundPage = page;
+}
+
+// points the instance attributes at the first instance in the buffer, the sprite vertex array has to be bound
+static void setInstanceAttributes( GLuint buffer, GLintptr bufferOffset, int firstInstance )
+{
+	GLintptr baseOffset = bufferOffset + (GLintptr)( sizeof( SpriteInstance ) * firstInstance );
+
+	GL( glBindBuffer( GL_ARRAY_BUFFER, buffer ) );
+	GL( glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, startPos ) ) ) );
+	GL( glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, endPos ) ) ) );
+	GL( glVertexAttribPointer( 3, 2, GL_FLOAT, GL_FALSE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, startScale ) ) ) );
+	GL( glVertexAttribPointer( 4, 2, GL_FLOAT, GL_FALSE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, endScale ) ) ) );
+	GL( glVertexAttribPointer( 5, 2, GL_FLOAT, GL_FALSE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, offset ) ) ) );
+	GL( glVertexAttribPointer( 6, 3, GL_FLOAT, GL_FALSE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, startRot ) ) ) );
+	GL( glVertexAttribPointer( 7, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, uvRect ) ) ) );
+	GL( glVertexAttribPointer( 8, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, startCol ) ) ) );
+	GL( glVertexAttribPointer( 9, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, endCol ) ) ) );
+	GL( glVertexAttribPointer( 10, 1, GL_SHORT, GL_FALSE, sizeof( SpriteInstance ), (const GLvoid*)( baseOffset + offsetof( SpriteInstance, layer ) ) ) );
+}
+
+// points the tile attributes at the start of a chunk's buffer, the tile vertex array has to be bound
+static void setTileAttributes( GLuint buffer )
+{
+	GL( glBindBuffer( GL_ARRAY_BUFFER, buffer ) );
+	GL( glVertexAttribPointer( 1, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof( TileInstance ), (const GLvoid*)offsetof( TileInstance, cell ) ) );
+	GL( glVertexAttribPointer( 2, 4, GL_SHORT, GL_FALSE, sizeof( TileInstance ), (const GLvoid*)offsetof( TileInstance, rect ) ) );
+	GL( glVertexAttribPointer( 3, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof( TileInstance ), (const GLvoid*)offsetof( TileInstance, uvRect ) ) );
+	GL( glVertexAttribPointer( 4, 1, GL_SHORT, GL_FALSE, sizeof( TileInstance ), (const GLvoid*)offsetof( TileInstance, layer ) ) );
+}
+
+static int createTriListGLObjects( TriangleList* triList, bool sortByDepth )
 {
 	GL( glGenVertexArrays( 1, &( triList->VAO ) ) );
-	GL( glGenBuffers( 1, &( triList->VBO ) ) );
-	GL( glGenBuffers( 1, &( triList->IBO ) ) );
-	if( ( triList->VAO == 0 ) || ( triList->VBO == 0 ) || ( triList->IBO == 0 ) ) {
+	if( triList->VAO == 0 ) {
+		llog( LOG_ERROR, "Unable to create one or more storage objects for triangle rendering." );
+		return -1;
+	}
+
+	glState_BindVertexArray( triList->VAO );
+
+	if( streamBuffer_Create( &( triList->vertexStream ), GL_ARRAY_BUFFER, sizeof( Vertex ) * INITIAL_TRIS * 3 ) < 0 ) {
 		llog( LOG_ERROR, "Unable to create one or more storage objects for triangle rendering." );
 		return -1;
 	}
 
-	GL( glBindVertexArray( triList->VAO ) );
+	for( GLuint i = 0; i < 7; ++i ) {
+		GL( glEnableVertexAttribArray( i ) );
+	}
+
+	triList->vertexOffset = 0;
+	bindVertexPage( triList, 0 );
+
+	glState_BindVertexArray( 0 );
+
+	GL( glBindBuffer( GL_ARRAY_BUFFER, 0 ) );
+
+	triList->lastTriIndex = -1;
+	triList->sortByDepth = sortByDepth;
+
+	sb_Reserve( triList->sbTriangles, INITIAL_TRIS );
+	sb_Reserve( triList->sbVertices, INITIAL_TRIS * 3 );
+	sb_Reserve( triList->sbSprites, INITIAL_SPRITES );
+	sb_Reserve( triList->sbSortEntries, INITIAL_TRIS );
+	sb_Reserve( triList->sbSortScratch, INITIAL_TRIS );
+	triList->sortedTris = triList->sbSortEntries;
+
+	return 0;
+}
+
+static int createSpriteGLObjects( void )
+{
+	// the corners match the order the images used to be split into triangles in, so it can be drawn as a strip
+	float quadCorners[] = { -0.5f, -0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f, 0.5f };
 
-	GL( glBindBuffer( GL_ARRAY_BUFFER, triList->VBO ) );
-	GL( glBufferData( GL_ARRAY_BUFFER, sizeof( triList->vertices ), NULL, GL_DYNAMIC_DRAW ) );
+	GL( glGenVertexArrays( 1, &spriteVAO ) );
+	GL( glGenBuffers( 1, &spriteQuadVBO ) );
+	if( ( spriteVAO == 0 ) || ( spriteQuadVBO == 0 ) ) {
+		llog( LOG_ERROR, "Unable to create one or more storage objects for sprite rendering." );
+		return -1;
+	}
 
-	GL( glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, triList->IBO ) );
-	GL( glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( triList->indices ), triList->indices, GL_DYNAMIC_DRAW ) );
+	glState_BindVertexArray( spriteVAO );
 
+	GL( glBindBuffer( GL_ARRAY_BUFFER, spriteQuadVBO ) );
+	GL( glBufferData( GL_ARRAY_BUFFER, sizeof( quadCorners ), quadCorners, GL_STATIC_DRAW ) );
 	GL( glEnableVertexAttribArray( 0 ) );
-	GL( glEnableVertexAttribArray( 1 ) );
-	GL( glEnableVertexAttribArray( 2 ) );
+	GL( glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof( float ) * 2, NULL ) );
+
+	if( streamBuffer_Create( &instanceStream, GL_ARRAY_BUFFER, sizeof( SpriteInstance ) * INITIAL_SPRITES ) < 0 ) {
+		llog( LOG_ERROR, "Unable to create one or more storage objects for sprite rendering." );
+		glState_BindVertexArray( 0 );
+		return -1;
+	}
 
-	GL( glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), (const GLvoid*)offsetof( Vertex, pos ) ) );
-	GL( glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex ), (const GLvoid*)offsetof( Vertex, uv ) ) );
-	GL( glVertexAttribPointer( 2, 4, GL_FLOAT, GL_FALSE, sizeof( Vertex ), (const GLvoid*)offsetof( Vertex, col ) ) );
+	for( GLuint i = 1; i < 11; ++i ) {
+		GL( glEnableVertexAttribArray( i ) );
+		GL( glVertexAttribDivisor( i, 1 ) );
+	}
+	setInstanceAttributes( instanceStream.buffer, 0, 0 );
 
-	GL( glBindVertexArray( 0 ) );
+	glState_BindVertexArray( 0 );
 
 	GL( glBindBuffer( GL_ARRAY_BUFFER, 0 ) );
 
-	triList->lastIndexBufferIndex = -1;
-	triList->lastTriIndex = -1;
+	sb_Reserve( sbFrameInstances, INITIAL_SPRITES );
+
+	return 0;
+}
+
+// the tiles use the same quad as the sprites, each chunk has its own buffer so the instance attributes are pointed at
+//  it when it's drawn
+static int createTileGLObjects( void )
+{
+	GL( glGenVertexArrays( 1, &tileVAO ) );
+	if( tileVAO == 0 ) {
+		llog( LOG_ERROR, "Unable to create one or more storage objects for tile rendering." );
+		return -1;
+	}
+
+	glState_BindVertexArray( tileVAO );
+
+	GL( glBindBuffer( GL_ARRAY_BUFFER, spriteQuadVBO ) );
+	GL( glEnableVertexAttribArray( 0 ) );
+	GL( glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof( float ) * 2, NULL ) );
+
+	for( GLuint i = 1; i < 5; ++i ) {
+		GL( glEnableVertexAttribArray( i ) );
+		GL( glVertexAttribDivisor( i, 1 ) );
+	}
+
+	glState_BindVertexArray( 0 );
+
+	GL( glBindBuffer( GL_ARRAY_BUFFER, 0 ) );
 
 	return 0;
 }
@@ -143,7 +572,7 @@ Initializes all the stuff needed for rendering the triangles.
 */
 int triRenderer_Init( int renderAreaWidth, int renderAreaHeight )
 {
-	for( int i = 0; i < NUM_SHADERS; ++i ) {
+	for( int i = 0; i < NUM_PRIMITIVE_TYPES; ++i ) {
 		shaderPrograms[i].programID = 0;
 	}
 
@@ -152,53 +581,243 @@ int triRenderer_Init( int renderAreaWidth, int renderAreaHeight )
 	}
 
 	llog( LOG_INFO, "Creating triangle lists." );
-	if( ( createTriListGLObjects( &solidTriangles ) < 0 ) ||
-		( createTriListGLObjects( &transparentTriangles ) < 0 ) ) {
+	if( ( createTriListGLObjects( &solidTriangles, false ) < 0 ) ||
+		( createTriListGLObjects( &transparentTriangles, true ) < 0 ) ||
+		( createSpriteGLObjects( ) < 0 ) ||
+		( createTileGLObjects( ) < 0 ) ) {
+		return -1;
+	}
+
+	// both lists draw from the same index buffer, the element array binding is part of the vertex array state
+	glState_BindVertexArray( solidTriangles.VAO );
+	if( streamBuffer_Create( &indexStream, GL_ELEMENT_ARRAY_BUFFER, sizeof( GLushort ) * INITIAL_TRIS * 3 ) < 0 ) {
+		glState_BindVertexArray( 0 );
 		return -1;
 	}
+	glState_BindVertexArray( transparentTriangles.VAO );
+	GL( glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexStream.buffer ) );
+	glState_BindVertexArray( 0 );
 
 	return 0;
 }
 
-int addTriangle( TriangleList* triList, Vector2 pos0, Vector2 pos1, Vector2 pos2, Vector2 uv0, Vector2 uv1, Vector2 uv2,
-	ShaderType shader, GLuint texture, Color color, int clippingID, uint32_t camFlags, int8_t depth )
+/*
+Packs the render state into a key so sorting the keys puts triangles that can be drawn together next to each other.
+ Solid triangles are ordered by whether they're sprites, then whether they use an array texture, then texture, then
+ scissor area. Transparent
+ triangles have to be drawn back to front, so they're ordered by depth and then the order they were added in, which
+ keeps the triangles from the same image or string together.
+*/
+static uint64_t createSortKey( TriangleList* triList, DrawState* state, bool isSprite )
 {
-	if( triList->lastTriIndex >= ( MAX_TRIS - 1 ) ) {
-		llog( LOG_VERBOSE, "Triangle list full." );
-		return -1;
+	if( triList->sortByDepth ) {
+		return ( ( (uint64_t)( (uint8_t)state->depth ^ 0x80 ) << 32 ) | state->sequence );
+	}
+
+	return ( ( (uint64_t)( isSprite ? 1 : 0 ) << 63 ) |
+		( (uint64_t)( state->textureArray ? 1 : 0 ) << 62 ) |
+		( (uint64_t)state->texture << 24 ) |
+		( (uint64_t)( state->scissorID & 0xFFFFFF ) ) );
+}
+
+static void addSortEntry( TriangleList* triList, DrawState* state, uint32_t value, bool isSprite )
+{
+	RadixSortEntry* sortEntry = sb_Add( triList->sbSortEntries, 1 );
+	sortEntry->key = createSortKey( triList, state, isSprite );
+	sortEntry->value = isSprite ? ( value | SPRITE_ENTRY ) : value;
+}
+
+static DrawState* getEntryState( TriangleList* triList, uint32_t entry )
+{
+	if( entry & SPRITE_ENTRY ) {
+		return &( triList->sbSprites[entry & ~SPRITE_ENTRY].state );
+	}
+	return &( triList->sbTriangles[entry].state );
+}
+
+// sprites don't use the vertices so they can go with whatever page
+static int getEntryPage( TriangleList* triList, uint32_t entry )
+{
+	if( entry & SPRITE_ENTRY ) {
+		return 0;
+	}
+	return (int)( triList->sbTriangles[entry].vertexIndices[0] / VERTS_PER_PAGE );
+}
+
+static void setDrawState( DrawState* state, GLuint texture, int textureLayer, int clippingID, uint32_t camFlags, int8_t depth )
+{
+	// the z position depends on how many triangles there are in total, so it's filled in when we upload
+	state->sequence = nextSequence++;
+	state->camFlags = camFlags;
+	state->texture = texture;
+	state->textureArray = ( textureLayer >= 0 );
+	state->depth = depth;
+	state->scissorID = clippingID;
+}
+
+static uint16_t packUV( float uv )
+{
+	return (uint16_t)( ( clamp( 0.0f, 1.0f, uv ) * 65535.0f ) + 0.5f );
+}
+
+static void packColor( const Color* color, uint8_t* out )
+{
+	for( int i = 0; i < 4; ++i ) {
+		out[i] = (uint8_t)( ( clamp( 0.0f, 1.0f, color->col[i] ) * 255.0f ) + 0.5f );
+	}
+}
+
+// the shader just mixes the rotations, so the end rotation is moved so it goes the shortest way around
+static float shortestEndRotation( float startRot, float endRot )
+{
+	float diff = endRot - startRot;
+	if( fabsf( diff ) > M_PI_F ) {
+		return ( endRot - ( sign( diff ) * M_TWO_PI_F ) );
+	}
+	return endRot;
+}
+
+// does shortestEndRotation( ) for SPRITE_PACK_WIDTH sprites at once
+static void shortestEndRotations( const float* startRots, const float* endRots, float* outEndRots )
+{
+#if defined( SPRITE_PACK_SSE2 )
+	__m128 signMask = _mm_set1_ps( -0.0f );
+	__m128 starts = _mm_loadu_ps( startRots );
+	__m128 ends = _mm_loadu_ps( endRots );
+	__m128 diffs = _mm_sub_ps( ends, starts );
+	__m128 wrapped = _mm_cmpgt_ps( _mm_andnot_ps( signMask, diffs ), _mm_set1_ps( M_PI_F ) );
+	__m128 turns = _mm_or_ps( _mm_set1_ps( M_TWO_PI_F ), _mm_and_ps( signMask, diffs ) );
+	_mm_storeu_ps( outEndRots, _mm_sub_ps( ends, _mm_and_ps( wrapped, turns ) ) );
+#elif defined( SPRITE_PACK_NEON )
+	float32x4_t starts = vld1q_f32( startRots );
+	float32x4_t ends = vld1q_f32( endRots );
+	float32x4_t diffs = vsubq_f32( ends, starts );
+	uint32x4_t wrapped = vcgtq_f32( vabsq_f32( diffs ), vdupq_n_f32( M_PI_F ) );
+	float32x4_t turns = vbslq_f32( vcltq_f32( diffs, vdupq_n_f32( 0.0f ) ), vdupq_n_f32( -M_TWO_PI_F ), vdupq_n_f32( M_TWO_PI_F ) );
+	vst1q_f32( outEndRots, vbslq_f32( wrapped, vsubq_f32( ends, turns ), ends ) );
+#else
+	for( int i = 0; i < SPRITE_PACK_WIDTH; ++i ) {
+		outEndRots[i] = shortestEndRotation( startRots[i], endRots[i] );
+	}
+#endif
+}
+
+// packs the uv rectangle into normalized shorts and the colors into normalized bytes, the same as packUV( ) and
+//  packColor( ) would, the uv rectangle and colors each fit in a single vector so they're done together
+static void packSpriteUVsAndColors( SpriteInstance* inst, Vector2 uvMin, Vector2 uvMax, const Color* startColor, const Color* endColor )
+{
+#if defined( SPRITE_PACK_SSE2 )
+	__m128 zero = _mm_setzero_ps( );
+	__m128 one = _mm_set1_ps( 1.0f );
+	__m128 half = _mm_set1_ps( 0.5f );
+
+	__m128 uvs = _mm_min_ps( _mm_max_ps( _mm_setr_ps( uvMin.x, uvMin.y, uvMax.x, uvMax.y ), zero ), one );
+	__m128i uvInts = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( uvs, _mm_set1_ps( 65535.0f ) ), half ) );
+	// there's only a signed pack to shorts, so shift everything into the signed range and flip the top bit back after
+	uvInts = _mm_sub_epi32( uvInts, _mm_set1_epi32( 32768 ) );
+	__m128i uvShorts = _mm_xor_si128( _mm_packs_epi32( uvInts, uvInts ), _mm_set1_epi16( (short)0x8000 ) );
+	_mm_storel_epi64( (__m128i*)inst->uvRect, uvShorts );
+
+	__m128 colorScale = _mm_set1_ps( 255.0f );
+	__m128 startCol = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( startColor->col ), zero ), one );
+	__m128 endCol = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( endColor->col ), zero ), one );
+	__m128i startInts = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( startCol, colorScale ), half ) );
+	__m128i endInts = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( endCol, colorScale ), half ) );
+	__m128i colBytes = _mm_packus_epi16( _mm_packs_epi32( startInts, endInts ), _mm_setzero_si128( ) );
+	int32_t packedStart = _mm_cvtsi128_si32( colBytes );
+	int32_t packedEnd = _mm_cvtsi128_si32( _mm_srli_si128( colBytes, 4 ) );
+	memcpy( inst->startCol, &packedStart, sizeof( inst->startCol ) );
+	memcpy( inst->endCol, &packedEnd, sizeof( inst->endCol ) );
+#elif defined( SPRITE_PACK_NEON )
+	float32x4_t zero = vdupq_n_f32( 0.0f );
+	float32x4_t one = vdupq_n_f32( 1.0f );
+	float32x4_t half = vdupq_n_f32( 0.5f );
+
+	float uvRect[4] = { uvMin.x, uvMin.y, uvMax.x, uvMax.y };
+	float32x4_t uvs = vminq_f32( vmaxq_f32( vld1q_f32( uvRect ), zero ), one );
+	vst1_u16( inst->uvRect, vmovn_u32( vcvtq_u32_f32( vaddq_f32( vmulq_n_f32( uvs, 65535.0f ), half ) ) ) );
+
+	float32x4_t startCol = vminq_f32( vmaxq_f32( vld1q_f32( startColor->col ), zero ), one );
+	float32x4_t endCol = vminq_f32( vmaxq_f32( vld1q_f32( endColor->col ), zero ), one );
+	uint16x4_t startShorts = vmovn_u32( vcvtq_u32_f32( vaddq_f32( vmulq_n_f32( startCol, 255.0f ), half ) ) );
+	uint16x4_t endShorts = vmovn_u32( vcvtq_u32_f32( vaddq_f32( vmulq_n_f32( endCol, 255.0f ), half ) ) );
+	uint8x8_t colBytes = vmovn_u16( vcombine_u16( startShorts, endShorts ) );
+	uint32_t packedStart = vget_lane_u32( vreinterpret_u32_u8( colBytes ), 0 );
+	uint32_t packedEnd = vget_lane_u32( vreinterpret_u32_u8( colBytes ), 1 );
+	memcpy( inst->startCol, &packedStart, sizeof( inst->startCol ) );
+	memcpy( inst->endCol, &packedEnd, sizeof( inst->endCol ) );
+#else
+	inst->uvRect[0] = packUV( uvMin.x );
+	inst->uvRect[1] = packUV( uvMin.y );
+	inst->uvRect[2] = packUV( uvMax.x );
+	inst->uvRect[3] = packUV( uvMax.y );
+	packColor( startColor, inst->startCol );
+	packColor( endColor, inst->endCol );
+#endif
+}
+
+// the shader uses a negative layer to know it should sample the plain texture
+static int16_t packLayer( int textureLayer )
+{
+	return (int16_t)MAX( textureLayer, -1 );
+}
+
+static void setVertex( Vertex* vert, Vector2 startPos, Vector2 endPos, Vector2 uv, int16_t layer, const uint8_t* startCol, const uint8_t* endCol )
+{
+	vert->startPos = startPos;
+	vert->endPos = endPos;
+	vert->z = 0.0f;
+	memcpy( vert->startCol, startCol, sizeof( vert->startCol ) );
+	memcpy( vert->endCol, endCol, sizeof( vert->endCol ) );
+	vert->uv[0] = packUV( uv.x );
+	vert->uv[1] = packUV( uv.y );
+	vert->layer = layer;
+}
+
+// gets space for a block of vertices that a triangle or mesh will index into, a triangle can't use vertices from
+//  different pages so if the block won't fit in what's left of the current page it's moved to the start of the next
+static Vertex* reserveVertices( TriangleList* triList, int count, GLuint* outBaseIdx )
+{
+	GLuint baseIdx = (GLuint)sb_Count( triList->sbVertices );
+	GLuint pageRemaining = VERTS_PER_PAGE - ( baseIdx % VERTS_PER_PAGE );
+	if( (GLuint)count > pageRemaining ) {
+		// the padding never gets drawn but it's still uploaded, so don't send garbage
+		memset( sb_Add( triList->sbVertices, pageRemaining ), 0, sizeof( Vertex ) * pageRemaining );
+		baseIdx += pageRemaining;
 	}
 
-	float z = (float)depth + ( Z_ORDER_OFFSET * ( solidTriangles.lastTriIndex + transparentTriangles.lastTriIndex + 2 ) );
+	(*outBaseIdx) = baseIdx;
+	return sb_Add( triList->sbVertices, count );
+}
 
+static int addTriangle( TriangleList* triList, const Vector2* startPositions, const Vector2* endPositions, const Vector2* uvs,
+	GLuint texture, Color startColor, Color endColor, int clippingID, uint32_t camFlags, int8_t depth )
+{
 	int idx = triList->lastTriIndex + 1;
 	triList->lastTriIndex = idx;
-	triList->triangles[idx].camFlags = camFlags;
-	triList->triangles[idx].texture = texture;
-	triList->triangles[idx].zPos = z;
-	triList->triangles[idx].shaderType = shader;
-	triList->triangles[idx].scissorID = clippingID;
-	int baseIdx = idx * 3;
-
-	vec2ToVec3( &( pos0 ), z, &( triList->vertices[baseIdx].pos ) );
-	triList->vertices[baseIdx].col = color;
-	triList->vertices[baseIdx].uv = uv0;
-	triList->triangles[idx].vertexIndices[0] = baseIdx;
-
-	vec2ToVec3( &( pos1 ), z, &( triList->vertices[baseIdx+1].pos ) );
-	triList->vertices[baseIdx+1].col = color;
-	triList->vertices[baseIdx+1].uv = uv1;
-	triList->triangles[idx].vertexIndices[1] = baseIdx + 1;
-
-	vec2ToVec3( &( pos2 ), z, &( triList->vertices[baseIdx+2].pos ) );
-	triList->vertices[baseIdx+2].col = color;
-	triList->vertices[baseIdx+2].uv = uv2;
-	triList->triangles[idx].vertexIndices[2] = baseIdx + 2;
+
+	Triangle* tri = sb_Add( triList->sbTriangles, 1 );
+	setDrawState( &( tri->state ), texture, -1, clippingID, camFlags, depth );
+
+	uint8_t packedStartColor[4];
+	uint8_t packedEndColor[4];
+	packColor( &startColor, packedStartColor );
+	packColor( &endColor, packedEndColor );
+
+	GLuint baseIdx;
+	Vertex* verts = reserveVertices( triList, 3, &baseIdx );
+	for( int i = 0; i < 3; ++i ) {
+		setVertex( &( verts[i] ), startPositions[i], endPositions[i], uvs[i], -1, packedStartColor, packedEndColor );
+		tri->vertexIndices[i] = baseIdx + i;
+	}
+
+	addSortEntry( triList, &( tri->state ), (uint32_t)idx, false );
 
 	return 0;
 }
 
 /*
-We'll assume the array has three vertices in it.
+We'll assume the array has three vertices in it. The texture can't be an array texture.
  Return a value < 0 if there's a problem.
 */
 int triRenderer_AddVertices( Vector2* positions, Vector2* uvs, ShaderType shader, GLuint texture, Color color,
@@ -210,172 +829,1806 @@ int triRenderer_AddVertices( Vector2* positions, Vector2* uvs, ShaderType shader
 
 int triRenderer_Add( Vector2 pos0, Vector2 pos1, Vector2 pos2, Vector2 uv0, Vector2 uv1, Vector2 uv2, ShaderType shader, GLuint texture,
 	Color color, int clippingID, uint32_t camFlags, int8_t depth, int transparent )
+{
+	Vector2 positions[3] = { pos0, pos1, pos2 };
+	Vector2 uvs[3] = { uv0, uv1, uv2 };
+	return triRenderer_AddInterpolated( positions, positions, uvs, shader, texture, color, color, clippingID, camFlags, depth, transparent );
+}
+
+/*
+Adds a triangle that moves from the start positions and color to the end positions and color as the frame is
+ interpolated. We'll assume all the arrays have three vertices in them. The texture can't be an array texture.
+ Return a value < 0 if there's a problem.
+*/
+int triRenderer_AddInterpolated( Vector2* startPositions, Vector2* endPositions, Vector2* uvs, ShaderType shader, GLuint texture,
+	Color startColor, Color endColor, int clippingID, uint32_t camFlags, int8_t depth, int transparent )
 {
 	if( transparent ) {
-		return addTriangle( &transparentTriangles, pos0, pos1, pos2, uv0, uv1, uv2, shader, texture, color, clippingID, camFlags, depth );
+		return addTriangle( &transparentTriangles, startPositions, endPositions, uvs, texture, startColor, endColor, clippingID, camFlags, depth );
 	} else {
-		return addTriangle( &solidTriangles, pos0, pos1, pos2, uv0, uv1, uv2, shader, texture, color, clippingID, camFlags, depth );
+		return addTriangle( &solidTriangles, startPositions, endPositions, uvs, texture, startColor, endColor, clippingID, camFlags, depth );
 	}
 }
 
 /*
-Clears out all the triangles currently stored.
+Adds a mesh of triangles that all share the same state, every three indices make a triangle. The vertices are copied
+ in once and shared by all the triangles that use them, so there can't be more than 65535 of them. endPositions can
+ be NULL if the mesh isn't moving, and colors can be NULL to use the color in the state for every vertex.
+ Return a value < 0 if there's a problem.
 */
-void triRenderer_Clear( void )
+int triRenderer_AddMesh( const Vector2* startPositions, const Vector2* endPositions, const Vector2* uvs, const Color* colors,
+	int vertexCount, const uint16_t* indices, int indexCount, const TriMeshState* state )
 {
-	transparentTriangles.lastTriIndex = -1;
-	solidTriangles.lastTriIndex = -1;
-}
+	assert( ( indexCount % 3 ) == 0 );
 
-static int sortByRenderState( const void* p1, const void* p2 )
-{
-	Triangle* tri1 = (Triangle*)p1;
-	Triangle* tri2 = (Triangle*)p2;
+	if( vertexCount > VERTS_PER_PAGE ) {
+		llog( LOG_ERROR, "Mesh has %i vertices, the most a mesh can have is %i.", vertexCount, VERTS_PER_PAGE );
+		return -1;
+	}
 
-	int stDiff = ( (int)tri1->shaderType - (int)tri2->shaderType );
-	if( stDiff != 0 ) {
-		return stDiff;
+	if( ( vertexCount <= 0 ) || ( indexCount <= 0 ) ) {
+		return 0;
 	}
 
-	if( tri1->texture < tri2->texture ) {
-		return -1;
-	} else if( tri1->texture > tri2->texture ) {
-		return 1;
+	TriangleList* triList = state->transparent ? &transparentTriangles : &solidTriangles;
+
+	// every triangle gets the same sequence so the vertices they share end up with the same z
+	DrawState drawState;
+	setDrawState( &drawState, state->texture, state->textureLayer, state->clippingID, state->camFlags, state->depth );
+
+	if( endPositions == NULL ) {
+		endPositions = startPositions;
+	}
+
+	uint8_t packedStateColor[4];
+	packColor( &( state->color ), packedStateColor );
+	int16_t layer = packLayer( state->textureLayer );
+
+	GLuint baseIdx;
+	Vertex* verts = reserveVertices( triList, vertexCount, &baseIdx );
+	for( int i = 0; i < vertexCount; ++i ) {
+		if( colors != NULL ) {
+			uint8_t packedColor[4];
+			packColor( &( colors[i] ), packedColor );
+			setVertex( &( verts[i] ), startPositions[i], endPositions[i], uvs[i], layer, packedColor, packedColor );
+		} else {
+			setVertex( &( verts[i] ), startPositions[i], endPositions[i], uvs[i], layer, packedStateColor, packedStateColor );
+		}
 	}
 
-	return ( tri1->scissorID - tri2->scissorID );
+	int triCount = indexCount / 3;
+	int firstIdx = triList->lastTriIndex + 1;
+	triList->lastTriIndex += triCount;
+
+	uint64_t key = createSortKey( triList, &drawState, false );
+	Triangle* tris = sb_Add( triList->sbTriangles, triCount );
+	RadixSortEntry* sortEntries = sb_Add( triList->sbSortEntries, triCount );
+	for( int i = 0; i < triCount; ++i ) {
+		tris[i].state = drawState;
+		for( int v = 0; v < 3; ++v ) {
+			assert( indices[( i * 3 ) + v] < vertexCount );
+			tris[i].vertexIndices[v] = baseIdx + indices[( i * 3 ) + v];
+		}
+
+		sortEntries[i].key = key;
+		sortEntries[i].value = (uint32_t)( firstIdx + i );
+	}
+
+	return 0;
 }
 
-static int sortByDepth( const void* p1, const void* p2 )
+/*
+Adds a sprite, a quad centered on the position that's offset and then scaled and rotated. The quad is built on the
+ GPU from the start and end states, uvMin is used for the corner at (-0.5,-0.5) and uvMax for the one at (0.5,0.5).
+ textureLayer is the layer to use if the texture is an array texture, otherwise it should be < 0.
+ Return a value < 0 if there's a problem.
+*/
+int triRenderer_AddSprite( const SpriteState* start, const SpriteState* end, Vector2 offset, Vector2 uvMin, Vector2 uvMax,
+	ShaderType shader, GLuint texture, int textureLayer, int clippingID, uint32_t camFlags, int8_t depth, int transparent )
 {
-	Triangle* tri1 = (Triangle*)p1;
-	Triangle* tri2 = (Triangle*)p2;
-	return ( ( ( tri1->zPos ) - ( tri2->zPos ) ) > 0.0f ) ? 1 : -1;
+	TriangleList* triList = transparent ? &transparentTriangles : &solidTriangles;
+
+	uint32_t idx = (uint32_t)sb_Count( triList->sbSprites );
+	Sprite* sprite = sb_Add( triList->sbSprites, 1 );
+	setDrawState( &( sprite->state ), texture, textureLayer, clippingID, camFlags, depth );
+
+	SpriteInstance* inst = &( sprite->instance );
+	inst->startPos = start->pos;
+	inst->endPos = end->pos;
+	inst->startScale = start->scaleSize;
+	inst->endScale = end->scaleSize;
+	inst->offset = offset;
+	inst->startRot = start->rotation;
+	inst->endRot = shortestEndRotation( start->rotation, end->rotation );
+	inst->z = 0.0f;
+	inst->layer = packLayer( textureLayer );
+	packSpriteUVsAndColors( inst, uvMin, uvMax, &( start->color ), &( end->color ) );
+
+	addSortEntry( triList, &( sprite->state ), idx, true );
+
+	return 0;
 }
 
-static void generateVertexArray( TriangleList* triList )
+/*
+Adds count sprites stored as separate arrays for each field, each one is the same as passing that index of every
+ array to triRenderer_AddSprite( ). The sprites are packed a few at a time, so this is quicker than adding them one
+ by one when there are a lot of them.
+ Return a value < 0 if there's a problem.
+*/
+int triRenderer_AddSprites( const SpriteArrays* sprites, int count )
 {
-	GL( glBindBuffer( GL_ARRAY_BUFFER, triList->VBO ) );
-	GL( glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( Vertex ) * ( ( triList->lastTriIndex + 1 ) * 3 ), triList->vertices ) );
+	TriangleList* packedLists[SPRITE_PACK_WIDTH];
+	uint32_t packedIdx[SPRITE_PACK_WIDTH];
+	float endRots[SPRITE_PACK_WIDTH];
+
+	for( int first = 0; first < count; first += SPRITE_PACK_WIDTH ) {
+		int packCount = MIN( SPRITE_PACK_WIDTH, count - first );
+
+		// the sorting and batching still has to be done for each sprite, the lists can grow while they're being added
+		//  so they're only looked up by index
+		for( int i = 0; i < packCount; ++i ) {
+			int s = first + i;
+			TriangleList* triList = sprites->transparent[s] ? &transparentTriangles : &solidTriangles;
+
+			uint32_t idx = (uint32_t)sb_Count( triList->sbSprites );
+			Sprite* sprite = sb_Add( triList->sbSprites, 1 );
+			setDrawState( &( sprite->state ), sprites->texture[s], sprites->textureLayer[s], sprites->clippingID[s],
+				sprites->camFlags[s], sprites->depth[s] );
+			addSortEntry( triList, &( sprite->state ), idx, true );
+			packedLists[i] = triList;
+			packedIdx[i] = idx;
+		}
+
+		if( packCount == SPRITE_PACK_WIDTH ) {
+			shortestEndRotations( &( sprites->startRot[first] ), &( sprites->endRot[first] ), endRots );
+		} else {
+			for( int i = 0; i < packCount; ++i ) {
+				endRots[i] = shortestEndRotation( sprites->startRot[first + i], sprites->endRot[first + i] );
+			}
+		}
+
+		for( int i = 0; i < packCount; ++i ) {
+			int s = first + i;
+			SpriteInstance* inst = &( packedLists[i]->sbSprites[packedIdx[i]].instance );
+			inst->startPos = sprites->startPos[s];
+			inst->endPos = sprites->endPos[s];
+			inst->startScale = sprites->startScale[s];
+			inst->endScale = sprites->endScale[s];
+			inst->offset = sprites->offset[s];
+			inst->startRot = sprites->startRot[s];
+			inst->endRot = endRots[i];
+			inst->z = 0.0f;
+			inst->layer = packLayer( sprites->textureLayer[s] );
+			packSpriteUVsAndColors( inst, sprites->uvMin[s], sprites->uvMax[s], &( sprites->startColor[s] ), &( sprites->endColor[s] ) );
+		}
+	}
+
+	return 0;
 }
 
-static void setScissor( int area )
+/*
+Creates a group of sprites that stays on the GPU between uploads instead of having to be added again after every
+ clear. Every sprite in the group is drawn with the same texture, cameras, depth, and blending, they can't be
+ clipped, and they're drawn behind anything else at the same depth. The group starts out empty.
+ Returns the id of the group, or a value < 0 if there's a problem.
+*/
+int triRenderer_CreateSpriteGroup( GLuint texture, bool textureArray, uint32_t camFlags, int8_t depth, int transparent )
 {
-	GLint x;
-	GLint y;
-	GLsizei w;
-	GLsizei h;
+	int idx;
+	for( idx = 0; ( idx < (int)sb_Count( sbSpriteGroups ) ) && sbSpriteGroups[idx].inUse; ++idx ) ;
+	if( idx >= (int)sb_Count( sbSpriteGroups ) ) {
+		SpriteGroup* newGroup = sb_Add( sbSpriteGroups, 1 );
+		memset( newGroup, 0, sizeof( *newGroup ) );
+	}
 
-	scissor_GetScissorAreaGL( area, &x, &y, &w, &h );
-	GL( glScissor( x, y, w, h ) );
+	SpriteGroup* group = &( sbSpriteGroups[idx] );
+	GL( glGenBuffers( 1, &( group->buffer ) ) );
+	if( group->buffer == 0 ) {
+		llog( LOG_ERROR, "Unable to create buffer for sprite group." );
+		return -1;
+	}
+
+	group->inUse = true;
+	group->texture = texture;
+	group->textureArray = textureArray;
+	group->camFlags = camFlags;
+	group->depth = depth;
+	group->transparent = ( transparent != 0 );
+	group->count = 0;
+	group->bufferCapacity = 0;
+	++group->version;
+	sb_Clear( group->sbDirtyRanges );
+
+	return idx;
 }
 
-static void drawTriangles( uint32_t currCamera, TriangleList* triList )
+static SpriteGroup* getSpriteGroup( int group )
 {
-	// create the index buffers to access the vertex buffer
-	//  TODO: Test to see if having the index buffer or the vertex buffer in order is faster
-	GLuint lastBoundTexture = 0;
-	int triIdx = 0;
-	ShaderType lastBoundShader = NUM_SHADERS;
-	Matrix4 vpMat;
-	uint32_t camFlags = 0;
-	int lastSetClippingArea = -1;
-
-	// we'll only be accessing the one vertex array
-	GL( glBindVertexArray( triList->VAO ) );
+	if( ( group < 0 ) || ( group >= (int)sb_Count( sbSpriteGroups ) ) || !sbSpriteGroups[group].inUse ) {
+		return NULL;
+	}
+	return &( sbSpriteGroups[group] );
+}
 
-	do {
-		GLuint texture = triList->triangles[triIdx].texture;
-		triList->lastIndexBufferIndex = -1;
+/*
+Releases the group and the buffer it was using.
+*/
+void triRenderer_DestroySpriteGroup( int group )
+{
+	SpriteGroup* spriteGroup = getSpriteGroup( group );
+	if( spriteGroup == NULL ) {
+		return;
+	}
 
-		if( ( triIdx <= triList->lastTriIndex ) && ( triList->triangles[triIdx].shaderType != lastBoundShader ) ) {
-			// next shader, bind and set up
-			lastBoundShader = triList->triangles[triIdx].shaderType;
+	GL( glDeleteBuffers( 1, &( spriteGroup->buffer ) ) );
+	spriteGroup->buffer = 0;
+	spriteGroup->bufferCapacity = 0;
+	spriteGroup->count = 0;
+	spriteGroup->inUse = false;
+	sb_Clear( spriteGroup->sbDirtyRanges );
+}
 
-			camFlags = cam_GetFlags( currCamera );
-			cam_GetVPMatrix( currCamera, &vpMat );
+/*
+Sets how many sprites are in the group, the sprites are in the slots from 0 up to count. Any new slots have to be set
+ before the next upload.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_SetSpriteGroupCount( int group, int count )
+{
+	SpriteGroup* spriteGroup = getSpriteGroup( group );
+	if( ( spriteGroup == NULL ) || ( count < 0 ) ) {
+		return -1;
+	}
 
-			GL( glUseProgram( shaderPrograms[lastBoundShader].programID ) );
-			GL( glUniformMatrix4fv( shaderPrograms[lastBoundShader].uniformLocs[0], 1, GL_FALSE, &( vpMat.m[0] ) ) );
-			GL( glUniform1i( shaderPrograms[lastBoundShader].uniformLocs[1], 0 ) );
+	if( count > spriteGroup->capacity ) {
+		int newCapacity = MAX( count, spriteGroup->capacity + ( spriteGroup->capacity / 2 ) + 1 );
+		SpriteInstance* grown = mem_Resize( spriteGroup->instances, sizeof( SpriteInstance ) * newCapacity );
+		if( grown == NULL ) {
+			llog( LOG_ERROR, "Unable to grow sprite group." );
+			return -1;
 		}
+		spriteGroup->instances = grown;
+		spriteGroup->capacity = newCapacity;
+	}
 
-		if( ( triIdx <= triList->lastTriIndex ) && ( triList->triangles[triIdx].scissorID != lastSetClippingArea ) ) {
-			lastSetClippingArea = triList->triangles[triIdx].scissorID;
-			setScissor( lastSetClippingArea );
-		}
+	spriteGroup->count = count;
+	++spriteGroup->version;
+	return 0;
+}
 
-		int triCount = 0;
-		// gather the list of all the triangles to be drawn
-		while( ( triIdx <= triList->lastTriIndex ) &&
-				( triList->triangles[triIdx].texture == texture ) &&
-				( triList->triangles[triIdx].shaderType == lastBoundShader ) &&
-				( triList->triangles[triIdx].scissorID == lastSetClippingArea ) ) {
-			if( ( triList->triangles[triIdx].camFlags & camFlags ) != 0 ) {
-				triList->indices[++triList->lastIndexBufferIndex] = triList->triangles[triIdx].vertexIndices[0];
-				triList->indices[++triList->lastIndexBufferIndex] = triList->triangles[triIdx].vertexIndices[1];
-				triList->indices[++triList->lastIndexBufferIndex] = triList->triangles[triIdx].vertexIndices[2];
-			}
-			++triIdx;
-			++triCount;
+// adds the slot to the dirty ranges, sprites tend to be changed in order so usually the last range can be extended
+static void markGroupSlotDirty( SpriteGroup* group, int slot )
+{
+	if( sb_Count( group->sbDirtyRanges ) > 0 ) {
+		DirtyRange* last = &sb_Last( group->sbDirtyRanges );
+		if( ( slot >= last->first ) && ( slot < ( last->first + last->count ) ) ) {
+			return;
 		}
 
-		// send the indices of the vertex array to draw, if there is any
-		if( triList->lastIndexBufferIndex < 0 ) {
-			continue;
+		if( slot == ( last->first + last->count ) ) {
+			++last->count;
+			return;
 		}
-		GL( glBindTexture( GL_TEXTURE_2D, texture ) );
-		GL( glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, sizeof( GLuint ) * ( triList->lastIndexBufferIndex + 1 ), triList->indices ) );
-		GL( glDrawElements( GL_TRIANGLES, triList->lastIndexBufferIndex + 1, GL_UNSIGNED_INT, NULL ) );
-	} while( triIdx <= triList->lastTriIndex );
-}
 
-static void lerpVertices( TriangleList* triList, float t )
-{
-	for( int i = 0; i < triList->lastTriIndex; ++i ) {
-		int baseIdx = i * 3;
-		for( int s = 0; s < 3; ++i ) {
-			triList->vertices[baseIdx+s].uv = triList->startVertices[baseIdx+s].uv;
-			vec3_Lerp( &( triList->startVertices[baseIdx+s].pos ), &( triList->endVertices[baseIdx+s].pos ), t, &( triList->vertices[baseIdx+s].pos ) );
-			clr_Lerp( &( triList->startVertices[baseIdx+s].col ), &( triList->endVertices[baseIdx+s].col ), t, &( triList->vertices[baseIdx+s].col ) );
+		if( slot == ( last->first - 1 ) ) {
+			--last->first;
+			++last->count;
+			return;
 		}
 	}
+
+	DirtyRange* range = sb_Add( group->sbDirtyRanges, 1 );
+	range->first = slot;
+	range->count = 1;
 }
 
 /*
-Draws out all the triangles.
+Sets the sprite in a slot of the group, the arguments are the same as for triRenderer_AddSprite( ). The slot is sent
+ to the GPU at the next upload, along with any other slots that were changed.
+ Returns a value < 0 if there's a problem.
 */
-void triRenderer_Render( )
+int triRenderer_SetGroupSprite( int group, int slot, const SpriteState* start, const SpriteState* end, Vector2 offset,
+	Vector2 uvMin, Vector2 uvMax, int textureLayer )
 {
-	// SDL_qsort appears to break some times, so fall back onto the standard library qsort for right now, and implement our own when we have time
-	qsort( solidTriangles.triangles, solidTriangles.lastTriIndex + 1, sizeof( Triangle ), sortByRenderState );
-	qsort( transparentTriangles.triangles, transparentTriangles.lastTriIndex + 1, sizeof( Triangle ), sortByDepth );
+	SpriteGroup* spriteGroup = getSpriteGroup( group );
+	if( ( spriteGroup == NULL ) || ( slot < 0 ) || ( slot >= spriteGroup->count ) ) {
+		return -1;
+	}
 
-	// now that the triangles have been sorted create the vertex arrays
-	generateVertexArray( &solidTriangles );
-	generateVertexArray( &transparentTriangles );
+	SpriteInstance* inst = &( spriteGroup->instances[slot] );
+	inst->startPos = start->pos;
+	inst->endPos = end->pos;
+	inst->startScale = start->scaleSize;
+	inst->endScale = end->scaleSize;
+	inst->offset = offset;
+	inst->startRot = start->rotation;
+	inst->endRot = shortestEndRotation( start->rotation, end->rotation );
+	inst->z = (float)spriteGroup->depth;
+	inst->layer = packLayer( textureLayer );
+	packSpriteUVsAndColors( inst, uvMin, uvMax, &( start->color ), &( end->color ) );
+
+	markGroupSlotDirty( spriteGroup, slot );
+	++spriteGroup->version;
 
-	GL( glDisable( GL_CULL_FACE ) );
-	GL( glEnable( GL_DEPTH_TEST ) );
-	GL( glEnable( GL_SCISSOR_TEST ) );
-	GL( glDepthMask( GL_TRUE ) );
-	GL( glDepthFunc( GL_LESS ) );
+	return 0;
+}
 
-	// render triangles
-	// TODO: We're ignoring any issues with cameras and transparency, probably want to handle this better.
-	for( int currCamera = cam_StartIteration( ); currCamera != -1; currCamera = cam_GetNextActiveCam( ) ) {
-		setScissor( 0 ); // set to the default scissor area for clearing
-		GL( glClear( GL_DEPTH_BUFFER_BIT ) );
+/*
+Creates a chunk of tiles that stays on the GPU between uploads and is drawn with one call. Every tile in the chunk
+ uses the same texture, cameras, and depth, and the cells are tileSize apart with the first one's corner at the
+ origin. The chunks are drawn in depth order before anything else, so partly transparent tiles only blend with the
+ chunks behind them. The chunk starts out empty.
+ Returns the id of the chunk, or a value < 0 if there's a problem.
+*/
+int triRenderer_CreateTileChunk( GLuint texture, bool textureArray, uint32_t camFlags, int8_t depth, Vector2 origin, Vector2 tileSize )
+{
+	int idx;
+	for( idx = 0; ( idx < (int)sb_Count( sbTileChunks ) ) && sbTileChunks[idx].inUse; ++idx ) ;
+	if( idx >= (int)sb_Count( sbTileChunks ) ) {
+		TileChunk* newChunk = sb_Add( sbTileChunks, 1 );
+		memset( newChunk, 0, sizeof( *newChunk ) );
+	}
+
+	TileChunk* chunk = &( sbTileChunks[idx] );
+	GL( glGenBuffers( 1, &( chunk->buffer ) ) );
+	if( chunk->buffer == 0 ) {
+		llog( LOG_ERROR, "Unable to create buffer for tile chunk." );
+		return -1;
+	}
 
-		GL( glDisable( GL_BLEND ) );
-		drawTriangles( currCamera, &solidTriangles );
+	chunk->inUse = true;
+	chunk->texture = texture;
+	chunk->textureArray = textureArray;
+	chunk->camFlags = camFlags;
+	chunk->depth = depth;
+	chunk->origin = origin;
+	chunk->tileSize = tileSize;
+	chunk->count = 0;
+	chunk->dirty = false;
+	chunk->boundsMin = origin;
+	chunk->boundsMax = origin;
+	chunk->bufferCapacity = 0;
+	chunk->uploadedCount = 0;
+	++chunk->version;
+
+	return idx;
+}
 
-		GL( glEnable( GL_BLEND ) );
-		GL( glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA ) );
-		drawTriangles( currCamera, &transparentTriangles );
+static TileChunk* getTileChunk( int chunk )
+{
+	if( ( chunk < 0 ) || ( chunk >= (int)sb_Count( sbTileChunks ) ) || !sbTileChunks[chunk].inUse ) {
+		return NULL;
 	}
+	return &( sbTileChunks[chunk] );
+}
 
-	GL( glDisable( GL_SCISSOR_TEST ) );
-	GL( glBindVertexArray( 0 ) );
-	GL( glUseProgram( 0 ) );
-}
\ No newline at end of file
+/*
+Releases the chunk and the buffer it was using.
+*/
+void triRenderer_DestroyTileChunk( int chunk )
+{
+	TileChunk* tileChunk = getTileChunk( chunk );
+	if( tileChunk == NULL ) {
+		return;
+	}
+
+	GL( glDeleteBuffers( 1, &( tileChunk->buffer ) ) );
+	tileChunk->buffer = 0;
+	tileChunk->bufferCapacity = 0;
+	tileChunk->uploadedCount = 0;
+	tileChunk->count = 0;
+	tileChunk->dirty = false;
+	tileChunk->inUse = false;
+	sb_Release( tileChunk->sbPendingTiles );
+}
+
+static int16_t packTileCorner( float corner )
+{
+	return (int16_t)clamp( (float)INT16_MIN, (float)INT16_MAX, roundf( corner ) );
+}
+
+/*
+Replaces all the tiles in the chunk, the whole chunk is sent to the GPU at the next upload. There can't be more than
+ 65535 columns or rows in a chunk.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_SetTileChunkTiles( int chunk, const ChunkTile* tiles, int count )
+{
+	TileChunk* tileChunk = getTileChunk( chunk );
+	if( ( tileChunk == NULL ) || ( count < 0 ) || ( ( count > 0 ) && ( tiles == NULL ) ) ) {
+		return -1;
+	}
+
+	sb_Clear( tileChunk->sbPendingTiles );
+	TileInstance* instances = sb_Add( tileChunk->sbPendingTiles, count );
+
+	Vector2 boundsMin = tileChunk->origin;
+	Vector2 boundsMax = tileChunk->origin;
+	for( int i = 0; i < count; ++i ) {
+		const ChunkTile* tile = &( tiles[i] );
+		if( ( tile->column < 0 ) || ( tile->column > UINT16_MAX ) || ( tile->row < 0 ) || ( tile->row > UINT16_MAX ) ) {
+			llog( LOG_ERROR, "Tile cell outside of what a chunk can hold." );
+			sb_Clear( tileChunk->sbPendingTiles );
+			return -1;
+		}
+
+		TileInstance* inst = &( instances[i] );
+		inst->cell[0] = (uint16_t)tile->column;
+		inst->cell[1] = (uint16_t)tile->row;
+		inst->rect[0] = packTileCorner( tile->min.x );
+		inst->rect[1] = packTileCorner( tile->min.y );
+		inst->rect[2] = packTileCorner( tile->max.x );
+		inst->rect[3] = packTileCorner( tile->max.y );
+		inst->uvRect[0] = packUV( tile->uvMin.x );
+		inst->uvRect[1] = packUV( tile->uvMin.y );
+		inst->uvRect[2] = packUV( tile->uvMax.x );
+		inst->uvRect[3] = packUV( tile->uvMax.y );
+		inst->layer = packLayer( tile->textureLayer );
+		inst->padding = 0;
+
+		Vector2 center;
+		center.x = tileChunk->origin.x + ( ( (float)tile->column + 0.5f ) * tileChunk->tileSize.x );
+		center.y = tileChunk->origin.y + ( ( (float)tile->row + 0.5f ) * tileChunk->tileSize.y );
+		if( i == 0 ) {
+			boundsMin = center;
+			boundsMax = center;
+		}
+		boundsMin.x = MIN( boundsMin.x, center.x + MIN( inst->rect[0], inst->rect[2] ) );
+		boundsMin.y = MIN( boundsMin.y, center.y + MIN( inst->rect[1], inst->rect[3] ) );
+		boundsMax.x = MAX( boundsMax.x, center.x + MAX( inst->rect[0], inst->rect[2] ) );
+		boundsMax.y = MAX( boundsMax.y, center.y + MAX( inst->rect[1], inst->rect[3] ) );
+	}
+
+	tileChunk->count = count;
+	tileChunk->boundsMin = boundsMin;
+	tileChunk->boundsMax = boundsMax;
+	tileChunk->dirty = true;
+	++tileChunk->version;
+
+	return 0;
+}
+
+static void clearTriList( TriangleList* triList )
+{
+	triList->lastTriIndex = -1;
+	sb_Clear( triList->sbTriangles );
+	sb_Clear( triList->sbVertices );
+	sb_Clear( triList->sbSprites );
+	sb_Clear( triList->sbSortEntries );
+}
+
+/*
+Clears out all the triangles currently stored.
+*/
+void triRenderer_Clear( void )
+{
+	clearTriList( &transparentTriangles );
+	clearTriList( &solidTriangles );
+	nextSequence = 0;
+	captureLoaded = false;
+}
+
+/*
+Gets how many bytes of vertex and index data were sent to the GPU for the last rendered frame, frames that only
+ redraw what was already uploaded won't have sent anything. Sprite instances are counted as vertex data. Either of
+ the out parameters can be NULL.
+*/
+void triRenderer_GetLastUploadStats( int* outVertexBytes, int* outIndexBytes )
+{
+	if( outVertexBytes != NULL ) (*outVertexBytes) = lastUploadedVertexBytes;
+	if( outIndexBytes != NULL ) (*outIndexBytes) = lastUploadedIndexBytes;
+}
+
+/*
+Gets the number of triangles that were in the last rendered frame, the most triangles there have been in a single
+ frame, and how many triangles the lists have space for before they have to grow. Each sprite and tile counts as
+ two triangles. Any of the out parameters can be NULL.
+*/
+void triRenderer_GetLastRenderStats( int* outRendered, int* outPeak, int* outCapacity )
+{
+	if( outRendered != NULL ) (*outRendered) = lastRenderTriangles;
+	if( outPeak != NULL ) (*outPeak) = peakTriangles;
+	if( outCapacity != NULL ) {
+		(*outCapacity) = (int)( sb_Reserved( solidTriangles.sbTriangles ) + sb_Reserved( transparentTriangles.sbTriangles ) +
+			( 2 * ( sb_Reserved( solidTriangles.sbSprites ) + sb_Reserved( transparentTriangles.sbSprites ) ) ) );
+	}
+}
+
+/*
+Gets how many draw calls were issued for the last rendered frame and how many times the shader program had to be
+ changed for them. Either of the out parameters can be NULL.
+*/
+void triRenderer_GetLastDrawStats( int* outDrawCalls, int* outProgramBinds )
+{
+	if( outDrawCalls != NULL ) (*outDrawCalls) = lastDrawCalls;
+	if( outProgramBinds != NULL ) (*outProgramBinds) = lastProgramBinds;
+}
+
+/*
+Gets how many sprites were in sprite groups for the last rendered frame, and how many ranges of them had to be sent
+ to the GPU because they changed. Either of the out parameters can be NULL.
+*/
+void triRenderer_GetLastSpriteGroupStats( int* outSprites, int* outRangesSent )
+{
+	if( outSprites != NULL ) (*outSprites) = lastGroupSprites;
+	if( outRangesSent != NULL ) (*outRangesSent) = lastGroupRangesSent;
+}
+
+/*
+Gets how many tile chunks had tiles in them for the last rendered frame, how many of those any of the cameras could
+ see, and how many had to be sent to the GPU because they changed. Any of the out parameters can be NULL.
+*/
+void triRenderer_GetLastTileChunkStats( int* outChunks, int* outVisible, int* outSent )
+{
+	if( outChunks != NULL ) (*outChunks) = lastTileChunks;
+	if( outVisible != NULL ) (*outVisible) = lastVisibleTileChunks;
+	if( outSent != NULL ) (*outSent) = lastTileChunksSent;
+}
+
+/*
+Gets how long the stages of building the last set of batches took on the CPU: sorting, filling in the depths and
+ sending the vertices, splitting what the cameras can see out of the sorted order, gathering that into batches and
+ indices, and sending the indices and sprite instances. Any of the out parameters can be NULL.
+*/
+void triRenderer_GetLastUploadTimings( float* outSortMS, float* outVertexMS, float* outOrderMS, float* outBatchMS, float* outSendMS )
+{
+	if( outSortMS != NULL ) (*outSortMS) = lastSortMS;
+	if( outVertexMS != NULL ) (*outVertexMS) = lastVertexMS;
+	if( outOrderMS != NULL ) (*outOrderMS) = lastOrderMS;
+	if( outBatchMS != NULL ) (*outBatchMS) = lastBatchMS;
+	if( outSendMS != NULL ) (*outSendMS) = lastSendMS;
+}
+
+static float msSince( Uint64 start )
+{
+	return (float)( ( (double)( SDL_GetPerformanceCounter( ) - start ) * 1000.0 ) / (double)SDL_GetPerformanceFrequency( ) );
+}
+
+static void sortTriangles( TriangleList* triList )
+{
+	size_t count = sb_Count( triList->sbSortEntries );
+	sb_Clear( triList->sbSortScratch );
+	sb_Add( triList->sbSortScratch, count );
+	triList->sortedTris = radix_Sort( triList->sbSortEntries, triList->sbSortScratch, count );
+}
+
+static void uploadVertices( TriangleList* triList, float zOrderOffset )
+{
+	// the triangles with the same depth are spread out between it and the next depth in the order they were added
+	for( int i = 0; i <= triList->lastTriIndex; ++i ) {
+		Triangle* tri = &( triList->sbTriangles[i] );
+		float z = (float)tri->state.depth + ( zOrderOffset * (float)tri->state.sequence );
+		for( int v = 0; v < 3; ++v ) {
+			triList->sbVertices[tri->vertexIndices[v]].z = z;
+		}
+	}
+
+	// the sprites are sent along with the indices since they have to be put in draw order
+	for( size_t i = 0; i < sb_Count( triList->sbSprites ); ++i ) {
+		Sprite* sprite = &( triList->sbSprites[i] );
+		sprite->instance.z = (float)sprite->state.depth + ( zOrderOffset * (float)sprite->state.sequence );
+	}
+
+	size_t vertexDataSize = sizeof( Vertex ) * sb_Count( triList->sbVertices );
+	glState_BindVertexArray( triList->VAO );
+	GL( glBindBuffer( GL_ARRAY_BUFFER, triList->vertexStream.buffer ) );
+	triList->vertexOffset = streamBuffer_Write( &( triList->vertexStream ), triList->sbVertices, vertexDataSize );
+	bindVertexPage( triList, 0 );
+	frameVertexBytes += (int)vertexDataSize;
+}
+
+static int compareDirtyRanges( const void* left, const void* right )
+{
+	return ( ( (const DirtyRange*)left )->first - ( (const DirtyRange*)right )->first );
+}
+
+/*
+Sends the changed parts of a group to the GPU. The dirty ranges are sorted and any that overlap or are close to each
+ other are merged, so each call sends as much as it can. If the buffer has to grow the whole group is sent.
+*/
+static void uploadSpriteGroup( SpriteGroup* group )
+{
+	GL( glBindBuffer( GL_ARRAY_BUFFER, group->buffer ) );
+
+	if( group->count > group->bufferCapacity ) {
+		group->bufferCapacity = MAX( group->count, group->bufferCapacity * 2 );
+		GL( glBufferData( GL_ARRAY_BUFFER, sizeof( SpriteInstance ) * group->bufferCapacity, NULL, GL_DYNAMIC_DRAW ) );
+
+		sb_Clear( group->sbDirtyRanges );
+		DirtyRange* all = sb_Add( group->sbDirtyRanges, 1 );
+		all->first = 0;
+		all->count = group->count;
+	}
+
+	int numRanges = (int)sb_Count( group->sbDirtyRanges );
+	if( numRanges > 1 ) {
+		qsort( group->sbDirtyRanges, numRanges, sizeof( DirtyRange ), compareDirtyRanges );
+	}
+
+	int i = 0;
+	while( i < numRanges ) {
+		int first = group->sbDirtyRanges[i].first;
+		int end = first + group->sbDirtyRanges[i].count;
+		for( ++i; ( i < numRanges ) && ( group->sbDirtyRanges[i].first <= ( end + DIRTY_RANGE_MERGE_GAP ) ); ++i ) {
+			end = MAX( end, group->sbDirtyRanges[i].first + group->sbDirtyRanges[i].count );
+		}
+
+		// anything past the end of the group was removed after it was set
+		end = MIN( end, group->count );
+		if( end <= first ) {
+			continue;
+		}
+
+		size_t dataSize = sizeof( SpriteInstance ) * ( end - first );
+		GL( glBufferSubData( GL_ARRAY_BUFFER, (GLintptr)( sizeof( SpriteInstance ) * first ), dataSize, &( group->instances[first] ) ) );
+		frameVertexBytes += (int)dataSize;
+		++frameGroupRangesSent;
+	}
+
+	sb_Clear( group->sbDirtyRanges );
+}
+
+/*
+Sends the changes for all the sprite groups to the GPU, and works out what order the transparent groups will be drawn
+ in. Returns how many sprites are in groups.
+*/
+static int uploadSpriteGroups( void )
+{
+	int numSprites = 0;
+
+	sb_Clear( sbTransparentGroupOrder );
+	memset( transparentGroupDepths, 0, sizeof( transparentGroupDepths ) );
+
+	for( int i = 0; i < (int)sb_Count( sbSpriteGroups ); ++i ) {
+		SpriteGroup* group = &( sbSpriteGroups[i] );
+		if( !group->inUse || ( group->count <= 0 ) ) {
+			continue;
+		}
+
+		uploadSpriteGroup( group );
+		numSprites += group->count;
+
+		if( group->transparent ) {
+			// there's only ever a handful of groups so a simple insertion keeps them in depth order
+			int at = (int)sb_Count( sbTransparentGroupOrder );
+			while( ( at > 0 ) && ( sbSpriteGroups[sbTransparentGroupOrder[at - 1]].depth > group->depth ) ) {
+				--at;
+			}
+			sb_Insert( sbTransparentGroupOrder, at, i );
+			transparentGroupDepths[group->depth + 128] = true;
+		}
+	}
+
+	GL( glBindBuffer( GL_ARRAY_BUFFER, 0 ) );
+
+	return numSprites;
+}
+
+// the whole chunk is sent, the buffer is only reallocated if it has to grow
+static void uploadTileChunk( TileChunk* chunk )
+{
+	size_t dataSize = sizeof( TileInstance ) * chunk->count;
+	if( dataSize > 0 ) {
+		GL( glBindBuffer( GL_ARRAY_BUFFER, chunk->buffer ) );
+		if( chunk->count > chunk->bufferCapacity ) {
+			chunk->bufferCapacity = chunk->count;
+			GL( glBufferData( GL_ARRAY_BUFFER, dataSize, chunk->sbPendingTiles, GL_STATIC_DRAW ) );
+		} else {
+			GL( glBufferSubData( GL_ARRAY_BUFFER, 0, dataSize, chunk->sbPendingTiles ) );
+		}
+		frameVertexBytes += (int)dataSize;
+		++frameTileChunksSent;
+	}
+
+	// the tiles are only needed again if the chunk changes, and then they're all replaced
+	sb_Release( chunk->sbPendingTiles );
+	chunk->uploadedCount = chunk->count;
+	chunk->dirty = false;
+}
+
+/*
+Sends any tile chunks that changed to the GPU, and works out which chunks can be seen and what order they'll be drawn
+ in. Returns how many tiles are in chunks.
+*/
+static int uploadTileChunks( void )
+{
+	int numTiles = 0;
+
+	sb_Clear( sbTileChunkOrder );
+	lastTileChunks = 0;
+
+	for( int i = 0; i < (int)sb_Count( sbTileChunks ); ++i ) {
+		TileChunk* chunk = &( sbTileChunks[i] );
+		if( !chunk->inUse ) {
+			continue;
+		}
+
+		if( chunk->dirty ) {
+			uploadTileChunk( chunk );
+		}
+
+		if( chunk->uploadedCount <= 0 ) {
+			continue;
+		}
+
+		numTiles += chunk->uploadedCount;
+		++lastTileChunks;
+
+		if( !cam_IsRenderAreaVisible( chunk->camFlags, chunk->boundsMin, chunk->boundsMax, chunk->boundsMin, chunk->boundsMax ) ) {
+			continue;
+		}
+
+		// the chunks in a map all share a depth, so this almost never has to move anything
+		int at = (int)sb_Count( sbTileChunkOrder );
+		while( ( at > 0 ) && ( sbTileChunks[sbTileChunkOrder[at - 1]].depth > chunk->depth ) ) {
+			--at;
+		}
+		sb_Insert( sbTileChunkOrder, at, i );
+	}
+
+	GL( glBindBuffer( GL_ARRAY_BUFFER, 0 ) );
+
+	lastVisibleTileChunks = (int)sb_Count( sbTileChunkOrder );
+
+	return numTiles;
+}
+
+// if there's a transparent group with a depth after the first depth and up to the second
+static bool transparentGroupBetween( int8_t after, int8_t upTo )
+{
+	for( int depth = after + 1; depth <= upTo; ++depth ) {
+		if( transparentGroupDepths[depth + 128] ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// while only part of a cached layer is being drawn again everything is kept inside that part
+static bool scissorLimited = false;
+static GLint scissorLimit[4];
+
+static void setScissor( int area )
+{
+	GLint x;
+	GLint y;
+	GLsizei w;
+	GLsizei h;
+
+	scissor_GetScissorAreaGL( area, &x, &y, &w, &h );
+	if( scissorLimited ) {
+		GLint x1 = MIN( x + w, scissorLimit[0] + scissorLimit[2] );
+		GLint y1 = MIN( y + h, scissorLimit[1] + scissorLimit[3] );
+		x = MAX( x, scissorLimit[0] );
+		y = MAX( y, scissorLimit[1] );
+		w = MAX( 0, x1 - x );
+		h = MAX( 0, y1 - y );
+	}
+	GL( glScissor( x, y, w, h ) );
+}
+
+static int findBucket( uint32_t camFlags, int page, int lastBucket )
+{
+	// there's usually only a handful of different camera flags in use, and neighboring triangles tend to share them
+	if( ( lastBucket >= 0 ) && ( sbBuckets[lastBucket].camFlags == camFlags ) && ( sbBuckets[lastBucket].page == page ) ) {
+		return lastBucket;
+	}
+
+	for( size_t i = 0; i < sb_Count( sbBuckets ); ++i ) {
+		if( ( sbBuckets[i].camFlags == camFlags ) && ( sbBuckets[i].page == page ) ) {
+			return (int)i;
+		}
+	}
+
+	VisibilityBucket* newBucket = sb_Add( sbBuckets, 1 );
+	newBucket->camFlags = camFlags;
+	newBucket->page = page;
+	newBucket->triCount = 0;
+	newBucket->nextSlot = 0;
+	return (int)( sb_Count( sbBuckets ) - 1 );
+}
+
+/*
+Solid triangles can be drawn in any order, so they're grouped by which cameras can see them. Within each group they
+ stay in the order they were sorted in so the batches stay as large as possible.
+*/
+static void bucketSolidTriangles( TriangleList* triList, uint32_t visibleFlags )
+{
+	int numEntries = (int)sb_Count( triList->sbSortEntries );
+	int lastBucket = -1;
+	int numVisible = 0;
+
+	sb_Clear( sbBuckets );
+	sb_Clear( sbTriBuckets );
+	sb_Add( sbTriBuckets, numEntries );
+	for( int i = 0; i < numEntries; ++i ) {
+		uint32_t entry = triList->sortedTris[i].value;
+		DrawState* state = getEntryState( triList, entry );
+		if( ( state->camFlags & visibleFlags ) == 0 ) {
+			sbTriBuckets[i] = -1;
+			continue;
+		}
+
+		lastBucket = findBucket( state->camFlags, getEntryPage( triList, entry ), lastBucket );
+		sbTriBuckets[i] = lastBucket;
+		++sbBuckets[lastBucket].triCount;
+		++numVisible;
+	}
+
+	int slot = 0;
+	for( size_t i = 0; i < sb_Count( sbBuckets ); ++i ) {
+		sbBuckets[i].nextSlot = slot;
+		slot += sbBuckets[i].triCount;
+	}
+
+	sb_Clear( triList->sbDrawOrder );
+	sb_Add( triList->sbDrawOrder, numVisible );
+	for( int i = 0; i < numEntries; ++i ) {
+		if( sbTriBuckets[i] >= 0 ) {
+			triList->sbDrawOrder[sbBuckets[sbTriBuckets[i]].nextSlot++] = triList->sortedTris[i].value;
+		}
+	}
+}
+
+/*
+Transparent triangles have to be drawn in the order they were sorted in, so we just drop the ones no one can see.
+*/
+static void orderTransparentTriangles( TriangleList* triList, uint32_t visibleFlags )
+{
+	sb_Clear( triList->sbDrawOrder );
+	for( size_t i = 0; i < sb_Count( triList->sbSortEntries ); ++i ) {
+		uint32_t entry = triList->sortedTris[i].value;
+		if( ( getEntryState( triList, entry )->camFlags & visibleFlags ) != 0 ) {
+			sb_Push( triList->sbDrawOrder, entry );
+		}
+	}
+}
+
+// if the state's texture can be bound alongside the textures the batch is already using
+static bool textureFitsBatch( const DrawState* state, const DrawBatch* batch )
+{
+	GLuint batchTexture = state->textureArray ? batch->arrayTexture : batch->texture;
+	return ( ( batchTexture == 0 ) || ( batchTexture == state->texture ) );
+}
+
+// returns if the entry can't be added to the batch, and why
+static bool breaksBatch( const DrawBatch* batch, const DrawState* state, bool instanced, int page, bool crossesGroup, BatchBreak* outReason )
+{
+	if( state->camFlags != batch->camFlags ) {
+		(*outReason) = BB_CAMERA;
+	} else if( instanced != batch->instanced ) {
+		(*outReason) = BB_SHADER;
+	} else if( !textureFitsBatch( state, batch ) ) {
+		(*outReason) = BB_TEXTURE;
+	} else if( state->scissorID != batch->scissorID ) {
+		(*outReason) = BB_SCISSOR;
+	} else if( crossesGroup || ( page != batch->page ) ) {
+		(*outReason) = BB_ORDER;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/*
+Adds the indices of all the triangles and the instances of all the sprites in the draw order to the frame's buffers,
+ grouping them into batches that can be drawn by the same cameras without changing any state. Transparent batches
+ are also split wherever a transparent sprite group has to be drawn between them.
+*/
+static void gatherBatches( TriangleList* triList )
+{
+	DrawBatch* currBatch = NULL;
+	int8_t lastDepth = INT8_MIN;
+
+	triList->firstBatch = (int)sb_Count( sbDrawBatches );
+	triList->batchCount = 0;
+
+	for( size_t i = 0; i < sb_Count( triList->sbDrawOrder ); ++i ) {
+		uint32_t entry = triList->sbDrawOrder[i];
+		DrawState* state = getEntryState( triList, entry );
+		bool instanced = ( entry & SPRITE_ENTRY ) != 0;
+		int page = getEntryPage( triList, entry );
+		bool crossesGroup = triList->sortByDepth && transparentGroupBetween( lastDepth, state->depth );
+		lastDepth = state->depth;
+
+		BatchBreak breakReason = BB_ORDER;
+		if( ( currBatch == NULL ) || breaksBatch( currBatch, state, instanced, page, crossesGroup, &breakReason ) ) {
+			currBatch = sb_Add( sbDrawBatches, 1 );
+			currBatch->texture = 0;
+			currBatch->arrayTexture = 0;
+			currBatch->scissorID = state->scissorID;
+			currBatch->camFlags = state->camFlags;
+			currBatch->instanced = instanced;
+			currBatch->depth = state->depth;
+			currBatch->page = page;
+			currBatch->first = instanced ? (int)sb_Count( sbFrameInstances ) : (int)sb_Count( sbFrameIndices );
+			currBatch->count = 0;
+			currBatch->breakReason = breakReason;
+			++triList->batchCount;
+		}
+
+		if( state->textureArray ) {
+			currBatch->arrayTexture = state->texture;
+		} else {
+			currBatch->texture = state->texture;
+		}
+
+		if( instanced ) {
+			sb_Push( sbFrameInstances, triList->sbSprites[entry & ~SPRITE_ENTRY].instance );
+			++currBatch->count;
+		} else {
+			Triangle* tri = &( triList->sbTriangles[entry] );
+			GLuint pageStart = (GLuint)( page * VERTS_PER_PAGE );
+			GLushort* indices = sb_Add( sbFrameIndices, 3 );
+			indices[0] = (GLushort)( tri->vertexIndices[0] - pageStart );
+			indices[1] = (GLushort)( tri->vertexIndices[1] - pageStart );
+			indices[2] = (GLushort)( tri->vertexIndices[2] - pageStart );
+			currBatch->count += 3;
+		}
+	}
+}
+
+static uint32_t getVisibleCamFlags( void )
+{
+	uint32_t visibleFlags = 0;
+	for( int currCamera = cam_StartRenderIteration( ); currCamera != -1; currCamera = cam_GetNextActiveRenderCam( ) ) {
+		visibleFlags |= cam_GetRenderFlags( currCamera );
+	}
+	return visibleFlags;
+}
+
+static void buildIndices( uint32_t visibleFlags )
+{
+	// group the triangles by which cameras can see them, each triangle is only written to the index buffer once and
+	//  each camera just picks out the batches it can see
+	Uint64 stageStart = SDL_GetPerformanceCounter( );
+	bucketSolidTriangles( &solidTriangles, visibleFlags );
+	orderTransparentTriangles( &transparentTriangles, visibleFlags );
+	lastOrderMS = msSince( stageStart );
+
+	stageStart = SDL_GetPerformanceCounter( );
+	sb_Clear( sbFrameIndices );
+	sb_Clear( sbFrameInstances );
+	sb_Clear( sbDrawBatches );
+	gatherBatches( &solidTriangles );
+	gatherBatches( &transparentTriangles );
+	lastBatchMS = msSince( stageStart );
+
+	// both vertex arrays use the index buffer, so it doesn't matter which is bound
+	stageStart = SDL_GetPerformanceCounter( );
+	size_t indexDataSize = sizeof( GLushort ) * sb_Count( sbFrameIndices );
+	glState_BindVertexArray( solidTriangles.VAO );
+	indexOffset = streamBuffer_Write( &indexStream, sbFrameIndices, indexDataSize );
+	frameIndexBytes += (int)indexDataSize;
+
+	size_t instanceDataSize = sizeof( SpriteInstance ) * sb_Count( sbFrameInstances );
+	GL( glBindBuffer( GL_ARRAY_BUFFER, instanceStream.buffer ) );
+	instanceOffset = streamBuffer_Write( &instanceStream, sbFrameInstances, instanceDataSize );
+	frameVertexBytes += (int)instanceDataSize;
+	lastSendMS = msSince( stageStart );
+
+	indexedCamFlags = visibleFlags;
+}
+
+// what's being drawn for a camera, the bound objects are tracked by the GL state so only the program, for counting
+//  the switches and setting the tile uniforms, and the clipping area, which isn't, are kept here
+typedef struct {
+	uint32_t camFlags;
+	Matrix4 vpMat;
+	ShaderProgram* program;
+	int clippingArea;
+} DrawContext;
+
+static void startDrawContext( DrawContext* ctx, int currCamera )
+{
+	ctx->camFlags = cam_GetRenderFlags( currCamera );
+	cam_GetVPMatrix( currCamera, &( ctx->vpMat ) );
+	ctx->program = NULL;
+	ctx->clippingArea = -1;
+
+	glState_BindCamera( currCamera );
+}
+
+// the uniforms are kept by the programs, so they only have to be set once for each frame instead of every time the
+//  program is bound
+static void setFrameUniforms( float t )
+{
+	for( int i = 0; i < NUM_PRIMITIVE_TYPES; ++i ) {
+		ShaderProgram* program = &( shaderPrograms[i] );
+		glState_UseProgram( program->programID );
+		GL( glUniform1i( program->uniformLocs[0], 0 ) );
+		// the colors shouldn't overshoot when we're extrapolating
+		GL( glUniform2f( program->uniformLocs[1], t, MIN( t, 1.0f ) ) );
+		GL( glUniform1i( program->uniformLocs[2], 1 ) );
+	}
+}
+
+static void bindDrawState( DrawContext* ctx, PrimitiveType primitive, GLuint vao, int clippingArea, GLuint texture, GLuint arrayTexture )
+{
+	ShaderProgram* program = &( shaderPrograms[primitive] );
+	if( program != ctx->program ) {
+		ctx->program = program;
+		++frameProgramBinds;
+		glState_UseProgram( program->programID );
+	}
+
+	glState_BindVertexArray( vao );
+
+	if( clippingArea != ctx->clippingArea ) {
+		ctx->clippingArea = clippingArea;
+		setScissor( clippingArea );
+	}
+
+	if( texture != 0 ) {
+		glState_BindTexture( 0, GL_TEXTURE_2D, texture );
+	}
+
+	if( arrayTexture != 0 ) {
+		glState_BindTexture( 1, GL_TEXTURE_2D_ARRAY, arrayTexture );
+	}
+}
+
+static void drawSpriteGroup( DrawContext* ctx, SpriteGroup* group )
+{
+	if( !group->inUse || ( group->count <= 0 ) || ( ( group->camFlags & ctx->camFlags ) == 0 ) ) {
+		return;
+	}
+
+	bindDrawState( ctx, PT_SPRITES, spriteVAO, 0, group->textureArray ? 0 : group->texture, group->textureArray ? group->texture : 0 );
+	setInstanceAttributes( group->buffer, 0, 0 );
+	GL( glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, group->count ) );
+	++frameDrawCalls;
+	renderStats_CountDraw( group->count * 2 );
+}
+
+// draws the transparent groups in order starting at next until one is deeper than upToDepth, returns where it stopped
+static int drawTransparentGroups( DrawContext* ctx, int next, int upToDepth )
+{
+	while( ( next < (int)sb_Count( sbTransparentGroupOrder ) ) && ( sbSpriteGroups[sbTransparentGroupOrder[next]].depth <= upToDepth ) ) {
+		drawSpriteGroup( ctx, &( sbSpriteGroups[sbTransparentGroupOrder[next]] ) );
+		++next;
+	}
+	return next;
+}
+
+static void drawTileChunks( DrawContext* ctx )
+{
+	for( size_t i = 0; i < sb_Count( sbTileChunkOrder ); ++i ) {
+		TileChunk* chunk = &( sbTileChunks[sbTileChunkOrder[i]] );
+		if( !chunk->inUse || ( chunk->uploadedCount <= 0 ) || ( ( chunk->camFlags & ctx->camFlags ) == 0 ) ) {
+			continue;
+		}
+
+		bindDrawState( ctx, PT_TILES, tileVAO, 0, chunk->textureArray ? 0 : chunk->texture, chunk->textureArray ? chunk->texture : 0 );
+		GL( glUniform3f( ctx->program->uniformLocs[3], chunk->origin.x, chunk->origin.y, (float)chunk->depth ) );
+		GL( glUniform2f( ctx->program->uniformLocs[4], chunk->tileSize.x, chunk->tileSize.y ) );
+		setTileAttributes( chunk->buffer );
+		GL( glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, chunk->uploadedCount ) );
+		++frameDrawCalls;
+		renderStats_CountDraw( chunk->uploadedCount * 2 );
+	}
+}
+
+static void drawBatches( DrawContext* ctx, TriangleList* triList )
+{
+	int nextGroup = 0;
+	bool firstDrawn = true;
+
+	for( int i = 0; i < triList->batchCount; ++i ) {
+		DrawBatch* batch = &( sbDrawBatches[triList->firstBatch + i] );
+
+		// the transparent groups are drawn behind everything else at their depth
+		if( triList->sortByDepth ) {
+			nextGroup = drawTransparentGroups( ctx, nextGroup, batch->depth );
+		}
+
+		if( ( batch->camFlags & ctx->camFlags ) == 0 ) {
+			continue;
+		}
+
+		if( !firstDrawn ) {
+			renderStats_CountBatchBreak( batch->breakReason );
+		}
+		firstDrawn = false;
+
+		bindDrawState( ctx, batch->instanced ? PT_SPRITES : PT_TRIANGLES, batch->instanced ? spriteVAO : triList->VAO,
+			batch->scissorID, batch->texture, batch->arrayTexture );
+
+		if( batch->instanced ) {
+			// there's no base instance in the versions of GL we support, so move the attributes instead
+			setInstanceAttributes( instanceStream.buffer, instanceOffset, batch->first );
+			GL( glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, batch->count ) );
+			++frameDrawCalls;
+			renderStats_CountDraw( batch->count * 2 );
+		} else {
+			if( batch->page != triList->boundPage ) {
+				bindVertexPage( triList, batch->page );
+			}
+
+			GL( glDrawElements( GL_TRIANGLES, batch->count, GL_UNSIGNED_SHORT,
+				(const GLvoid*)( indexOffset + ( sizeof( GLushort ) * batch->first ) ) ) );
+			++frameDrawCalls;
+			renderStats_CountDraw( batch->count / 3 );
+		}
+	}
+
+	if( triList->sortByDepth ) {
+		drawTransparentGroups( ctx, nextGroup, INT8_MAX );
+	} else {
+		// the depth test takes care of the solid groups, so they can be drawn whenever
+		for( size_t i = 0; i < sb_Count( sbSpriteGroups ); ++i ) {
+			if( !sbSpriteGroups[i].transparent ) {
+				drawSpriteGroup( ctx, &( sbSpriteGroups[i] ) );
+			}
+		}
+	}
+}
+
+// FNV-1a done a word at a time instead of a byte at a time, used to tell if what a cached camera can see has changed
+//  since it was last drawn, each step can be undone so changing any single word always changes the result
+#define CONTENT_HASH_START 0xcbf29ce484222325ull
+#define CONTENT_HASH_PRIME 0x100000001b3ull
+static uint64_t hashBytes( uint64_t hash, const void* data, size_t size )
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	size_t i = 0;
+	for( ; ( i + sizeof( uint32_t ) ) <= size; i += sizeof( uint32_t ) ) {
+		uint32_t word;
+		memcpy( &word, bytes + i, sizeof( word ) );
+		hash = ( hash ^ word ) * CONTENT_HASH_PRIME;
+	}
+	for( ; i < size; ++i ) {
+		hash = ( hash ^ bytes[i] ) * CONTENT_HASH_PRIME;
+	}
+	return hash;
+}
+
+// the sequence and z only say where things are in the order, which doesn't change how anything looks if nothing
+//  else did, the scissor areas can change on their own so the area is hashed instead of the id, any padding at the end
+//  of the vertices and instances is left out since it's never set
+static uint64_t hashDrawState( uint64_t hash, const DrawState* state, int* lastScissorID, GLint* scissorArea )
+{
+	if( state->scissorID != (*lastScissorID) ) {
+		GLsizei w;
+		GLsizei h;
+		scissor_GetScissorAreaGL( state->scissorID, &( scissorArea[0] ), &( scissorArea[1] ), &w, &h );
+		scissorArea[2] = w;
+		scissorArea[3] = h;
+		(*lastScissorID) = state->scissorID;
+	}
+
+	uint32_t packed[3];
+	packed[0] = state->texture;
+	packed[1] = state->textureArray ? 1 : 0;
+	packed[2] = (uint32_t)(int32_t)state->depth;
+	hash = hashBytes( hash, packed, sizeof( packed ) );
+	return hashBytes( hash, scissorArea, sizeof( GLint ) * 4 );
+}
+
+static bool spriteMoving( const SpriteInstance* inst )
+{
+	return ( inst->startPos.x != inst->endPos.x ) || ( inst->startPos.y != inst->endPos.y ) ||
+		( inst->startScale.x != inst->endScale.x ) || ( inst->startScale.y != inst->endScale.y ) ||
+		( inst->startRot != inst->endRot ) || ( memcmp( inst->startCol, inst->endCol, sizeof( inst->startCol ) ) != 0 );
+}
+
+// anything moving means the layer is drawn every frame anyway, so this stops as soon as it finds something that is
+static uint64_t hashTriList( uint64_t hash, TriangleList* triList, uint32_t camFlags, bool* outAnimated )
+{
+	int lastScissorID = -1;
+	GLint scissorArea[4] = { 0, 0, 0, 0 };
+
+	for( int i = 0; i <= triList->lastTriIndex; ++i ) {
+		Triangle* tri = &( triList->sbTriangles[i] );
+		if( ( tri->state.camFlags & camFlags ) == 0 ) {
+			continue;
+		}
+
+		hash = hashDrawState( hash, &( tri->state ), &lastScissorID, scissorArea );
+		for( int v = 0; v < 3; ++v ) {
+			Vertex* vert = &( triList->sbVertices[tri->vertexIndices[v]] );
+			if( ( vert->startPos.x != vert->endPos.x ) || ( vert->startPos.y != vert->endPos.y ) ||
+				( memcmp( vert->startCol, vert->endCol, sizeof( vert->startCol ) ) != 0 ) ) {
+				(*outAnimated) = true;
+				return hash;
+			}
+			hash = hashBytes( hash, &( vert->startPos ), sizeof( vert->startPos ) );
+			hash = hashBytes( hash, vert->startCol, ( offsetof( Vertex, layer ) + sizeof( vert->layer ) ) - offsetof( Vertex, startCol ) );
+		}
+	}
+
+	for( size_t i = 0; i < sb_Count( triList->sbSprites ); ++i ) {
+		Sprite* sprite = &( triList->sbSprites[i] );
+		if( ( sprite->state.camFlags & camFlags ) == 0 ) {
+			continue;
+		}
+
+		if( spriteMoving( &( sprite->instance ) ) ) {
+			(*outAnimated) = true;
+			return hash;
+		}
+
+		// nothing is moving so only the start state and what's shared has to be looked at
+		hash = hashDrawState( hash, &( sprite->state ), &lastScissorID, scissorArea );
+		hash = hashBytes( hash, &( sprite->instance.startPos ), sizeof( Vector2 ) );
+		hash = hashBytes( hash, &( sprite->instance.startScale ), sizeof( Vector2 ) );
+		hash = hashBytes( hash, &( sprite->instance.offset ), sizeof( Vector2 ) + sizeof( float ) );
+		hash = hashBytes( hash, sprite->instance.uvRect, sizeof( sprite->instance.uvRect ) + sizeof( sprite->instance.startCol ) );
+		hash = hashBytes( hash, &( sprite->instance.layer ), sizeof( sprite->instance.layer ) );
+	}
+
+	return hash;
+}
+
+// works out what the camera can see for the layer cache, the groups and chunks are only looked through when they
+//  change so a camera over mostly retained things costs next to nothing
+static void describeCameraContent( int camera )
+{
+	uint32_t camFlags = cam_GetRenderFlags( camera );
+	bool animated = false;
+
+	uint64_t hash = CONTENT_HASH_START;
+	hash = hashTriList( hash, &solidTriangles, camFlags, &animated );
+	if( !animated ) {
+		hash = hashTriList( hash, &transparentTriangles, camFlags, &animated );
+	}
+
+	for( int i = 0; ( i < (int)sb_Count( sbSpriteGroups ) ) && !animated; ++i ) {
+		SpriteGroup* group = &( sbSpriteGroups[i] );
+		if( !group->inUse || ( group->count <= 0 ) || ( ( group->camFlags & camFlags ) == 0 ) ) {
+			continue;
+		}
+
+		if( group->checkedVersion != group->version ) {
+			group->moving = false;
+			for( int s = 0; ( s < group->count ) && !group->moving; ++s ) {
+				group->moving = spriteMoving( &( group->instances[s] ) );
+			}
+			group->checkedVersion = group->version;
+		}
+
+		animated = group->moving;
+		uint32_t packed[2] = { (uint32_t)i, (uint32_t)group->version };
+		hash = hashBytes( hash, packed, sizeof( packed ) );
+	}
+
+	for( int i = 0; ( i < (int)sb_Count( sbTileChunks ) ) && !animated; ++i ) {
+		TileChunk* chunk = &( sbTileChunks[i] );
+		if( !chunk->inUse || ( chunk->uploadedCount <= 0 ) || ( ( chunk->camFlags & camFlags ) == 0 ) ) {
+			continue;
+		}
+
+		uint32_t packed[2] = { (uint32_t)i, (uint32_t)chunk->version };
+		hash = hashBytes( hash, packed, sizeof( packed ) );
+	}
+
+	layerCache_SetContent( camera, hash, animated );
+}
+
+static bool writeCaptureData( SDL_RWops* file, const void* data, size_t size )
+{
+	return ( size == 0 ) || ( SDL_RWwrite( file, data, size, 1 ) == 1 );
+}
+
+static bool readCaptureData( SDL_RWops* file, void* data, size_t size )
+{
+	return ( size == 0 ) || ( SDL_RWread( file, data, size, 1 ) == 1 );
+}
+
+static int getMaxScissorID( TriangleList* triList, int maxID )
+{
+	for( int i = 0; i <= triList->lastTriIndex; ++i ) {
+		maxID = MAX( maxID, triList->sbTriangles[i].state.scissorID );
+	}
+	for( size_t i = 0; i < sb_Count( triList->sbSprites ); ++i ) {
+		maxID = MAX( maxID, triList->sbSprites[i].state.scissorID );
+	}
+	return maxID;
+}
+
+static bool writeCaptureList( SDL_RWops* file, TriangleList* triList )
+{
+	CaptureList list;
+	list.triangleCount = (uint32_t)( triList->lastTriIndex + 1 );
+	list.vertexCount = (uint32_t)sb_Count( triList->sbVertices );
+	list.spriteCount = (uint32_t)sb_Count( triList->sbSprites );
+	list.entryCount = (uint32_t)sb_Count( triList->sbSortEntries );
+
+	if( !writeCaptureData( file, &list, sizeof( list ) ) ||
+		!writeCaptureData( file, triList->sbTriangles, sizeof( Triangle ) * list.triangleCount ) ||
+		!writeCaptureData( file, triList->sbVertices, sizeof( Vertex ) * list.vertexCount ) ||
+		!writeCaptureData( file, triList->sbSprites, sizeof( Sprite ) * list.spriteCount ) ) {
+		return false;
+	}
+
+	// the values are gathered up a block at a time so there isn't a write for every entry
+	uint32_t values[CAPTURE_ENTRY_BLOCK];
+	for( uint32_t i = 0; i < list.entryCount; i += CAPTURE_ENTRY_BLOCK ) {
+		uint32_t count = MIN( CAPTURE_ENTRY_BLOCK, list.entryCount - i );
+		for( uint32_t v = 0; v < count; ++v ) {
+			values[v] = triList->sbSortEntries[i + v].value;
+		}
+		if( !writeCaptureData( file, values, sizeof( uint32_t ) * count ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool writeCaptureGroups( SDL_RWops* file )
+{
+	for( size_t i = 0; i < sb_Count( sbSpriteGroups ); ++i ) {
+		SpriteGroup* group = &( sbSpriteGroups[i] );
+		if( !group->inUse || ( group->count <= 0 ) ) {
+			continue;
+		}
+
+		CaptureGroup captureGroup;
+		captureGroup.texture = (uint32_t)group->texture;
+		captureGroup.textureArray = group->textureArray ? 1 : 0;
+		captureGroup.camFlags = group->camFlags;
+		captureGroup.depth = (int32_t)group->depth;
+		captureGroup.transparent = group->transparent ? 1 : 0;
+		captureGroup.count = (uint32_t)group->count;
+		if( !writeCaptureData( file, &captureGroup, sizeof( captureGroup ) ) ||
+			!writeCaptureData( file, group->instances, sizeof( SpriteInstance ) * captureGroup.count ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// writes out everything that goes into sorting and batching the lists: the triangles, sprites, and vertices in the
+//  order they were added, the sprite groups, what the cameras could see, and the scissor areas
+static void writeCapture( const char* fileName )
+{
+	SDL_RWops* file = SDL_RWFromFile( fileName, "wb" );
+	if( file == NULL ) {
+		llog( LOG_ERROR, "Unable to open %s to capture the triangle upload: %s", fileName, SDL_GetError( ) );
+		return;
+	}
+
+	CaptureCamera cameras[NUM_CAMERAS];
+	int cameraCount = 0;
+	for( int currCamera = cam_StartRenderIteration( ); ( currCamera != -1 ) && ( cameraCount < NUM_CAMERAS ); currCamera = cam_GetNextActiveRenderCam( ) ) {
+		cameras[cameraCount].camera = currCamera;
+		cameras[cameraCount].renderFlags = cam_GetRenderFlags( currCamera );
+		cam_GetVPMatrix( currCamera, &( cameras[cameraCount].vpMat ) );
+		++cameraCount;
+	}
+
+	CaptureHeader header;
+	memset( &header, 0, sizeof( header ) );
+	header.magic = CAPTURE_MAGIC;
+	header.version = CAPTURE_VERSION;
+	header.vertexSize = sizeof( Vertex );
+	header.triangleSize = sizeof( Triangle );
+	header.spriteSize = sizeof( Sprite );
+	header.spriteInstanceSize = sizeof( SpriteInstance );
+	header.nextSequence = nextSequence;
+	header.cameraCount = (uint32_t)cameraCount;
+	header.scissorAreaCount = (uint32_t)( getMaxScissorID( &transparentTriangles, getMaxScissorID( &solidTriangles, 0 ) ) + 1 );
+	for( size_t i = 0; i < sb_Count( sbSpriteGroups ); ++i ) {
+		if( sbSpriteGroups[i].inUse && ( sbSpriteGroups[i].count > 0 ) ) {
+			++header.spriteGroupCount;
+		}
+	}
+	for( size_t i = 0; i < sb_Count( sbTileChunks ); ++i ) {
+		if( sbTileChunks[i].inUse && ( sbTileChunks[i].uploadedCount > 0 ) ) {
+			++header.tileChunkCount;
+		}
+	}
+	if( header.tileChunkCount > 0 ) {
+		llog( LOG_WARN, "The upload being captured has tile chunks, they aren't kept once they're sent so the capture can't be replayed." );
+	}
+
+	bool written = writeCaptureData( file, &header, sizeof( header ) ) &&
+		writeCaptureData( file, cameras, sizeof( CaptureCamera ) * cameraCount );
+
+	for( uint32_t i = 0; ( i < header.scissorAreaCount ) && written; ++i ) {
+		Vector2 area[2];
+		scissor_GetScissorArea( (int)i, &( area[0] ), &( area[1] ) );
+		written = writeCaptureData( file, area, sizeof( area ) );
+	}
+
+	written = written && writeCaptureList( file, &solidTriangles ) && writeCaptureList( file, &transparentTriangles ) &&
+		writeCaptureGroups( file );
+
+	SDL_RWclose( file );
+	if( written ) {
+		llog( LOG_INFO, "Captured the triangle upload to %s.", fileName );
+	} else {
+		llog( LOG_ERROR, "Unable to write the triangle upload capture to %s.", fileName );
+	}
+}
+
+/*
+Writes everything that goes into sorting and batching the next upload that takes at least minUploadMS on the CPU out
+ to the file, 0 captures the next upload whatever it takes. Only one upload is captured for each call.
+*/
+void triRenderer_CaptureUpload( const char* fileName, float minUploadMS )
+{
+	if( ( fileName == NULL ) || ( strlen( fileName ) >= MAX_CAPTURE_PATH_LEN ) ) {
+		llog( LOG_ERROR, "Invalid file name to capture the triangle upload to." );
+		return;
+	}
+
+	strcpy( captureFileName, fileName );
+	captureMinMS = minUploadMS;
+}
+
+// the entries and triangles are checked so a bad file can't point outside of the lists
+static bool readCaptureList( SDL_RWops* file, TriangleList* triList )
+{
+	CaptureList list;
+	if( !readCaptureData( file, &list, sizeof( list ) ) ) {
+		return false;
+	}
+
+	if( list.triangleCount > 0 ) {
+		if( !readCaptureData( file, sb_Add( triList->sbTriangles, list.triangleCount ), sizeof( Triangle ) * list.triangleCount ) ) {
+			return false;
+		}
+	}
+	triList->lastTriIndex = (int)list.triangleCount - 1;
+
+	if( list.vertexCount > 0 ) {
+		if( !readCaptureData( file, sb_Add( triList->sbVertices, list.vertexCount ), sizeof( Vertex ) * list.vertexCount ) ) {
+			return false;
+		}
+	}
+
+	if( list.spriteCount > 0 ) {
+		if( !readCaptureData( file, sb_Add( triList->sbSprites, list.spriteCount ), sizeof( Sprite ) * list.spriteCount ) ) {
+			return false;
+		}
+	}
+
+	for( uint32_t i = 0; i < list.triangleCount; ++i ) {
+		for( int v = 0; v < 3; ++v ) {
+			if( triList->sbTriangles[i].vertexIndices[v] >= list.vertexCount ) {
+				return false;
+			}
+		}
+	}
+
+	uint32_t values[CAPTURE_ENTRY_BLOCK];
+	for( uint32_t i = 0; i < list.entryCount; i += CAPTURE_ENTRY_BLOCK ) {
+		uint32_t count = MIN( CAPTURE_ENTRY_BLOCK, list.entryCount - i );
+		if( !readCaptureData( file, values, sizeof( uint32_t ) * count ) ) {
+			return false;
+		}
+
+		for( uint32_t v = 0; v < count; ++v ) {
+			bool isSprite = ( values[v] & SPRITE_ENTRY ) != 0;
+			uint32_t idx = values[v] & ~SPRITE_ENTRY;
+			if( idx >= ( isSprite ? list.spriteCount : list.triangleCount ) ) {
+				return false;
+			}
+			addSortEntry( triList, getEntryState( triList, values[v] ), idx, isSprite );
+		}
+	}
+
+	return true;
+}
+
+// the groups are made again and marked so they're all sent with the next upload
+static bool readCaptureGroups( SDL_RWops* file, uint32_t groupCount )
+{
+	for( uint32_t i = 0; i < groupCount; ++i ) {
+		CaptureGroup captureGroup;
+		if( !readCaptureData( file, &captureGroup, sizeof( captureGroup ) ) ||
+			( captureGroup.depth < INT8_MIN ) || ( captureGroup.depth > INT8_MAX ) || ( captureGroup.count > INT32_MAX ) ) {
+			return false;
+		}
+
+		int group = triRenderer_CreateSpriteGroup( (GLuint)captureGroup.texture, captureGroup.textureArray != 0, captureGroup.camFlags,
+			(int8_t)captureGroup.depth, (int)captureGroup.transparent );
+		if( ( group < 0 ) || ( triRenderer_SetSpriteGroupCount( group, (int)captureGroup.count ) < 0 ) ) {
+			return false;
+		}
+
+		SpriteGroup* spriteGroup = &( sbSpriteGroups[group] );
+		if( !readCaptureData( file, spriteGroup->instances, sizeof( SpriteInstance ) * captureGroup.count ) ) {
+			return false;
+		}
+
+		sb_Clear( spriteGroup->sbDirtyRanges );
+		DirtyRange* all = sb_Add( spriteGroup->sbDirtyRanges, 1 );
+		all->first = 0;
+		all->count = spriteGroup->count;
+	}
+
+	return true;
+}
+
+static void destroyAllSpriteGroups( void )
+{
+	for( int i = 0; i < (int)sb_Count( sbSpriteGroups ); ++i ) {
+		triRenderer_DestroySpriteGroup( i );
+	}
+}
+
+static void copySortEntries( RadixSortEntry** sbDest, const RadixSortEntry* sbSource )
+{
+	sb_Clear( (*sbDest) );
+	size_t count = sb_Count( sbSource );
+	if( count > 0 ) {
+		memcpy( sb_Add( (*sbDest), count ), sbSource, sizeof( RadixSortEntry ) * count );
+	}
+}
+
+/*
+Replaces everything that's been added with an upload written out by triRenderer_CaptureUpload( ), so it can be
+ sorted and batched again with triRenderer_Upload( ) to see how long it takes. The camera render flags and scissor
+ areas are set to what they were when it was captured, and any sprite groups are replaced with the captured ones.
+ The capture has to be from a build that lays the triangles and sprites out the same way. Tile chunks don't keep
+ their tiles once they've been sent so they can't be captured, captures of uploads that had any are refused.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_LoadCapture( const char* fileName )
+{
+	int ret = -1;
+
+	SDL_RWops* file = SDL_RWFromFile( fileName, "rb" );
+	if( file == NULL ) {
+		llog( LOG_ERROR, "Unable to open triangle upload capture %s: %s", fileName, SDL_GetError( ) );
+		return -1;
+	}
+
+	triRenderer_Clear( );
+	destroyAllSpriteGroups( );
+
+	CaptureHeader header;
+	if( !readCaptureData( file, &header, sizeof( header ) ) || ( header.magic != CAPTURE_MAGIC ) ) {
+		llog( LOG_ERROR, "%s isn't a triangle upload capture.", fileName );
+		goto clean_up;
+	}
+
+	if( ( header.version != CAPTURE_VERSION ) || ( header.vertexSize != sizeof( Vertex ) ) ||
+		( header.triangleSize != sizeof( Triangle ) ) || ( header.spriteSize != sizeof( Sprite ) ) ||
+		( header.spriteInstanceSize != sizeof( SpriteInstance ) ) ) {
+		llog( LOG_ERROR, "Triangle upload capture %s is from an incompatible build.", fileName );
+		goto clean_up;
+	}
+
+	if( header.tileChunkCount > 0 ) {
+		llog( LOG_ERROR, "Triangle upload capture %s has tile chunks, their tiles aren't captured so it can't be replayed.", fileName );
+		goto clean_up;
+	}
+
+	if( ( header.cameraCount > NUM_CAMERAS ) || ( header.scissorAreaCount == 0 ) ) {
+		llog( LOG_ERROR, "Triangle upload capture %s is corrupt.", fileName );
+		goto clean_up;
+	}
+
+	CaptureCamera cameras[NUM_CAMERAS];
+	if( !readCaptureData( file, cameras, sizeof( CaptureCamera ) * header.cameraCount ) ) {
+		llog( LOG_ERROR, "Triangle upload capture %s is truncated.", fileName );
+		goto clean_up;
+	}
+
+	for( uint32_t i = 0; i < header.cameraCount; ++i ) {
+		if( ( cameras[i].camera < 0 ) || ( cameras[i].camera >= NUM_CAMERAS ) ) {
+			llog( LOG_ERROR, "Triangle upload capture %s is corrupt.", fileName );
+			goto clean_up;
+		}
+	}
+
+	for( int currCamera = cam_StartIteration( ); currCamera != -1; currCamera = cam_GetNextActiveCam( ) ) {
+		cam_TurnOffFlags( currCamera, 0xFFFFFFFF );
+	}
+	for( uint32_t i = 0; i < header.cameraCount; ++i ) {
+		cam_TurnOnFlags( cameras[i].camera, cameras[i].renderFlags );
+	}
+	cam_FinalizeStates( 1.0f );
+	cam_SnapshotStates( );
+
+	// the first area is always the whole render area, the rest are pushed in order so they get the same ids
+	for( uint32_t i = 0; i < header.scissorAreaCount; ++i ) {
+		Vector2 area[2];
+		if( !readCaptureData( file, area, sizeof( area ) ) ) {
+			llog( LOG_ERROR, "Triangle upload capture %s is truncated.", fileName );
+			goto clean_up;
+		}
+
+		if( i == 0 ) {
+			scissor_Init( (int)area[1].w, (int)area[1].h );
+		} else if( scissor_Push( &( area[0] ), &( area[1] ) ) < 0 ) {
+			llog( LOG_ERROR, "Too many scissor areas in triangle upload capture %s.", fileName );
+			goto clean_up;
+		} else {
+			scissor_Pop( );
+		}
+	}
+
+	if( !readCaptureList( file, &solidTriangles ) || !readCaptureList( file, &transparentTriangles ) ||
+		!readCaptureGroups( file, header.spriteGroupCount ) ) {
+		llog( LOG_ERROR, "Triangle upload capture %s is truncated or corrupt.", fileName );
+		goto clean_up;
+	}
+
+	nextSequence = header.nextSequence;
+	copySortEntries( &sbCapturedSolidEntries, solidTriangles.sbSortEntries );
+	copySortEntries( &sbCapturedTransparentEntries, transparentTriangles.sbSortEntries );
+	captureLoaded = true;
+	ret = 0;
+
+clean_up:
+	SDL_RWclose( file );
+	if( ret < 0 ) {
+		triRenderer_Clear( );
+		destroyAllSpriteGroups( );
+	}
+	return ret;
+}
+
+/*
+Puts the sort entries of a loaded capture back in the order they were captured in, so uploading it again sorts the
+ same thing instead of what the last upload already sorted. Does nothing if there isn't a capture loaded.
+*/
+void triRenderer_RestoreCapture( void )
+{
+	if( !captureLoaded ) {
+		return;
+	}
+
+	copySortEntries( &( solidTriangles.sbSortEntries ), sbCapturedSolidEntries );
+	copySortEntries( &( transparentTriangles.sbSortEntries ), sbCapturedTransparentEntries );
+}
+
+// makes the entries again from what was added, the triangles first and then the sprites
+static void remakeSortEntries( TriangleList* triList )
+{
+	sb_Clear( triList->sbSortEntries );
+	for( int i = 0; i <= triList->lastTriIndex; ++i ) {
+		addSortEntry( triList, &( triList->sbTriangles[i].state ), (uint32_t)i, false );
+	}
+	for( size_t i = 0; i < sb_Count( triList->sbSprites ); ++i ) {
+		addSortEntry( triList, &( triList->sbSprites[i].state ), (uint32_t)i, true );
+	}
+}
+
+/*
+Makes the sort keys for everything added since the last clear again and sorts them the same way triRenderer_Upload( )
+ does, without building or sending anything. Every call starts from the same order, so it can be used to measure
+ the sort.
+*/
+void triRenderer_SortAdded( void )
+{
+	remakeSortEntries( &solidTriangles );
+	remakeSortEntries( &transparentTriangles );
+	sortTriangles( &solidTriangles );
+	sortTriangles( &transparentTriangles );
+}
+
+/*
+Sorts all the triangles added since the last clear and sends them to the GPU, along with any changes to the sprite
+ groups. They'll be drawn by every call to triRenderer_Render( ) until the next upload, so this only has to be done
+ when the state being drawn changes.
+*/
+void triRenderer_Upload( void )
+{
+	Uint64 uploadStart = SDL_GetPerformanceCounter( );
+
+	// the groups have to be sent first so the transparent batches know where to split for them
+	lastGroupSprites = uploadSpriteGroups( );
+	int numTiles = uploadTileChunks( );
+
+	int numSprites = (int)( sb_Count( solidTriangles.sbSprites ) + sb_Count( transparentTriangles.sbSprites ) ) + lastGroupSprites + numTiles;
+	lastRenderTriangles = ( solidTriangles.lastTriIndex + 1 ) + ( transparentTriangles.lastTriIndex + 1 ) + ( 2 * numSprites );
+	peakTriangles = MAX( peakTriangles, lastRenderTriangles );
+
+	// sort the keys instead of the triangles, the vertices don't depend on the order so they can be sent as is
+	Uint64 stageStart = SDL_GetPerformanceCounter( );
+	sortTriangles( &solidTriangles );
+	sortTriangles( &transparentTriangles );
+	lastSortMS = msSince( stageStart );
+
+	stageStart = SDL_GetPerformanceCounter( );
+	float zOrderOffset = 1.0f / (float)( nextSequence + 1 );
+	uploadVertices( &solidTriangles, zOrderOffset );
+	uploadVertices( &transparentTriangles, zOrderOffset );
+	lastVertexMS = msSince( stageStart );
+
+	// anything none of the cameras can see can be skipped entirely
+	buildIndices( getVisibleCamFlags( ) );
+
+	for( int currCamera = cam_StartRenderIteration( ); currCamera != -1; currCamera = cam_GetNextActiveRenderCam( ) ) {
+		if( layerCache_IsEnabled( currCamera ) ) {
+			describeCameraContent( currCamera );
+		}
+	}
+
+	// sorting and building the batches doesn't change the lists, so they're written out as they were added
+	if( ( captureFileName[0] != 0 ) && ( msSince( uploadStart ) >= captureMinMS ) ) {
+		writeCapture( captureFileName );
+		captureFileName[0] = 0;
+	}
+}
+
+/*
+Draws out all the uploaded triangles. t is how far to interpolate between the start and end states of the
+ triangles, anything past 1 will extrapolate the positions past the end state.
+*/
+void triRenderer_Render( float t )
+{
+	// a camera that was switched on since the upload may be able to see triangles that were skipped
+	uint32_t visibleFlags = getVisibleCamFlags( );
+	if( ( visibleFlags & ~indexedCamFlags ) != 0 ) {
+		buildIndices( visibleFlags );
+	}
+
+	setFrameUniforms( t );
+
+	glState_SetEnabled( GL_CULL_FACE, false );
+	glState_SetEnabled( GL_DEPTH_TEST, true );
+	glState_SetEnabled( GL_SCISSOR_TEST, true );
+	glState_DepthMask( GL_TRUE );
+	GL( glDepthFunc( GL_LESS ) );
+
+	// render triangles
+	// TODO: We're ignoring any issues with cameras and transparency, probably want to handle this better.
+	for( int currCamera = cam_StartRenderIteration( ); currCamera != -1; currCamera = cam_GetNextActiveRenderCam( ) ) {
+		DrawContext ctx;
+		startDrawContext( &ctx, currCamera );
+
+		// a cached camera that hasn't changed is just drawn from its layer
+		LayerDraw layerDraw = layerCache_Begin( currCamera, &( ctx.vpMat ), scissorLimit );
+		if( layerDraw != LD_REUSE ) {
+			scissorLimited = ( layerDraw == LD_REDRAW );
+
+			setScissor( 0 ); // set to the default scissor area for clearing
+			GL( glClear( GL_DEPTH_BUFFER_BIT ) );
+
+			// the tiles go down first so their edges can blend with the chunks under them, the depth test keeps them
+			//  behind anything in front of them, the alpha is blended separately so a cached layer ends up with the
+			//  coverage it needs to be drawn over the cameras before it
+			glState_SetEnabled( GL_BLEND, true );
+			glState_BlendFuncSeparate( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+			drawTileChunks( &ctx );
+
+			glState_SetEnabled( GL_BLEND, false );
+			drawBatches( &ctx, &solidTriangles );
+
+			glState_SetEnabled( GL_BLEND, true );
+			glState_BlendFuncSeparate( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+			drawBatches( &ctx, &transparentTriangles );
+
+			scissorLimited = false;
+		}
+
+		if( layerDraw != LD_UNCACHED ) {
+			layerCache_End( currCamera );
+		}
+
+		glDebugging_CheckPass( "triangle renderer camera pass" );
+	}
+
+	glState_SetEnabled( GL_SCISSOR_TEST, false );
+	glState_BindVertexArray( 0 );
+	glState_UseProgram( 0 );
+
+	streamBuffer_EndFrame( &( solidTriangles.vertexStream ) );
+	streamBuffer_EndFrame( &( transparentTriangles.vertexStream ) );
+	streamBuffer_EndFrame( &indexStream );
+	streamBuffer_EndFrame( &instanceStream );
+
+	lastUploadedVertexBytes = frameVertexBytes;
+	lastUploadedIndexBytes = frameIndexBytes;
+	frameVertexBytes = 0;
+	frameIndexBytes = 0;
+
+	lastDrawCalls = frameDrawCalls;
+	lastProgramBinds = frameProgramBinds;
+	frameDrawCalls = 0;
+	frameProgramBinds = 0;
+
+	lastGroupRangesSent = frameGroupRangesSent;
+	frameGroupRangesSent = 0;
+
+	lastTileChunksSent = frameTileChunksSent;
+	frameTileChunksSent = 0;
+}
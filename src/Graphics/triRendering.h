@@ -2,6 +2,7 @@
 #define TRI_RENDERING_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "../Graphics/glPlatform.h"
 #include "glPlatform.h"
@@ -9,12 +10,69 @@
 #include "../Math/vector2.h"
 #include "color.h"
 
+// both types are drawn with the same program now, alpha only textures sample as white with the coverage in the
+//  alpha so the default shader handles them, they're only kept apart so callers can say what a texture holds
 typedef enum {
 	ST_DEFAULT,
 	ST_ALPHA_ONLY,
 	NUM_SHADERS
 } ShaderType;
 
+// the state of a sprite at the start or end of a frame
+typedef struct {
+	Vector2 pos;
+	Vector2 scaleSize;
+	Color color;
+	float rotation;
+} SpriteState;
+
+// the render state shared by every triangle in a mesh, the color is used for any mesh that doesn't have vertex colors,
+//  the texture layer is the layer in an array texture or < 0 if the texture isn't an array
+typedef struct {
+	ShaderType shader;
+	GLuint texture;
+	int textureLayer;
+	Color color;
+	int clippingID;
+	uint32_t camFlags;
+	int8_t depth;
+	int transparent;
+} TriMeshState;
+
+// sprites stored as one array for each field, every array has to have an entry for each sprite, transparent is
+//  non-zero for any sprite that needs to be blended
+typedef struct {
+	const Vector2* startPos;
+	const Vector2* endPos;
+	const Vector2* startScale;
+	const Vector2* endScale;
+	const Vector2* offset;
+	const float* startRot;
+	const float* endRot;
+	const Color* startColor;
+	const Color* endColor;
+	const Vector2* uvMin;
+	const Vector2* uvMax;
+	const GLuint* texture;
+	const int* textureLayer;
+	const int* clippingID;
+	const uint32_t* camFlags;
+	const int8_t* depth;
+	const uint8_t* transparent;
+} SpriteArrays;
+
+// a tile in a chunk, the column and row are the cell of the chunk it's in, the corners of its quad are relative to the
+//  center of the cell and are rounded to whole units, the texture layer is < 0 if the texture isn't an array texture
+typedef struct {
+	int column;
+	int row;
+	Vector2 min;
+	Vector2 max;
+	Vector2 uvMin;
+	Vector2 uvMax;
+	int textureLayer;
+} ChunkTile;
+
 /*
 Makes all the shaders reload.
 */
@@ -27,7 +85,7 @@ Initializes all the stuff needed for rendering the triangles.
 int triRenderer_Init( int renderAreaWidth, int renderAreaHeight );
 
 /*
-We'll assume the array has three vertices in it.
+We'll assume the array has three vertices in it. The texture can't be an array texture.
  Return a value < 0 if there's a problem.
 */
 int triRenderer_AddVertices( Vector2* positions, Vector2* uvs, ShaderType shader, GLuint texture, Color color,
@@ -35,14 +93,173 @@ int triRenderer_AddVertices( Vector2* positions, Vector2* uvs, ShaderType shader
 int triRenderer_Add( Vector2 pos0, Vector2 pos1, Vector2 pos2, Vector2 uv0, Vector2 uv1, Vector2 uv2, ShaderType shader, GLuint texture,
 	Color color, int clippingID, uint32_t camFlags, int8_t depth, int transparent );
 
+/*
+Adds a triangle that moves from the start positions and color to the end positions and color as the frame is
+ interpolated. We'll assume all the arrays have three vertices in them. The texture can't be an array texture.
+ Return a value < 0 if there's a problem.
+*/
+int triRenderer_AddInterpolated( Vector2* startPositions, Vector2* endPositions, Vector2* uvs, ShaderType shader, GLuint texture,
+	Color startColor, Color endColor, int clippingID, uint32_t camFlags, int8_t depth, int transparent );
+
+/*
+Adds a mesh of triangles that all share the same state, every three indices make a triangle. The vertices are copied
+ in once and shared by all the triangles that use them, so there can't be more than 65535 of them. endPositions can
+ be NULL if the mesh isn't moving, and colors can be NULL to use the color in the state for every vertex.
+ Return a value < 0 if there's a problem.
+*/
+int triRenderer_AddMesh( const Vector2* startPositions, const Vector2* endPositions, const Vector2* uvs, const Color* colors,
+	int vertexCount, const uint16_t* indices, int indexCount, const TriMeshState* state );
+
+/*
+Adds a sprite, a quad centered on the position that's offset and then scaled and rotated. The quad is built on the
+ GPU from the start and end states, uvMin is used for the corner at (-0.5,-0.5) and uvMax for the one at (0.5,0.5).
+ textureLayer is the layer to use if the texture is an array texture, otherwise it should be < 0.
+ Return a value < 0 if there's a problem.
+*/
+int triRenderer_AddSprite( const SpriteState* start, const SpriteState* end, Vector2 offset, Vector2 uvMin, Vector2 uvMax,
+	ShaderType shader, GLuint texture, int textureLayer, int clippingID, uint32_t camFlags, int8_t depth, int transparent );
+
+/*
+Adds count sprites stored as separate arrays for each field, each one is the same as passing that index of every
+ array to triRenderer_AddSprite( ). The sprites are packed a few at a time, so this is quicker than adding them one
+ by one when there are a lot of them.
+ Return a value < 0 if there's a problem.
+*/
+int triRenderer_AddSprites( const SpriteArrays* sprites, int count );
+
+/*
+Creates a group of sprites that stays on the GPU between uploads instead of having to be added again after every
+ clear. Every sprite in the group is drawn with the same texture, cameras, depth, and blending, they can't be
+ clipped, and they're drawn behind anything else at the same depth. The group starts out empty.
+ Returns the id of the group, or a value < 0 if there's a problem.
+*/
+int triRenderer_CreateSpriteGroup( GLuint texture, bool textureArray, uint32_t camFlags, int8_t depth, int transparent );
+
+/*
+Releases the group and the buffer it was using.
+*/
+void triRenderer_DestroySpriteGroup( int group );
+
+/*
+Sets how many sprites are in the group, the sprites are in the slots from 0 up to count. Any new slots have to be set
+ before the next upload.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_SetSpriteGroupCount( int group, int count );
+
+/*
+Sets the sprite in a slot of the group, the arguments are the same as for triRenderer_AddSprite( ). The slot is sent
+ to the GPU at the next upload, along with any other slots that were changed.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_SetGroupSprite( int group, int slot, const SpriteState* start, const SpriteState* end, Vector2 offset,
+	Vector2 uvMin, Vector2 uvMax, int textureLayer );
+
+/*
+Creates a chunk of tiles that stays on the GPU between uploads and is drawn with one call. Every tile in the chunk
+ uses the same texture, cameras, and depth, and the cells are tileSize apart with the first one's corner at the
+ origin. The chunks are drawn in depth order before anything else, so partly transparent tiles only blend with the
+ chunks behind them. The chunk starts out empty.
+ Returns the id of the chunk, or a value < 0 if there's a problem.
+*/
+int triRenderer_CreateTileChunk( GLuint texture, bool textureArray, uint32_t camFlags, int8_t depth, Vector2 origin, Vector2 tileSize );
+
+/*
+Releases the chunk and the buffer it was using.
+*/
+void triRenderer_DestroyTileChunk( int chunk );
+
+/*
+Replaces all the tiles in the chunk, the whole chunk is sent to the GPU at the next upload. There can't be more than
+ 65535 columns or rows in a chunk.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_SetTileChunkTiles( int chunk, const ChunkTile* tiles, int count );
+
 /*
 Clears out all the triangles currently stored.
 */
 void triRenderer_Clear( void );
 
 /*
-Draws out all the triangles.
+Gets the number of triangles that were in the last rendered frame, the most triangles there have been in a single
+ frame, and how many triangles the lists have space for before they have to grow. Each sprite and tile counts as
+ two triangles. Any of the out parameters can be NULL.
+*/
+void triRenderer_GetLastRenderStats( int* outRendered, int* outPeak, int* outCapacity );
+
+/*
+Gets how many bytes of vertex and index data were sent to the GPU for the last rendered frame, frames that only
+ redraw what was already uploaded won't have sent anything. Sprite instances are counted as vertex data. Either of
+ the out parameters can be NULL.
+*/
+void triRenderer_GetLastUploadStats( int* outVertexBytes, int* outIndexBytes );
+
+/*
+Gets how many draw calls were issued for the last rendered frame and how many times the shader program had to be
+ changed for them. Either of the out parameters can be NULL.
+*/
+void triRenderer_GetLastDrawStats( int* outDrawCalls, int* outProgramBinds );
+
+/*
+Gets how many sprites were in sprite groups for the last rendered frame, and how many ranges of them had to be sent
+ to the GPU because they changed. Either of the out parameters can be NULL.
+*/
+void triRenderer_GetLastSpriteGroupStats( int* outSprites, int* outRangesSent );
+
+/*
+Gets how many tile chunks had tiles in them for the last rendered frame, how many of those any of the cameras could
+ see, and how many had to be sent to the GPU because they changed. Any of the out parameters can be NULL.
+*/
+void triRenderer_GetLastTileChunkStats( int* outChunks, int* outVisible, int* outSent );
+
+/*
+Gets how long the stages of building the last set of batches took on the CPU: sorting, filling in the depths and
+ sending the vertices, splitting what the cameras can see out of the sorted order, gathering that into batches and
+ indices, and sending the indices and sprite instances. Any of the out parameters can be NULL.
+*/
+void triRenderer_GetLastUploadTimings( float* outSortMS, float* outVertexMS, float* outOrderMS, float* outBatchMS, float* outSendMS );
+
+/*
+Writes everything that goes into sorting and batching the next upload that takes at least minUploadMS on the CPU out
+ to the file, 0 captures the next upload whatever it takes. Only one upload is captured for each call.
+*/
+void triRenderer_CaptureUpload( const char* fileName, float minUploadMS );
+
+/*
+Replaces everything that's been added with an upload written out by triRenderer_CaptureUpload( ), so it can be
+ sorted and batched again with triRenderer_Upload( ) to see how long it takes. The camera render flags and scissor
+ areas are set to what they were when it was captured, and any sprite groups are replaced with the captured ones.
+ The capture has to be from a build that lays the triangles and sprites out the same way. Tile chunks don't keep
+ their tiles once they've been sent so they can't be captured, captures of uploads that had any are refused.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_LoadCapture( const char* fileName );
+
+/*
+Puts the sort entries of a loaded capture back in the order they were captured in, so uploading it again sorts the
+ same thing instead of what the last upload already sorted. Does nothing if there isn't a capture loaded.
+*/
+void triRenderer_RestoreCapture( void );
+
+/*
+Makes the sort keys for everything added since the last clear again and sorts them the same way triRenderer_Upload( )
+ does, without building or sending anything. Every call starts from the same order, so it can be used to measure
+ the sort.
+*/
+void triRenderer_SortAdded( void );
+
+/*
+Sorts all the triangles added since the last clear and sends them to the GPU, along with any changes to the sprite
+ groups and tile chunks. They'll be drawn by every call to triRenderer_Render( ) until the next upload, so this only
+ has to be done when the state being drawn changes.
+*/
+void triRenderer_Upload( void );
+
+/*
+Draws out all the uploaded triangles. t is how far to interpolate between the start and end states of the
+ triangles, anything past 1 will extrapolate the positions past the end state.
 */
-void triRenderer_Render( );
+void triRenderer_Render( float t );
 
 #endif /* inclusion guard */
\ No newline at end of file
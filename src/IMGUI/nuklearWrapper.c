@@ -7,12 +7,15 @@
 #include "../Graphics/triRendering.h"
 #include "../Graphics/scissor.h"
 #include "../System/memory.h"
+#include "../Utils/stretchyBuffer.h"
 #include "../Math/matrix4.h"
 #include "../Input/input.h"
 
 #include "../Graphics/debugRendering.h"
 
 #include "../Graphics/glPlatform.h"
+#include "../Graphics/glState.h"
+#include "../Graphics/renderStats.h"
 
 //struct nk_context* nkCtx = NULL;
 
@@ -32,7 +35,7 @@ typedef struct {
 static void uploadAtlas( NuklearWrapper* xu, const void *image, int width, int height)
 {
     GL( glGenTextures( 1, &( xu->fontTx ) ) );
-    GL( glBindTexture( GL_TEXTURE_2D, xu->fontTx ) );
+    glState_BindTexture( 0, GL_TEXTURE_2D, xu->fontTx );
     GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR ) );
     GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR ) );
     GL( glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, (GLsizei)width, (GLsizei)height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image ) );
@@ -172,7 +175,7 @@ void nk_xu_init( NuklearWrapper* xu, SDL_Window* win, bool useRelativeMousePos,
 	GL( glGenBuffers( 1, &( xu->ebo ) ) );
 	GL( glGenVertexArrays( 1, &( xu->vao ) ) );
 
-	GL( glBindVertexArray( xu->vao ) );
+	glState_BindVertexArray( xu->vao );
 	GL( glBindBuffer( GL_ARRAY_BUFFER, xu->vbo ) );
 	GL( glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, xu->ebo ) );
 
@@ -184,16 +187,29 @@ void nk_xu_init( NuklearWrapper* xu, SDL_Window* win, bool useRelativeMousePos,
 	GL( glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, vertSize, (void*)vertUV ) );
 	GL( glVertexAttribPointer( 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, vertSize, (void*)vertClr ) );
 
-	GL( glBindTexture( GL_TEXTURE_2D, 0 ) );
+	glState_BindTexture( 0, GL_TEXTURE_2D, 0 );
 	GL( glBindBuffer( GL_ARRAY_BUFFER, 0 ) );
 	GL( glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 ) );
-	GL( glBindVertexArray( 0 ) );
+	glState_BindVertexArray( 0 );
 
 	xu->renderWidth = renderWidth;
 	xu->renderHeight = renderHeight;
 
 	xu->useRelativeMousePos = useRelativeMousePos;
-	xu->clear = true;
+
+	for( int i = 0; i < NUM_FRAME_PACKETS; ++i ) {
+		NuklearPacket* packet = &( xu->packets[i] );
+		packet->vertices = mem_Allocate( MAX_VERTEX_MEMORY );
+		packet->elements = mem_Allocate( MAX_ELEMENT_MEMORY );
+		assert( ( packet->vertices != NULL ) && ( packet->elements != NULL ) );
+		packet->vertexBytes = 0;
+		packet->elementBytes = 0;
+		packet->sbCommands = NULL;
+		packet->renderWidth = renderWidth;
+		packet->renderHeight = renderHeight;
+	}
+	xu->writePacket = 0;
+	xu->readPacket = 0;
 }
 
 void nk_xu_fontStashBegin( NuklearWrapper* xu, struct nk_font_atlas** atlas )
@@ -307,138 +323,128 @@ void nk_xu_handleEvent( NuklearWrapper* xu, SDL_Event* evt )
     }
 }
 
+void nk_xu_snapshot( NuklearWrapper* xu )
+{
+	NuklearPacket* packet = &( xu->packets[xu->writePacket] );
+
+	// fill the convert configuration
+	struct nk_convert_config config;
+	memset( &config, 0, sizeof( config ) );
+
+	static const struct nk_draw_vertex_layout_element vertexLayout[] = {
+		{ NK_VERTEX_POSITION, NK_FORMAT_FLOAT, NK_OFFSETOF( nk_xturos_vertex, position ) },
+		{ NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, NK_OFFSETOF( nk_xturos_vertex, uv ) },
+		{ NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, NK_OFFSETOF( nk_xturos_vertex, col ) },
+		{ NK_VERTEX_LAYOUT_END }
+	};
+	config.vertex_layout = vertexLayout;
+	config.vertex_size = sizeof( nk_xturos_vertex );
+	config.vertex_alignment = NK_ALIGNOF( nk_xturos_vertex );
+
+	config.global_alpha = 1.0f;
+	config.shape_AA = NK_ANTI_ALIASING_OFF;
+	config.line_AA = NK_ANTI_ALIASING_OFF;
+	config.circle_segment_count = 22;
+	config.curve_segment_count = 22;
+	config.arc_segment_count = 22;
+	config.null = xu->nullTx;
+
+	// convert from command queue into the packets vertices and elements
+	struct nk_buffer vertBfr, elemBfr;
+	nk_buffer_init_fixed( &vertBfr, packet->vertices, (size_t)MAX_VERTEX_MEMORY );
+	nk_buffer_init_fixed( &elemBfr, packet->elements, (size_t)MAX_ELEMENT_MEMORY );
+	nk_convert( &( xu->ctx ), &( xu->cmds ), &vertBfr, &elemBfr, &config );
+	packet->vertexBytes = vertBfr.allocated;
+	packet->elementBytes = elemBfr.allocated;
+
+	// the draw commands are read out of the context, so they're copied as well
+	const struct nk_draw_command *cmd = NULL;
+	sb_Clear( packet->sbCommands );
+	nk_draw_foreach( cmd, &( xu->ctx ), &( xu->cmds ) ) {
+		if( cmd->elem_count == 0 ) continue;
+
+		NuklearDrawCommand* drawCmd = sb_Add( packet->sbCommands, 1 );
+		drawCmd->texture = (GLuint)( cmd->texture.id );
+		drawCmd->clipRect = cmd->clip_rect;
+		drawCmd->elemCount = cmd->elem_count;
+	}
+
+	packet->renderWidth = xu->renderWidth;
+	packet->renderHeight = xu->renderHeight;
+
+	nk_clear( &( xu->ctx ) );
+	nk_buffer_clear( &( xu->cmds ) );
+}
+
+void nk_xu_setWritePacket( NuklearWrapper* xu, int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	xu->writePacket = packet;
+}
+
+void nk_xu_setReadPacket( NuklearWrapper* xu, int packet )
+{
+	assert( ( packet >= 0 ) && ( packet < NUM_FRAME_PACKETS ) );
+	xu->readPacket = packet;
+}
+
 void nk_xu_render( NuklearWrapper* xu )
 {
+	NuklearPacket* packet = &( xu->packets[xu->readPacket] );
+
 	Matrix4 ortho;
-	mat4_CreateOrthographicProjection( 0.0f, (float)( xu->renderWidth ), 0.0f, (float)( xu->renderHeight ), -1000.0f, 1000.0f, &ortho );
+	mat4_CreateOrthographicProjection( 0.0f, (float)( packet->renderWidth ), 0.0f, (float)( packet->renderHeight ), -1000.0f, 1000.0f, &ortho );
 
 	// global state
-	glViewport( 0, 0, xu->renderWidth, xu->renderHeight );
-	GL( glEnable( GL_BLEND ) );
+	glViewport( 0, 0, packet->renderWidth, packet->renderHeight );
+	glState_SetEnabled( GL_BLEND, true );
 	GL( glBlendEquation( GL_FUNC_ADD ) );
-	GL( glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA ) );
-	GL( glDisable( GL_CULL_FACE ) );
-	GL( glDisable( GL_DEPTH_TEST ) );
-	GL( glEnable( GL_SCISSOR_TEST ) );
-	GL( glActiveTexture( GL_TEXTURE0 ) );
+	glState_BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	glState_SetEnabled( GL_CULL_FACE, false );
+	glState_SetEnabled( GL_DEPTH_TEST, false );
+	glState_SetEnabled( GL_SCISSOR_TEST, true );
 
-	GL( glUseProgram( xu->prog.programID ) );
+	glState_UseProgram( xu->prog.programID );
 	GL( glUniform1i( xu->prog.uniformLocs[1], 0 ) );
 	GL( glUniformMatrix4fv( xu->prog.uniformLocs[0], 1, GL_FALSE, &( ortho.m[0] ) ) );
 	{
-		// convert from command queue into draw list and render
-		const struct nk_draw_command *cmd = NULL;
-		void* vertices = NULL;
-		void* elements = NULL;
 		const nk_draw_index* offset = NULL;
 
-		// allocate vertex adn element buffer
-		GL( glBindVertexArray( xu->vao ) );
+		// load the vertices and elements converted when the packet was published
+		glState_BindVertexArray( xu->vao );
 		GL( glBindBuffer( GL_ARRAY_BUFFER, xu->vbo ) );
 		GL( glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, xu->ebo ) );
 
-		GL( glBufferData( GL_ARRAY_BUFFER, MAX_VERTEX_MEMORY, NULL, GL_STREAM_DRAW ) );
-		GL( glBufferData( GL_ELEMENT_ARRAY_BUFFER, MAX_ELEMENT_MEMORY, NULL, GL_STREAM_DRAW ) );
-
-		// load draw vertices and elements directly into vertex + element buffer
-		GLR( vertices, glMapBufferRange( GL_ARRAY_BUFFER, 0, MAX_VERTEX_MEMORY, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT ) );
-		GLR( elements, glMapBufferRange( GL_ELEMENT_ARRAY_BUFFER, 0, MAX_ELEMENT_MEMORY, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT ) );
-		{
-			// fill the convert configuration
-			struct nk_convert_config config;
-			memset( &config, 0, sizeof( config ) );
-
-			static const struct nk_draw_vertex_layout_element vertexLayout[] = {
-				{ NK_VERTEX_POSITION, NK_FORMAT_FLOAT, NK_OFFSETOF( nk_xturos_vertex, position ) },
-				{ NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, NK_OFFSETOF( nk_xturos_vertex, uv ) },
-				{ NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, NK_OFFSETOF( nk_xturos_vertex, col ) },
-				{ NK_VERTEX_LAYOUT_END }
-			};
-			config.vertex_layout = vertexLayout;
-			config.vertex_size = sizeof( nk_xturos_vertex );
-			config.vertex_alignment = NK_ALIGNOF( nk_xturos_vertex );
-
-			config.global_alpha = 1.0f;
-			config.shape_AA = NK_ANTI_ALIASING_OFF;
-			config.line_AA = NK_ANTI_ALIASING_OFF;
-			config.circle_segment_count = 22;
-			config.curve_segment_count = 22;
-			config.arc_segment_count = 22;
-			config.null = xu->nullTx;
-
-			// setup buffers to load vertices and elements
-			{
-				struct nk_buffer vertBfr, elemBfr;
-				nk_buffer_init_fixed( &vertBfr, vertices, (size_t)MAX_VERTEX_MEMORY );
-				nk_buffer_init_fixed( &elemBfr, elements, (size_t)MAX_ELEMENT_MEMORY );
-				nk_convert( &( xu->ctx ), &( xu->cmds ), &vertBfr, &elemBfr, &config );
-			}
-		}
-		GL( glUnmapBuffer( GL_ARRAY_BUFFER ) );
-		GL( glUnmapBuffer( GL_ELEMENT_ARRAY_BUFFER ) );
+		GL( glBufferData( GL_ARRAY_BUFFER, (GLsizeiptr)packet->vertexBytes, packet->vertices, GL_STREAM_DRAW ) );
+		GL( glBufferData( GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)packet->elementBytes, packet->elements, GL_STREAM_DRAW ) );
+		renderStats_CountUpload( packet->vertexBytes + packet->elementBytes );
 
 		// iterate over and execute each draw command
-		nk_draw_foreach( cmd, &( xu->ctx ), &( xu->cmds ) ) {
-			if( cmd->elem_count == 0 ) continue;
+		for( size_t i = 0; i < sb_Count( packet->sbCommands ); ++i ) {
+			NuklearDrawCommand* cmd = &( packet->sbCommands[i] );
 
-			GL( glBindTexture( GL_TEXTURE_2D, (GLuint)( cmd->texture.id ) ) );
+			glState_BindTexture( 0, GL_TEXTURE_2D, cmd->texture );
 			glScissor(
-				(GLint)( cmd->clip_rect.x ),
-				(GLint)( ( xu->renderHeight - (GLint)( cmd->clip_rect.y + cmd->clip_rect.h ) ) ),
-				(GLint)( cmd->clip_rect.w ),
-				(GLint)( cmd->clip_rect.h ) );
-
-			GL( glDrawElements( GL_TRIANGLES, (GLsizei)cmd->elem_count, GL_UNSIGNED_SHORT, offset ) );
-
-#if 0 // for debugging rendering
-#pragma warning(push)
-#pragma warning(disable: 4305)
-			for( unsigned short i = (unsigned short)offset; i < cmd->elem_count; i+=3 ) {
-#pragma warning(pop)
-				uint16_t vIdx0 = ( (uint16_t*)elements )[i];
-				uint16_t vIdx1 = ( (uint16_t*)elements )[i+1];
-				uint16_t vIdx2 = ( (uint16_t*)elements )[i+2];
-
-				struct nk_draw_vertex vert0 = ( (struct nk_draw_vertex*)vertices )[vIdx0];
-				struct nk_draw_vertex vert1 = ( (struct nk_draw_vertex*)vertices )[vIdx1];
-				struct nk_draw_vertex vert2 = ( (struct nk_draw_vertex*)vertices )[vIdx2];
-
-				Vector2 v2_0, v2_1, v2_2;
-				v2_0.x = (float)vert0.position.x;
-				v2_0.y = (float)vert0.position.y;
-
-				v2_1.x = (float)vert1.position.x;
-				v2_1.y = (float)vert1.position.y;
-
-				v2_2.x = (float)vert2.position.x;
-				v2_2.y = (float)vert2.position.y;
-
-				Color clr;
-				
-				clr.r = (float)( vert0.col & 0xFF ) / ( 255.0f );
-				clr.g = (float)( ( vert0.col >> 8 ) & 0xFF ) / ( 255.0f );
-				clr.b = (float)( ( vert0.col >> 16 ) & 0xFF ) / ( 255.0f );
-				clr.a = (float)( ( vert0.col >> 24 ) & 0xFF ) / ( 255.0f );
-
-				clr = CLR_MAGENTA;
-
-				debugRenderer_Line( 0xFFFFFFFF, v2_0, v2_1, clr );
-			}
-#endif
+				(GLint)( cmd->clipRect.x ),
+				(GLint)( ( packet->renderHeight - (GLint)( cmd->clipRect.y + cmd->clipRect.h ) ) ),
+				(GLint)( cmd->clipRect.w ),
+				(GLint)( cmd->clipRect.h ) );
 
-			offset += cmd->elem_count;
+			GL( glDrawElements( GL_TRIANGLES, (GLsizei)cmd->elemCount, GL_UNSIGNED_SHORT, offset ) );
+			renderStats_CountDraw( (int)( cmd->elemCount / 3 ) );
 
-			
+			offset += cmd->elemCount;
 		}
-		if( xu->clear ) nk_clear( &( xu->ctx ) );
 	}
 
-	GL( glUseProgram( 0 ) );
+	glState_UseProgram( 0 );
 	GL( glBindBuffer( GL_ARRAY_BUFFER, 0 ) );
 	GL( glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 ) );
-	GL( glBindVertexArray( 0 ) );
-	GL( glDisable( GL_BLEND ) );
-	GL( glDisable( GL_SCISSOR_TEST ) );
+	glState_BindVertexArray( 0 );
+	glState_SetEnabled( GL_BLEND, false );
+	glState_SetEnabled( GL_SCISSOR_TEST, false );
+
+	glDebugging_CheckPass( "imgui" );
 }
 
 void nk_xu_shutdown( NuklearWrapper* xu )
@@ -448,11 +454,17 @@ void nk_xu_shutdown( NuklearWrapper* xu )
 
 	// destroy the device stuff
 	shaders_Destroy( &( xu->prog ), 1 );
-	GL( glDeleteTextures( 1, &( xu->fontTx ) ) );
+	glState_DeleteTextures( 1, &( xu->fontTx ) );
 	GL( glDeleteBuffers( 1, &( xu->vbo ) ) );
 	GL( glDeleteBuffers( 1, &( xu->ebo ) ) );
 
 	nk_buffer_free( &( xu->cmds ) );
 
+	for( int i = 0; i < NUM_FRAME_PACKETS; ++i ) {
+		mem_Release( xu->packets[i].vertices );
+		mem_Release( xu->packets[i].elements );
+		sb_Release( xu->packets[i].sbCommands );
+	}
+
 	memset( &xu, 0, sizeof( xu ) );
 }
\ No newline at end of file
@@ -13,9 +13,29 @@ This is just an adaptation of the nuklear_sdl_gl3 example.
 #include "../Graphics/glPlatform.h"
 
 #include "../Graphics/shaderManager.h"
+#include "../Graphics/graphics.h"
 
 #include "nuklearHeader.h"
 
+// the ui is converted into vertices and draw commands when the frame packet is published, so the rendering never
+//  touches the context while the game is building the ui in it
+typedef struct {
+	GLuint texture;
+	struct nk_rect clipRect;
+	unsigned int elemCount;
+} NuklearDrawCommand;
+
+typedef struct {
+	void* vertices;
+	void* elements;
+	nk_size vertexBytes;
+	nk_size elementBytes;
+	NuklearDrawCommand* sbCommands;
+
+	int renderWidth;
+	int renderHeight;
+} NuklearPacket;
+
 typedef struct {
 	SDL_Window* win;
 
@@ -36,7 +56,9 @@ typedef struct {
 
 	bool useRelativeMousePos;
 
-	bool clear;
+	NuklearPacket packets[NUM_FRAME_PACKETS];
+	int writePacket;
+	int readPacket;
 
 	struct nk_context ctx;
 	struct nk_font_atlas fontAtlas;
@@ -51,6 +73,9 @@ void nk_xu_init( NuklearWrapper* xu, SDL_Window* win, bool useRelativeMousePos,
 void nk_xu_fontStashBegin( NuklearWrapper* xu, struct nk_font_atlas** atlas );
 void nk_xu_fontStashEnd( NuklearWrapper* xu );
 void nk_xu_handleEvent( NuklearWrapper* xu, SDL_Event* e );
+void nk_xu_snapshot( NuklearWrapper* xu ); // converts the ui into the write packet and clears it, call after the ui is built
+void nk_xu_setWritePacket( NuklearWrapper* xu, int packet );
+void nk_xu_setReadPacket( NuklearWrapper* xu, int packet );
 void nk_xu_render( NuklearWrapper* xu );
 void nk_xu_shutdown( NuklearWrapper* xu );
 
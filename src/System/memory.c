@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <SDL_stdinc.h>
+#include <SDL_mutex.h>
 
 #include "platformLog.h"
 
@@ -74,9 +75,35 @@ typedef struct {
 
 static Memory memoryBlock;
 
+// the simulation and rendering can run on separate threads and both allocate, so anything that touches the blocks
+//  has to hold this, it's recursive so the functions can call each other
+static SDL_mutex* memoryMutex = NULL;
+
 static void* watchedAddress = NULL;
 static MemoryBlockHeader* watchedHeader = NULL;
 
+// steady state auditing, once everything is loaded the game shouldn't need to allocate anything, so while in
+//  the steady state every allocation is recorded by where it came from and reported at the end of the frame
+#define MAX_STEADY_STATE_SITES 64
+typedef struct {
+	const char* fileName;
+	int line;
+	uint32_t count;
+	size_t bytes;
+} AllocationSite;
+
+static bool steadyState = false;
+static bool assertInSteadyState = false;
+static int steadyStateExemptions = 0;
+static uint32_t steadyStateFrame = 0;
+static uint32_t steadyStateTotalAllocations = 0;
+static AllocationSite steadyStateSites[MAX_STEADY_STATE_SITES];
+static int lastSteadyStateSite = -1;
+static uint32_t untrackedSteadyStateAllocations = 0;
+
+static void* allocateBlock( size_t size, const char* fileName, const int line );
+static void recordSteadyStateAllocation( size_t size, const char* fileName, int line );
+
 static void* alignAddress( void* addr )
 {
 	return (void*)( ( ( (uintptr_t)addr + ( ALIGN - 1 ) ) / ALIGN ) * ALIGN );
@@ -91,19 +118,21 @@ static MemoryBlockHeader* findMemoryBlock( void* ptr, bool ensureInUse )
 {
 	MemoryBlockHeader* block = NULL;
 
+	SDL_LockMutex( memoryMutex );
 	MemoryBlockHeader* header = (MemoryBlockHeader*)( memoryBlock.memory );
-	while( header != NULL ) {
+	while( ( block == NULL ) && ( header != NULL ) ) {
 		if( !ensureInUse || ( header->flags & IN_USE_FLAG ) ) {
 			void* dataStart = (void*)( (uintptr_t)header + MEMORY_HEADER_SIZE );
 			void* dataEnd = (void*)( (uint8_t*)( dataStart ) + header->size );
 			if( ( ptr >= dataStart ) && ( ptr < dataEnd ) ) {
-				return header;
+				block = header;
 			}
 		}
 		header = header->next;
 	}
+	SDL_UnlockMutex( memoryMutex );
 
-	return NULL;
+	return block;
 }
 
 #include <inttypes.h>
@@ -288,7 +317,7 @@ static void* growBlock( MemoryBlockHeader* header, size_t newSize, const char* f
 		// attempt to allocate some new memory
 		// if we get some then copy the memory over, release the old block,
 		//  and return the pointer to the beginning of the new block of data
-		result = mem_Allocate_Data( newSize, fileName, line );
+		result = allocateBlock( newSize, fileName, line );
 		if( result != NULL ) {
 			memcpy( result, (void*)( (uintptr_t)header + MEMORY_HEADER_SIZE ), header->size );
 			mem_Release( (void*)( (uintptr_t)header + MEMORY_HEADER_SIZE ) );
@@ -323,6 +352,13 @@ static void* shrinkBlock( MemoryBlockHeader* header, size_t newSize, const char*
 
 int mem_Init( size_t totalSize )
 {
+	if( memoryMutex == NULL ) {
+		memoryMutex = SDL_CreateMutex( );
+		if( memoryMutex == NULL ) {
+			return -1;
+		}
+	}
+
 	memoryBlock.memory = SDL_malloc(totalSize);
 
 	testingSetMemory( memoryBlock.memory, totalSize, 0xFF );
@@ -341,16 +377,23 @@ void mem_CleanUp( void )
 	// invalidates all the pointers
 	SDL_free( memoryBlock.memory );
 	memoryBlock.memory = NULL;
+
+	if( memoryMutex != NULL ) {
+		SDL_DestroyMutex( memoryMutex );
+		memoryMutex = NULL;
+	}
 }
 
 void mem_Log( void )
 {
 	llog( LOG_DEBUG, "=== Memory Use Log ===" );
+	SDL_LockMutex( memoryMutex );
 	MemoryBlockHeader* header = (MemoryBlockHeader*)( memoryBlock.memory );
 	while( header != NULL ) {
 		memoryBlockLogDump( header );
 		header = header->next;
 	}
+	SDL_UnlockMutex( memoryMutex );
 	llog( LOG_DEBUG, "=== End Memory Use Log ===" );
 }
 
@@ -368,6 +411,7 @@ void mem_Verify( void )
 {
 	// just follow the list, verifying that the guard value is correct
 	//  also make sure all the previous and next pointers are correct
+	SDL_LockMutex( memoryMutex );
 	MemoryBlockHeader* header = (MemoryBlockHeader*)( memoryBlock.memory );
 	bool firstBlock = true;
 	while( header != NULL ) {
@@ -387,23 +431,22 @@ void mem_Verify( void )
 		header = header->next;
 		firstBlock = false;
 	}
+	SDL_UnlockMutex( memoryMutex );
 }
 
 bool mem_GetVerify( void )
 {
 	// just follow the list, verifying that the guard value is correct
+	bool valid = true;
+	SDL_LockMutex( memoryMutex );
 	MemoryBlockHeader* header = (MemoryBlockHeader*)( memoryBlock.memory );
-	while( header != NULL ) {
-		if( header->guardValue != GUARD_VALUE ) {
-			return false;
-		}
-		if( header->postGuardValue != GUARD_VALUE ) {
-			return false;
-		}
+	while( valid && ( header != NULL ) ) {
+		valid = ( header->guardValue == GUARD_VALUE ) && ( header->postGuardValue == GUARD_VALUE );
 		header = header->next;
 	}
+	SDL_UnlockMutex( memoryMutex );
 
-	return true;
+	return valid;
 }
 
 void mem_VerifyPointer( void* p )
@@ -436,6 +479,7 @@ void mem_GetReportValues( size_t* totalOut, size_t* inUseOut, size_t* overheadOu
 	size_t overhead = 0;
 	uint32_t fragments = 0; // blocks not in use
 
+	SDL_LockMutex( memoryMutex );
 	MemoryBlockHeader* header = (MemoryBlockHeader*)( memoryBlock.memory );
 	while( header != NULL ) {
 		if( header->flags & IN_USE_FLAG ) {
@@ -448,6 +492,7 @@ void mem_GetReportValues( size_t* totalOut, size_t* inUseOut, size_t* overheadOu
 
 		header = header->next;
 	}
+	SDL_UnlockMutex( memoryMutex );
 
 	if( totalOut != NULL ) (*totalOut) = total;
 	if( inUseOut != NULL ) (*inUseOut) = inUse;
@@ -455,7 +500,7 @@ void mem_GetReportValues( size_t* totalOut, size_t* inUseOut, size_t* overheadOu
 	if( fragmentsOut != NULL ) (*fragmentsOut) = fragments;
 }
 
-void* mem_Allocate_Data( size_t size, const char* fileName, const int line )
+static void* allocateBlock( size_t size, const char* fileName, const int line )
 {
 #ifdef TEST_EVERY_CHANGE
 	mem_Verify( );
@@ -514,6 +559,16 @@ void* mem_Allocate_Data( size_t size, const char* fileName, const int line )
 	return (void*)result;
 }
 
+void* mem_Allocate_Data( size_t size, const char* fileName, const int line )
+{
+	SDL_LockMutex( memoryMutex );
+	recordSteadyStateAllocation( size, fileName, line );
+	void* result = allocateBlock( size, fileName, line );
+	SDL_UnlockMutex( memoryMutex );
+
+	return result;
+}
+
 void* mem_Resize_Data( void* memory, size_t newSize, const char* fileName, const int line )
 {
 #ifdef TEST_EVERY_CHANGE
@@ -521,11 +576,15 @@ void* mem_Resize_Data( void* memory, size_t newSize, const char* fileName, const
 #endif
 	assert( memoryBlock.memory != NULL );
 
+	// releasing through a resize isn't an allocation, so it isn't recorded for the steady state
 	if( newSize == 0 ) {
 		mem_Release( memory );
 		return NULL;
 	}
 
+	SDL_LockMutex( memoryMutex );
+	recordSteadyStateAllocation( newSize, fileName, line );
+
 	newSize = ALIGN_SIZE( newSize );
 
 	// two cases, when we want more and when we want less
@@ -544,7 +603,7 @@ void* mem_Resize_Data( void* memory, size_t newSize, const char* fileName, const
 			result = shrinkBlock( header, newSize, fileName, line );
 		}
 	} else {
-		result = mem_Allocate_Data( newSize, fileName, line );
+		result = allocateBlock( newSize, fileName, line );
 	}
 
 #ifdef TEST_EVERY_CHANGE
@@ -553,6 +612,7 @@ void* mem_Resize_Data( void* memory, size_t newSize, const char* fileName, const
 	assert( result != NULL );
 
 	logWatchedMemoryAddressChange( (MemoryBlockHeader*)( (uintptr_t)result - MEMORY_HEADER_SIZE ), "mem_Resize_Data", NULL );
+	SDL_UnlockMutex( memoryMutex );
 
 	return result;
 }
@@ -570,6 +630,7 @@ void mem_Release_Data( void* memory, const char* fileName, const int line )
 	
 	// set the associated block as not in use, and merge with nearby blocks if they're
 	//  not in use
+	SDL_LockMutex( memoryMutex );
 	MemoryBlockHeader* header = (MemoryBlockHeader*)( (uintptr_t)memory - MEMORY_HEADER_SIZE );
 	logWatchedMemoryAddressChange( header, "mem_Release_Data", NULL );
 	header->flags &= ~IN_USE_FLAG;
@@ -583,6 +644,116 @@ void mem_Release_Data( void* memory, const char* fileName, const int line )
 #ifdef TEST_EVERY_CHANGE
 	mem_Verify( );
 #endif
+	SDL_UnlockMutex( memoryMutex );
+}
+
+// the memory mutex has to be held when calling this
+static void recordSteadyStateAllocation( size_t size, const char* fileName, int line )
+{
+	if( !steadyState || ( steadyStateExemptions > 0 ) ) {
+		return;
+	}
+
+	++steadyStateTotalAllocations;
+
+	if( assertInSteadyState ) {
+		llog( LOG_CRITICAL, "Allocation of %u bytes during steady state at %s:%i", (unsigned int)size, fileName, line );
+		assert( false && "Allocation during steady state" );
+	}
+
+	for( int i = 0; i <= lastSteadyStateSite; ++i ) {
+		if( ( steadyStateSites[i].line == line ) && ( strcmp( steadyStateSites[i].fileName, fileName ) == 0 ) ) {
+			++steadyStateSites[i].count;
+			steadyStateSites[i].bytes += size;
+			return;
+		}
+	}
+
+	if( lastSteadyStateSite >= ( MAX_STEADY_STATE_SITES - 1 ) ) {
+		++untrackedSteadyStateAllocations;
+		return;
+	}
+
+	++lastSteadyStateSite;
+	steadyStateSites[lastSteadyStateSite].fileName = fileName;
+	steadyStateSites[lastSteadyStateSite].line = line;
+	steadyStateSites[lastSteadyStateSite].count = 1;
+	steadyStateSites[lastSteadyStateSite].bytes = size;
+}
+
+/*
+Turns the steady state on or off. While on every allocation and resize is counted and attributed to the file and
+ line it came from, these are logged when mem_EndSteadyStateFrame( ) is called. If assertOnAllocation is true
+ then any allocation while in the steady state will assert.
+*/
+void mem_SetSteadyState( bool inSteadyState, bool assertOnAllocation )
+{
+	SDL_LockMutex( memoryMutex );
+	steadyState = inSteadyState;
+	assertInSteadyState = assertOnAllocation;
+	steadyStateFrame = 0;
+	steadyStateTotalAllocations = 0;
+	lastSteadyStateSite = -1;
+	untrackedSteadyStateAllocations = 0;
+	SDL_UnlockMutex( memoryMutex );
+}
+
+/*
+Allocations made between a push and the matching pop aren't recorded, for things like loading a new screen.
+*/
+void mem_PushSteadyStateExemption( void )
+{
+	SDL_LockMutex( memoryMutex );
+	++steadyStateExemptions;
+	SDL_UnlockMutex( memoryMutex );
+}
+
+void mem_PopSteadyStateExemption( void )
+{
+	SDL_LockMutex( memoryMutex );
+	assert( steadyStateExemptions > 0 );
+	--steadyStateExemptions;
+	SDL_UnlockMutex( memoryMutex );
+}
+
+/*
+Logs all the allocations that happened since the last call and resets the per frame counts.
+*/
+void mem_EndSteadyStateFrame( void )
+{
+	SDL_LockMutex( memoryMutex );
+	if( !steadyState ) {
+		SDL_UnlockMutex( memoryMutex );
+		return;
+	}
+
+	if( ( lastSteadyStateSite >= 0 ) || ( untrackedSteadyStateAllocations > 0 ) ) {
+		llog( LOG_WARN, "Steady state frame %u allocated memory:", steadyStateFrame );
+		for( int i = 0; i <= lastSteadyStateSite; ++i ) {
+			llog( LOG_WARN, "  %s:%i - %u allocations, %u bytes", steadyStateSites[i].fileName, steadyStateSites[i].line,
+				steadyStateSites[i].count, (unsigned int)steadyStateSites[i].bytes );
+		}
+		if( untrackedSteadyStateAllocations > 0 ) {
+			llog( LOG_WARN, "  %u allocations from other locations", untrackedSteadyStateAllocations );
+		}
+	}
+
+	lastSteadyStateSite = -1;
+	untrackedSteadyStateAllocations = 0;
+	++steadyStateFrame;
+	SDL_UnlockMutex( memoryMutex );
+}
+
+/*
+Gets the total number of allocations made since the steady state was turned on.
+*/
+uint32_t mem_GetSteadyStateAllocationCount( void )
+{
+	SDL_LockMutex( memoryMutex );
+	uint32_t count = steadyStateTotalAllocations;
+	SDL_UnlockMutex( memoryMutex );
+
+	return count;
 }
 
 void mem_WatchAddress( void* ptr )
@@ -609,6 +780,8 @@ void mem_UnWatchAddress( void* ptr )
 void mem_RunTests( void )
 {
 	void* oldMemoryBlock = memoryBlock.memory;
+	SDL_mutex* oldMemoryMutex = memoryMutex;
+	memoryMutex = NULL;
 
 	uint8_t* testOne;
 	uint8_t* testTwo;
@@ -762,4 +935,5 @@ void mem_RunTests( void )
 
 	// restore old memory block
 	memoryBlock.memory = oldMemoryBlock;
+	memoryMutex = oldMemoryMutex;
 }
\ No newline at end of file
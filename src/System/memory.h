@@ -18,6 +18,13 @@ void mem_GetReportValues( size_t* totalOut, size_t* inUseOut, size_t* overheadOu
 void mem_WatchAddress( void* ptr );
 void mem_UnWatchAddress( void* ptr );
 
+// steady state auditing, reports any allocations made after everything has been loaded
+void mem_SetSteadyState( bool inSteadyState, bool assertOnAllocation );
+void mem_PushSteadyStateExemption( void );
+void mem_PopSteadyStateExemption( void );
+void mem_EndSteadyStateFrame( void );
+uint32_t mem_GetSteadyStateAllocationCount( void );
+
 #define mem_Allocate( s ) mem_Allocate_Data( (s), __FILE__, __LINE__ )
 #define mem_Resize( p, s ) mem_Resize_Data( (p), (s), __FILE__, __LINE__ )
 #define mem_Release( p ) mem_Release_Data( (p), __FILE__, __LINE__ )
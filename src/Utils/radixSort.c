@@ -0,0 +1,75 @@
+#include "radixSort.h"
+
+#include <string.h>
+
+#define RADIX_BITS 8
+#define RADIX_SIZE ( 1 << RADIX_BITS )
+#define NUM_PASSES ( 64 / RADIX_BITS )
+
+/*
+Sorts the entries from the lowest key to the highest. The sort is stable so entries with matching keys stay in
+ the order they were in. The scratch buffer has to be able to hold count entries. Passes over bytes that are
+ the same for every key are skipped, so unused bits in the keys don't cost anything.
+ Returns whichever of entries or scratch ended up holding the sorted entries.
+*/
+RadixSortEntry* radix_Sort( RadixSortEntry* entries, RadixSortEntry* scratch, size_t count )
+{
+	if( count <= 1 ) {
+		return entries;
+	}
+
+	// build the histograms for every pass at once so we only have to go over the keys one extra time
+	size_t histograms[NUM_PASSES][RADIX_SIZE];
+	memset( histograms, 0, sizeof( histograms ) );
+	for( size_t i = 0; i < count; ++i ) {
+		uint64_t key = entries[i].key;
+		for( int p = 0; p < NUM_PASSES; ++p ) {
+			++histograms[p][( key >> ( p * RADIX_BITS ) ) & ( RADIX_SIZE - 1 )];
+		}
+	}
+
+	RadixSortEntry* src = entries;
+	RadixSortEntry* dest = scratch;
+	for( int p = 0; p < NUM_PASSES; ++p ) {
+		size_t* histogram = histograms[p];
+		int shift = p * RADIX_BITS;
+
+		// if every key has the same value for this byte then the pass wouldn't change anything
+		if( histogram[( src[0].key >> shift ) & ( RADIX_SIZE - 1 )] == count ) {
+			continue;
+		}
+
+		// turn the counts into the starting offsets for each bucket
+		size_t offset = 0;
+		for( int b = 0; b < RADIX_SIZE; ++b ) {
+			size_t bucketCount = histogram[b];
+			histogram[b] = offset;
+			offset += bucketCount;
+		}
+
+		for( size_t i = 0; i < count; ++i ) {
+			dest[histogram[( src[i].key >> shift ) & ( RADIX_SIZE - 1 )]++] = src[i];
+		}
+
+		RadixSortEntry* temp = src;
+		src = dest;
+		dest = temp;
+	}
+
+	return src;
+}
+
+/*
+Converts a float to an unsigned integer that sorts in the same order as the float.
+*/
+uint32_t radix_FloatToKey( float f )
+{
+	uint32_t bits;
+	memcpy( &bits, &f, sizeof( bits ) );
+
+	// negative numbers need to be flipped so larger magnitudes come first, positive just need to be above them
+	if( bits & 0x80000000 ) {
+		return ~bits;
+	}
+	return ( bits | 0x80000000 );
+}
@@ -0,0 +1,30 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Sorting for packed 64-bit keys. Instead of moving around whatever is being sorted we sort small key and index
+ pairs and then use the indices to look up the original data.
+*/
+
+typedef struct {
+	uint64_t key;
+	uint32_t value;
+} RadixSortEntry;
+
+/*
+Sorts the entries from the lowest key to the highest. The sort is stable so entries with matching keys stay in
+ the order they were in. The scratch buffer has to be able to hold count entries. Passes over bytes that are
+ the same for every key are skipped, so unused bits in the keys don't cost anything.
+ Returns whichever of entries or scratch ended up holding the sorted entries.
+*/
+RadixSortEntry* radix_Sort( RadixSortEntry* entries, RadixSortEntry* scratch, size_t count );
+
+/*
+Converts a float to an unsigned integer that sorts in the same order as the float.
+*/
+uint32_t radix_FloatToKey( float f );
+
+#endif // inclusion guard
@@ -2,6 +2,8 @@
 
 #include <assert.h>
 
+#include "System/memory.h"
+
 // this is a simple state machine for right now, will most likely modify it to be heirarchical at some point
 //  but it's not necessary now
 
@@ -11,6 +13,9 @@ void gsmEnterState( struct GameStateMachine* fsm, struct GameState* newState )
 {
 	assert( fsm );
 
+	// changing states is where loading happens, so it's fine if it allocates
+	mem_PushSteadyStateExemption( );
+
 	if( ( fsm->currentState != NULL ) && ( fsm->currentState->exit != NULL ) ) {
 		fsm->currentState->exit( );
 	}
@@ -19,6 +24,8 @@ void gsmEnterState( struct GameStateMachine* fsm, struct GameState* newState )
 		newState->enter( );
 	}
 
+	mem_PopSteadyStateExemption( );
+
 	fsm->currentState = newState;
 }
 
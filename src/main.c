@@ -27,6 +27,7 @@
 #include "gameState.h"
 #include "Game/gameScreen.h"
 #include "Game/titleScreen.h"
+#include "Game/stressTestScreen.h"
 #include "Game/resources.h"
 
 #include "System/memory.h"
@@ -34,8 +35,13 @@
 #include "System/platformLog.h"
 #include "System/random.h"
 
-#include "Graphics\debugRendering.h"
-#include "Graphics\glPlatform.h"
+#include "Graphics/debugRendering.h"
+#include "Graphics/glPlatform.h"
+#include "Graphics/glDebugging.h"
+#include "Graphics/gfxUtil.h"
+#include "Graphics/shaderManager.h"
+#include "Graphics/renderStats.h"
+#include "Graphics/triRendering.h"
 
 #define RENDER_WIDTH 512
 #define RENDER_HEIGHT 288
@@ -48,7 +54,7 @@
 #endif
 
 static bool running;
-static bool focused;
+static SDL_atomic_t focused; // read by the simulation thread
 static unsigned int lastTicks;
 static unsigned int physicsTickAcc;
 static SDL_Window* window;
@@ -60,8 +66,39 @@ the second number is how many times per second it will update */
 #define PHYSICS_TICK ( 1000 / 30 )
 #define PHYSICS_DELTA ( (float)PHYSICS_TICK / 1000.0f )
 
+/* when the simulation is threaded all the processing, physics ticks, and draw instruction generation is done on
+the simulation thread, the main thread just handles the window, polls events, and renders whatever the last frame
+packet published was. events are queued up here for the simulation thread to process.
+note: the IMGUI instances are still handled by the main thread, so they shouldn't be used by the game states */
+#define MAX_QUEUED_SIM_EVENTS 256
+static bool threadedSimulation;
+
+// start in the stress test scene instead of the title screen, used for benchmarking
+static bool runStressTest;
+static SDL_Thread* simThread;
+static SDL_atomic_t simRunning;
+static SDL_sem* simWakeSem;
+static SDL_mutex* simEventMutex;
+static SDL_Event queuedSimEvents[MAX_QUEUED_SIM_EVENTS];
+static int numQueuedSimEvents;
+
+/* input latency measurement, times how long it takes from when an input event is polled to when the frame showing
+the state of the first physics tick that processed it is swapped in. when the simulation is threaded the input has
+to go through the event queue and a frame packet first, both threads move the stage along so it's atomic */
+enum {
+	LATENCY_IDLE,
+	LATENCY_QUEUED, // waiting for the simulation thread to take the input out of the queue
+	LATENCY_WAITING_FOR_TICK,
+	LATENCY_PUBLISHED, // waiting for the frame packet with the results to be acquired
+	LATENCY_WAITING_FOR_SWAP
+};
+static SDL_atomic_t latencyStage;
+static Uint64 latencyInputTime;
+
 void cleanUp( void )
 {
+	renderStats_StopCSV( );
+
 	SDL_DestroyWindow( window );
 	window = NULL;
 
@@ -164,6 +201,50 @@ int initEverything( void )
 	cfg_GetInt( oglCFGFile, "GREEN_SIZE", 8, &greenSize );
 	cfg_GetInt( oglCFGFile, "BLUE_SIZE", 8, &blueSize );
 	cfg_GetInt( oglCFGFile, "DEPTH_SIZE", 16, &depthSize );
+
+	int useSimThread;
+	cfg_GetInt( oglCFGFile, "THREADED_SIMULATION", 0, &useSimThread );
+
+	int extrapolate;
+	cfg_GetInt( oglCFGFile, "EXTRAPOLATE_RENDERING", 0, &extrapolate );
+
+	// packs textures with matching sizes into array textures so they can be drawn together
+	int textureArrays;
+	cfg_GetInt( oglCFGFile, "TEXTURE_ARRAYS", 0, &textureArrays );
+
+	int stressTest;
+	cfg_GetInt( oglCFGFile, "STRESS_TEST", 0, &stressTest );
+	runStressTest = ( stressTest != 0 );
+
+	// 0 is off, 1 logs any allocations made after loading, 2 asserts on them
+	int steadyStateAudit;
+	cfg_GetInt( oglCFGFile, "STEADY_STATE_AUDIT", 0, &steadyStateAudit );
+
+	// 0 is off, 1 checks every frame, 2 every pass, 3 after every call, 4 has the driver report through KHR_debug
+	int errorCheckMode;
+	cfg_GetInt( oglCFGFile, "GL_ERROR_CHECKS", DEFAULT_GL_ERROR_CHECK_MODE, &errorCheckMode );
+
+	// what the driver reports when using KHR_debug, 0 is only high severity, 1 medium, 2 low, and 3 includes notifications
+	int debugOutputSeverity;
+	cfg_GetInt( oglCFGFile, "GL_DEBUG_SEVERITY", 1, &debugOutputSeverity );
+
+	// keeps the linked shader programs around so they don't have to be built again the next time
+	int shaderCache;
+	cfg_GetInt( oglCFGFile, "SHADER_CACHE", 1, &shaderCache );
+
+	// writes the timings and counts for every rendered frame out to renderStats.csv
+	int renderStatsCSV;
+	cfg_GetInt( oglCFGFile, "RENDER_STATS_CSV", 0, &renderStatsCSV );
+
+	// writes the first triangle upload that takes at least this many milliseconds out to renderCapture.bin so it can
+	//  be replayed with xturosReplay, 0 is off, F12 captures the next upload whatever it takes
+	int renderCaptureMS;
+	cfg_GetInt( oglCFGFile, "RENDER_CAPTURE_MS", 0, &renderCaptureMS );
+#if defined( __EMSCRIPTEN__ )
+	threadedSimulation = false;
+#else
+	threadedSimulation = ( useSimThread != 0 );
+#endif
 	cfg_CloseFile( oglCFGFile );
 
 	SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, PROFILE );
@@ -174,6 +255,9 @@ int initEverything( void )
     SDL_GL_SetAttribute( SDL_GL_BLUE_SIZE, blueSize );
     SDL_GL_SetAttribute( SDL_GL_DEPTH_SIZE, depthSize );
     SDL_GL_SetAttribute( SDL_GL_DOUBLEBUFFER, 1 );
+	if( errorCheckMode == GLEC_DEBUG_OUTPUT ) {
+		SDL_GL_SetAttribute( SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG );
+	}
 
 	window = SDL_CreateWindow( windowName, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
 		WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE );
@@ -183,10 +267,32 @@ int initEverything( void )
 	}
 	llog( LOG_INFO, "SDL OpenGL window successfully created" );
 
+	if( shaderCache != 0 ) {
+		char* prefPath = SDL_GetPrefPath( "Xturos", windowName );
+		if( prefPath != NULL ) {
+			shaders_SetCacheDirectory( prefPath );
+			SDL_free( prefPath );
+		} else {
+			llog( LOG_WARN, "Unable to get a directory to cache shaders in: %s", SDL_GetError( ) );
+		}
+	}
+
 	// Create rendering
 	if( gfx_Init( window, RENDER_WIDTH, RENDER_HEIGHT ) < 0 ) {
 		return -1;
 	}
+	if( glDebugging_SetErrorCheckMode( (GLErrorCheckMode)errorCheckMode ) == GLEC_DEBUG_OUTPUT ) {
+		GLenum severities[] = { GL_DEBUG_SEVERITY_HIGH, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_NOTIFICATION };
+		glDebugging_SetDebugOutputSeverity( severities[MAX( 0, MIN( 3, debugOutputSeverity ) )] );
+	}
+	if( renderStatsCSV != 0 ) {
+		renderStats_StartCSV( "renderStats.csv" );
+	}
+	if( renderCaptureMS > 0 ) {
+		triRenderer_CaptureUpload( "renderCapture.bin", (float)renderCaptureMS );
+	}
+	gfx_SetPresentationMode( ( extrapolate != 0 ) ? PM_EXTRAPOLATE : PM_INTERPOLATE );
+	gfxUtil_SetTextureArraysEnabled( textureArrays != 0 );
 	llog( LOG_INFO, "Rendering successfully initialized" );
 
 	// Create sound mixer
@@ -219,15 +325,61 @@ int initEverything( void )
 
 	loadResources( );
 
+	mem_SetSteadyState( steadyStateAudit != 0, steadyStateAudit == 2 );
+
 	return 0;
 }
 
+/* starts timing an input event if we're not already timing one, startStage is where the timing picks up from */
+static void startLatencyMeasurement( SDL_Event* e, int startStage )
+{
+	if( SDL_AtomicGet( &latencyStage ) != LATENCY_IDLE ) {
+		return;
+	}
+
+	if( ( ( e->type == SDL_KEYDOWN ) && !e->key.repeat ) ||
+		( e->type == SDL_MOUSEBUTTONDOWN ) || ( e->type == SDL_FINGERDOWN ) ) {
+		latencyInputTime = SDL_GetPerformanceCounter( );
+		SDL_AtomicSet( &latencyStage, startStage );
+	}
+}
+
+/* called after the window has been swapped, finishes the timing if the results of the input are on screen */
+static void finishLatencyMeasurement( void )
+{
+	if( ( SDL_AtomicGet( &latencyStage ) != LATENCY_WAITING_FOR_SWAP ) || !gfx_IsShowingLatestState( ) ) {
+		return;
+	}
+	SDL_AtomicSet( &latencyStage, LATENCY_IDLE );
+
+	gfx_RecordInputLatency( ( (double)( SDL_GetPerformanceCounter( ) - latencyInputTime ) * 1000.0 ) / (double)SDL_GetPerformanceFrequency( ) );
+}
+
+/* queues an event up to be processed by the simulation thread */
+static void queueSimEvent( SDL_Event* e )
+{
+	SDL_LockMutex( simEventMutex );
+		if( numQueuedSimEvents < MAX_QUEUED_SIM_EVENTS ) {
+			queuedSimEvents[numQueuedSimEvents] = (*e);
+			++numQueuedSimEvents;
+			// started while locked so the simulation thread can't take the event before it's being timed
+			startLatencyMeasurement( e, LATENCY_QUEUED );
+		} else {
+			llog( LOG_WARN, "Simulation event queue full, dropping event." );
+		}
+	SDL_UnlockMutex( simEventMutex );
+}
+
 /* input processing */
 void processEvents( int windowsEventsOnly )
 {
 	SDL_Event e;
-	nk_input_begin( &( editorIMGUI.ctx ) );
-	nk_input_begin( &( inGameIMGUI.ctx ) );
+	int numQueued = 0;
+	// when threaded the nuklear contexts belong to the simulation thread, they get their input from the queued events
+	if( !threadedSimulation ) {
+		nk_input_begin( &( editorIMGUI.ctx ) );
+		nk_input_begin( &( inGameIMGUI.ctx ) );
+	}
 	while( SDL_PollEvent( &e ) != 0 ) {
 		if( e.type == SDL_WINDOWEVENT ) {
 			switch( e.window.event ) {
@@ -240,12 +392,12 @@ void processEvents( int windowsEventsOnly )
 			// will want to handle these messages for pausing and unpausing the game when they lose focus
 			case SDL_WINDOWEVENT_FOCUS_GAINED:
 				llog( LOG_DEBUG, "Gained focus" );
-				focused = true;
+				SDL_AtomicSet( &focused, 1 );
 				snd_SetFocus( true );
 				break;
 			case SDL_WINDOWEVENT_FOCUS_LOST:
 				llog( LOG_DEBUG, "Lost focus" );
-				focused = false;
+				SDL_AtomicSet( &focused, 0 );
 				snd_SetFocus( false );
 				break;
 			}
@@ -256,22 +408,183 @@ void processEvents( int windowsEventsOnly )
 			running = false;
 		}
 
+		// the uploads happen on this thread, so the capture can be asked for here even when the simulation is threaded
+		if( ( e.type == SDL_KEYDOWN ) && !e.key.repeat && ( e.key.keysym.sym == SDLK_F12 ) ) {
+			triRenderer_CaptureUpload( "renderCapture.bin", 0.0f );
+		}
+
 		if( windowsEventsOnly ) { 
 			continue;
 		}
 
-		sys_ProcessEvents( &e );
-		input_ProcessEvents( &e );
-		gsmProcessEvents( &globalFSM, &e );
-		//imgui_ProcessEvents( &e ); // just for TextInput events when text input is enabled
-		nk_xu_handleEvent( &editorIMGUI, &e );
-		nk_xu_handleEvent( &inGameIMGUI, &e );
+		if( threadedSimulation ) {
+			queueSimEvent( &e );
+			++numQueued;
+		} else {
+			startLatencyMeasurement( &e, LATENCY_WAITING_FOR_TICK );
+			sys_ProcessEvents( &e );
+			input_ProcessEvents( &e );
+			gsmProcessEvents( &globalFSM, &e );
+			//imgui_ProcessEvents( &e ); // just for TextInput events when text input is enabled
+			nk_xu_handleEvent( &editorIMGUI, &e );
+			nk_xu_handleEvent( &inGameIMGUI, &e );
+		}
+	}
+
+	if( !threadedSimulation ) {
+		nk_input_end( &( editorIMGUI.ctx ) );
+		nk_input_end( &( inGameIMGUI.ctx ) );
+	}
+
+	// wake up the simulation thread so it can respond to the input
+	if( numQueued > 0 ) {
+		SDL_SemPost( simWakeSem );
 	}
+}
+
+/* processes everything the main thread has queued up for the simulation thread */
+static void processQueuedSimEvents( void )
+{
+	static SDL_Event processingEvents[MAX_QUEUED_SIM_EVENTS];
+	int numProcessing;
+
+	SDL_LockMutex( simEventMutex );
+		numProcessing = numQueuedSimEvents;
+		SDL_memcpy( processingEvents, queuedSimEvents, sizeof( SDL_Event ) * numProcessing );
+		numQueuedSimEvents = 0;
+		// anything being timed was in the queue, so it's processed before the next tick
+		SDL_AtomicCAS( &latencyStage, LATENCY_QUEUED, LATENCY_WAITING_FOR_TICK );
+	SDL_UnlockMutex( simEventMutex );
 
+	nk_input_begin( &( editorIMGUI.ctx ) );
+	nk_input_begin( &( inGameIMGUI.ctx ) );
+	for( int i = 0; i < numProcessing; ++i ) {
+		sys_ProcessEvents( &( processingEvents[i] ) );
+		input_ProcessEvents( &( processingEvents[i] ) );
+		gsmProcessEvents( &globalFSM, &( processingEvents[i] ) );
+		nk_xu_handleEvent( &editorIMGUI, &( processingEvents[i] ) );
+		nk_xu_handleEvent( &inGameIMGUI, &( processingEvents[i] ) );
+	}
 	nk_input_end( &( editorIMGUI.ctx ) );
 	nk_input_end( &( inGameIMGUI.ctx ) );
 }
 
+/* the simulation thread, does the same thing as the main loop but instead of rendering it publishes a frame
+packet every time new draw instructions are generated */
+static int simulationThread( void* data )
+{
+	unsigned int simLastTicks = SDL_GetTicks( );
+	unsigned int simTickAcc = 0;
+
+	while( SDL_AtomicGet( &simRunning ) ) {
+		unsigned int currTicks = SDL_GetTicks( );
+		unsigned int tickDelta = currTicks - simLastTicks;
+		simLastTicks = currTicks;
+
+		if( !SDL_AtomicGet( &focused ) ) {
+			SDL_SemWaitTimeout( simWakeSem, PHYSICS_TICK );
+			continue;
+		}
+
+		simTickAcc += tickDelta;
+
+		// process input
+		processQueuedSimEvents( );
+
+		// handle per frame update
+		sys_Process( );
+		gsmProcess( &globalFSM );
+
+		// process movement, collision, and other things that require a delta time
+		int numPhysicsProcesses = 0;
+		while( simTickAcc > PHYSICS_TICK ) {
+			sys_PhysicsTick( PHYSICS_DELTA );
+			gsmPhysicsTick( &globalFSM, PHYSICS_DELTA );
+			simTickAcc -= PHYSICS_TICK;
+			++numPhysicsProcesses;
+		}
+
+		if( numPhysicsProcesses > 0 ) {
+			// set the new render positions
+			float renderDelta = PHYSICS_DELTA * (float)numPhysicsProcesses;
+			gfx_ClearDrawCommands( renderDelta );
+			cam_FinalizeStates( renderDelta );
+
+			// set up rendering for everything
+			sys_Draw( );
+			gsmDraw( &globalFSM );
+
+			// hand it off to the main thread, nothing in this packet will be touched again until it's rendered
+			gfx_PublishFramePacket( );
+			SDL_AtomicCAS( &latencyStage, LATENCY_WAITING_FOR_TICK, LATENCY_PUBLISHED );
+		}
+
+		// sleep until the next physics tick is due or the main thread has sent us more input
+		unsigned int timeToNextTick = ( simTickAcc > PHYSICS_TICK ) ? 0 : ( ( PHYSICS_TICK + 1 ) - simTickAcc );
+		SDL_SemWaitTimeout( simWakeSem, timeToNextTick );
+	}
+
+	return 0;
+}
+
+/* creates everything needed to run the simulation on it's own thread and starts it
+ returns < 0 on failure */
+static int startSimulationThread( void )
+{
+	simEventMutex = SDL_CreateMutex( );
+	if( simEventMutex == NULL ) {
+		llog( LOG_ERROR, "Unable to create simulation event mutex: %s", SDL_GetError( ) );
+		return -1;
+	}
+
+	simWakeSem = SDL_CreateSemaphore( 0 );
+	if( simWakeSem == NULL ) {
+		llog( LOG_ERROR, "Unable to create simulation semaphore: %s", SDL_GetError( ) );
+		return -1;
+	}
+
+	if( gfx_UseFramePackets( ) < 0 ) {
+		return -1;
+	}
+
+	numQueuedSimEvents = 0;
+	SDL_AtomicSet( &latencyStage, LATENCY_IDLE );
+	SDL_AtomicSet( &simRunning, 1 );
+	simThread = SDL_CreateThread( simulationThread, "simulation", NULL );
+	if( simThread == NULL ) {
+		llog( LOG_ERROR, "Unable to create simulation thread: %s", SDL_GetError( ) );
+		SDL_AtomicSet( &simRunning, 0 );
+		return -1;
+	}
+
+	llog( LOG_INFO, "Simulation thread started." );
+	return 0;
+}
+
+static void stopSimulationThread( void )
+{
+	if( simThread != NULL ) {
+		SDL_AtomicSet( &simRunning, 0 );
+		SDL_SemPost( simWakeSem );
+		SDL_WaitThread( simThread, NULL );
+		simThread = NULL;
+	}
+
+	// nothing is writing to the frame packets anymore, go back to drawing everything from the first one
+	gfx_StopUsingFramePackets( );
+	SDL_AtomicSet( &latencyStage, LATENCY_IDLE );
+
+	if( simWakeSem != NULL ) {
+		SDL_DestroySemaphore( simWakeSem );
+		simWakeSem = NULL;
+	}
+
+	if( simEventMutex != NULL ) {
+		SDL_DestroyMutex( simEventMutex );
+		simEventMutex = NULL;
+	}
+}
+
 // needed to be able to work in javascript
 void mainLoop( void* v )
 {
@@ -290,11 +603,32 @@ void mainLoop( void* v )
 	tickDelta = currTicks - lastTicks;
 	lastTicks = currTicks;
 
-	if( !focused ) {
+	if( !SDL_AtomicGet( &focused ) ) {
 		processEvents( 1 );
 		return;
 	}
 
+	if( threadedSimulation ) {
+		// the simulation thread handles everything besides the rendering
+		processEvents( 0 );
+
+		// a packet published before this will be the one acquired, or was replaced by or already is the one being drawn
+		bool latencyPublished = ( SDL_AtomicGet( &latencyStage ) == LATENCY_PUBLISHED );
+		gfx_AcquireFramePacket( );
+		if( latencyPublished ) {
+			SDL_AtomicSet( &latencyStage, LATENCY_WAITING_FOR_SWAP );
+		}
+
+		float dt = (float)tickDelta / 1000.0f;
+		cam_Update( dt );
+		gfx_Render( dt );
+		SDL_GL_SwapWindow( window );
+
+		finishLatencyMeasurement( );
+		mem_EndSteadyStateFrame( );
+		return;
+	}
+
 	physicsTickAcc += tickDelta;
 
 	// process input
@@ -314,8 +648,6 @@ void mainLoop( void* v )
 	}
 
 	// rendering
-	editorIMGUI.clear = false;
-	inGameIMGUI.clear = false;
 	if( numPhysicsProcesses > 0 ) {
 		// set the new render positions
 		renderDelta = PHYSICS_DELTA * (float)numPhysicsProcesses;
@@ -325,9 +657,9 @@ void mainLoop( void* v )
 		// set up rendering for everything
 		sys_Draw( );
 		gsmDraw( &globalFSM );
+		gfx_PublishFramePacket( );
 
-		editorIMGUI.clear = true;
-		inGameIMGUI.clear = true;
+		SDL_AtomicCAS( &latencyStage, LATENCY_WAITING_FOR_TICK, LATENCY_WAITING_FOR_SWAP );
 	}
 
 	// do the actual drawing for this frame
@@ -336,6 +668,9 @@ void mainLoop( void* v )
 	gfx_Render( dt );
 	// flip here so we don't have to store the window anywhere else
 	SDL_GL_SwapWindow( window );
+
+	finishLatencyMeasurement( );
+	mem_EndSteadyStateFrame( );
 }
 
 int main( int argc, char** argv )
@@ -358,10 +693,16 @@ int main( int argc, char** argv )
 	lastTicks = SDL_GetTicks( );
 	physicsTickAcc = 0;
 #if defined( __ANDROID__ )
-	focused = true;
+	SDL_AtomicSet( &focused, 1 );
 #endif
 
-	gsmEnterState( &globalFSM, &titleScreenState );
+	gsmEnterState( &globalFSM, runStressTest ? &stressTestScreenState : &titleScreenState );
+
+	if( threadedSimulation && ( startSimulationThread( ) < 0 ) ) {
+		llog( LOG_WARN, "Unable to run simulation on a separate thread, falling back to single threaded." );
+		stopSimulationThread( );
+		threadedSimulation = false;
+	}
 
 #if defined( __EMSCRIPTEN__ )
 	emscripten_set_main_loop_arg( mainLoop, NULL, -1, 1 );
@@ -371,5 +712,7 @@ int main( int argc, char** argv )
 	}
 #endif
 
+	stopSimulationThread( );
+
 	return 0;
 }
\ No newline at end of file
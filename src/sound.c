@@ -7,13 +7,13 @@
 #include <stdlib.h>
 #include <math.h>
 
-#include "Others\stb_vorbis_sdl.c"
-#include "System\platformLog.h"
-#include "Math\mathUtil.h"
-#include "System\memory.h"
-#include "Utils\stretchyBuffer.h"
-#include "Utils\helpers.h"
-#include "Utils\cfgFile.h"
+#include "Others/stb_vorbis_sdl.c"
+#include "System/platformLog.h"
+#include "Math/mathUtil.h"
+#include "System/memory.h"
+#include "Utils/stretchyBuffer.h"
+#include "Utils/helpers.h"
+#include "Utils/cfgFile.h"
 
 #define MAX_SAMPLES 256
 #define MAX_PLAYING_SOUNDS 32
@@ -31,6 +31,7 @@ void snd_SetMasterVolume( float volume ) { }
 float snd_GetVolume( unsigned int group ) { return 0.0f; }
 void snd_SetVolume( float volume, unsigned int group ) { }
 int snd_LoadSample( const char* fileName, Uint8 desiredChannels, bool loops ) { return 0; }
+int snd_CreateSample( const float* data, int numSamples, Uint8 numChannels, bool loops ) { return 0; }
 EntityID snd_Play( int sampleID, float volume, float pitch, float pan, unsigned int group ) { return 0; }
 void snd_ChangeSoundVolume( EntityID soundID, float volume ) { }
 void snd_ChangeSoundPitch( EntityID soundID, float pitch ) { }
@@ -328,6 +329,38 @@ clean_up:
 	return newIdx;
 }
 
+int snd_CreateSample( const float* data, int numSamples, Uint8 numChannels, bool loops )
+{
+	assert( ( numChannels >= 1 ) && ( numChannels <= 2 ) );
+	assert( data != NULL );
+
+	int newIdx = -1;
+	for( int i = 0; ( i < ARRAY_SIZE( samples ) ) && ( newIdx < 0 ); ++i ) {
+		if( samples[i].data == NULL ) {
+			newIdx = i;
+		}
+	}
+
+	if( newIdx < 0 ) {
+		llog( LOG_ERROR, "Unable to find free space for sample." );
+		return -1;
+	}
+
+	size_t size = numSamples * numChannels * sizeof( data[0] );
+	samples[newIdx].data = mem_Allocate( size );
+	if( samples[newIdx].data == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate memory for sample." );
+		return -1;
+	}
+	memcpy( samples[newIdx].data, data, size );
+
+	samples[newIdx].numChannels = numChannels;
+	samples[newIdx].numSamples = numSamples;
+	samples[newIdx].loops = loops;
+
+	return newIdx;
+}
+
 /* Sets up the SDL mixer. Returns 0 on success. */
 int snd_Init( unsigned int numGroups )
 {
@@ -4,7 +4,7 @@
 #include <stdbool.h>
 #include <SDL_types.h>
 
-#include "Utils\idSet.h"
+#include "Utils/idSet.h"
 
 // Sets up the SDL mixer. Returns 0 on success.
 int snd_Init( unsigned int numGroups );
@@ -22,6 +22,9 @@ void snd_SetVolume( float volume, unsigned int group );
 
 //***** Loaded all at once
 int snd_LoadSample( const char* fileName, Uint8 desiredChannels, bool loops );
+// Creates a sample from data that's already in the working format, 32-bit floats at 44100 Hz with the channels interleaved.
+//  The data is copied so it can be released after this is called. numSamples is the number of samples per channel.
+int snd_CreateSample( const float* data, int numSamples, Uint8 numChannels, bool loops );
 // Returns an id that can be used to change the volume and pitch
 //  volume - how loud the sound will be, in the range [0,1], 0 being off, 1 being loudest
 //  pitch - pitch change for the sound, multiplies the sample rate, 1 for normal, lesser for slower, higher for faster